@@ -0,0 +1,81 @@
+/**
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+#include <faiss/IndexHNSW.h>
+#include <faiss/IndexIVF.h>
+#include <faiss/index_factory.h>
+#include <faiss/utils/random.h>
+#include <faiss/utils/utils.h>
+
+/************************
+ * Measures the latency of searches with a single query. The indexes are
+ * small, so that the fixed cost of a search call (buffer allocations,
+ * scanner creation, parallel regions) is a significant part of the total.
+ * The per-query time of a batched search is given for reference.
+ */
+
+int main() {
+    using idx_t = faiss::idx_t;
+    int d = 64;
+    size_t nb = 20000;
+    size_t nq = 2000;
+    size_t k = 10;
+    std::vector<float> data((nb + nq) * d);
+    float* xb = data.data();
+    float* xq = data.data() + nb * d;
+    faiss::rand_smooth_vectors(nb + nq, d, data.data(), 1234);
+
+    const char* index_keys[] = {
+            "Flat", "IVF256,Flat", "IVF256,PQ16", "IVF256,SQ8", "HNSW32"};
+
+    for (const char* index_key : index_keys) {
+        std::unique_ptr<faiss::Index> index(
+                faiss::index_factory(d, index_key));
+        index->train(nb, xb);
+        index->add(nb, xb);
+        if (auto ivf = dynamic_cast<faiss::IndexIVF*>(index.get())) {
+            ivf->nprobe = 4;
+        }
+        if (auto hnsw = dynamic_cast<faiss::IndexHNSW*>(index.get())) {
+            hnsw->hnsw.efSearch = 32;
+        }
+
+        std::vector<float> D(nq * k);
+        std::vector<idx_t> I(nq * k);
+
+        double t0 = faiss::getmillisecs();
+        index->search(nq, xq, k, D.data(), I.data());
+        double t1 = faiss::getmillisecs();
+
+        // one query at a time
+        std::vector<double> times(nq);
+        for (size_t i = 0; i < nq; i++) {
+            double t2 = faiss::getmillisecs();
+            index->search(1, xq + i * d, k, D.data() + i * k, I.data() + i * k);
+            times[i] = faiss::getmillisecs() - t2;
+        }
+        std::sort(times.begin(), times.end());
+        double sum = 0;
+        for (double t : times) {
+            sum += t;
+        }
+
+        printf("%-14s batch: %7.2f us/query  single: mean %7.2f us "
+               "p50 %7.2f us p99 %7.2f us\n",
+               index_key,
+               (t1 - t0) * 1000 / nq,
+               sum * 1000 / nq,
+               times[nq / 2] * 1000,
+               times[nq * 99 / 100] * 1000);
+    }
+    return 0;
+}
@@ -46,6 +46,7 @@ DEFINE_GETTER(ClusteringIterationStats, double, time)
 DEFINE_GETTER(ClusteringIterationStats, double, time_search)
 DEFINE_GETTER(ClusteringIterationStats, double, imbalance_factor)
 DEFINE_GETTER(ClusteringIterationStats, int, nsplit)
+DEFINE_GETTER(ClusteringIterationStats, int64_t, ndis_skipped)
 
 void faiss_ClusteringParameters_init(FaissClusteringParameters* params) {
     ClusteringParameters d;
@@ -84,6 +84,7 @@ FAISS_DECLARE_GETTER(ClusteringIterationStats, double, time)
 FAISS_DECLARE_GETTER(ClusteringIterationStats, double, time_search)
 FAISS_DECLARE_GETTER(ClusteringIterationStats, double, imbalance_factor)
 FAISS_DECLARE_GETTER(ClusteringIterationStats, int, nsplit)
+FAISS_DECLARE_GETTER(ClusteringIterationStats, int64_t, ndis_skipped)
 
 /// getter for centroids (size = k * d)
 void faiss_Clustering_centroids(
@@ -26,6 +26,8 @@ typedef enum FaissQuantizerType {
     QT_fp16,
     QT_8bit_direct, ///< fast indexing of uint8s
     QT_6bit,        ///< 6 bits per component
+    QT_bf16,        ///< bfloat16 components, no training
+    QT_8bit_sym,    ///< int8 in [-vmax, vmax], shared range for all dims
 } FaissQuantizerType;
 
 // forward declaration
@@ -140,6 +140,8 @@ def reverse_index_factory(index):
             faiss.ScalarQuantizer.QT_4bit: "4",
             faiss.ScalarQuantizer.QT_6bit: "6",
             faiss.ScalarQuantizer.QT_fp16: "fp16",
+            faiss.ScalarQuantizer.QT_bf16: "bf16",
+            faiss.ScalarQuantizer.QT_8bit_sym: "8sym",
         }
         return f"SQ{sqtypes[index.sq.qtype]}"
 
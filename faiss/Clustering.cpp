@@ -11,16 +11,20 @@
 #include <faiss/VectorTransform.h>
 #include <faiss/impl/AuxIndexStructures.h>
 
+#include <algorithm>
 #include <cinttypes>
 #include <cmath>
 #include <cstdio>
 #include <cstring>
+#include <mutex>
+#include <string>
 
 #include <omp.h>
 #include <faiss/OMPConfig.h>
 
 #include <faiss/IndexFlat.h>
 #include <faiss/impl/FaissAssert.h>
+#include <faiss/impl/io.h>
 #include <faiss/impl/kmeans1d.h>
 #include <faiss/utils/distances.h>
 #include <faiss/utils/random.h>
@@ -251,6 +255,121 @@ int split_clusters(
     return nsplit;
 }
 
+/** Assignment with Hamerly's bounds.
+ *
+ * For each point, lower is a lower bound of the distance to the second
+ * nearest centroid. A point cannot change centroid if its distance to its
+ * centroid is below the lower bound, or below half the distance from its
+ * centroid to the nearest other centroid: either test is sufficient. The
+ * other points are assigned with the index (k = 2 to refresh the lower
+ * bound).
+ *
+ * @param prev_centroids  centroids of the previous assignment, or NULL to
+ *                        assign all points and initialize the bounds
+ * @param lower           lower bounds (not squared), size n, in/out
+ * @param dis             squared distance to the centroid, size n, out
+ * @param assign          assigned centroid, size n, in/out
+ * @return                nb of point-to-centroid distances skipped
+ */
+int64_t bounded_assign(
+        size_t d,
+        size_t k,
+        idx_t n,
+        const float* x,
+        Index& index,
+        const float* centroids,
+        const float* prev_centroids,
+        float* lower,
+        float* dis,
+        idx_t* assign) {
+    std::vector<idx_t> todo;
+    int64_t nskip = 0;
+
+    if (prev_centroids) {
+        // centroid shifts, the lower bounds decrease by the largest shift
+        // among the other centroids
+        std::vector<float> shift(k);
+        size_t cmax = 0;
+        for (size_t c = 0; c < k; c++) {
+            shift[c] = sqrtf(fvec_L2sqr(
+                    centroids + c * d, prev_centroids + c * d, d));
+            if (shift[c] > shift[cmax]) {
+                cmax = c;
+            }
+        }
+        float shift2 = 0;
+        for (size_t c = 0; c < k; c++) {
+            if (c != cmax) {
+                shift2 = std::max(shift2, shift[c]);
+            }
+        }
+
+        // half distance from each centroid to its nearest neighbor
+        std::vector<float> half_nn(k);
+        {
+            IndexFlatL2 cindex(d);
+            cindex.add(k, centroids);
+            std::vector<float> cD(2 * k);
+            std::vector<idx_t> cI(2 * k);
+            cindex.search(k, centroids, 2, cD.data(), cI.data());
+            for (size_t c = 0; c < k; c++) {
+                half_nn[c] = sqrtf(std::max(cD[2 * c + 1], 0.0f)) / 2;
+            }
+        }
+
+        std::vector<uint8_t> skip(n);
+#pragma omp parallel for reduction(+ : nskip) num_threads(num_omp_threads)
+        for (idx_t i = 0; i < n; i++) {
+            idx_t a = assign[i];
+            lower[i] -= a == cmax ? shift2 : shift[cmax];
+            dis[i] = fvec_L2sqr(x + i * d, centroids + a * d, d);
+            float upper = sqrtf(dis[i]);
+            if (upper <= std::max(half_nn[a], lower[i])) {
+                skip[i] = 1;
+                nskip += k - 1;
+            }
+        }
+        for (idx_t i = 0; i < n; i++) {
+            if (!skip[i]) {
+                todo.push_back(i);
+            }
+        }
+    } else {
+        todo.resize(n);
+        for (idx_t i = 0; i < n; i++) {
+            todo[i] = i;
+        }
+    }
+
+    // assign the remaining points by blocks
+    size_t bs = 32768;
+    std::vector<float> xb(std::min(todo.size(), bs) * d);
+    std::vector<float> D(2 * bs);
+    std::vector<idx_t> I(2 * bs);
+    for (size_t i0 = 0; i0 < todo.size(); i0 += bs) {
+        size_t i1 = std::min(i0 + bs, todo.size());
+        const float* xi;
+        if (i1 - i0 == size_t(n)) {
+            xi = x; // all points, no copy
+        } else {
+            for (size_t i = i0; i < i1; i++) {
+                memcpy(xb.data() + (i - i0) * d,
+                       x + todo[i] * d,
+                       sizeof(float) * d);
+            }
+            xi = xb.data();
+        }
+        index.search(i1 - i0, xi, 2, D.data(), I.data());
+        for (size_t i = i0; i < i1; i++) {
+            idx_t j = todo[i];
+            assign[j] = I[2 * (i - i0)];
+            dis[j] = D[2 * (i - i0)];
+            lower[j] = sqrtf(std::max(D[2 * (i - i0) + 1], 0.0f));
+        }
+    }
+    return nskip;
+}
+
 } // namespace
 
 void Clustering::train_encoded(
@@ -279,6 +398,10 @@ void Clustering::train_encoded(
             int(index.d),
             int(d));
 
+    FAISS_THROW_IF_NOT_MSG(
+            !bounded_assignment || (!codec && index.metric_type == METRIC_L2),
+            "bounded assignment requires float vectors and the L2 metric");
+
     double t0 = getmillisecs();
 
     if (!codec) {
@@ -358,6 +481,12 @@ void Clustering::train_encoded(
     std::unique_ptr<idx_t[]> assign(new idx_t[nx]);
     std::unique_ptr<float[]> dis(new float[nx]);
 
+    // lower bounds and centroids of the last assignment for
+    // bounded_assignment
+    bool use_bounds = bounded_assignment && k > 1;
+    std::vector<float> lower(use_bounds ? nx : 0);
+    std::vector<float> assigned_centroids;
+
     // remember best iteration for redo
     bool lower_is_better = !is_similarity_metric(index.metric_type);
     float best_obj = lower_is_better ? HUGE_VALF : -HUGE_VALF;
@@ -427,8 +556,22 @@ void Clustering::train_encoded(
         float obj = 0;
         for (int i = 0; i < niter; i++) {
             double t0s = getmillisecs();
+            int64_t ndis_skipped = 0;
 
-            if (!codec) {
+            if (use_bounds) {
+                ndis_skipped = bounded_assign(
+                        d,
+                        k,
+                        nx,
+                        reinterpret_cast<const float*>(x),
+                        index,
+                        centroids.data(),
+                        i == 0 ? nullptr : assigned_centroids.data(),
+                        lower.data(),
+                        dis.get(),
+                        assign.get());
+                assigned_centroids = centroids;
+            } else if (!codec) {
                 index.search(
                         nx,
                         reinterpret_cast<const float*>(x),
@@ -488,7 +631,8 @@ void Clustering::train_encoded(
                     (getmillisecs() - t0) / 1000.0,
                     t_search_tot / 1000,
                     imbalance_factor(nx, k, assign.get()),
-                    nsplit};
+                    nsplit,
+                    ndis_skipped};
             iteration_stats.push_back(stats);
 
             if (verbose) {
@@ -539,6 +683,207 @@ void Clustering::train_encoded(
     }
 }
 
+/******************************************************************************
+ * Mini-batch k-means
+ ******************************************************************************/
+
+ClusteringArraySource::ClusteringArraySource(
+        size_t n,
+        size_t d,
+        const float* x)
+        : n(n), d(d), x(x) {}
+
+size_t ClusteringArraySource::next_batch(size_t nb, float* xb) {
+    nb = std::min(nb, n - i);
+    memcpy(xb, x + i * d, sizeof(float) * nb * d);
+    i += nb;
+    return nb;
+}
+
+bool ClusteringArraySource::rewind() {
+    i = 0;
+    return true;
+}
+
+ClusteringIOReaderSource::ClusteringIOReaderSource(IOReader* reader, size_t d)
+        : reader(reader), d(d) {}
+
+size_t ClusteringIOReaderSource::next_batch(size_t nb, float* xb) {
+    size_t nread = 0;
+    // readers may return partial batches
+    while (nread < nb) {
+        size_t r = (*reader)(xb + nread * d, sizeof(float) * d, nb - nread);
+        if (r == 0) {
+            break;
+        }
+        nread += r;
+    }
+    return nread;
+}
+
+namespace {
+
+/// fill a batch, rewinding the source at the end of the data if possible
+size_t read_batch(
+        ClusteringBatchSource& source,
+        size_t n,
+        float* x,
+        size_t d) {
+    size_t nread = source.next_batch(n, x);
+    if (nread < n && source.rewind()) {
+        nread += source.next_batch(n - nread, x + nread * d);
+    }
+    return nread;
+}
+
+} // namespace
+
+void Clustering::train_minibatch(ClusteringBatchSource& source, Index& index) {
+    FAISS_THROW_IF_NOT_FMT(
+            index.d == d,
+            "Index dimension %d not the same as data dimension %d",
+            int(index.d),
+            int(d));
+    FAISS_THROW_IF_NOT(minibatch_size > 0);
+    FAISS_THROW_IF_NOT_MSG(
+            centroids.size() % d == 0,
+            "size of provided input centroids not a multiple of dimension");
+
+    double t0 = getmillisecs();
+    size_t bs = std::max(minibatch_size, k);
+    std::vector<float> batch(bs * d);
+    std::vector<idx_t> assign(bs);
+    std::vector<float> dis(bs);
+
+    size_t n_input_centroids = centroids.size() / d;
+    size_t k_frozen = frozen_centroids ? n_input_centroids : 0;
+
+    // initialize the remaining centroids with the first vectors of the
+    // stream
+    centroids.resize(k * d);
+    size_t nb = 0;
+    if (n_input_centroids < k) {
+        size_t nmissing = k - n_input_centroids;
+        nb = read_batch(source, bs, batch.data(), d);
+        FAISS_THROW_IF_NOT_FMT(
+                nb >= nmissing,
+                "Number of training points (%zd) should be at least "
+                "as large as number of clusters (%zd)",
+                nb + n_input_centroids,
+                k);
+        memcpy(centroids.data() + n_input_centroids * d,
+               batch.data(),
+               sizeof(float) * nmissing * d);
+    }
+    post_process_centroids();
+
+    if (verbose) {
+        printf("Mini-batch clustering in %zdD to %zd clusters, "
+               "%d batches of %zd vectors\n",
+               d,
+               k,
+               minibatch_niter,
+               bs);
+    }
+
+    if (index.ntotal != 0) {
+        index.reset();
+    }
+    if (!index.is_trained) {
+        index.train(k, centroids.data());
+    }
+    index.add(k, centroids.data());
+
+    // nb of vectors assigned to each centroid so far
+    std::vector<double> counts(k);
+    std::vector<float> batch_centroids(k * d);
+    std::vector<float> hassign(k);
+    double t_search_tot = 0;
+
+    for (int it = 0; it < minibatch_niter; it++) {
+        if (nb == 0) {
+            nb = read_batch(source, bs, batch.data(), d);
+            if (nb == 0) {
+                break; // end of data
+            }
+        }
+
+        double t0s = getmillisecs();
+        index.search(nb, batch.data(), 1, dis.data(), assign.data());
+        InterruptCallback::check();
+        t_search_tot += getmillisecs() - t0s;
+
+        float obj = 0;
+        for (size_t j = 0; j < nb; j++) {
+            obj += dis[j];
+        }
+
+        // per-centroid mean of the batch vectors
+        std::fill(hassign.begin(), hassign.end(), 0);
+        compute_centroids(
+                d,
+                k,
+                nb,
+                k_frozen,
+                reinterpret_cast<const uint8_t*>(batch.data()),
+                nullptr,
+                assign.data(),
+                nullptr,
+                hassign.data(),
+                batch_centroids.data());
+
+        // c += nj / (n_c + nj) * (batch_mean - c): same as applying the
+        // per-vector updates with learning rate 1 / n_c in sequence
+#pragma omp parallel for num_threads(num_omp_threads)
+        for (idx_t ci = k_frozen; ci < k; ci++) {
+            float nj = hassign[ci - k_frozen];
+            if (nj == 0) {
+                continue;
+            }
+            counts[ci] += nj;
+            float eta = nj / counts[ci];
+            float* c = centroids.data() + ci * d;
+            // compute_centroids leaves the frozen centroids in place
+            const float* m = batch_centroids.data() + ci * d;
+            for (size_t j = 0; j < d; j++) {
+                c[j] += eta * (m[j] - c[j]);
+            }
+        }
+
+        post_process_centroids();
+
+        ClusteringIterationStats stats = {
+                obj,
+                (getmillisecs() - t0) / 1000.0,
+                t_search_tot / 1000,
+                imbalance_factor(nb, k, assign.data()),
+                0};
+        iteration_stats.push_back(stats);
+
+        if (verbose) {
+            printf("  Batch %d (%.2f s, search %.2f s): "
+                   "objective=%g imbalance=%.3f       \r",
+                   it,
+                   stats.time,
+                   stats.time_search,
+                   stats.obj,
+                   stats.imbalance_factor);
+            fflush(stdout);
+        }
+
+        index.reset();
+        if (update_index) {
+            index.train(k, centroids.data());
+        }
+        index.add(k, centroids.data());
+        InterruptCallback::check();
+        nb = 0;
+    }
+    if (verbose) {
+        printf("\n");
+    }
+}
+
 Clustering1D::Clustering1D(int k) : Clustering(1, k) {}
 
 Clustering1D::Clustering1D(int k, const ClusteringParameters& cp)
@@ -682,4 +1027,348 @@ void ProgressiveDimClustering::train(
     }
 }
 
+/******************************************************************************
+ * HierarchicalClustering implementation
+ ******************************************************************************/
+
+HierarchicalClustering::HierarchicalClustering(int d, int k) : d(d), k(k) {}
+
+HierarchicalClustering::HierarchicalClustering(
+        int d,
+        int k,
+        const HierarchicalClusteringParameters& cp)
+        : HierarchicalClusteringParameters(cp), d(d), k(k) {}
+
+namespace {
+
+/// split k into per-group counts proportional to the group sizes, with at
+/// most group size centroids per group
+std::vector<size_t> allocate_subclusters(
+        const std::vector<size_t>& sizes,
+        size_t k,
+        bool proportional) {
+    size_t ng = sizes.size();
+    size_t n = 0;
+    for (size_t s : sizes) {
+        n += s;
+    }
+    std::vector<size_t> alloc(ng);
+    std::vector<double> frac(ng);
+    size_t tot = 0;
+    for (size_t i = 0; i < ng; i++) {
+        double target = proportional ? double(k) * sizes[i] / n
+                                     : double(k) / ng;
+        alloc[i] = std::min(size_t(target), sizes[i]);
+        frac[i] = target - alloc[i];
+        tot += alloc[i];
+    }
+    // distribute the remaining centroids by decreasing fractional part
+    std::vector<size_t> order(ng);
+    for (size_t i = 0; i < ng; i++) {
+        order[i] = i;
+    }
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return frac[a] > frac[b];
+    });
+    while (tot < k) {
+        size_t tot0 = tot;
+        for (size_t i = 0; i < ng && tot < k; i++) {
+            size_t g = order[i];
+            if (alloc[g] < sizes[g]) {
+                alloc[g]++;
+                tot++;
+            }
+        }
+        FAISS_THROW_IF_NOT(tot > tot0);
+    }
+    return alloc;
+}
+
+/** assign the points to centroids so that no centroid gets more than
+ * capacity points. Points with the largest loss if not assigned to their
+ * nearest centroid are assigned first. Returns the nb of points that could
+ * not be assigned to any of their candidates (they are assigned to the
+ * nearest candidate). */
+size_t balanced_assignment(
+        size_t n,
+        size_t nprobe,
+        const float* D,
+        const idx_t* I,
+        size_t k,
+        size_t capacity,
+        bool is_similarity,
+        idx_t* assign) {
+    std::vector<float> regret(n);
+    for (size_t i = 0; i < n; i++) {
+        float gap = nprobe > 1 ? D[i * nprobe + 1] - D[i * nprobe] : 0;
+        regret[i] = is_similarity ? -gap : gap;
+    }
+    std::vector<idx_t> order(n);
+    for (size_t i = 0; i < n; i++) {
+        order[i] = i;
+    }
+    std::sort(order.begin(), order.end(), [&](idx_t a, idx_t b) {
+        return regret[a] > regret[b];
+    });
+    std::vector<size_t> fill(k);
+    size_t nfail = 0;
+    for (idx_t i : order) {
+        const idx_t* Ii = I + i * nprobe;
+        idx_t c = -1;
+        for (size_t j = 0; j < nprobe && Ii[j] >= 0; j++) {
+            if (fill[Ii[j]] < capacity) {
+                c = Ii[j];
+                break;
+            }
+        }
+        if (c < 0) {
+            c = Ii[0];
+            nfail++;
+        }
+        fill[c]++;
+        assign[i] = c;
+    }
+    return nfail;
+}
+
+/** balancing iterations on the points of a group: capacity-constrained
+ * assignment followed by a centroid update. Fills the objective, the nb
+ * of points assigned beyond capacity and the sizes of the clusters with
+ * the nearest-centroid assignment at each iteration. */
+void balance_clusters(
+        size_t d,
+        size_t n,
+        const float* x,
+        size_t k,
+        float* centroids,
+        size_t capacity,
+        size_t nprobe,
+        int niter,
+        MetricType metric,
+        bool spherical,
+        double* obj,
+        size_t* nfail,
+        int* hist,
+        size_t hist_stride) {
+    nprobe = std::min(nprobe, k);
+    std::vector<float> D(n * nprobe);
+    std::vector<idx_t> I(n * nprobe);
+    std::vector<idx_t> assign(n);
+    std::vector<float> hassign(k);
+    std::vector<float> new_centroids(k * d);
+
+    for (int it = 0; it < niter; it++) {
+        IndexFlat index(d, metric);
+        index.add(k, centroids);
+        index.search(n, x, nprobe, D.data(), I.data());
+        InterruptCallback::check();
+
+        int* h = hist + it * hist_stride;
+        for (size_t i = 0; i < n; i++) {
+            obj[it] += D[i * nprobe];
+            h[I[i * nprobe]]++;
+        }
+
+        nfail[it] = balanced_assignment(
+                n,
+                nprobe,
+                D.data(),
+                I.data(),
+                k,
+                capacity,
+                is_similarity_metric(metric),
+                assign.data());
+
+        std::fill(hassign.begin(), hassign.end(), 0);
+        compute_centroids(
+                d,
+                k,
+                n,
+                0,
+                reinterpret_cast<const uint8_t*>(x),
+                nullptr,
+                assign.data(),
+                nullptr,
+                hassign.data(),
+                new_centroids.data());
+        // centroids that got no points are left in place
+        for (size_t c = 0; c < k; c++) {
+            if (hassign[c] > 0) {
+                memcpy(centroids + c * d,
+                       new_centroids.data() + c * d,
+                       sizeof(float) * d);
+            }
+        }
+        if (spherical) {
+            fvec_renorm_L2(d, k, centroids);
+        }
+    }
+}
+
+} // namespace
+
+void HierarchicalClustering::train(idx_t n, const float* x) {
+    FAISS_THROW_IF_NOT_FMT(
+            n >= k,
+            "Number of training points (%" PRId64
+            ") should be at least "
+            "as large as number of clusters (%zd)",
+            n,
+            k);
+    size_t nc1_eff = nc1 > 0 ? nc1 : size_t(std::sqrt(double(k)) + 0.5);
+    nc1_eff = std::max(std::min(nc1_eff, k), size_t(1));
+    MetricType metric = spherical ? METRIC_INNER_PRODUCT : METRIC_L2;
+    double t0 = getmillisecs();
+
+    // first level
+    if (verbose) {
+        printf("Hierarchical clustering of %" PRId64
+               " points in %zdD to %zd x ~%zd clusters\n",
+               n,
+               d,
+               nc1_eff,
+               k / nc1_eff);
+    }
+    std::vector<float> centroids1;
+    {
+        Clustering clus(d, nc1_eff, *this);
+        IndexFlat index(d, metric);
+        clus.train(n, x, index);
+        centroids1 = clus.centroids;
+        iteration_stats = clus.iteration_stats;
+    }
+
+    std::vector<idx_t> assign1(n);
+    {
+        IndexFlat index(d, metric);
+        index.add(nc1_eff, centroids1.data());
+        std::vector<float> dis(n);
+        index.search(n, x, 1, dis.data(), assign1.data());
+    }
+
+    // group the points by first-level cluster
+    std::vector<size_t> sizes(nc1_eff), lims(nc1_eff + 1);
+    for (idx_t i = 0; i < n; i++) {
+        sizes[assign1[i]]++;
+    }
+    for (size_t c = 0; c < nc1_eff; c++) {
+        lims[c + 1] = lims[c] + sizes[c];
+    }
+    std::vector<idx_t> perm(n);
+    {
+        std::vector<size_t> ofs(lims.begin(), lims.end() - 1);
+        for (idx_t i = 0; i < n; i++) {
+            perm[ofs[assign1[i]]++] = i;
+        }
+    }
+    std::vector<size_t> nc2 = allocate_subclusters(sizes, k, rebalance);
+    std::vector<size_t> c2_offsets(nc1_eff + 1);
+    for (size_t c = 0; c < nc1_eff; c++) {
+        c2_offsets[c + 1] = c2_offsets[c] + nc2[c];
+    }
+
+    if (verbose) {
+        printf("  first level done in %.2f s, sub-clustering\n",
+               (getmillisecs() - t0) / 1000);
+    }
+
+    // second level, largest groups first for load balancing
+    std::vector<size_t> order(nc1_eff);
+    for (size_t c = 0; c < nc1_eff; c++) {
+        order[c] = c;
+    }
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return sizes[a] * nc2[a] > sizes[b] * nc2[b];
+    });
+
+    centroids.resize(k * d);
+    std::string exception_string;
+    std::mutex exception_mutex;
+
+    // balancing is done within each group, with a global capacity
+    bool balance = max_size_factor > 0 && balance_niter > 0;
+    size_t capacity = size_t(std::ceil(max_size_factor * double(n) / k));
+    size_t niter_b = balance ? balance_niter : 0;
+    std::vector<double> balance_obj(nc1_eff * niter_b);
+    std::vector<size_t> balance_nfail(nc1_eff * niter_b);
+    std::vector<int> hist(niter_b * k);
+
+#pragma omp parallel for schedule(dynamic) num_threads(num_omp_threads)
+    for (idx_t o = 0; o < nc1_eff; o++) {
+        size_t c = order[o];
+        if (nc2[c] == 0) {
+            continue;
+        }
+        try {
+            std::vector<float> xsub(sizes[c] * d);
+            for (size_t i = lims[c]; i < lims[c + 1]; i++) {
+                memcpy(xsub.data() + (i - lims[c]) * d,
+                       x + perm[i] * d,
+                       sizeof(float) * d);
+            }
+            ClusteringParameters cp = *this;
+            cp.verbose = false;
+            cp.seed = seed + 1 + c;
+            // the groups are processed in parallel, avoid the warning
+            cp.min_points_per_centroid = 1;
+            Clustering clus(d, nc2[c], cp);
+            IndexFlat index(d, metric);
+            clus.train(sizes[c], xsub.data(), index);
+            float* cent = centroids.data() + c2_offsets[c] * d;
+            memcpy(cent, clus.centroids.data(), sizeof(float) * nc2[c] * d);
+            if (balance) {
+                balance_clusters(
+                        d,
+                        sizes[c],
+                        xsub.data(),
+                        nc2[c],
+                        cent,
+                        capacity,
+                        balance_nprobe,
+                        balance_niter,
+                        metric,
+                        spherical,
+                        balance_obj.data() + c * niter_b,
+                        balance_nfail.data() + c * niter_b,
+                        hist.data() + c2_offsets[c],
+                        k);
+            }
+        } catch (const std::exception& e) {
+            std::lock_guard<std::mutex> lock(exception_mutex);
+            exception_string = e.what();
+        }
+    }
+    if (!exception_string.empty()) {
+        FAISS_THROW_MSG(exception_string.c_str());
+    }
+
+    for (size_t it = 0; it < niter_b; it++) {
+        double obj = 0;
+        size_t nfail = 0;
+        for (size_t c = 0; c < nc1_eff; c++) {
+            obj += balance_obj[c * niter_b + it];
+            nfail += balance_nfail[c * niter_b + it];
+        }
+        const int* h = hist.data() + it * k;
+        double tot = 0, uf = 0;
+        for (size_t c = 0; c < k; c++) {
+            tot += h[c];
+            uf += h[c] * double(h[c]);
+        }
+        // imbalance of the assignment to the nearest centroid of the group
+        ClusteringIterationStats stats = {
+                float(obj),
+                (getmillisecs() - t0) / 1000.0,
+                0.0,
+                uf * k / (tot * tot),
+                int(nfail)};
+        iteration_stats.push_back(stats);
+    }
+
+    if (verbose) {
+        printf("  second level done in %.2f s\n",
+               (getmillisecs() - t0) / 1000);
+    }
+}
+
 } // namespace faiss
@@ -48,6 +48,56 @@ struct ClusteringParameters {
 
     /// when the training set is encoded, batch size of the codec decoder
     size_t decode_block_size = 32768;
+
+    /** Hamerly's bounds on the distances (Hamerly, "Making k-means even
+     * faster", SDM'10) to skip the assignment of points that cannot change
+     * centroid. Requires the L2 metric and float training vectors. The
+     * assignment of the remaining points is done by the index, which
+     * should be exact. */
+    bool bounded_assignment = false;
+
+    /// nb of training vectors per batch for train_minibatch
+    size_t minibatch_size = 16384;
+    /// nb of batches processed by train_minibatch (niter is not used)
+    int minibatch_niter = 200;
+};
+
+struct IOReader;
+
+/** Source of training vectors for the mini-batch k-means. The vectors are
+ * read sequentially, so they should be in random order. */
+struct ClusteringBatchSource {
+    /// read up to n vectors into x (size n * d), returns the nb of vectors
+    /// read, 0 at the end of the data
+    virtual size_t next_batch(size_t n, float* x) = 0;
+
+    /// restart from the beginning of the data. Returns false if the source
+    /// cannot be rewound (single pass)
+    virtual bool rewind() {
+        return false;
+    }
+
+    virtual ~ClusteringBatchSource() {}
+};
+
+/// batches from an array in RAM (not owned)
+struct ClusteringArraySource : ClusteringBatchSource {
+    size_t n, d;
+    const float* x;
+    size_t i = 0; ///< next vector to read
+
+    ClusteringArraySource(size_t n, size_t d, const float* x);
+    size_t next_batch(size_t nb, float* xb) override;
+    bool rewind() override;
+};
+
+/// batches of raw float32 vectors from an IOReader (single pass)
+struct ClusteringIOReaderSource : ClusteringBatchSource {
+    IOReader* reader; ///< not owned
+    size_t d;
+
+    ClusteringIOReaderSource(IOReader* reader, size_t d);
+    size_t next_batch(size_t nb, float* xb) override;
 };
 
 struct ClusteringIterationStats {
@@ -56,6 +106,8 @@ struct ClusteringIterationStats {
     double time_search;      ///< seconds for just search
     double imbalance_factor; ///< imbalance factor of iteration
     int nsplit;              ///< number of cluster splits
+    /// nb of point-to-centroid distances skipped by bounded_assignment
+    int64_t ndis_skipped = 0;
 };
 
 /** K-means clustering based on assignment - centroid update iterations
@@ -113,6 +165,21 @@ struct Clustering : ClusteringParameters {
             Index& index,
             const float* weights = nullptr);
 
+    /** run mini-batch k-means (Sculley, "Web-Scale K-Means Clustering",
+     * WWW'10) on vectors streamed from a source.
+     *
+     * Each iteration reads minibatch_size vectors and assigns them with the
+     * index. Each centroid moves towards the mean of its assigned vectors
+     * with a learning rate 1 / (nb of vectors assigned to it so far), so
+     * the centroid is the running mean of all the vectors it got. The
+     * memory usage is that of one batch.
+     *
+     * The centroids are initialized with the first k vectors of the
+     * source, unless provided on input. The iteration stats are computed
+     * on each batch.
+     */
+    void train_minibatch(ClusteringBatchSource& source, Index& index);
+
     /// Post-process the centroids after each centroid update.
     /// includes optional L2 normalization and nearest integer rounding
     void post_process_centroids();
@@ -183,6 +250,58 @@ struct ProgressiveDimClustering : ProgressiveDimClusteringParameters {
     virtual ~ProgressiveDimClustering() {}
 };
 
+struct HierarchicalClusteringParameters : ClusteringParameters {
+    /// nb of first-level clusters (0 = sqrt(k))
+    int nc1 = 0;
+    /// allocate the second-level centroids proportionally to the sizes of
+    /// the first-level clusters (otherwise evenly)
+    bool rebalance = true;
+    /// if > 0, balance the final clusters with a capacity of
+    /// max_size_factor * n / k training points per cluster
+    float max_size_factor = 0;
+    /// nb of candidate centroids per point for the balanced assignment
+    int balance_nprobe = 8;
+    /// nb of balanced assignment - centroid update iterations
+    int balance_niter = 10;
+};
+
+/** Two-level k-means for large k
+ *
+ * The training set is clustered into nc1 groups, then each group is
+ * clustered independently into a number of sub-clusters. The groups are
+ * processed in parallel, so the cost of an iteration is O(n * (nc1 +
+ * k / nc1) * d) instead of O(n * k * d).
+ *
+ * Optionally, a balancing stage iterates, within each group, a
+ * capacity-constrained assignment of the points to their nearest centroids
+ * followed by a centroid update. This shrinks the largest clusters, and
+ * hence the longest inverted lists when the centroids are used as IVF
+ * coarse quantizer. The iteration stats of the balancing stage record the
+ * imbalance factor of the nearest-centroid assignment and, in nsplit, the
+ * nb of points that did not fit in any of their candidate clusters.
+ */
+struct HierarchicalClustering : HierarchicalClusteringParameters {
+    size_t d; ///< dimension of the vectors
+    size_t k; ///< nb of centroids
+
+    /** centroids (k * d) */
+    std::vector<float> centroids;
+
+    /// stats of the first-level clustering and the balancing stage
+    std::vector<ClusteringIterationStats> iteration_stats;
+
+    HierarchicalClustering(int d, int k);
+    HierarchicalClustering(
+            int d,
+            int k,
+            const HierarchicalClusteringParameters& cp);
+
+    /// the assignment uses L2 distance (inner product if spherical)
+    void train(idx_t n, const float* x);
+
+    virtual ~HierarchicalClustering() {}
+};
+
 /** simplified interface
  *
  * @param d dimension of the data
@@ -38,11 +38,13 @@
 
 namespace faiss {
 
-/// Forward declarations see impl/AuxIndexStructures.h, impl/IDSelector.h and
-/// impl/DistanceComputer.h
+/// Forward declarations see impl/AuxIndexStructures.h, impl/IDSelector.h,
+/// impl/DistanceComputer.h and utils/Heap.h
 struct IDSelector;
 struct RangeSearchResult;
 struct DistanceComputer;
+struct SharedKnnBounds;
+struct SearchStats;
 
 /** Parent class for the optional search paramenters.
  *
@@ -52,6 +54,17 @@ struct DistanceComputer;
 struct SearchParameters {
     /// if non-null, only these IDs will be considered during search.
     IDSelector* sel = nullptr;
+    /// if < 1, the top-k results may be collected with an approximate
+    /// selection that reaches this expected recall (supported by IndexFlat
+    /// and IndexIVF)
+    float approx_topk_recall = 1;
+    /// if non-null, the k-th result distances are shared with searches on
+    /// other parts of the dataset to skip results that can not be in the
+    /// merged top-k (supported by IndexIVF)
+    SharedKnnBounds* shared_bounds = nullptr;
+    /// if non-null, per-query costs of the search are collected here
+    /// (supported by IndexIVF, IndexHNSW and IndexFlat)
+    SearchStats* stats = nullptr;
     /// make sure we can dynamic_cast this
     virtual ~SearchParameters() {}
 };
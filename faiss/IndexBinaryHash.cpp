@@ -9,8 +9,11 @@
 
 #include <faiss/IndexBinaryHash.h>
 
+#include <algorithm>
 #include <cinttypes>
+#include <cmath>
 #include <cstdio>
+#include <cstring>
 #include <memory>
 #include <unordered_set>
 
@@ -479,4 +482,362 @@ size_t IndexBinaryMultiHash::hashtable_size() const {
     return tot;
 }
 
+/*******************************************************
+ * IndexBinaryMIH implementation
+ ******************************************************/
+
+void IndexBinaryMIH::Table::add(
+        size_t n,
+        const uint64_t* new_keys,
+        const idx_t* new_ids) {
+    std::vector<size_t> perm(n);
+    for (size_t i = 0; i < n; i++) {
+        perm[i] = i;
+    }
+    std::stable_sort(perm.begin(), perm.end(), [&](size_t a, size_t b) {
+        return new_keys[a] < new_keys[b];
+    });
+
+    // merge the sorted new entries with the existing table
+    std::vector<uint64_t> keys2;
+    std::vector<size_t> offsets2;
+    std::vector<idx_t> ids2;
+    keys2.reserve(keys.size() + n);
+    offsets2.reserve(keys.size() + n + 1);
+    ids2.reserve(ids.size() + n);
+
+    size_t i = 0, p = 0;
+    while (i < keys.size() || p < n) {
+        uint64_t key;
+        if (p == n || (i < keys.size() && keys[i] <= new_keys[perm[p]])) {
+            key = keys[i];
+        } else {
+            key = new_keys[perm[p]];
+        }
+        keys2.push_back(key);
+        offsets2.push_back(ids2.size());
+        if (i < keys.size() && keys[i] == key) {
+            ids2.insert(
+                    ids2.end(),
+                    ids.begin() + offsets[i],
+                    ids.begin() + offsets[i + 1]);
+            i++;
+        }
+        while (p < n && new_keys[perm[p]] == key) {
+            ids2.push_back(new_ids[perm[p]]);
+            p++;
+        }
+    }
+    offsets2.push_back(ids2.size());
+
+    keys.swap(keys2);
+    offsets.swap(offsets2);
+    ids.swap(ids2);
+}
+
+void IndexBinaryMIH::Table::lookup(
+        uint64_t key,
+        const idx_t*& begin,
+        const idx_t*& end) const {
+    auto it = std::lower_bound(keys.begin(), keys.end(), key);
+    if (it == keys.end() || *it != key) {
+        begin = end = nullptr;
+        return;
+    }
+    size_t i = it - keys.begin();
+    begin = ids.data() + offsets[i];
+    end = ids.data() + offsets[i + 1];
+}
+
+IndexBinaryMIH::IndexBinaryMIH(int d, int m)
+        : IndexBinary(d), m(m), tables(m), sub_offsets(m + 1) {
+    FAISS_THROW_IF_NOT(m > 0 && m <= d);
+    FAISS_THROW_IF_NOT_MSG(
+            (d + m - 1) / m <= 32, "substrings should be at most 32 bits");
+    sub_offsets[0] = 0;
+    for (int i = 0; i < m; i++) {
+        // the first d % m substrings have one more bit
+        sub_offsets[i + 1] = sub_offsets[i] + d / m + (i < d % m ? 1 : 0);
+    }
+    is_trained = true;
+}
+
+IndexBinaryMIH::IndexBinaryMIH() {
+    is_trained = true;
+}
+
+void IndexBinaryMIH::reset() {
+    xb.clear();
+    for (auto& t : tables) {
+        t = Table();
+    }
+    ntotal = 0;
+}
+
+void IndexBinaryMIH::get_substrings(const uint8_t* code, uint64_t* subs)
+        const {
+    BitstringReader rd(code, code_size);
+    for (int i = 0; i < m; i++) {
+        subs[i] = rd.read(sub_offsets[i + 1] - sub_offsets[i]);
+    }
+}
+
+void IndexBinaryMIH::add(idx_t n, const uint8_t* x) {
+    std::vector<uint64_t> subs(n * m);
+    for (idx_t i = 0; i < n; i++) {
+        get_substrings(x + i * code_size, subs.data() + i * m);
+    }
+    std::vector<idx_t> ids(n);
+    for (idx_t i = 0; i < n; i++) {
+        ids[i] = ntotal + i;
+    }
+
+#pragma omp parallel for if (n > 1000) num_threads(num_omp_threads)
+    for (int h = 0; h < m; h++) {
+        std::vector<uint64_t> keys(n);
+        for (idx_t i = 0; i < n; i++) {
+            keys[i] = subs[i * m + h];
+        }
+        tables[h].add(n, keys.data(), ids.data());
+    }
+    xb.insert(xb.end(), x, x + n * code_size);
+    ntotal += n;
+}
+
+void IndexBinaryMIH::reconstruct(idx_t key, uint8_t* recons) const {
+    FAISS_THROW_IF_NOT(key >= 0 && key < ntotal);
+    memcpy(recons, xb.data() + key * code_size, code_size);
+}
+
+size_t IndexBinaryMIH::hashtable_size() const {
+    size_t tot = 0;
+    for (const auto& t : tables) {
+        tot += t.keys.size();
+    }
+    return tot;
+}
+
+namespace {
+
+// knn search can stop when all results within radius R are found and the
+// heap is full with distances <= R
+inline bool mih_done(const KnnSearchResults& res, int R) {
+    return res.heap_sim[0] <= R;
+}
+
+inline bool mih_done(const RangeSearchResults&, int) {
+    return false;
+}
+
+template <class HammingComputer, class SearchResults>
+void search_1_query_mih(
+        const IndexBinaryMIH* pindex,
+        const uint8_t* q,
+        int max_R,
+        SearchResults* pres,
+        VisitedTable* pvisited,
+        size_t* pn0,
+        size_t* pnlist,
+        size_t* pndis) {
+    // passed as pointers because dispatch_HammingComputer copies its
+    // arguments
+    const IndexBinaryMIH& index = *pindex;
+    SearchResults& res = *pres;
+    VisitedTable& visited = *pvisited;
+    size_t &n0 = *pn0, &nlist = *pnlist, &ndis = *pndis;
+    size_t code_size = index.code_size;
+    int m = index.m;
+    HammingComputer hc(q, code_size);
+    std::vector<uint64_t> qsubs(m);
+    index.get_substrings(q, qsubs.data());
+    // the table is shared by the queries of a thread
+    visited.advance();
+
+    // for the tables where a ring is larger than the table, the keys are
+    // sorted by distance to the query substring (counting sort)
+    std::vector<std::vector<size_t>> by_dis(m), by_dis_lims(m);
+
+    auto visit_bucket = [&](const IndexBinaryMIH::Table& table, size_t b) {
+        nlist++;
+        for (size_t j = table.offsets[b]; j < table.offsets[b + 1]; j++) {
+            idx_t id = table.ids[j];
+            if (!visited.get(id)) {
+                visited.set(id);
+                int dis = hc.hamming(index.xb.data() + id * code_size);
+                res.add(dis, id);
+                ndis++;
+            }
+        }
+    };
+
+    // after step R, all codes at distance <= R have been visited
+    for (int R = 0; R <= max_R; R++) {
+        int r = R / m, a = R % m;
+        int s = index.sub_offsets[a + 1] - index.sub_offsets[a];
+        const IndexBinaryMIH::Table& table = index.tables[a];
+        if (r <= s && !table.keys.empty()) {
+            uint64_t qa = qsubs[a];
+            // nb of substrings at distance exactly r
+            double ring_size = 1;
+            for (int i = 0; i < r; i++) {
+                ring_size = ring_size * (s - i) / (i + 1);
+            }
+            // a hash lookup costs ~ log2(nb of keys) comparisons
+            double lookup_cost = ring_size * std::log2(table.keys.size() + 1);
+            if (lookup_cost > table.keys.size() || !by_dis[a].empty()) {
+                std::vector<size_t>& order = by_dis[a];
+                std::vector<size_t>& lims = by_dis_lims[a];
+                if (order.empty()) {
+                    size_t nk = table.keys.size();
+                    std::vector<uint8_t> kdis(nk);
+                    lims.assign(s + 2, 0);
+                    for (size_t i = 0; i < nk; i++) {
+                        kdis[i] = popcount64(table.keys[i] ^ qa);
+                        lims[kdis[i] + 1]++;
+                    }
+                    for (int i = 0; i <= s; i++) {
+                        lims[i + 1] += lims[i];
+                    }
+                    order.resize(nk);
+                    std::vector<size_t> ofs(lims.begin(), lims.end() - 1);
+                    for (size_t i = 0; i < nk; i++) {
+                        order[ofs[kdis[i]]++] = i;
+                    }
+                }
+                for (size_t i = lims[r]; i < lims[r + 1]; i++) {
+                    visit_bucket(table, order[i]);
+                }
+            } else {
+                auto visit_key = [&](uint64_t key) {
+                    auto it = std::lower_bound(
+                            table.keys.begin(), table.keys.end(), key);
+                    if (it == table.keys.end() || *it != key) {
+                        n0++;
+                    } else {
+                        visit_bucket(table, it - table.keys.begin());
+                    }
+                };
+                if (r == 0) {
+                    visit_key(qa);
+                } else {
+                    // enumerate the r-bit masks (Gosper's hack)
+                    uint64_t x = ((uint64_t)1 << r) - 1;
+                    while (x < ((uint64_t)1 << s)) {
+                        visit_key(qa ^ x);
+                        uint64_t c = x & -x;
+                        uint64_t rr = x + c;
+                        x = (((rr ^ x) >> 2) / c) | rr;
+                    }
+                }
+            }
+        }
+        if (mih_done(res, R)) {
+            break;
+        }
+    }
+}
+
+struct Run_search_1_query_mih {
+    using T = void;
+    template <class HammingComputer, class... Types>
+    T f(Types... args) {
+        search_1_query_mih<HammingComputer>(args...);
+    }
+};
+
+} // anonymous namespace
+
+void IndexBinaryMIH::range_search(
+        idx_t n,
+        const uint8_t* x,
+        int radius,
+        RangeSearchResult* result,
+        const SearchParameters* params) const {
+    FAISS_THROW_IF_NOT_MSG(
+            !params, "search params not supported for this index");
+    size_t nlist = 0, ndis = 0, n0 = 0;
+    // results are strictly below radius
+    int max_R = std::min(radius - 1, d);
+
+#pragma omp parallel if (n > 100) reduction(+ : ndis, n0, nlist) num_threads(num_omp_threads)
+    {
+        RangeSearchPartialResult pres(result);
+        Run_search_1_query_mih r;
+        VisitedTable visited(ntotal);
+
+#pragma omp for
+        for (idx_t i = 0; i < n; i++) { // loop queries
+            RangeQueryResult& qres = pres.new_result(i);
+            RangeSearchResults res = {radius, qres};
+            const uint8_t* q = x + i * code_size;
+
+            dispatch_HammingComputer(
+                    code_size,
+                    r,
+                    this,
+                    q,
+                    max_R,
+                    &res,
+                    &visited,
+                    &n0,
+                    &nlist,
+                    &ndis);
+        }
+        pres.finalize();
+    }
+    indexBinaryHash_stats.nq += n;
+    indexBinaryHash_stats.n0 += n0;
+    indexBinaryHash_stats.nlist += nlist;
+    indexBinaryHash_stats.ndis += ndis;
+}
+
+void IndexBinaryMIH::search(
+        idx_t n,
+        const uint8_t* x,
+        idx_t k,
+        int32_t* distances,
+        idx_t* labels,
+        const SearchParameters* params) const {
+    FAISS_THROW_IF_NOT_MSG(
+            !params, "search params not supported for this index");
+    FAISS_THROW_IF_NOT(k > 0);
+
+    using HeapForL2 = CMax<int32_t, idx_t>;
+    size_t nlist = 0, ndis = 0, n0 = 0;
+
+#pragma omp parallel if (n > 100) reduction(+ : nlist, ndis, n0) num_threads(num_omp_threads)
+    {
+        VisitedTable visited(ntotal);
+
+#pragma omp for
+        for (idx_t i = 0; i < n; i++) {
+            int32_t* simi = distances + k * i;
+            idx_t* idxi = labels + k * i;
+
+            heap_heapify<HeapForL2>(k, simi, idxi);
+            KnnSearchResults res = {k, simi, idxi};
+            const uint8_t* q = x + i * code_size;
+
+            Run_search_1_query_mih r;
+            dispatch_HammingComputer(
+                    code_size,
+                    r,
+                    this,
+                    q,
+                    d,
+                    &res,
+                    &visited,
+                    &n0,
+                    &nlist,
+                    &ndis);
+
+            heap_reorder<HeapForL2>(k, simi, idxi);
+        }
+    }
+    indexBinaryHash_stats.nq += n;
+    indexBinaryHash_stats.n0 += n0;
+    indexBinaryHash_stats.nlist += nlist;
+    indexBinaryHash_stats.ndis += ndis;
+}
+
 } // namespace faiss
@@ -123,6 +123,89 @@ struct IndexBinaryMultiHash : IndexBinary {
     size_t hashtable_size() const;
 };
 
+/** Multi-Index Hashing (Norouzi et al., "Fast Exact Search in Hamming Space
+ * with Multi-Index Hashing", TPAMI'14).
+ *
+ * The codes are split into m disjoint substrings, each indexed in its own
+ * table. If two codes are at distance <= R = m * r + a (0 <= a < m), then
+ * one of the first a + 1 substrings is at distance <= r, or one of the
+ * others is at distance <= r - 1 (pigeonhole principle). Searching the
+ * tables with these radii and verifying the candidates with the full
+ * distance gives exact results.
+ *
+ * The k-NN search grows R one step at a time: each step enumerates the
+ * substring values at exactly distance r in table a, and the search stops
+ * when the k-th result is at distance <= R.
+ *
+ * The tables are compact sorted arrays of substring values, with the ids of
+ * each bucket stored contiguously.
+ *
+ * The search is efficient when the neighbors are at a small distance
+ * compared to d (near-duplicate search). For large radii most of the
+ * database is verified and IndexBinaryFlat is faster. A good choice is
+ * m ~= d / log2(ntotal).
+ */
+struct IndexBinaryMIH : IndexBinary {
+    /// one hash table per substring
+    struct Table {
+        std::vector<uint64_t> keys;  ///< sorted distinct substring values
+        std::vector<size_t> offsets; ///< size keys.size() + 1
+        /// ids of bucket i are in offsets[i]:offsets[i + 1]
+        std::vector<idx_t> ids;
+
+        /// adds (key, id) pairs, ids should be increasing
+        void add(size_t n, const uint64_t* new_keys, const idx_t* new_ids);
+
+        /// returns the bucket of the key, or an empty range
+        void lookup(uint64_t key, const idx_t*& begin, const idx_t*& end)
+                const;
+    };
+
+    int m = 0; ///< nb of substrings
+
+    /// the codes, size ntotal * code_size
+    std::vector<uint8_t> xb;
+
+    /// size m
+    std::vector<Table> tables;
+
+    /// substring i is bits sub_offsets[i]:sub_offsets[i + 1] of the code,
+    /// size m + 1
+    std::vector<int> sub_offsets;
+
+    /// substrings are at most 32 bits
+    IndexBinaryMIH(int d, int m);
+
+    IndexBinaryMIH();
+
+    void reset() override;
+
+    void add(idx_t n, const uint8_t* x) override;
+
+    void range_search(
+            idx_t n,
+            const uint8_t* x,
+            int radius,
+            RangeSearchResult* result,
+            const SearchParameters* params = nullptr) const override;
+
+    void search(
+            idx_t n,
+            const uint8_t* x,
+            idx_t k,
+            int32_t* distances,
+            idx_t* labels,
+            const SearchParameters* params = nullptr) const override;
+
+    void reconstruct(idx_t key, uint8_t* recons) const override;
+
+    /// extract the m substrings of a code
+    void get_substrings(const uint8_t* code, uint64_t* subs) const;
+
+    /// nb of distinct substring values over all tables
+    size_t hashtable_size() const;
+};
+
 } // namespace faiss
 
 #endif
@@ -32,10 +32,29 @@ void IndexFlat::search(
         idx_t* labels,
         const SearchParameters* params) const {
     IDSelector* sel = params ? params->sel : nullptr;
+    float recall = params ? params->approx_topk_recall : 1;
+    SearchStats* search_stats = params ? params->stats : nullptr;
     FAISS_THROW_IF_NOT(k > 0);
+    double t0 = search_stats ? getmillisecs() : 0;
 
     // we see the distances and labels as heaps
-    if (metric_type == METRIC_INNER_PRODUCT) {
+    if (recall < 1 && k > 1 && metric_type == METRIC_INNER_PRODUCT) {
+        knn_inner_product_approx_topk(
+                x, get_xb(), d, n, ntotal, k, distances, labels, recall, sel);
+    } else if (recall < 1 && k > 1 && metric_type == METRIC_L2) {
+        knn_L2sqr_approx_topk(
+                x,
+                get_xb(),
+                d,
+                n,
+                ntotal,
+                k,
+                distances,
+                labels,
+                recall,
+                nullptr,
+                sel);
+    } else if (metric_type == METRIC_INNER_PRODUCT) {
         float_minheap_array_t res = {size_t(n), size_t(k), labels, distances};
         knn_inner_product(x, get_xb(), d, n, ntotal, &res, sel);
     } else if (metric_type == METRIC_L2) {
@@ -51,6 +70,18 @@ void IndexFlat::search(
         knn_extra_metrics(
                 x, get_xb(), d, n, ntotal, metric_type, metric_arg, &res);
     }
+
+    if (search_stats) {
+        // the queries are searched together, so the time is split evenly
+        double scan_time = (getmillisecs() - t0) / n;
+        search_stats->begin(n);
+        for (QueryStats& qs : search_stats->queries) {
+            qs.ndis = ntotal;
+            qs.nbytes = ntotal * code_size;
+            qs.scan_time = scan_time;
+            search_stats->end_query(qs);
+        }
+    }
 }
 
 void IndexFlat::range_search(
@@ -419,99 +450,102 @@ void IndexFlat1D::search(
             perm.size() == ntotal, "Call update_permutation before search");
     const float* xb = get_xb();
 
-#pragma omp parallel for if (n > 10000) num_threads(num_omp_threads)
-    for (idx_t i = 0; i < n; i++) {
-        float q = x[i]; // query
-        float* D = distances + i * k;
-        idx_t* I = labels + i * k;
-
-        // binary search
-        idx_t i0 = 0, i1 = ntotal;
-        idx_t wp = 0;
-
-        if (ntotal == 0) {
-            for (idx_t j = 0; j < k; j++) {
-                I[j] = -1;
-                D[j] = HUGE_VAL;
+    // the binary searches are cheap, parallelize only large batches
+    int nt = n > 10000 ? std::min(idx_t(parallel_num_threads()), n) : 1;
+    parallel_for(nt, [&](int64_t rank) {
+        for (idx_t i = n * rank / nt; i < n * (rank + 1) / nt; i++) {
+            float q = x[i]; // query
+            float* D = distances + i * k;
+            idx_t* I = labels + i * k;
+
+            // binary search
+            idx_t i0 = 0, i1 = ntotal;
+            idx_t wp = 0;
+
+            if (ntotal == 0) {
+                for (idx_t j = 0; j < k; j++) {
+                    I[j] = -1;
+                    D[j] = HUGE_VAL;
+                }
+                goto done;
             }
-            goto done;
-        }
-
-        if (xb[perm[i0]] > q) {
-            i1 = 0;
-            goto finish_right;
-        }
 
-        if (xb[perm[i1 - 1]] <= q) {
-            i0 = i1 - 1;
-            goto finish_left;
-        }
+            if (xb[perm[i0]] > q) {
+                i1 = 0;
+                goto finish_right;
+            }
 
-        while (i0 + 1 < i1) {
-            idx_t imed = (i0 + i1) / 2;
-            if (xb[perm[imed]] <= q)
-                i0 = imed;
-            else
-                i1 = imed;
-        }
+            if (xb[perm[i1 - 1]] <= q) {
+                i0 = i1 - 1;
+                goto finish_left;
+            }
 
-        // query is between xb[perm[i0]] and xb[perm[i1]]
-        // expand to nearest neighs
+            while (i0 + 1 < i1) {
+                idx_t imed = (i0 + i1) / 2;
+                if (xb[perm[imed]] <= q)
+                    i0 = imed;
+                else
+                    i1 = imed;
+            }
 
-        while (wp < k) {
-            float xleft = xb[perm[i0]];
-            float xright = xb[perm[i1]];
+            // query is between xb[perm[i0]] and xb[perm[i1]]
+            // expand to nearest neighs
+
+            while (wp < k) {
+                float xleft = xb[perm[i0]];
+                float xright = xb[perm[i1]];
+
+                if (q - xleft < xright - q) {
+                    D[wp] = q - xleft;
+                    I[wp] = perm[i0];
+                    i0--;
+                    wp++;
+                    if (i0 < 0) {
+                        goto finish_right;
+                    }
+                } else {
+                    D[wp] = xright - q;
+                    I[wp] = perm[i1];
+                    i1++;
+                    wp++;
+                    if (i1 >= ntotal) {
+                        goto finish_left;
+                    }
+                }
+            }
+            goto done;
 
-            if (q - xleft < xright - q) {
-                D[wp] = q - xleft;
-                I[wp] = perm[i0];
-                i0--;
-                wp++;
-                if (i0 < 0) {
-                    goto finish_right;
+        finish_right:
+            // grow to the right from i1
+            while (wp < k) {
+                if (i1 < ntotal) {
+                    D[wp] = xb[perm[i1]] - q;
+                    I[wp] = perm[i1];
+                    i1++;
+                } else {
+                    D[wp] = std::numeric_limits<float>::infinity();
+                    I[wp] = -1;
                 }
-            } else {
-                D[wp] = xright - q;
-                I[wp] = perm[i1];
-                i1++;
                 wp++;
-                if (i1 >= ntotal) {
-                    goto finish_left;
-                }
-            }
-        }
-        goto done;
-
-    finish_right:
-        // grow to the right from i1
-        while (wp < k) {
-            if (i1 < ntotal) {
-                D[wp] = xb[perm[i1]] - q;
-                I[wp] = perm[i1];
-                i1++;
-            } else {
-                D[wp] = std::numeric_limits<float>::infinity();
-                I[wp] = -1;
             }
-            wp++;
-        }
-        goto done;
-
-    finish_left:
-        // grow to the left from i0
-        while (wp < k) {
-            if (i0 >= 0) {
-                D[wp] = q - xb[perm[i0]];
-                I[wp] = perm[i0];
-                i0--;
-            } else {
-                D[wp] = std::numeric_limits<float>::infinity();
-                I[wp] = -1;
+            goto done;
+
+        finish_left:
+            // grow to the left from i0
+            while (wp < k) {
+                if (i0 >= 0) {
+                    D[wp] = q - xb[perm[i0]];
+                    I[wp] = perm[i0];
+                    i0--;
+                } else {
+                    D[wp] = std::numeric_limits<float>::infinity();
+                    I[wp] = -1;
+                }
+                wp++;
             }
-            wp++;
+        done:;
         }
-    done:;
-    }
+    });
 }
 
 } // namespace faiss
@@ -11,6 +11,7 @@
 
 #include <omp.h>
 
+#include <atomic>
 #include <cassert>
 #include <cinttypes>
 #include <cmath>
@@ -18,6 +19,7 @@
 #include <cstdlib>
 #include <cstring>
 
+#include <mutex>
 #include <queue>
 #include <unordered_set>
 
@@ -63,6 +65,8 @@ using NodeDistFarther = HNSW::NodeDistFarther;
 
 HNSWStats hnsw_stats;
 
+size_t hnsw_visited_table_cache_size = 1 << 20;
+
 /**************************************************************
  * add / search blocks of descriptors
  **************************************************************/
@@ -283,12 +287,85 @@ void IndexHNSW::train(idx_t n, const float* x) {
             storage,
             "Please use IndexHNSWFlat (or variants) instead of IndexHNSW directly");
     // hnsw structure does not require training
+    search_cache_key.invalidate();
     storage->train(n, x);
     is_trained = true;
 }
 
 namespace {
 
+/// VisitedTable kept across calls by each thread. The flags of the
+/// previous searches are invalidated by advancing it (twice, because some
+/// searches also use visno + 1). Its size is bounded by
+/// hnsw_visited_table_cache_size.
+VisitedTable& thread_local_visited_table(idx_t ntotal) {
+    thread_local std::unique_ptr<VisitedTable> vt;
+    if (!vt || vt->visited.size() != ntotal) {
+        vt.reset(); // release the previous table first
+        vt.reset(new VisitedTable(ntotal));
+    } else {
+        vt->advance();
+        vt->advance();
+    }
+    return *vt;
+}
+
+/// distance computer of the storage. Single-query searches take it from a
+/// per-thread cache, keyed on the search_cache_key of the index, the
+/// storage and its size (the distance computers may capture the data
+/// pointer of the storage).
+struct ScopedStorageDistanceComputer {
+    struct Cache {
+        uint64_t key = 0;
+        const Index* storage = nullptr;
+        idx_t ntotal = 0;
+        bool in_use = false;
+        std::unique_ptr<DistanceComputer> dis;
+    };
+
+    DistanceComputer* dis = nullptr;
+    std::unique_ptr<DistanceComputer> dis_buf;
+    bool* in_use = nullptr;
+
+    ScopedStorageDistanceComputer(const IndexHNSW& index, bool use_cache) {
+        const Index* storage = index.storage;
+        if (use_cache) {
+            thread_local Cache cache;
+            if (!cache.in_use) {
+                if (!(cache.dis && cache.key == index.search_cache_key.value &&
+                      cache.storage == storage &&
+                      cache.ntotal == storage->ntotal)) {
+                    cache.dis.reset();
+                    cache.dis.reset(storage_distance_computer(storage));
+                    cache.key = index.search_cache_key.value;
+                    cache.storage = storage;
+                    cache.ntotal = storage->ntotal;
+                }
+                cache.in_use = true;
+                in_use = &cache.in_use;
+                dis = cache.dis.get();
+                return;
+            }
+        }
+        dis_buf.reset(storage_distance_computer(storage));
+        dis = dis_buf.get();
+    }
+
+    DistanceComputer* operator->() const {
+        return dis;
+    }
+
+    DistanceComputer& operator*() const {
+        return *dis;
+    }
+
+    ~ScopedStorageDistanceComputer() {
+        if (in_use) {
+            *in_use = false;
+        }
+    }
+};
+
 template <class BlockResultHandler>
 void hnsw_search(
         const IndexHNSW* index,
@@ -310,34 +387,79 @@ void hnsw_search(
     }
     size_t n1 = 0, n2 = 0, n3 = 0, ndis = 0, nreorder = 0;
 
+    SearchStats* search_stats = params_in ? params_in->stats : nullptr;
+    size_t code_size = 0;
+    if (search_stats) {
+        search_stats->begin(n);
+        if (auto storage =
+                    dynamic_cast<const IndexFlatCodes*>(index->storage)) {
+            code_size = storage->code_size;
+        }
+    }
+
     idx_t check_period = InterruptCallback::get_period_hint(
             hnsw.max_level * index->d * efSearch);
 
+    std::mutex stats_mutex;
+
     for (idx_t i0 = 0; i0 < n; i0 += check_period) {
         idx_t i1 = std::min(i0 + check_period, n);
-
-#pragma omp parallel num_threads(num_omp_threads)
-        {
-            VisitedTable vt(index->ntotal);
+        int nt = std::min(idx_t(parallel_num_threads()), i1 - i0);
+        // the queries are distributed dynamically over the tasks
+        std::atomic<idx_t> next_query(i0);
+
+        parallel_for(nt, [&](int64_t) {
+            // a single query uses the per-thread table, that is not
+            // allocated and cleared at each call
+            std::unique_ptr<VisitedTable> vt_buf;
+            VisitedTable* vt_ptr;
+            if (n == 1 &&
+                size_t(index->ntotal) <= hnsw_visited_table_cache_size) {
+                vt_ptr = &thread_local_visited_table(index->ntotal);
+            } else {
+                vt_buf.reset(new VisitedTable(index->ntotal));
+                vt_ptr = vt_buf.get();
+            }
+            VisitedTable& vt = *vt_ptr;
             typename BlockResultHandler::SingleResultHandler res(bres);
 
-            std::unique_ptr<DistanceComputer> dis(
-                    storage_distance_computer(index->storage));
+            ScopedStorageDistanceComputer dis(*index, n == 1);
+            HNSWStats local_stats;
 
-#pragma omp for reduction(+ : n1, n2, n3, ndis, nreorder) schedule(guided)
-            for (idx_t i = i0; i < i1; i++) {
+            for (idx_t i = next_query++; i < i1; i = next_query++) {
+                QueryStats* qs =
+                        search_stats ? &search_stats->queries[i] : nullptr;
                 res.begin(i);
-                dis->set_query(x + i * index->d);
-
-                HNSWStats stats = hnsw.search(*dis, res, vt, params);
-                n1 += stats.n1;
-                n2 += stats.n2;
-                n3 += stats.n3;
-                ndis += stats.ndis;
-                nreorder += stats.nreorder;
-                res.end();
+                {
+                    QueryStatsTimer timer(qs, &QueryStats::lut_time);
+                    dis->set_query(x + i * index->d);
+                }
+
+                HNSWStats query_hnsw_stats;
+                {
+                    QueryStatsTimer timer(qs, &QueryStats::scan_time);
+                    query_hnsw_stats = hnsw.search(*dis, res, vt, params);
+                }
+                local_stats.combine(query_hnsw_stats);
+                {
+                    QueryStatsTimer timer(qs, &QueryStats::heap_time);
+                    res.end();
+                }
+                if (qs) {
+                    // the visited nodes are those whose distance is computed
+                    qs->ndis = query_hnsw_stats.n3;
+                    qs->nvisited = query_hnsw_stats.n3;
+                    qs->nbytes = query_hnsw_stats.n3 * code_size;
+                    search_stats->end_query(*qs);
+                }
             }
-        }
+            std::lock_guard<std::mutex> lock(stats_mutex);
+            n1 += local_stats.n1;
+            n2 += local_stats.n2;
+            n3 += local_stats.n3;
+            ndis += local_stats.ndis;
+            nreorder += local_stats.nreorder;
+        });
         InterruptCallback::check();
     }
 
@@ -392,6 +514,7 @@ void IndexHNSW::add(idx_t n, const float* x) {
             storage,
             "Please use IndexHNSWFlat (or variants) instead of IndexHNSW directly");
     FAISS_THROW_IF_NOT(is_trained);
+    search_cache_key.invalidate();
     int n0 = ntotal;
     storage->add(n, x);
     ntotal = storage->ntotal;
@@ -400,6 +523,7 @@ void IndexHNSW::add(idx_t n, const float* x) {
 }
 
 void IndexHNSW::reset() {
+    search_cache_key.invalidate();
     hnsw.reset();
     storage->reset();
     ntotal = 0;
@@ -463,16 +587,20 @@ void IndexHNSW::search_level_0(
     using RH = HeapBlockResultHandler<HNSW::C>;
     RH bres(n, distances, labels, k);
 
-#pragma omp parallel num_threads(num_omp_threads)
-    {
+    int nt = std::min(idx_t(parallel_num_threads()), n);
+    // the queries are distributed dynamically over the tasks
+    std::atomic<idx_t> next_query(0);
+    std::mutex stats_mutex;
+    HNSWStats total_stats;
+
+    parallel_for(nt, [&](int64_t) {
         std::unique_ptr<DistanceComputer> qdis(
                 storage_distance_computer(storage));
         HNSWStats search_stats;
         VisitedTable vt(ntotal);
         RH::SingleResultHandler res(bres);
 
-#pragma omp for
-        for (idx_t i = 0; i < n; i++) {
+        for (idx_t i = next_query++; i < n; i = next_query++) {
             res.begin(i);
             qdis->set_query(x + i * d);
 
@@ -488,9 +616,11 @@ void IndexHNSW::search_level_0(
             res.end();
             vt.advance();
         }
-#pragma omp critical
-        { hnsw_stats.combine(search_stats); }
-    }
+        std::lock_guard<std::mutex> lock(stats_mutex);
+        total_stats.combine(search_stats);
+    });
+
+    hnsw_stats.combine(total_stats);
 }
 
 void IndexHNSW::init_level_0_from_knngraph(
@@ -14,6 +14,7 @@
 #include <faiss/IndexFlat.h>
 #include <faiss/IndexPQ.h>
 #include <faiss/IndexScalarQuantizer.h>
+#include <faiss/impl/AuxIndexStructures.h>
 #include <faiss/impl/HNSW.h>
 #include <faiss/utils/utils.h>
 
@@ -34,6 +35,12 @@ struct IndexHNSW : Index {
     bool own_fields = false;
     Index* storage = nullptr;
 
+    /** Single-query searches keep the distance computer of the storage
+     * per thread, keyed on this value and on the storage size. It changes
+     * with add(), train() and reset(); call search_cache_key.invalidate()
+     * after modifying the storage in place. */
+    SearchCacheKey search_cache_key;
+
     explicit IndexHNSW(int d = 0, int M = 32, MetricType metric = METRIC_L2);
     explicit IndexHNSW(Index* storage, int M = 32);
 
@@ -148,4 +155,9 @@ struct IndexHNSW2Level : IndexHNSW {
             const SearchParameters* params = nullptr) const override;
 };
 
+/// single-query searches keep a per-thread VisitedTable across calls when
+/// ntotal is at most this size, so that each thread holds at most this
+/// many bytes. Larger indexes allocate the table at each call
+FAISS_API extern size_t hnsw_visited_table_cache_size;
+
 } // namespace faiss
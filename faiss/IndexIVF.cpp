@@ -14,6 +14,7 @@
 #include <cstdint>
 #include <memory>
 #include <mutex>
+#include <optional>
 
 #include <algorithm>
 #include <cinttypes>
@@ -21,6 +22,7 @@
 #include <limits>
 #include <memory>
 
+#include <faiss/utils/approx_topk/bucketed.h>
 #include <faiss/utils/hamming.h>
 #include <faiss/utils/utils.h>
 
@@ -288,6 +290,116 @@ void IndexIVF::set_direct_map_type(DirectMap::Type type) {
     direct_map.set_type(type, invlists, ntotal);
 }
 
+namespace {
+
+/// coarse quantization results of a batch of queries. A single query uses
+/// per-thread buffers that are kept across calls, so that it does not
+/// allocate them. The buffers are not reused if they are already in use
+/// higher in the call stack (eg. an IVF quantizer).
+struct CoarseAssignBuffers {
+    std::unique_ptr<idx_t[]> idx_buf;
+    std::unique_ptr<float[]> dis_buf;
+    idx_t* idx;
+    float* dis;
+    bool* in_use = nullptr;
+
+    CoarseAssignBuffers(idx_t n, size_t nprobe) {
+        thread_local std::vector<idx_t> tl_idx;
+        thread_local std::vector<float> tl_dis;
+        thread_local bool tl_in_use = false;
+        if (n == 1 && !tl_in_use) {
+            if (tl_idx.size() < nprobe) {
+                tl_idx.resize(nprobe);
+                tl_dis.resize(nprobe);
+            }
+            in_use = &tl_in_use;
+            *in_use = true;
+            idx = tl_idx.data();
+            dis = tl_dis.data();
+        } else {
+            idx_buf.reset(new idx_t[n * nprobe]);
+            dis_buf.reset(new float[n * nprobe]);
+            idx = idx_buf.get();
+            dis = dis_buf.get();
+        }
+    }
+
+    ~CoarseAssignBuffers() {
+        if (in_use) {
+            *in_use = false;
+        }
+    }
+};
+
+/// scanner of a search. Single-query searches take it from a per-thread
+/// cache, keyed on the search_cache_key of the index, store_pairs and the
+/// selector. Only the scanners that confirm it with is_reusable are kept.
+struct ScopedScanner {
+    struct Cache {
+        uint64_t key = 0;
+        bool store_pairs = false;
+        const IDSelector* sel = nullptr;
+        bool in_use = false;
+        std::unique_ptr<InvertedListScanner> scanner;
+    };
+
+    InvertedListScanner* scanner = nullptr;
+    std::unique_ptr<InvertedListScanner> scanner_buf;
+    bool* in_use = nullptr;
+
+    ScopedScanner(
+            const IndexIVF& index,
+            bool store_pairs,
+            const IDSelector* sel,
+            bool use_cache) {
+        if (use_cache) {
+            thread_local Cache cache;
+            if (!cache.in_use) {
+                if (!(cache.scanner &&
+                      cache.key == index.search_cache_key.value &&
+                      cache.store_pairs == store_pairs && cache.sel == sel &&
+                      cache.scanner->is_reusable(index))) {
+                    cache.scanner.reset();
+                    scanner_buf.reset(
+                            index.get_InvertedListScanner(store_pairs, sel));
+                    if (scanner_buf && scanner_buf->is_reusable(index)) {
+                        cache.scanner = std::move(scanner_buf);
+                        cache.key = index.search_cache_key.value;
+                        cache.store_pairs = store_pairs;
+                        cache.sel = sel;
+                    }
+                }
+                if (cache.scanner) {
+                    cache.in_use = true;
+                    in_use = &cache.in_use;
+                    scanner = cache.scanner.get();
+                    return;
+                }
+            }
+        }
+        if (!scanner_buf) {
+            scanner_buf.reset(index.get_InvertedListScanner(store_pairs, sel));
+        }
+        scanner = scanner_buf.get();
+    }
+
+    InvertedListScanner* operator->() const {
+        return scanner;
+    }
+
+    InvertedListScanner* get() const {
+        return scanner;
+    }
+
+    ~ScopedScanner() {
+        if (in_use) {
+            *in_use = false;
+        }
+    }
+};
+
+} // anonymous namespace
+
 /** It is a sad fact of software that a conceptually simple function like this
  * becomes very complex when you factor in several ways of parallelizing +
  * interrupt/error handling + collecting stats + min/max collection. The
@@ -309,6 +421,11 @@ void IndexIVF::search(
             std::min(nlist, params ? params->nprobe : this->nprobe);
     FAISS_THROW_IF_NOT(nprobe > 0);
 
+    SearchStats* search_stats = params ? params->stats : nullptr;
+    if (search_stats) {
+        search_stats->begin(n);
+    }
+
     // search function for a subset of queries
     auto sub_search_func = [this, k, nprobe, params](
                                    idx_t n,
@@ -316,27 +433,31 @@ void IndexIVF::search(
                                    float* distances,
                                    idx_t* labels,
                                    IndexIVFStats* ivf_stats) {
-        std::unique_ptr<idx_t[]> idx(new idx_t[n * nprobe]);
-        std::unique_ptr<float[]> coarse_dis(new float[n * nprobe]);
+        CoarseAssignBuffers coarse(n, nprobe);
 
         double t0 = getmillisecs();
         quantizer->search(
                 n,
                 x,
                 nprobe,
-                coarse_dis.get(),
-                idx.get(),
+                coarse.dis,
+                coarse.idx,
                 params ? params->quantizer_params : nullptr);
 
         double t1 = getmillisecs();
-        invlists->prefetch_lists(idx.get(), n * nprobe);
+        if (ivf_stats->query_stats) {
+            for (idx_t i = 0; i < n; i++) {
+                ivf_stats->query_stats[i].coarse_time += (t1 - t0) / n;
+            }
+        }
+        invlists->prefetch_lists(coarse.idx, n * nprobe);
 
         search_preassigned(
                 n,
                 x,
                 k,
-                idx.get(),
-                coarse_dis.get(),
+                coarse.idx,
+                coarse.dis,
                 distances,
                 labels,
                 false,
@@ -347,18 +468,20 @@ void IndexIVF::search(
         ivf_stats->search_time += t2 - t0;
     };
 
-    if ((parallel_mode & ~PARALLEL_MODE_NO_HEAP_INIT) == 0) {
-        int nt = std::min(omp_get_max_threads(), int(n));
+    if ((parallel_mode & ~PARALLEL_MODE_NO_HEAP_INIT) == 0 && n > 1) {
+        int nt = std::min(parallel_num_threads(), int(n));
         std::vector<IndexIVFStats> stats(nt);
         std::mutex exception_mutex;
         std::string exception_string;
 
-#pragma omp parallel for if (nt > 1) num_threads(num_omp_threads)
-        for (idx_t slice = 0; slice < nt; slice++) {
-            IndexIVFStats local_stats;
+        parallel_for(nt, [&](int64_t slice) {
             idx_t i0 = n * slice / nt;
             idx_t i1 = n * (slice + 1) / nt;
             if (i1 > i0) {
+                if (search_stats) {
+                    stats[slice].query_stats =
+                            search_stats->queries.data() + i0;
+                }
                 try {
                     sub_search_func(
                             i1 - i0,
@@ -371,7 +494,7 @@ void IndexIVF::search(
                     exception_string = e.what();
                 }
             }
-        }
+        });
 
         if (!exception_string.empty()) {
             FAISS_THROW_MSG(exception_string.c_str());
@@ -383,8 +506,15 @@ void IndexIVF::search(
         }
     } else {
         // handle parallelization at level below (or don't run in parallel at
-        // all)
-        sub_search_func(n, x, distances, labels, &indexIVF_stats);
+        // all). A single query is searched directly in the calling thread.
+        if (search_stats) {
+            IndexIVFStats stats;
+            stats.query_stats = search_stats->queries.data();
+            sub_search_func(n, x, distances, labels, &stats);
+            indexIVF_stats.add(stats);
+        } else {
+            sub_search_func(n, x, distances, labels, &indexIVF_stats);
+        }
     }
 }
 
@@ -445,7 +575,9 @@ void IndexIVF::search_preassigned(
         max_codes = unlimited_list_size;
     }
 
-    bool do_parallel = omp_get_max_threads() >= 2 &&
+    int max_threads =
+            search_executor ? parallel_num_threads() : omp_get_max_threads();
+    bool do_parallel = max_threads >= 2 &&
             (pmode == 0           ? false
                      : pmode == 3 ? n > 1
                      : pmode == 1 ? nprobe > 1
@@ -454,10 +586,82 @@ void IndexIVF::search_preassigned(
     void* inverted_list_context =
             params ? params->inverted_list_context : nullptr;
 
-#pragma omp parallel if (do_parallel) reduction(+ : nlistv, ndis, nheap) num_threads(num_omp_threads)
-    {
-        std::unique_ptr<InvertedListScanner> scanner(
-                get_InvertedListScanner(store_pairs, sel));
+    // approximate top-k: distances of the scanned lists are collected in
+    // buckets that are merged into the result heap once per query
+    float topk_recall = params ? params->approx_topk_recall : 1;
+    bool approx_topk = topk_recall < 1 && k > 1 && !invlists->use_iterator &&
+            (pmode == 0 || pmode == 3) && do_heap_init;
+    ApproxTopKConfig approx_config;
+    if (approx_topk) {
+        size_t n_est = nprobe * std::max(ntotal / (idx_t)nlist, idx_t(1));
+        approx_config = approx_topk_choose(k, n_est, topk_recall);
+    }
+
+    SharedKnnBounds* shared_bounds =
+            params ? params->shared_bounds : nullptr;
+    if (shared_bounds &&
+        (approx_topk || !do_heap_init || !(pmode == 0 || pmode == 3) ||
+         shared_bounds->is_max != (metric_type != METRIC_INNER_PRODUCT))) {
+        shared_bounds = nullptr;
+    }
+
+    // per-query stats, the search function may already have set them up
+    SearchStats* search_stats = params ? params->stats : nullptr;
+    QueryStats* query_stats = nullptr;
+    if (search_stats) {
+        if (ivf_stats && ivf_stats->query_stats) {
+            query_stats = ivf_stats->query_stats;
+        } else {
+            search_stats->begin(n);
+            query_stats = search_stats->queries.data();
+        }
+    }
+
+    // initialize + reorder a result heap
+
+    auto init_result = [&](float* simi, idx_t* idxi) {
+        if (!do_heap_init)
+            return;
+        if (metric_type == METRIC_INNER_PRODUCT) {
+            heap_heapify<HeapForIP>(k, simi, idxi);
+        } else {
+            heap_heapify<HeapForL2>(k, simi, idxi);
+        }
+    };
+
+    auto reorder_heap = [&](float* simi, idx_t* idxi) {
+        if (metric_type == METRIC_INNER_PRODUCT) {
+            heap_reorder<HeapForIP>(k, simi, idxi);
+        } else {
+            heap_reorder<HeapForL2>(k, simi, idxi);
+        }
+    };
+
+    std::mutex merge_mutex;
+
+    // Search run by each thread of the OpenMP team (task < 0), or by each
+    // of the ntask tasks of the search executor. Tasks can not synchronize,
+    // so they process a slice of the queries (parallel_mode 0 and 3) or of
+    // the (query, probe) pairs (parallel_mode 1 and 2). In the latter case
+    // the result heaps are initialized and reordered by the caller.
+    auto search_thread = [&](int64_t task,
+                             int64_t ntask,
+                             size_t& nlistv,
+                             size_t& ndis,
+                             size_t& nheap) {
+        ScopedScanner scanner(*this, store_pairs, sel, n == 1 && task < 0);
+
+        ApproxTopKBuckets<HeapForIP> buckets_ip;
+        ApproxTopKBuckets<HeapForL2> buckets_l2;
+        std::vector<float> approx_dis;
+        std::vector<idx_t> approx_ids;
+        if (approx_topk) {
+            if (metric_type == METRIC_INNER_PRODUCT) {
+                buckets_ip.init(approx_config);
+            } else {
+                buckets_l2.init(approx_config);
+            }
+        }
 
         /*****************************************************
          * Depending on parallel_mode, there are two possible ways
@@ -465,15 +669,18 @@ void IndexIVF::search_preassigned(
          * that are in common between the two
          ******************************************************/
 
-        // initialize + reorder a result heap
-
-        auto init_result = [&](float* simi, idx_t* idxi) {
-            if (!do_heap_init)
+        // publish the k-th distance of query i and drop the results that
+        // are beyond the bound reached by the other searches
+        auto share_bound = [&](idx_t i, float* simi, idx_t* idxi) {
+            int64_t q = shared_bounds->query_no(x + i * d);
+            if (q < 0) {
                 return;
+            }
+            float bound = shared_bounds->update(q, simi[0]);
             if (metric_type == METRIC_INNER_PRODUCT) {
-                heap_heapify<HeapForIP>(k, simi, idxi);
+                heap_clamp<HeapForIP>(k, simi, idxi, bound);
             } else {
-                heap_heapify<HeapForL2>(k, simi, idxi);
+                heap_clamp<HeapForL2>(k, simi, idxi, bound);
             }
         };
 
@@ -488,23 +695,70 @@ void IndexIVF::search_preassigned(
             }
         };
 
-        auto reorder_result = [&](float* simi, idx_t* idxi) {
+        // compute the distances of a list and add them to the buckets
+        auto add_to_buckets = [&](idx_t key,
+                                  size_t list_size,
+                                  const uint8_t* codes,
+                                  const idx_t* ids,
+                                  size_t j0) {
+            bool is_ip = metric_type == METRIC_INNER_PRODUCT;
+            float neutral = is_ip ? HeapForIP::neutral() : HeapForL2::neutral();
+            approx_dis.resize(list_size);
+            if (store_pairs) {
+                approx_ids.resize(list_size);
+                for (size_t j = 0; j < list_size; j++) {
+                    approx_ids[j] = lo_build(key, j0 + j);
+                }
+                ids = approx_ids.data();
+            }
+            scanner->distances_to_codes(list_size, codes, approx_dis.data());
+            if (sel) {
+                for (size_t j = 0; j < list_size; j++) {
+                    if (!sel->is_member(ids[j])) {
+                        // neutral values are never collected
+                        approx_dis[j] = neutral;
+                    }
+                }
+            }
+            if (is_ip) {
+                buckets_ip.add(list_size, approx_dis.data(), ids);
+            } else {
+                buckets_l2.add(list_size, approx_dis.data(), ids);
+            }
+        };
+
+        auto reorder_result = [&](float* simi,
+                                  idx_t* idxi,
+                                  QueryStats* qs = nullptr) {
             if (!do_heap_init)
                 return;
-            if (metric_type == METRIC_INNER_PRODUCT) {
-                heap_reorder<HeapForIP>(k, simi, idxi);
-            } else {
-                heap_reorder<HeapForL2>(k, simi, idxi);
+            QueryStatsTimer timer(qs, &QueryStats::heap_time);
+            if (approx_topk) {
+                size_t nheap_buckets;
+                if (metric_type == METRIC_INNER_PRODUCT) {
+                    nheap_buckets = buckets_ip.to_heap(k, simi, idxi);
+                    buckets_ip.reset();
+                } else {
+                    nheap_buckets = buckets_l2.to_heap(k, simi, idxi);
+                    buckets_l2.reset();
+                }
+                nheap += nheap_buckets;
+                if (qs) {
+                    qs->nheap_updates += nheap_buckets;
+                }
             }
+            reorder_heap(simi, idxi);
         };
 
         // single list scan using the current scanner (with query
-        // set porperly) and storing results in simi and idxi
+        // set porperly) and storing results in simi and idxi. The costs are
+        // added to qs if it is not null
         auto scan_one_list = [&](idx_t key,
                                  float coarse_dis_i,
                                  float* simi,
                                  idx_t* idxi,
-                                 idx_t list_size_max) {
+                                 idx_t list_size_max,
+                                 QueryStats* qs) {
             if (key < 0) {
                 // not enough centroids for multiprobe
                 return (size_t)0;
@@ -520,20 +774,32 @@ void IndexIVF::search_preassigned(
                 return (size_t)0;
             }
 
-            scanner->set_list(key, coarse_dis_i);
+            {
+                QueryStatsTimer timer(qs, &QueryStats::lut_time);
+                scanner->set_list(key, coarse_dis_i);
+            }
 
             nlistv++;
 
             try {
+                QueryStatsTimer timer(qs, &QueryStats::scan_time);
+                size_t nheap_list = 0;
                 if (invlists->use_iterator) {
                     size_t list_size = 0;
 
                     std::unique_ptr<InvertedListsIterator> it(
                             invlists->get_iterator(key, inverted_list_context));
 
-                    nheap += scanner->iterate_codes(
+                    nheap_list = scanner->iterate_codes(
                             it.get(), simi, idxi, k, list_size);
+                    nheap += nheap_list;
 
+                    if (qs) {
+                        qs->nvisited++;
+                        qs->ndis += list_size;
+                        qs->nbytes += list_size * (code_size + sizeof(idx_t));
+                        qs->nheap_updates += nheap_list;
+                    }
                     return list_size;
                 } else {
                     size_t list_size = invlists->list_size(key);
@@ -544,18 +810,17 @@ void IndexIVF::search_preassigned(
                     InvertedLists::ScopedCodes scodes(invlists, key);
                     const uint8_t* codes = scodes.get();
 
-                    std::unique_ptr<InvertedLists::ScopedIds> sids;
+                    std::optional<InvertedLists::ScopedIds> sids;
                     const idx_t* ids = nullptr;
 
                     if (!store_pairs) {
-                        sids = std::make_unique<InvertedLists::ScopedIds>(
-                                invlists, key);
-                        ids = sids->get();
+                        ids = sids.emplace(invlists, key).get();
                     }
 
+                    size_t jmin = 0;
                     if (selr) { // IDSelectorRange
                         // restrict search to a section of the inverted list
-                        size_t jmin, jmax;
+                        size_t jmax;
                         selr->find_sorted_ids_bounds(
                                 list_size, ids, &jmin, &jmax);
                         list_size = jmax - jmin;
@@ -566,9 +831,21 @@ void IndexIVF::search_preassigned(
                         ids += jmin;
                     }
 
-                    nheap += scanner->scan_codes(
-                            list_size, codes, ids, simi, idxi, k);
+                    if (approx_topk) {
+                        add_to_buckets(key, list_size, codes, ids, jmin);
+                    } else {
+                        nheap_list = scanner->scan_codes(
+                                list_size, codes, ids, simi, idxi, k);
+                        nheap += nheap_list;
+                    }
 
+                    if (qs) {
+                        qs->nvisited++;
+                        qs->ndis += list_size;
+                        qs->nbytes += list_size *
+                                (code_size + (store_pairs ? 0 : sizeof(idx_t)));
+                        qs->nheap_updates += nheap_list;
+                    }
                     return list_size;
                 }
             } catch (const std::exception& e) {
@@ -580,53 +857,125 @@ void IndexIVF::search_preassigned(
             }
         };
 
-        /****************************************************
-         * Actual loops, depending on parallel_mode
-         ****************************************************/
-
-        if (pmode == 0 || pmode == 3) {
-#pragma omp for
-            for (idx_t i = 0; i < n; i++) {
-                if (interrupt) {
-                    continue;
-                }
+        // search query i over all its probes
+        auto search_query = [&](idx_t i) {
+            if (interrupt) {
+                return;
+            }
 
-                // loop over queries
+            QueryStats* qs = query_stats ? query_stats + i : nullptr;
+            {
+                QueryStatsTimer timer(qs, &QueryStats::lut_time);
                 scanner->set_query(x + i * d);
-                float* simi = distances + i * k;
-                idx_t* idxi = labels + i * k;
+            }
+            float* simi = distances + i * k;
+            idx_t* idxi = labels + i * k;
 
+            {
+                QueryStatsTimer timer(qs, &QueryStats::heap_time);
                 init_result(simi, idxi);
+                if (shared_bounds) {
+                    share_bound(i, simi, idxi);
+                }
+            }
 
-                idx_t nscan = 0;
-
-                // loop over probes
-                for (size_t ik = 0; ik < nprobe; ik++) {
-                    nscan += scan_one_list(
-                            keys[i * nprobe + ik],
-                            coarse_dis[i * nprobe + ik],
-                            simi,
-                            idxi,
-                            max_codes - nscan);
-                    if (nscan >= max_codes) {
-                        break;
-                    }
+            idx_t nscan = 0;
+
+            // loop over probes
+            for (size_t ik = 0; ik < nprobe; ik++) {
+                nscan += scan_one_list(
+                        keys[i * nprobe + ik],
+                        coarse_dis[i * nprobe + ik],
+                        simi,
+                        idxi,
+                        max_codes - nscan,
+                        qs);
+                if (shared_bounds) {
+                    share_bound(i, simi, idxi);
+                }
+                if (nscan >= max_codes) {
+                    break;
                 }
+            }
 
-                ndis += nscan;
-                reorder_result(simi, idxi);
+            ndis += nscan;
+            reorder_result(simi, idxi, qs);
+            if (qs) {
+                search_stats->end_query(*qs);
+            }
 
-                if (InterruptCallback::is_interrupted()) {
-                    interrupt = true;
-                }
+            if (InterruptCallback::is_interrupted()) {
+                interrupt = true;
+            }
+        };
+
+        // scan probe ij = i * nprobe + ik into a local heap and merge it
+        // into the (initialized) result heap of query i
+        std::vector<idx_t> probe_idx;
+        std::vector<float> probe_dis;
+        if (pmode == 1 || pmode == 2) {
+            probe_idx.resize(k);
+            probe_dis.resize(k);
+        }
+        auto search_probe = [&](int64_t ij) {
+            size_t i = ij / nprobe;
+            QueryStats local_qs;
+            QueryStats* qs = query_stats ? &local_qs : nullptr;
 
-            } // parallel for
+            {
+                QueryStatsTimer timer(qs, &QueryStats::lut_time);
+                scanner->set_query(x + i * d);
+            }
+            init_result(probe_dis.data(), probe_idx.data());
+            ndis += scan_one_list(
+                    keys[ij],
+                    coarse_dis[ij],
+                    probe_dis.data(),
+                    probe_idx.data(),
+                    unlimited_list_size,
+                    qs);
+            std::lock_guard<std::mutex> lock(merge_mutex);
+            add_local_results(
+                    probe_dis.data(),
+                    probe_idx.data(),
+                    distances + i * k,
+                    labels + i * k);
+            if (qs) {
+                query_stats[i].add(local_qs);
+            }
+        };
+
+        /****************************************************
+         * Actual loops, depending on parallel_mode
+         ****************************************************/
+
+        if (task >= 0) {
+            int64_t nwork = pmode == 0 || pmode == 3 ? n : n * nprobe;
+            int64_t j0 = nwork * task / ntask;
+            int64_t j1 = nwork * (task + 1) / ntask;
+            for (int64_t j = j0; j < j1; j++) {
+                if (pmode == 0 || pmode == 3) {
+                    search_query(j);
+                } else {
+                    search_probe(j);
+                }
+            }
+        } else if (pmode == 0 || pmode == 3) {
+#pragma omp for
+            for (idx_t i = 0; i < n; i++) {
+                search_query(i);
+            }
         } else if (pmode == 1) {
             std::vector<idx_t> local_idx(k);
             std::vector<float> local_dis(k);
+            QueryStats local_qs;
+            QueryStats* qs = query_stats ? &local_qs : nullptr;
 
             for (size_t i = 0; i < n; i++) {
-                scanner->set_query(x + i * d);
+                {
+                    QueryStatsTimer timer(qs, &QueryStats::lut_time);
+                    scanner->set_query(x + i * d);
+                }
                 init_result(local_dis.data(), local_idx.data());
 
 #pragma omp for schedule(dynamic)
@@ -636,7 +985,8 @@ void IndexIVF::search_preassigned(
                             coarse_dis[i * nprobe + ik],
                             local_dis.data(),
                             local_idx.data(),
-                            unlimited_list_size);
+                            unlimited_list_size,
+                            qs);
 
                     // can't do the test on max_codes
                 }
@@ -652,15 +1002,22 @@ void IndexIVF::search_preassigned(
                 {
                     add_local_results(
                             local_dis.data(), local_idx.data(), simi, idxi);
+                    if (qs) {
+                        query_stats[i].add(local_qs);
+                        local_qs = QueryStats();
+                    }
                 }
 #pragma omp barrier
 #pragma omp single
-                reorder_result(simi, idxi);
+                {
+                    reorder_result(
+                            simi, idxi, qs ? query_stats + i : nullptr);
+                    if (qs) {
+                        search_stats->end_query(query_stats[i]);
+                    }
+                }
             }
         } else if (pmode == 2) {
-            std::vector<idx_t> local_idx(k);
-            std::vector<float> local_dis(k);
-
 #pragma omp single
             for (int64_t i = 0; i < n; i++) {
                 init_result(distances + i * k, labels + i * k);
@@ -668,33 +1025,64 @@ void IndexIVF::search_preassigned(
 
 #pragma omp for schedule(dynamic)
             for (int64_t ij = 0; ij < n * nprobe; ij++) {
-                size_t i = ij / nprobe;
-
-                scanner->set_query(x + i * d);
-                init_result(local_dis.data(), local_idx.data());
-                ndis += scan_one_list(
-                        keys[ij],
-                        coarse_dis[ij],
-                        local_dis.data(),
-                        local_idx.data(),
-                        unlimited_list_size);
-#pragma omp critical
-                {
-                    add_local_results(
-                            local_dis.data(),
-                            local_idx.data(),
-                            distances + i * k,
-                            labels + i * k);
-                }
+                search_probe(ij);
             }
 #pragma omp single
             for (int64_t i = 0; i < n; i++) {
-                reorder_result(distances + i * k, labels + i * k);
+                QueryStats* qs = query_stats ? query_stats + i : nullptr;
+                reorder_result(distances + i * k, labels + i * k, qs);
+                if (qs) {
+                    search_stats->end_query(*qs);
+                }
             }
         } else {
             FAISS_THROW_FMT("parallel_mode %d not supported\n", pmode);
         }
-    } // parallel section
+    };
+
+    if (do_parallel && search_executor) {
+        bool by_query = pmode == 0 || pmode == 3;
+        // more tasks than threads for the (query, probe) pairs, whose
+        // costs depend on the list sizes
+        int64_t ntask = by_query
+                ? std::min(int64_t(max_threads), int64_t(n))
+                : std::min(int64_t(max_threads) * 4, int64_t(n * nprobe));
+        std::vector<size_t> task_nlistv(ntask), task_ndis(ntask),
+                task_nheap(ntask);
+        if (!by_query) {
+            for (idx_t i = 0; i < n; i++) {
+                init_result(distances + i * k, labels + i * k);
+            }
+        }
+        parallel_for(ntask, [&](int64_t task) {
+            search_thread(
+                    task,
+                    ntask,
+                    task_nlistv[task],
+                    task_ndis[task],
+                    task_nheap[task]);
+        });
+        if (!by_query) {
+            for (idx_t i = 0; i < n; i++) {
+                QueryStats* qs = query_stats ? query_stats + i : nullptr;
+                if (do_heap_init) {
+                    QueryStatsTimer timer(qs, &QueryStats::heap_time);
+                    reorder_heap(distances + i * k, labels + i * k);
+                }
+                if (qs) {
+                    search_stats->end_query(*qs);
+                }
+            }
+        }
+        for (int64_t task = 0; task < ntask; task++) {
+            nlistv += task_nlistv[task];
+            ndis += task_ndis[task];
+            nheap += task_nheap[task];
+        }
+    } else {
+#pragma omp parallel if (do_parallel) reduction(+ : nlistv, ndis, nheap) num_threads(num_omp_threads)
+        search_thread(-1, 0, nlistv, ndis, nheap);
+    }
 
     if (interrupt) {
         if (!exception_string.empty()) {
@@ -781,11 +1169,11 @@ void IndexIVF::range_search_preassigned(
     std::mutex exception_mutex;
     std::string exception_string;
 
-    std::vector<RangeSearchPartialResult*> all_pres(omp_get_max_threads());
-
     int pmode = this->parallel_mode & ~PARALLEL_MODE_NO_HEAP_INIT;
+    int max_threads =
+            search_executor ? parallel_num_threads() : omp_get_max_threads();
     // don't start parallel section if single query
-    bool do_parallel = omp_get_max_threads() >= 2 &&
+    bool do_parallel = max_threads >= 2 &&
             (pmode == 3           ? false
                      : pmode == 0 ? nx > 1
                      : pmode == 1 ? nprobe > 1
@@ -794,13 +1182,16 @@ void IndexIVF::range_search_preassigned(
     void* inverted_list_context =
             params ? params->inverted_list_context : nullptr;
 
-#pragma omp parallel if (do_parallel) reduction(+ : nlistv, ndis) num_threads(num_omp_threads)
-    {
-        RangeSearchPartialResult pres(result);
-        std::unique_ptr<InvertedListScanner> scanner(
-                get_InvertedListScanner(store_pairs, sel));
+    // Search run by each thread of the OpenMP team (task < 0), or by each
+    // of the ntask tasks of the search executor, that process a slice of
+    // the queries (parallel_mode 0) or of the (query, probe) pairs.
+    auto range_search_thread = [&](int64_t task,
+                                   int64_t ntask,
+                                   RangeSearchPartialResult& pres,
+                                   size_t& nlistv,
+                                   size_t& ndis) {
+        ScopedScanner scanner(*this, store_pairs, sel, nx == 1 && task < 0);
         FAISS_THROW_IF_NOT(scanner.get());
-        all_pres[omp_get_thread_num()] = &pres;
 
         // prepare the list scanning function
 
@@ -846,7 +1237,26 @@ void IndexIVF::range_search_preassigned(
             }
         };
 
-        if (parallel_mode == 0) {
+        if (task >= 0) {
+            int64_t nwork = parallel_mode == 0 ? nx : nx * nprobe;
+            int64_t j0 = nwork * task / ntask;
+            int64_t j1 = nwork * (task + 1) / ntask;
+            RangeQueryResult* qres = nullptr;
+            for (int64_t j = j0; j < j1; j++) {
+                idx_t i = parallel_mode == 0 ? j : j / nprobe;
+                if (qres == nullptr || qres->qno != i) {
+                    qres = &pres.new_result(i);
+                    scanner->set_query(x + i * d);
+                }
+                if (parallel_mode == 0) {
+                    for (size_t ik = 0; ik < nprobe; ik++) {
+                        scan_list_func(i, ik, *qres);
+                    }
+                } else {
+                    scan_list_func(i, j % nprobe, *qres);
+                }
+            }
+        } else if (parallel_mode == 0) {
 #pragma omp for
             for (idx_t i = 0; i < nx; i++) {
                 scanner->set_query(x + i * d);
@@ -885,13 +1295,51 @@ void IndexIVF::range_search_preassigned(
         } else {
             FAISS_THROW_FMT("parallel_mode %d not supported\n", parallel_mode);
         }
-        if (parallel_mode == 0) {
-            pres.finalize();
-        } else {
+    };
+
+    if (do_parallel && search_executor) {
+        // the partial results are merged by the caller
+        int64_t ntask = parallel_mode == 0
+                ? std::min(int64_t(max_threads), int64_t(nx))
+                : std::min(int64_t(max_threads) * 4, int64_t(nx * nprobe));
+        std::vector<std::unique_ptr<RangeSearchPartialResult>> task_pres(
+                ntask);
+        std::vector<RangeSearchPartialResult*> all_pres(ntask);
+        for (int64_t task = 0; task < ntask; task++) {
+            task_pres[task].reset(new RangeSearchPartialResult(result));
+            all_pres[task] = task_pres[task].get();
+        }
+        std::vector<size_t> task_nlistv(ntask), task_ndis(ntask);
+        parallel_for(ntask, [&](int64_t task) {
+            range_search_thread(
+                    task,
+                    ntask,
+                    *task_pres[task],
+                    task_nlistv[task],
+                    task_ndis[task]);
+        });
+        RangeSearchPartialResult::merge(all_pres, false);
+        for (int64_t task = 0; task < ntask; task++) {
+            nlistv += task_nlistv[task];
+            ndis += task_ndis[task];
+        }
+    } else {
+        std::vector<RangeSearchPartialResult*> all_pres(
+                omp_get_max_threads());
+
+#pragma omp parallel if (do_parallel) reduction(+ : nlistv, ndis) num_threads(num_omp_threads)
+        {
+            RangeSearchPartialResult pres(result);
+            all_pres[omp_get_thread_num()] = &pres;
+            range_search_thread(-1, 0, pres, nlistv, ndis);
+            if (parallel_mode == 0) {
+                pres.finalize();
+            } else {
 #pragma omp barrier
 #pragma omp single
-            RangeSearchPartialResult::merge(all_pres, false);
+                RangeSearchPartialResult::merge(all_pres, false);
 #pragma omp barrier
+            }
         }
     }
 
@@ -923,6 +1371,28 @@ void IndexIVF::reconstruct(idx_t key, float* recons) const {
     reconstruct_from_offset(lo_listno(lo), lo_offset(lo), recons);
 }
 
+void IndexIVF::reconstruct_batch(idx_t n, const idx_t* keys, float* recons)
+        const {
+    std::vector<idx_t> los(n);
+    direct_map.get_batch(n, keys, los.data());
+
+    std::mutex exception_mutex;
+    std::string exception_string;
+#pragma omp parallel for if (n > 1000) num_threads(num_omp_threads)
+    for (idx_t i = 0; i < n; i++) {
+        try {
+            reconstruct_from_offset(
+                    lo_listno(los[i]), lo_offset(los[i]), recons + i * d);
+        } catch (const std::exception& e) {
+            std::lock_guard<std::mutex> lock(exception_mutex);
+            exception_string = e.what();
+        }
+    }
+    if (!exception_string.empty()) {
+        FAISS_THROW_MSG(exception_string.c_str());
+    }
+}
+
 void IndexIVF::reconstruct_n(idx_t i0, idx_t ni, float* recons) const {
     FAISS_THROW_IF_NOT(ni == 0 || (i0 >= 0 && i0 + ni <= ntotal));
 
@@ -1138,6 +1608,7 @@ void IndexIVF::update_vectors(int n, const idx_t* new_ids, const float* x) {
 }
 
 void IndexIVF::train(idx_t n, const float* x) {
+    search_cache_key.invalidate();
     if (verbose) {
         printf("Training level-1 quantizer\n");
     }
@@ -1281,6 +1752,15 @@ IndexIVFStats indexIVF_stats;
  * InvertedListScanner
  *************************************************************************/
 
+void InvertedListScanner::distances_to_codes(
+        size_t n,
+        const uint8_t* codes,
+        float* distances) const {
+    for (size_t j = 0; j < n; j++) {
+        distances[j] = distance_to_code(codes + j * code_size);
+    }
+}
+
 size_t InvertedListScanner::scan_codes(
         size_t list_size,
         const uint8_t* codes,
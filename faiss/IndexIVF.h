@@ -17,6 +17,7 @@
 
 #include <faiss/Clustering.h>
 #include <faiss/Index.h>
+#include <faiss/impl/AuxIndexStructures.h>
 #include <faiss/impl/IDSelector.h>
 #include <faiss/impl/platform_macros.h>
 #include <faiss/invlists/DirectMap.h>
@@ -83,6 +84,7 @@ using IVFSearchParameters = SearchParametersIVF;
 
 struct InvertedListScanner;
 struct IndexIVFStats;
+struct QueryStats;
 struct CodePacker;
 
 struct IndexIVFInterface : Level1Quantizer {
@@ -201,6 +203,13 @@ struct IndexIVF : Index, IndexIVFInterface {
     /// centroids?
     bool by_residual = true;
 
+    /** Single-query searches keep their InvertedListScanner per thread,
+     * keyed on this value. It changes with train(); call
+     * search_cache_key.invalidate() after modifying the quantizer or the
+     * encoder in place. The search fields copied by the scanners are
+     * checked by InvertedListScanner::is_reusable. */
+    SearchCacheKey search_cache_key;
+
     /** The Inverted file takes a quantizer (an Index) on input,
      * which implements the function mapping a vector to a list
      * identifier.
@@ -321,6 +330,10 @@ struct IndexIVF : Index, IndexIVFInterface {
      */
     void reconstruct(idx_t key, float* recons) const override;
 
+    /// looks up all the keys in the direct map in one batch
+    void reconstruct_batch(idx_t n, const idx_t* keys, float* recons)
+            const override;
+
     /** Update a subset of vectors.
      *
      * The index must have a direct_map
@@ -493,6 +506,14 @@ struct InvertedListScanner {
     /// compute a single query-to-code distance
     virtual float distance_to_code(const uint8_t* code) const = 0;
 
+    /** compute the distances to n consecutive codes, same as
+     * distance_to_code on each of them. The default implementation calls
+     * distance_to_code, the scanners override it with a batched loop. */
+    virtual void distances_to_codes(
+            size_t n,
+            const uint8_t* codes,
+            float* distances) const;
+
     /** scan a set of codes, compute distances to current query and
      * update heap of results if necessary. Default implemetation
      * calls distance_to_code.
@@ -539,6 +560,14 @@ struct InvertedListScanner {
             RangeQueryResult& result,
             size_t& list_size) const;
 
+    /** whether the scanner can be used for other queries of the index it
+     * was created from. Scanners that copy search fields of the index
+     * (by_residual, etc.) check that they are unchanged. By default
+     * scanners are not reused. */
+    virtual bool is_reusable(const IndexIVF& /* index */) const {
+        return false;
+    }
+
     virtual ~InvertedListScanner() {}
 };
 
@@ -553,6 +582,10 @@ struct IndexIVFStats {
     double quantization_time; // time spent quantizing vectors (in ms)
     double search_time;       // time spent searching lists (in ms)
 
+    /// if non-null, per-query stats of the queries searched with these
+    /// stats (not accumulated by add)
+    QueryStats* query_stats;
+
     IndexIVFStats() {
         reset();
     }
@@ -145,6 +145,10 @@ struct IVFFlatScanner : InvertedListScanner {
         this->list_no = list_no;
     }
 
+    bool is_reusable(const IndexIVF& /* index */) const override {
+        return true;
+    }
+
     float distance_to_code(const uint8_t* code) const override {
         const float* yj = (float*)code;
         float dis = metric == METRIC_INNER_PRODUCT
@@ -153,6 +157,16 @@ struct IVFFlatScanner : InvertedListScanner {
         return dis;
     }
 
+    void distances_to_codes(size_t n, const uint8_t* codes, float* dis)
+            const override {
+        const float* list_vecs = (const float*)codes;
+        if (metric == METRIC_INNER_PRODUCT) {
+            fvec_inner_products_ny(dis, xi, list_vecs, d, n);
+        } else {
+            fvec_L2sqr_ny(dis, xi, list_vecs, d, n);
+        }
+    }
+
     size_t scan_codes(
             size_t list_size,
             const uint8_t* codes,
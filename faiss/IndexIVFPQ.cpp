@@ -781,6 +781,19 @@ struct KnnSearchResults {
     }
 };
 
+// stores the distances of all the codes
+struct DistancesResults {
+    float* distances;
+
+    inline bool skip_entry(idx_t) {
+        return false;
+    }
+
+    inline void add(idx_t j, float dis) {
+        distances[j] = dis;
+    }
+};
+
 template <class C, bool use_sel>
 struct RangeSearchResults {
     idx_t key;
@@ -1215,6 +1228,13 @@ struct IVFPQScanner : IVFPQScannerT<idx_t, METRIC_TYPE, PQDecoder>,
         this->init_list(list_no, coarse_dis, precompute_mode);
     }
 
+    bool is_reusable(const IndexIVF& index) const override {
+        const IndexIVFPQ& ivfpq = this->ivfpq;
+        return &index == &ivfpq && this->by_residual == ivfpq.by_residual &&
+                this->use_precomputed_table == ivfpq.use_precomputed_table &&
+                this->polysemous_ht == ivfpq.polysemous_ht;
+    }
+
     float distance_to_code(const uint8_t* code) const override {
         assert(precompute_mode == 2);
         float dis = this->dis0 +
@@ -1223,6 +1243,21 @@ struct IVFPQScanner : IVFPQScannerT<idx_t, METRIC_TYPE, PQDecoder>,
         return dis;
     }
 
+    // the polysemous filter does not apply, as in distance_to_code
+    void distances_to_codes(size_t ncode, const uint8_t* codes, float* dis)
+            const override {
+        DistancesResults res = {dis};
+        if (precompute_mode == 2) {
+            this->scan_list_with_table(ncode, codes, res);
+        } else if (precompute_mode == 1) {
+            this->scan_list_with_pointer(ncode, codes, res);
+        } else if (precompute_mode == 0) {
+            this->scan_on_the_fly_dist(ncode, codes, res);
+        } else {
+            FAISS_THROW_MSG("bad precomp mode");
+        }
+    }
+
     size_t scan_codes(
             size_t ncode,
             const uint8_t* codes,
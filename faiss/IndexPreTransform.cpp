@@ -9,6 +9,7 @@
 
 #include <faiss/IndexPreTransform.h>
 
+#include <algorithm>
 #include <cmath>
 #include <cstdio>
 #include <cstring>
@@ -141,10 +142,58 @@ void IndexPreTransform::reverse_chain(idx_t n, const float* xt, float* x)
     }
 }
 
+int index_pretransform_bs = 16384;
+
+namespace {
+
+/** Apply the chain by blocks of index_pretransform_bs vectors and call
+ * f(i0, i1, xt) on the transformed vectors of each block. The two
+ * buffers are allocated once and used alternately by the transforms. */
+template <class F>
+void apply_chain_by_blocks(
+        const IndexPreTransform& index,
+        idx_t n,
+        const float* x,
+        F f) {
+    const std::vector<VectorTransform*>& chain = index.chain;
+    idx_t bs = index_pretransform_bs;
+    if (chain.empty() || n == 0) {
+        f(0, n, x);
+        return;
+    }
+    if (bs <= 0 || n <= bs) {
+        TransformedVectors tv(x, index.apply_chain(n, x));
+        f(0, n, tv.x);
+        return;
+    }
+    int dmax = 0;
+    for (const VectorTransform* vt : chain) {
+        dmax = std::max(dmax, vt->d_out);
+    }
+    std::vector<float> buf[2];
+    buf[0].resize(bs * dmax);
+    buf[1].resize(bs * dmax);
+
+    for (idx_t i0 = 0; i0 < n; i0 += bs) {
+        idx_t i1 = std::min(i0 + bs, n);
+        const float* xi = x + i0 * index.d;
+        for (size_t s = 0; s < chain.size(); s++) {
+            float* xo = buf[s % 2].data();
+            chain[s]->apply_noalloc(i1 - i0, xi, xo);
+            xi = xo;
+        }
+        f(i0, i1, xi);
+    }
+}
+
+} // namespace
+
 void IndexPreTransform::add(idx_t n, const float* x) {
     FAISS_THROW_IF_NOT(is_trained);
-    TransformedVectors tv(x, apply_chain(n, x));
-    index->add(n, tv.x);
+    auto add_block = [&](idx_t i0, idx_t i1, const float* xt) {
+        index->add(i1 - i0, xt);
+    };
+    apply_chain_by_blocks(*this, n, x, add_block);
     ntotal = index->ntotal;
 }
 
@@ -153,8 +202,10 @@ void IndexPreTransform::add_with_ids(
         const float* x,
         const idx_t* xids) {
     FAISS_THROW_IF_NOT(is_trained);
-    TransformedVectors tv(x, apply_chain(n, x));
-    index->add_with_ids(n, tv.x, xids);
+    auto add_block = [&](idx_t i0, idx_t i1, const float* xt) {
+        index->add_with_ids(i1 - i0, xt, xids ? xids + i0 : nullptr);
+    };
+    apply_chain_by_blocks(*this, n, x, add_block);
     ntotal = index->ntotal;
 }
 
@@ -177,10 +228,17 @@ void IndexPreTransform::search(
         const SearchParameters* params) const {
     FAISS_THROW_IF_NOT(k > 0);
     FAISS_THROW_IF_NOT(is_trained);
-    const float* xt = apply_chain(n, x);
-    std::unique_ptr<const float[]> del(xt == x ? nullptr : xt);
-    index->search(
-            n, xt, k, distances, labels, extract_index_search_params(params));
+    const SearchParameters* sub_params = extract_index_search_params(params);
+    auto search_block = [&](idx_t i0, idx_t i1, const float* xt) {
+        index->search(
+                i1 - i0,
+                xt,
+                k,
+                distances + i0 * k,
+                labels + i0 * k,
+                sub_params);
+    };
+    apply_chain_by_blocks(*this, n, x, search_block);
 }
 
 void IndexPreTransform::range_search(
@@ -261,8 +319,11 @@ size_t IndexPreTransform::sa_code_size() const {
 
 void IndexPreTransform::sa_encode(idx_t n, const float* x, uint8_t* bytes)
         const {
-    TransformedVectors tv(x, apply_chain(n, x));
-    index->sa_encode(n, tv.x, bytes);
+    size_t code_size = index->sa_code_size();
+    auto encode_block = [&](idx_t i0, idx_t i1, const float* xt) {
+        index->sa_encode(i1 - i0, xt, bytes + i0 * code_size);
+    };
+    apply_chain_by_blocks(*this, n, x, encode_block);
 }
 
 void IndexPreTransform::sa_decode(idx_t n, const uint8_t* bytes, float* x)
@@ -300,19 +361,27 @@ namespace {
 struct PreTransformDistanceComputer : DistanceComputer {
     const IndexPreTransform* index;
     std::unique_ptr<DistanceComputer> sub_dc;
-    std::unique_ptr<const float[]> query;
+    /// transformed query, reused across set_query calls
+    std::vector<float> query[2];
 
     explicit PreTransformDistanceComputer(const IndexPreTransform* index)
-            : index(index), sub_dc(index->index->get_distance_computer()) {}
+            : index(index), sub_dc(index->index->get_distance_computer()) {
+        int dmax = 0;
+        for (const VectorTransform* vt : index->chain) {
+            dmax = std::max(dmax, vt->d_out);
+        }
+        query[0].resize(dmax);
+        query[1].resize(dmax);
+    }
 
     void set_query(const float* x) override {
-        const float* xt = index->apply_chain(1, x);
-        if (xt == x) {
-            sub_dc->set_query(x);
-        } else {
-            query.reset(xt);
-            sub_dc->set_query(xt);
+        const float* xt = x;
+        for (size_t s = 0; s < index->chain.size(); s++) {
+            float* xo = query[s % 2].data();
+            index->chain[s]->apply_noalloc(1, xt, xo);
+            xt = xo;
         }
+        sub_dc->set_query(xt);
     }
 
     float symmetric_dis(idx_t i, idx_t j) override {
@@ -99,4 +99,9 @@ struct IndexPreTransform : Index {
     ~IndexPreTransform() override;
 };
 
+/// add, add_with_ids, search and sa_encode stream the vectors through the
+/// chain by blocks of this size, so that the transformed vectors are not
+/// materialized for the whole batch (0 = no blocking)
+FAISS_API extern int index_pretransform_bs;
+
 } // namespace faiss
@@ -5,10 +5,16 @@
  * LICENSE file in the root directory of this source tree.
  */
 
+#include <algorithm>
+#include <chrono>
 #include <cinttypes>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
 
 #include <faiss/IndexReplicas.h>
 #include <faiss/impl/FaissAssert.h>
+#include <faiss/utils/utils.h>
 
 namespace faiss {
 
@@ -23,6 +29,47 @@ void sync_d(IndexBinary* index) {
     index->code_size = index->d / 8;
 }
 
+/// state of a search by micro-batches, shared by the replica workers. It
+/// outlives the search call if a hedged micro-batch is still running.
+template <typename component_t, typename distance_t>
+struct MicroBatchSearch {
+    std::mutex mutex;
+    std::condition_variable cv;
+
+    idx_t n, k, bs, nbatch;
+    size_t components_per_vec;
+    const component_t* x;
+    std::vector<component_t> x_copy; // when hedging
+
+    // output, written only while the search is not finished
+    distance_t* distances;
+    idx_t* labels;
+    std::vector<double>* latency; ///< protected by latency_mutex
+    std::mutex* latency_mutex;
+    double alpha;
+
+    idx_t next = 0; ///< next micro-batch to issue
+    idx_t ndone = 0;
+    std::vector<bool> done;
+    std::vector<int> runner;     ///< replica of the first issue
+    std::vector<double> t_start; ///< time of the first issue
+    std::vector<int> nissue;
+    int nrunning = 0; ///< nb of micro-batch searches in flight
+    bool finished = false;
+    std::string error;
+
+    double get_latency(int r) {
+        std::lock_guard<std::mutex> guard(*latency_mutex);
+        return (*latency)[r];
+    }
+
+    void update_latency(int r, double ms_per_query) {
+        std::lock_guard<std::mutex> guard(*latency_mutex);
+        double& l = (*latency)[r];
+        l = l == 0 ? ms_per_query : (1 - alpha) * l + alpha * ms_per_query;
+    }
+};
+
 } // anonymous namespace
 
 template <typename IndexT>
@@ -72,9 +119,20 @@ void IndexReplicasTemplate<IndexT>::onAfterAddIndex(IndexT* index) {
 
 template <typename IndexT>
 void IndexReplicasTemplate<IndexT>::onAfterRemoveIndex(IndexT* index) {
+    {
+        std::lock_guard<std::mutex> guard(latency_mutex);
+        replica_latency.clear();
+    }
     syncWithSubIndexes();
 }
 
+template <typename IndexT>
+std::vector<double> IndexReplicasTemplate<IndexT>::get_replica_latency()
+        const {
+    std::lock_guard<std::mutex> guard(latency_mutex);
+    return replica_latency;
+}
+
 template <typename IndexT>
 void IndexReplicasTemplate<IndexT>::train(idx_t n, const component_t* x) {
     auto fn = [n, x](int i, IndexT* index) {
@@ -136,6 +194,11 @@ void IndexReplicasTemplate<IndexT>::search(
         return;
     }
 
+    if (micro_batch_size > 0 && this->isThreaded_) {
+        search_micro_batches(n, x, k, distances, labels);
+        return;
+    }
+
     auto dim = this->d;
     size_t componentsPerVec = sizeof(component_t) == 1 ? (dim + 7) / 8 : dim;
 
@@ -173,6 +236,161 @@ void IndexReplicasTemplate<IndexT>::search(
     this->runOnIndex(fn);
 }
 
+template <typename IndexT>
+void IndexReplicasTemplate<IndexT>::search_micro_batches(
+        idx_t n,
+        const component_t* x,
+        idx_t k,
+        distance_t* distances,
+        idx_t* labels) const {
+    using State = MicroBatchSearch<component_t, distance_t>;
+    auto state = std::make_shared<State>();
+    int nrep = this->count();
+    {
+        std::lock_guard<std::mutex> guard(latency_mutex);
+        if (replica_latency.size() != nrep) {
+            replica_latency.assign(nrep, 0);
+        }
+    }
+
+    state->n = n;
+    state->k = k;
+    state->bs = micro_batch_size;
+    state->nbatch = (n + micro_batch_size - 1) / micro_batch_size;
+    state->components_per_vec =
+            sizeof(component_t) == 1 ? (this->d + 7) / 8 : this->d;
+    if (hedge_factor > 0) {
+        // a hedged micro-batch may run after we return
+        state->x_copy.assign(x, x + n * state->components_per_vec);
+        state->x = state->x_copy.data();
+    } else {
+        state->x = x;
+    }
+    state->distances = distances;
+    state->labels = labels;
+    state->latency = &replica_latency;
+    state->latency_mutex = &latency_mutex;
+    state->alpha = latency_ewma_alpha;
+    state->done.resize(state->nbatch, false);
+    state->runner.resize(state->nbatch, -1);
+    state->t_start.resize(state->nbatch, 0);
+    state->nissue.resize(state->nbatch, 0);
+
+    double hedge_factor = this->hedge_factor;
+
+    // each replica pulls micro-batches until there are none left, then
+    // possibly hedges the ones that are late
+    auto work = [state, hedge_factor](int r, const IndexT* index) {
+        State& s = *state;
+        std::vector<distance_t> D;
+        std::vector<idx_t> I;
+        std::unique_lock<std::mutex> lock(s.mutex);
+        for (;;) {
+            if (s.finished || !s.error.empty()) {
+                return;
+            }
+            idx_t b = -1;
+            double wait_ms = -1;
+            double t0 = getmillisecs();
+            if (s.next < s.nbatch) {
+                b = s.next++;
+                s.runner[b] = r;
+                s.t_start[b] = t0;
+            } else if (hedge_factor > 0) {
+                for (idx_t j = 0; j < s.nbatch; j++) {
+                    int rj = s.runner[j];
+                    if (s.done[j] || s.nissue[j] > 1 || rj == r) {
+                        continue;
+                    }
+                    double latency_j = s.get_latency(rj);
+                    if (latency_j == 0) {
+                        continue;
+                    }
+                    idx_t nj = std::min(s.bs, s.n - j * s.bs);
+                    double deadline =
+                            s.t_start[j] + hedge_factor * latency_j * nj;
+                    if (t0 >= deadline) {
+                        b = j;
+                        break;
+                    }
+                    if (wait_ms < 0 || deadline - t0 < wait_ms) {
+                        wait_ms = deadline - t0;
+                    }
+                }
+            }
+            if (b < 0) {
+                if (wait_ms < 0) {
+                    return; // nothing left that could be hedged
+                }
+                s.cv.wait_for(
+                        lock,
+                        std::chrono::microseconds(int64_t(wait_ms * 1000) + 1));
+                continue;
+            }
+            s.nissue[b]++;
+            s.nrunning++;
+            lock.unlock();
+
+            idx_t i0 = b * s.bs;
+            idx_t nb = std::min(s.bs, s.n - i0);
+            D.resize(nb * s.k);
+            I.resize(nb * s.k);
+            std::string error;
+            try {
+                index->search(
+                        nb,
+                        s.x + i0 * s.components_per_vec,
+                        s.k,
+                        D.data(),
+                        I.data());
+            } catch (const std::exception& e) {
+                error = e.what();
+            }
+            double t1 = getmillisecs();
+
+            lock.lock();
+            s.nrunning--;
+            if (s.finished || s.done[b]) {
+                s.cv.notify_all();
+                continue; // the other issue won
+            }
+            if (!error.empty()) {
+                s.error = error;
+                s.cv.notify_all();
+                return;
+            }
+            std::copy(D.begin(), D.end(), s.distances + i0 * s.k);
+            std::copy(I.begin(), I.end(), s.labels + i0 * s.k);
+            s.done[b] = true;
+            s.ndone++;
+            s.update_latency(r, (t1 - t0) / nb);
+            if (s.runner[b] != r) {
+                // the first issue is late, its time is at least this
+                s.update_latency(s.runner[b], (t1 - s.t_start[b]) / nb);
+            }
+            s.cv.notify_all();
+        }
+    };
+
+    for (int r = 0; r < nrep; r++) {
+        const IndexT* index = this->at(r);
+        this->indices_[r].second->add([work, r, index]() { work(r, index); });
+    }
+
+    // on error, wait for the searches that use x, unless it is a copy
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->cv.wait(lock, [&state, hedge_factor]() {
+        return state->ndone == state->nbatch ||
+                (!state->error.empty() &&
+                 (hedge_factor > 0 || state->nrunning == 0));
+    });
+    state->finished = true;
+    state->cv.notify_all();
+    if (!state->error.empty()) {
+        FAISS_THROW_MSG(state->error.c_str());
+    }
+}
+
 // FIXME: assumes that nothing is currently running on the sub-indexes, which is
 // true with the normal API, but should use the runOnIndex API instead
 template <typename IndexT>
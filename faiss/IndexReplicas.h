@@ -11,6 +11,9 @@
 #include <faiss/IndexBinary.h>
 #include <faiss/impl/ThreadedIndex.h>
 
+#include <mutex>
+#include <vector>
+
 namespace faiss {
 
 /// Takes individual faiss::Index instances, and splits queries for
@@ -58,7 +61,8 @@ class IndexReplicasTemplate : public ThreadedIndex<IndexT> {
 
     /// faiss::Index API
     /// Query is partitioned into a slice for each sub-index
-    /// split by ceil(n / #indices) for our sub-indices
+    /// split by ceil(n / #indices) for our sub-indices, or into
+    /// micro-batches if micro_batch_size > 0
     void search(
             idx_t n,
             const component_t* x,
@@ -74,7 +78,39 @@ class IndexReplicasTemplate : public ThreadedIndex<IndexT> {
     /// sub-indices
     void syncWithSubIndexes();
 
+    /// if > 0, the queries are cut into micro-batches of this size that
+    /// the replicas pull as they become idle, so that a slow replica does
+    /// not delay the whole search (threaded mode only)
+    idx_t micro_batch_size = 0;
+
+    /// if > 0, an idle replica re-issues a micro-batch that has been
+    /// running on another replica for more than hedge_factor times its
+    /// expected time, the first result is kept. The search then returns
+    /// without waiting for the straggler.
+    double hedge_factor = 0;
+
+    /// weight of the last measurement in the latency estimates
+    double latency_ewma_alpha = 0.2;
+
+    /// copy of the latency estimates of the replicas (ms per query),
+    /// 0 = no measurement yet
+    std::vector<double> get_replica_latency() const;
+
    protected:
+    /// search time per query of each replica (ms), as an exponentially
+    /// weighted moving average. Concurrent searches access it under
+    /// latency_mutex
+    mutable std::vector<double> replica_latency;
+    mutable std::mutex latency_mutex;
+
+    /// search by micro-batches pulled by the replicas
+    void search_micro_batches(
+            idx_t n,
+            const component_t* x,
+            idx_t k,
+            distance_t* distances,
+            idx_t* labels) const;
+
     /// Called just after an index is added
     void onAfterAddIndex(IndexT* index) override;
 
@@ -11,11 +11,14 @@
 
 #include <algorithm>
 #include <cstdio>
+#include <cstring>
+#include <memory>
 
 #include <omp.h>
 
 
 #include <faiss/impl/AuxIndexStructures.h>
+#include <faiss/impl/CodePacker.h>
 #include <faiss/impl/FaissAssert.h>
 #include <faiss/impl/IDSelector.h>
 #include <faiss/impl/ScalarQuantizer.h>
@@ -33,7 +36,8 @@ IndexScalarQuantizer::IndexScalarQuantizer(
         MetricType metric)
         : IndexFlatCodes(0, d, metric), sq(d, qtype) {
     is_trained = qtype == ScalarQuantizer::QT_fp16 ||
-            qtype == ScalarQuantizer::QT_8bit_direct;
+            qtype == ScalarQuantizer::QT_8bit_direct ||
+            qtype == ScalarQuantizer::QT_bf16;
     code_size = sq.code_size;
 }
 
@@ -116,6 +120,270 @@ void IndexScalarQuantizer::sa_decode(idx_t n, const uint8_t* bytes, float* x)
     sq.decode(bytes, x, n);
 }
 
+/*******************************************************************
+ * IndexScalarQuantizerBlocked implementation
+ ********************************************************************/
+
+IndexScalarQuantizerBlocked::IndexScalarQuantizerBlocked(
+        int d,
+        ScalarQuantizer::QuantizerType qtype,
+        MetricType metric,
+        size_t bbs)
+        : IndexFlatCodes(0, d, metric), sq(d, qtype), bbs(bbs) {
+    FAISS_THROW_IF_NOT(bbs > 0);
+    is_trained = qtype == ScalarQuantizer::QT_fp16 ||
+            qtype == ScalarQuantizer::QT_8bit_direct ||
+            qtype == ScalarQuantizer::QT_bf16;
+    code_size = sq.code_size;
+}
+
+IndexScalarQuantizerBlocked::IndexScalarQuantizerBlocked(
+        const IndexScalarQuantizer& orig,
+        size_t bbs)
+        : IndexFlatCodes(orig.code_size, orig.d, orig.metric_type),
+          sq(orig.sq),
+          bbs(bbs) {
+    FAISS_THROW_IF_NOT(bbs > 0);
+    metric_arg = orig.metric_arg;
+    is_trained = orig.is_trained;
+    add_sa_codes(orig.ntotal, orig.codes.data());
+}
+
+IndexScalarQuantizerBlocked::IndexScalarQuantizerBlocked()
+        : IndexScalarQuantizerBlocked(0, ScalarQuantizer::QT_8bit) {}
+
+void IndexScalarQuantizerBlocked::train(idx_t n, const float* x) {
+    sq.train(n, x);
+    is_trained = true;
+}
+
+void IndexScalarQuantizerBlocked::add(idx_t n, const float* x) {
+    FAISS_THROW_IF_NOT(is_trained);
+    if (n == 0) {
+        return;
+    }
+    std::vector<uint8_t> flat_codes(n * code_size);
+    sa_encode(n, x, flat_codes.data());
+    add_sa_codes(n, flat_codes.data());
+}
+
+void IndexScalarQuantizerBlocked::add_sa_codes(
+        idx_t n,
+        const uint8_t* flat_codes) {
+    if (n == 0) {
+        return;
+    }
+    CodePackerInterleaved packer(code_size, bbs);
+    idx_t nblock = (ntotal + n + bbs - 1) / bbs;
+    codes.resize(nblock * packer.block_size);
+    for (idx_t i = 0; i < n; i++) {
+        idx_t j = ntotal + i;
+        packer.pack_1(
+                flat_codes + i * code_size,
+                j % bbs,
+                codes.data() + (j / bbs) * packer.block_size);
+    }
+    ntotal += n;
+}
+
+void IndexScalarQuantizerBlocked::get_sa_codes(
+        idx_t i0,
+        idx_t ni,
+        uint8_t* flat_codes) const {
+    FAISS_THROW_IF_NOT(ni == 0 || (i0 >= 0 && i0 + ni <= ntotal));
+    CodePackerInterleaved packer(code_size, bbs);
+    for (idx_t i = 0; i < ni; i++) {
+        idx_t j = i0 + i;
+        packer.unpack_1(
+                codes.data() + (j / bbs) * packer.block_size,
+                j % bbs,
+                flat_codes + i * code_size);
+    }
+}
+
+void IndexScalarQuantizerBlocked::search(
+        idx_t n,
+        const float* x,
+        idx_t k,
+        float* distances,
+        idx_t* labels,
+        const SearchParameters* params) const {
+    const IDSelector* sel = params ? params->sel : nullptr;
+
+    FAISS_THROW_IF_NOT(k > 0);
+    FAISS_THROW_IF_NOT(is_trained);
+    FAISS_THROW_IF_NOT(
+            metric_type == METRIC_L2 || metric_type == METRIC_INNER_PRODUCT);
+
+    size_t block_size = bbs * code_size;
+
+#pragma omp parallel if (n > 1) num_threads(num_omp_threads)
+    {
+        std::unique_ptr<ScalarQuantizer::SQBlockDistanceComputer> bdc(
+                sq.get_block_distance_computer(metric_type, bbs));
+        std::vector<float> dis(bbs);
+
+#pragma omp for
+        for (idx_t i = 0; i < n; i++) {
+            float* D = distances + k * i;
+            idx_t* I = labels + k * i;
+            if (metric_type == METRIC_L2) {
+                maxheap_heapify(k, D, I);
+            } else {
+                minheap_heapify(k, D, I);
+            }
+            bdc->set_query(x + i * d);
+            for (idx_t j0 = 0; j0 < ntotal; j0 += bbs) {
+                bdc->distances_block(
+                        codes.data() + (j0 / bbs) * block_size, dis.data());
+                idx_t nj = std::min(idx_t(bbs), ntotal - j0);
+                for (idx_t j = 0; j < nj; j++) {
+                    if (sel && !sel->is_member(j0 + j)) {
+                        continue;
+                    }
+                    if (metric_type == METRIC_L2) {
+                        if (dis[j] < D[0]) {
+                            maxheap_replace_top(k, D, I, dis[j], j0 + j);
+                        }
+                    } else {
+                        if (dis[j] > D[0]) {
+                            minheap_replace_top(k, D, I, dis[j], j0 + j);
+                        }
+                    }
+                }
+            }
+            if (metric_type == METRIC_L2) {
+                maxheap_reorder(k, D, I);
+            } else {
+                minheap_reorder(k, D, I);
+            }
+        }
+    }
+}
+
+void IndexScalarQuantizerBlocked::reconstruct_n(
+        idx_t i0,
+        idx_t ni,
+        float* recons) const {
+    std::vector<uint8_t> flat_codes(ni * code_size);
+    get_sa_codes(i0, ni, flat_codes.data());
+    sa_decode(ni, flat_codes.data(), recons);
+}
+
+size_t IndexScalarQuantizerBlocked::remove_ids(const IDSelector& sel) {
+    std::vector<uint8_t> flat_codes(ntotal * code_size);
+    get_sa_codes(0, ntotal, flat_codes.data());
+    idx_t j = 0;
+    for (idx_t i = 0; i < ntotal; i++) {
+        if (sel.is_member(i)) {
+            // should be removed
+        } else {
+            if (i > j) {
+                memmove(&flat_codes[code_size * j],
+                        &flat_codes[code_size * i],
+                        code_size);
+            }
+            j++;
+        }
+    }
+    size_t nremove = ntotal - j;
+    if (nremove > 0) {
+        reset();
+        add_sa_codes(j, flat_codes.data());
+    }
+    return nremove;
+}
+
+void IndexScalarQuantizerBlocked::merge_from(Index& otherIndex, idx_t add_id) {
+    FAISS_THROW_IF_NOT_MSG(add_id == 0, "cannot set ids in FlatCodes index");
+    check_compatible_for_merge(otherIndex);
+    IndexScalarQuantizerBlocked* other =
+            static_cast<IndexScalarQuantizerBlocked*>(&otherIndex);
+    std::vector<uint8_t> flat_codes(other->ntotal * code_size);
+    other->get_sa_codes(0, other->ntotal, flat_codes.data());
+    add_sa_codes(other->ntotal, flat_codes.data());
+    other->reset();
+}
+
+void IndexScalarQuantizerBlocked::permute_entries(const idx_t* perm) {
+    std::vector<uint8_t> flat_codes(ntotal * code_size);
+    get_sa_codes(0, ntotal, flat_codes.data());
+    std::vector<uint8_t> new_codes(ntotal * code_size);
+    for (idx_t i = 0; i < ntotal; i++) {
+        memcpy(new_codes.data() + i * code_size,
+               flat_codes.data() + perm[i] * code_size,
+               code_size);
+    }
+    idx_t n = ntotal;
+    reset();
+    add_sa_codes(n, new_codes.data());
+}
+
+namespace {
+
+/// reads the codes from the interleaved layout before computing distances
+struct BlockedSQDistanceComputer : FlatCodesDistanceComputer {
+    const IndexScalarQuantizerBlocked& index;
+    std::unique_ptr<ScalarQuantizer::SQDistanceComputer> dc;
+    std::vector<uint8_t> tmp;
+
+    explicit BlockedSQDistanceComputer(
+            const IndexScalarQuantizerBlocked& index)
+            : FlatCodesDistanceComputer(nullptr, index.code_size),
+              index(index),
+              dc(index.sq.get_distance_computer(index.metric_type)),
+              tmp(2 * index.code_size) {
+        dc->code_size = code_size;
+        dc->codes = tmp.data();
+    }
+
+    void set_query(const float* x) override {
+        dc->set_query(x);
+    }
+
+    float operator()(idx_t i) override {
+        index.get_sa_codes(i, 1, tmp.data());
+        return dc->query_to_code(tmp.data());
+    }
+
+    float distance_to_code(const uint8_t* code) override {
+        return dc->query_to_code(code);
+    }
+
+    float symmetric_dis(idx_t i, idx_t j) override {
+        index.get_sa_codes(i, 1, tmp.data());
+        index.get_sa_codes(j, 1, tmp.data() + code_size);
+        return dc->symmetric_dis(0, 1);
+    }
+};
+
+} // anonymous namespace
+
+FlatCodesDistanceComputer* IndexScalarQuantizerBlocked::
+        get_FlatCodesDistanceComputer() const {
+    return new BlockedSQDistanceComputer(*this);
+}
+
+CodePacker* IndexScalarQuantizerBlocked::get_CodePacker() const {
+    return new CodePackerInterleaved(code_size, bbs);
+}
+
+void IndexScalarQuantizerBlocked::sa_encode(
+        idx_t n,
+        const float* x,
+        uint8_t* bytes) const {
+    FAISS_THROW_IF_NOT(is_trained);
+    sq.compute_codes(x, bytes, n);
+}
+
+void IndexScalarQuantizerBlocked::sa_decode(
+        idx_t n,
+        const uint8_t* bytes,
+        float* x) const {
+    FAISS_THROW_IF_NOT(is_trained);
+    sq.decode(bytes, x, n);
+}
+
 /*******************************************************************
  * IndexIVFScalarQuantizer implementation
  ********************************************************************/
@@ -57,6 +57,71 @@ struct IndexScalarQuantizer : IndexFlatCodes {
     void sa_decode(idx_t n, const uint8_t* bytes, float* x) const override;
 };
 
+/**
+ * Flat index built on a scalar quantizer, where the codes are interleaved
+ * by blocks of bbs vectors (see CodePackerInterleaved). For the 8-bit
+ * quantizers, the distances are computed for a whole block at a time,
+ * which makes brute-force search faster than with IndexScalarQuantizer.
+ * The standalone codec interface (sa_encode / sa_decode) uses the
+ * regular, non-interleaved codes.
+ */
+struct IndexScalarQuantizerBlocked : IndexFlatCodes {
+    /// Used to encode the vectors
+    ScalarQuantizer sq;
+
+    /// number of vectors per block
+    size_t bbs;
+
+    IndexScalarQuantizerBlocked(
+            int d,
+            ScalarQuantizer::QuantizerType qtype,
+            MetricType metric = METRIC_L2,
+            size_t bbs = 32);
+
+    /// build from an IndexScalarQuantizer, copying its codes
+    explicit IndexScalarQuantizerBlocked(
+            const IndexScalarQuantizer& orig,
+            size_t bbs = 32);
+
+    IndexScalarQuantizerBlocked();
+
+    void train(idx_t n, const float* x) override;
+
+    void add(idx_t n, const float* x) override;
+
+    /// add vectors given as standalone (non-interleaved) codes
+    void add_sa_codes(idx_t n, const uint8_t* flat_codes);
+
+    /// get the standalone codes of vectors i0:i0+ni
+    void get_sa_codes(idx_t i0, idx_t ni, uint8_t* flat_codes) const;
+
+    void search(
+            idx_t n,
+            const float* x,
+            idx_t k,
+            float* distances,
+            idx_t* labels,
+            const SearchParameters* params = nullptr) const override;
+
+    void reconstruct_n(idx_t i0, idx_t ni, float* recons) const override;
+
+    size_t remove_ids(const IDSelector& sel) override;
+
+    void merge_from(Index& otherIndex, idx_t add_id = 0) override;
+
+    /// perm of size ntotal maps new to old positions
+    void permute_entries(const idx_t* perm) override;
+
+    FlatCodesDistanceComputer* get_FlatCodesDistanceComputer() const override;
+
+    CodePacker* get_CodePacker() const override;
+
+    /* standalone codec interface */
+    void sa_encode(idx_t n, const float* x, uint8_t* bytes) const override;
+
+    void sa_decode(idx_t n, const uint8_t* bytes, float* x) const override;
+};
+
 /** An IVF implementation where the components of the residuals are
  * encoded with a scalar quantizer. All distance computations
  * are asymmetric, so the encoded vectors are decoded and approximate
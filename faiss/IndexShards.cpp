@@ -7,10 +7,15 @@
 
 #include <faiss/IndexShards.h>
 
+#include <atomic>
 #include <cinttypes>
 #include <cstdio>
 #include <functional>
+#include <limits>
+#include <memory>
 
+#include <faiss/IndexIVF.h>
+#include <faiss/IndexIVFFastScan.h>
 #include <faiss/impl/FaissAssert.h>
 #include <faiss/utils/Heap.h>
 #include <faiss/utils/WorkerThread.h>
@@ -40,6 +45,50 @@ void translate_labels(int64_t n, idx_t* labels, int64_t translation) {
     }
 }
 
+// shards of float indexes share the k-th distances of the queries while
+// they are searched, the bound is passed to the IVF indexes. The fast-scan
+// IVF indexes do not use it (and some of them reject search parameters)
+
+bool shard_bounds_supported(const Index* index) {
+    return index->metric_type == METRIC_L2 ||
+            index->metric_type == METRIC_INNER_PRODUCT;
+}
+
+bool shard_bounds_supported(const IndexBinary* index) {
+    return false;
+}
+
+void search_shard(
+        const Index* index,
+        idx_t n,
+        const float* x,
+        idx_t k,
+        float* distances,
+        idx_t* labels,
+        SharedKnnBounds* bounds) {
+    auto ivf = dynamic_cast<const IndexIVF*>(index);
+    if (bounds && ivf && !dynamic_cast<const IndexIVFFastScan*>(index)) {
+        SearchParametersIVF params;
+        params.nprobe = ivf->nprobe;
+        params.max_codes = ivf->max_codes;
+        params.shared_bounds = bounds;
+        index->search(n, x, k, distances, labels, &params);
+    } else {
+        index->search(n, x, k, distances, labels);
+    }
+}
+
+void search_shard(
+        const IndexBinary* index,
+        idx_t n,
+        const uint8_t* x,
+        idx_t k,
+        int32_t* distances,
+        idx_t* labels,
+        SharedKnnBounds* bounds) {
+    index->search(n, x, k, distances, labels);
+}
+
 } // anonymous namespace
 
 template <typename IndexT>
@@ -219,18 +268,39 @@ void IndexShardsTemplate<IndexT>::search(
         }
     }
 
-    auto fn = [n, k, x, &all_distances, &all_labels, &translations](
+    // bounds on the k-th distance of each query
+    std::unique_ptr<std::atomic<float>[]> bound_tab;
+    SharedKnnBounds bounds;
+    SharedKnnBounds* pbounds = nullptr;
+    if (share_bounds && nshard > 1 && shard_bounds_supported(this)) {
+        bounds.is_max = this->metric_type == METRIC_L2;
+        bounds.x = x;
+        bounds.query_size = sizeof(component_t) * this->d;
+        bounds.n = n;
+        bound_tab.reset(new std::atomic<float>[n]);
+        float neutral = bounds.is_max ? std::numeric_limits<float>::max()
+                                      : std::numeric_limits<float>::lowest();
+        for (idx_t i = 0; i < n; i++) {
+            bound_tab[i].store(neutral, std::memory_order_relaxed);
+        }
+        bounds.bounds = bound_tab.get();
+        pbounds = &bounds;
+    }
+
+    auto fn = [n, k, x, &all_distances, &all_labels, &translations, pbounds](
                       int no, const IndexT* index) {
         if (index->verbose) {
             printf("begin query shard %d on %" PRId64 " points\n", no, n);
         }
 
-        index->search(
+        search_shard(
+                index,
                 n,
                 x,
                 k,
                 all_distances.data() + no * k * n,
-                all_labels.data() + no * k * n);
+                all_labels.data() + no * k * n,
+                pbounds);
 
         translate_labels(
                 n * k, all_labels.data() + no * k * n, translations[no]);
@@ -93,6 +93,12 @@ struct IndexShardsTemplate : public ThreadedIndex<IndexT> {
 
     bool successive_ids;
 
+    /** share the k-th distance of each query between the shards while they
+     * are searched, so that the shards skip the results that can not be in
+     * the merged top-k. Used for IVF shards of float indexes. The results
+     * are the same, up to ties on the k-th distance. Off by default. */
+    bool share_bounds = false;
+
     /// Synchronize the top-level index (IndexShards) with data in the
     /// sub-indices
     virtual void syncWithSubIndexes();
@@ -10,6 +10,11 @@
 
 #include <faiss/OMPConfig.h>
 
+#include <omp.h>
+#include <algorithm>
+#include <atomic>
+#include <exception>
+
 namespace faiss {
 
     unsigned int num_omp_threads = std::thread::hardware_concurrency();
@@ -17,4 +22,169 @@ namespace faiss {
     void set_num_omp_threads(unsigned int value) {
         num_omp_threads = value;
     }
+
+    Executor* search_executor = nullptr;
+
+    void set_search_executor(Executor* executor) {
+        search_executor = executor;
+    }
+
+    namespace {
+
+    // > 0 when the thread is running a task of parallel_for
+    thread_local int parallel_depth = 0;
+
+    struct DepthGuard {
+        DepthGuard() {
+            parallel_depth++;
+        }
+        ~DepthGuard() {
+            parallel_depth--;
+        }
+    };
+
+    } // namespace
+
+    int parallel_num_threads() {
+        if (parallel_depth > 0) {
+            return 1;
+        }
+        if (search_executor) {
+            return std::max(search_executor->num_threads(), 1);
+        }
+        return std::max(
+                std::min(omp_get_max_threads(), int(num_omp_threads)), 1);
+    }
+
+    void parallel_for(
+            int64_t ntask,
+            const std::function<void(int64_t)>& task) {
+        if (ntask <= 1 || parallel_depth > 0) {
+            DepthGuard guard;
+            for (int64_t i = 0; i < ntask; i++) {
+                task(i);
+            }
+            return;
+        }
+        if (search_executor) {
+            search_executor->run(ntask, [&task](int64_t i) {
+                DepthGuard guard;
+                task(i);
+            });
+            return;
+        }
+        std::exception_ptr error;
+        std::mutex error_mutex;
+        int nt = std::min(int64_t(num_omp_threads), ntask);
+#pragma omp parallel for schedule(dynamic) num_threads(nt)
+        for (int64_t i = 0; i < ntask; i++) {
+            DepthGuard guard;
+            try {
+                task(i);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(error_mutex);
+                if (!error) {
+                    error = std::current_exception();
+                }
+            }
+        }
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+
+    /*********************************************************
+     * ThreadPoolExecutor
+     *********************************************************/
+
+    struct ThreadPoolExecutor::Job {
+        const std::function<void(int64_t)>* task;
+        int64_t ntask;
+        std::atomic<int64_t> next{0};
+        int64_t ndone = 0; // protected by mutex
+        std::mutex mutex;
+        std::condition_variable cv;
+        std::exception_ptr error;
+
+        // run tasks of the job until there are none left
+        void run_tasks() {
+            int64_t i;
+            while ((i = next++) < ntask) {
+                std::exception_ptr e;
+                try {
+                    (*task)(i);
+                } catch (...) {
+                    e = std::current_exception();
+                }
+                std::lock_guard<std::mutex> lock(mutex);
+                if (e && !error) {
+                    error = e;
+                }
+                if (++ndone == ntask) {
+                    cv.notify_all();
+                }
+            }
+        }
+    };
+
+    ThreadPoolExecutor::ThreadPoolExecutor(int nthreads) {
+        // the calling thread of run() is one of the threads
+        for (int i = 0; i + 1 < nthreads; i++) {
+            threads.emplace_back([this]() { worker_loop(); });
+        }
+    }
+
+    int ThreadPoolExecutor::num_threads() const {
+        return threads.size() + 1;
+    }
+
+    void ThreadPoolExecutor::run(
+            int64_t ntask,
+            const std::function<void(int64_t)>& task) {
+        auto job = std::make_shared<Job>();
+        job->task = &task;
+        job->ntask = ntask;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            jobs.push_back(job);
+        }
+        cv.notify_all();
+        job->run_tasks();
+        std::unique_lock<std::mutex> lock(job->mutex);
+        job->cv.wait(lock, [&job]() { return job->ndone == job->ntask; });
+        if (job->error) {
+            std::rethrow_exception(job->error);
+        }
+    }
+
+    void ThreadPoolExecutor::worker_loop() {
+        for (;;) {
+            std::shared_ptr<Job> job;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                cv.wait(lock, [this]() { return stop || !jobs.empty(); });
+                if (stop) {
+                    return;
+                }
+                job = jobs.front();
+                if (job->next >= job->ntask) {
+                    // all its tasks are started
+                    jobs.pop_front();
+                    continue;
+                }
+            }
+            job->run_tasks();
+        }
+    }
+
+    ThreadPoolExecutor::~ThreadPoolExecutor() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stop = true;
+        }
+        cv.notify_all();
+        for (auto& t : threads) {
+            t.join();
+        }
+    }
 }
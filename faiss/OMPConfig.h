@@ -10,7 +10,14 @@
 #ifndef OMPCONFIG_H
 #define OMPCONFIG_H
 
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
 #include <thread>
+#include <vector>
 
 namespace faiss {
     // Degree of OpenMP concurrency, determining the number of threads
@@ -47,5 +54,73 @@ namespace faiss {
     //
     // p.s. to be invoked on process init only.
     void set_num_omp_threads(unsigned int value);
+
+    // Executor on which the parallel loops of the search functions
+    // (IndexFlat, IndexIVF, IndexHNSW) run.
+    //
+    // By default they open OpenMP parallel regions. When many small
+    // searches are issued concurrently from the threads of a server, this
+    // oversubscribes the machine (OpenMP threads x server threads) and the
+    // fork/join cost dominates. A task-based pool, for example one shared
+    // with the host application, can be plugged in instead by implementing
+    // this interface.
+    //
+    // Not covered: the threads that the BLAS library starts in sgemm, the
+    // vector norm helpers (parallel only beyond 10000 vectors) and the
+    // functions that build indexes (train, add).
+    struct Executor {
+        // run task(i) for i in [0, ntask), possibly in parallel, and
+        // return when all calls are done. The calling thread may run tasks.
+        virtual void run(
+                int64_t ntask,
+                const std::function<void(int64_t)>& task) = 0;
+
+        // nb of tasks that can run concurrently
+        virtual int num_threads() const = 0;
+
+        virtual ~Executor() {}
+    };
+
+    // Executor used by the parallel loops, nullptr = OpenMP (default).
+    // Ownership stays with the caller.
+    extern Executor* search_executor;
+
+    void set_search_executor(Executor* executor);
+
+    // nb of threads that a parallel loop started from the calling thread
+    // can use (1 within a parallel loop)
+    int parallel_num_threads();
+
+    // Run task(i) for i in [0, ntask) on the search executor, or in an
+    // OpenMP parallel region with num_omp_threads. Calls nested in a task
+    // run sequentially. The first exception thrown by a task is rethrown.
+    void parallel_for(
+            int64_t ntask,
+            const std::function<void(int64_t)>& task);
+
+    // Persistent pool of threads that implements Executor. Concurrent
+    // run() calls share the pool, each caller also runs its own tasks.
+    struct ThreadPoolExecutor : Executor {
+        explicit ThreadPoolExecutor(
+                int nthreads = std::thread::hardware_concurrency());
+
+        void run(int64_t ntask, const std::function<void(int64_t)>& task)
+                override;
+
+        int num_threads() const override;
+
+        ~ThreadPoolExecutor() override;
+
+       private:
+        struct Job;
+
+        void worker_loop();
+
+        std::vector<std::thread> threads;
+        std::mutex mutex;
+        std::condition_variable cv;
+        std::deque<std::shared_ptr<Job>> jobs;
+        bool stop = false;
+    };
 }
 #endif // OMPCONFIG_H
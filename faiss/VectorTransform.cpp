@@ -15,7 +15,12 @@
 #include <cstring>
 #include <memory>
 
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
 #include <faiss/IndexPQ.h>
+#include <faiss/OMPConfig.h>
 #include <faiss/impl/FaissAssert.h>
 #include <faiss/utils/distances.h>
 #include <faiss/utils/random.h>
@@ -129,6 +134,27 @@ int dgesvd_(
         double* work,
         FINTEGER* lwork,
         FINTEGER* info);
+
+int dgeqrf_(
+        FINTEGER* m,
+        FINTEGER* n,
+        double* a,
+        FINTEGER* lda,
+        double* tau,
+        double* work,
+        FINTEGER* lwork,
+        FINTEGER* info);
+
+int dorgqr_(
+        FINTEGER* m,
+        FINTEGER* n,
+        FINTEGER* k,
+        double* a,
+        FINTEGER* lda,
+        double* tau,
+        double* work,
+        FINTEGER* lwork,
+        FINTEGER* info);
 }
 
 /*********************************************
@@ -352,6 +378,134 @@ void RandomRotationMatrix::train(idx_t /*n*/, const float* /*x*/) {
     init(12345);
 }
 
+/*********************************************
+ * CovarianceAccumulator
+ *********************************************/
+
+CovarianceAccumulator::CovarianceAccumulator(int d) : d(d) {
+    reset();
+}
+
+void CovarianceAccumulator::reset() {
+    n = 0;
+    shift.assign(d, 0);
+    sum.assign(d, 0);
+    sum2.assign(size_t(d) * d, 0);
+}
+
+void CovarianceAccumulator::add(idx_t n_in, const float* x) {
+    if (n_in == 0) {
+        return;
+    }
+    if (n == 0) {
+        // rounded to float so that the shifted vectors are consistent with
+        // the shift
+        std::vector<double> m(d);
+        for (idx_t i = 0; i < n_in; i++) {
+            for (int j = 0; j < d; j++) {
+                m[j] += x[i * d + j];
+            }
+        }
+        for (int j = 0; j < d; j++) {
+            shift[j] = float(m[j] / n_in);
+        }
+    }
+    std::vector<float> shiftf(shift.begin(), shift.end());
+
+    // the products are computed in float by blocks, and accumulated in
+    // double
+    const size_t bs = 4096;
+    std::vector<float> xs(std::min(size_t(n_in), bs) * d);
+    std::vector<float> block_cov(size_t(d) * d);
+
+    for (size_t i0 = 0; i0 < n_in; i0 += bs) {
+        size_t i1 = std::min(i0 + bs, size_t(n_in));
+        for (size_t i = i0; i < i1; i++) {
+            const float* xi = x + i * d;
+            float* xsi = xs.data() + (i - i0) * d;
+            for (int j = 0; j < d; j++) {
+                xsi[j] = xi[j] - shiftf[j];
+                sum[j] += xsi[j];
+            }
+        }
+        {
+            FINTEGER di = d, ni = i1 - i0;
+            float one = 1.0, zero = 0.0;
+            ssyrk_("Up",
+                   "Non transposed",
+                   &di,
+                   &ni,
+                   &one,
+                   xs.data(),
+                   &di,
+                   &zero,
+                   block_cov.data(),
+                   &di);
+        }
+        // only the lower triangle (in row-major order) is filled in
+        for (size_t i = 0; i < d; i++) {
+            for (size_t j = 0; j < i; j++) {
+                double v = block_cov[i * d + j];
+                sum2[i * d + j] += v;
+                sum2[j * d + i] += v;
+            }
+            sum2[i * d + i] += block_cov[i * d + i];
+        }
+    }
+    n += n_in;
+}
+
+void CovarianceAccumulator::merge(const CovarianceAccumulator& other) {
+    FAISS_THROW_IF_NOT(other.d == d);
+    if (other.n == 0) {
+        return;
+    }
+    if (n == 0) {
+        *this = other;
+        return;
+    }
+    // x - shift = (x - other.shift) + delta
+    std::vector<double> delta(d);
+    for (int j = 0; j < d; j++) {
+        delta[j] = other.shift[j] - shift[j];
+    }
+    const double* os = other.sum.data();
+    double on = other.n;
+    for (size_t i = 0; i < d; i++) {
+        for (size_t j = 0; j < d; j++) {
+            sum2[i * d + j] += other.sum2[i * d + j] + os[i] * delta[j] +
+                    delta[i] * os[j] + on * delta[i] * delta[j];
+        }
+    }
+    for (int j = 0; j < d; j++) {
+        sum[j] += os[j] + on * delta[j];
+    }
+    n += other.n;
+}
+
+void CovarianceAccumulator::get_mean(double* mean) const {
+    FAISS_THROW_IF_NOT_MSG(n > 0, "no vectors accumulated");
+    for (int j = 0; j < d; j++) {
+        mean[j] = shift[j] + sum[j] / n;
+    }
+}
+
+void CovarianceAccumulator::get_scatter(double* cov, bool centered) const {
+    FAISS_THROW_IF_NOT_MSG(n > 0, "no vectors accumulated");
+    for (size_t i = 0; i < d; i++) {
+        for (size_t j = 0; j < d; j++) {
+            double v = sum2[i * d + j];
+            if (centered) {
+                v -= sum[i] * sum[j] / n;
+            } else {
+                v += sum[i] * shift[j] + shift[i] * sum[j] +
+                        n * shift[i] * shift[j];
+            }
+            cov[i * d + j] = v;
+        }
+    }
+}
+
 /*********************************************
  * PCAMatrix
  *********************************************/
@@ -439,6 +593,137 @@ void eig(size_t d_in, double* cov, double* eigenvalues, int verbose) {
     }
 }
 
+/// orthonormalize the r vectors of size d stored in q (r <= d)
+void orthonormalize(size_t d, size_t r, double* q) {
+    FINTEGER di = d, ri = r, lwork = -1, info;
+    std::vector<double> tau(r);
+    double work_size;
+
+    dgeqrf_(&di, &ri, q, &di, tau.data(), &work_size, &lwork, &info);
+    lwork = FINTEGER(work_size);
+    std::vector<double> work(lwork);
+
+    dgeqrf_(&di, &ri, q, &di, tau.data(), work.data(), &lwork, &info);
+    dorgqr_(&di, &ri, &ri, q, &di, tau.data(), work.data(), &lwork, &info);
+}
+
+/// Compute the r leading eigenvectors of the symmetric d-by-d matrix cov
+/// with randomized subspace iteration (Halko et al., "Finding structure
+/// with randomness", SIAM Review 2011). Output the eigenvectors in evecs
+/// (size r * d) in decreasing order of eigenvalues.
+void eig_randomized(
+        size_t d,
+        const double* cov,
+        size_t r,
+        int niter,
+        double* eigenvalues,
+        double* evecs,
+        int verbose) {
+    if (verbose) {
+        printf("randomized eigendecomposition: %zd eigenvectors, "
+               "%d iterations\n",
+               r,
+               niter);
+    }
+    std::vector<float> omega(r * d);
+    float_randn(omega.data(), r * d, 1234);
+    std::vector<double> q(omega.begin(), omega.end());
+    std::vector<double> y(r * d);
+
+    FINTEGER di = d, ri = r;
+    double one = 1.0, zero = 0.0;
+
+    // y = cov * q
+    auto multiply_cov = [&]() {
+        dgemm_("Not",
+               "Not",
+               &di,
+               &ri,
+               &di,
+               &one,
+               cov,
+               &di,
+               q.data(),
+               &di,
+               &zero,
+               y.data(),
+               &di);
+    };
+
+    orthonormalize(d, r, q.data());
+    for (int iter = 0; iter < niter; iter++) {
+        multiply_cov();
+        std::swap(q, y);
+        orthonormalize(d, r, q.data());
+    }
+
+    // Rayleigh-Ritz: eigendecomposition of the r-by-r matrix q^T * cov * q
+    multiply_cov();
+    std::vector<double> b(r * r);
+    dgemm_("Transposed",
+           "Not",
+           &ri,
+           &ri,
+           &di,
+           &one,
+           q.data(),
+           &di,
+           y.data(),
+           &di,
+           &zero,
+           b.data(),
+           &ri);
+
+    eig(r, b.data(), eigenvalues, verbose);
+
+    // back to the input space: evecs = q * b
+    dgemm_("Not",
+           "Not",
+           &di,
+           &ri,
+           &ri,
+           &one,
+           q.data(),
+           &di,
+           b.data(),
+           &ri,
+           &zero,
+           evecs,
+           &di);
+}
+
+/// fill in the eigenvalues and PCAMat of pca from the d_in-by-d_in scatter
+/// matrix covd (destroyed)
+void pca_from_scatter(PCAMatrix& pca, double* covd) {
+    size_t d_in = pca.d_in;
+    FAISS_THROW_IF_NOT(pca.randomized_oversample >= 0);
+    size_t r = pca.d_out + pca.randomized_oversample;
+
+    if (pca.randomized_niter > 0 && r < d_in) {
+        std::vector<double> eigenvaluesd(r);
+        std::vector<double> evecs(r * d_in);
+        eig_randomized(
+                d_in,
+                covd,
+                r,
+                pca.randomized_niter,
+                eigenvaluesd.data(),
+                evecs.data(),
+                pca.verbose);
+        pca.PCAMat.assign(evecs.begin(), evecs.end());
+        // the remaining eigenvalues are not computed
+        pca.eigenvalues.assign(d_in, 0);
+        for (size_t i = 0; i < r; i++) {
+            pca.eigenvalues[i] = eigenvaluesd[i];
+        }
+    } else {
+        std::vector<double> eigenvaluesd(d_in);
+        eig(d_in, covd, eigenvaluesd.data(), pca.verbose);
+        pca.PCAMat.assign(covd, covd + d_in * d_in);
+        pca.eigenvalues.assign(eigenvaluesd.begin(), eigenvaluesd.end());
+    }
+}
+
 } // namespace
 
 void PCAMatrix::train(idx_t n, const float* x_in) {
@@ -504,16 +789,7 @@ void PCAMatrix::train(idx_t n, const float* x_in) {
         for (size_t i = 0; i < d_in * d_in; i++)
             covd[i] = cov[i];
 
-        std::vector<double> eigenvaluesd(d_in);
-
-        eig(d_in, covd.data(), eigenvaluesd.data(), verbose);
-
-        for (size_t i = 0; i < d_in * d_in; i++)
-            PCAMat[i] = covd[i];
-        eigenvalues.resize(d_in);
-
-        for (size_t i = 0; i < d_in; i++)
-            eigenvalues[i] = eigenvaluesd[i];
+        pca_from_scatter(*this, covd.data());
 
     } else {
         std::vector<float> xc(n * d_in);
@@ -604,6 +880,26 @@ void PCAMatrix::train(idx_t n, const float* x_in) {
     is_trained = true;
 }
 
+void PCAMatrix::train_from_accumulator(const CovarianceAccumulator& acc) {
+    FAISS_THROW_IF_NOT(acc.d == d_in);
+    std::vector<double> meand(d_in);
+    acc.get_mean(meand.data());
+
+    mean.clear();
+    mean.resize(d_in, 0.0);
+    if (have_bias) {
+        for (int j = 0; j < d_in; j++)
+            mean[j] = meand[j];
+    }
+
+    std::vector<double> covd(d_in * d_in);
+    acc.get_scatter(covd.data(), have_bias);
+    pca_from_scatter(*this, covd.data());
+
+    prepare_Ab();
+    is_trained = true;
+}
+
 void PCAMatrix::copy_from(const PCAMatrix& other) {
     FAISS_THROW_IF_NOT(other.is_trained);
     mean = other.mean;
@@ -1363,3 +1659,136 @@ void RemapDimensionsTransform::check_identical(
     FAISS_THROW_IF_NOT(other);
     FAISS_THROW_IF_NOT(other->map == map);
 }
+
+/*********************************************
+ * HadamardRotation
+ *********************************************/
+
+namespace {
+
+/// in-place unnormalized Walsh-Hadamard transform, n is a power of 2
+void fwht_inplace(size_t n, float* x) {
+    size_t h = 1;
+#ifdef __AVX2__
+    if (n >= 8) {
+        // the 3 first levels are done within 8-float registers
+        for (size_t j = 0; j < n; j += 8) {
+            __m256 v = _mm256_loadu_ps(x + j);
+            __m256 s = _mm256_permute_ps(v, 0xb1); // swap pairs
+            v = _mm256_blend_ps(
+                    _mm256_add_ps(v, s), _mm256_sub_ps(s, v), 0xaa);
+            s = _mm256_permute_ps(v, 0x4e); // swap 64-bit halves
+            v = _mm256_blend_ps(
+                    _mm256_add_ps(v, s), _mm256_sub_ps(s, v), 0xcc);
+            s = _mm256_permute2f128_ps(v, v, 1); // swap 128-bit halves
+            v = _mm256_blend_ps(
+                    _mm256_add_ps(v, s), _mm256_sub_ps(s, v), 0xf0);
+            _mm256_storeu_ps(x + j, v);
+        }
+        for (h = 8; h < n; h *= 2) {
+            for (size_t i = 0; i < n; i += 2 * h) {
+                for (size_t j = i; j < i + h; j += 8) {
+                    __m256 a = _mm256_loadu_ps(x + j);
+                    __m256 b = _mm256_loadu_ps(x + j + h);
+                    _mm256_storeu_ps(x + j, _mm256_add_ps(a, b));
+                    _mm256_storeu_ps(x + j + h, _mm256_sub_ps(a, b));
+                }
+            }
+        }
+        return;
+    }
+#endif
+    for (; h < n; h *= 2) {
+        for (size_t i = 0; i < n; i += 2 * h) {
+            for (size_t j = i; j < i + h; j++) {
+                float a = x[j], b = x[j + h];
+                x[j] = a + b;
+                x[j + h] = a - b;
+            }
+        }
+    }
+}
+
+int next_power_of_2(int d) {
+    int p = 1;
+    while (p < d) {
+        p *= 2;
+    }
+    return p;
+}
+
+} // anonymous namespace
+
+HadamardRotation::HadamardRotation(int d, int nrounds, int seed)
+        : VectorTransform(d, next_power_of_2(d)), nrounds(nrounds) {
+    FAISS_THROW_IF_NOT(nrounds >= 1);
+    init(seed);
+}
+
+void HadamardRotation::init(int seed_in) {
+    seed = seed_in;
+    signs.resize(size_t(nrounds) * d_out);
+    RandomGenerator rng(seed);
+    for (size_t i = 0; i < signs.size(); i++) {
+        signs[i] = rng.rand_int(2) ? 1.0f : -1.0f;
+    }
+    is_trained = true;
+}
+
+void HadamardRotation::apply_noalloc(idx_t n, const float* x, float* xt)
+        const {
+    FAISS_THROW_IF_NOT(signs.size() == size_t(nrounds) * d_out);
+    float scale = std::pow(float(d_out), -0.5f * nrounds);
+
+#pragma omp parallel for if (n > 100) num_threads(num_omp_threads)
+    for (idx_t i = 0; i < n; i++) {
+        const float* xi = x + i * d_in;
+        float* yi = xt + i * d_out;
+        memcpy(yi, xi, sizeof(float) * d_in);
+        memset(yi + d_in, 0, sizeof(float) * (d_out - d_in));
+        for (int r = 0; r < nrounds; r++) {
+            const float* sr = signs.data() + size_t(r) * d_out;
+            for (int j = 0; j < d_out; j++) {
+                yi[j] *= sr[j];
+            }
+            fwht_inplace(d_out, yi);
+        }
+        for (int j = 0; j < d_out; j++) {
+            yi[j] *= scale;
+        }
+    }
+}
+
+void HadamardRotation::reverse_transform(idx_t n, const float* xt, float* x)
+        const {
+    FAISS_THROW_IF_NOT(signs.size() == size_t(nrounds) * d_out);
+    float scale = std::pow(float(d_out), -0.5f * nrounds);
+
+#pragma omp parallel if (n > 100) num_threads(num_omp_threads)
+    {
+        std::vector<float> buf(d_out);
+#pragma omp for
+        for (idx_t i = 0; i < n; i++) {
+            // H is symmetric and H H = d_out I
+            memcpy(buf.data(), xt + i * d_out, sizeof(float) * d_out);
+            for (int r = nrounds - 1; r >= 0; r--) {
+                fwht_inplace(d_out, buf.data());
+                const float* sr = signs.data() + size_t(r) * d_out;
+                for (int j = 0; j < d_out; j++) {
+                    buf[j] *= sr[j];
+                }
+            }
+            float* xi = x + i * d_in;
+            for (int j = 0; j < d_in; j++) {
+                xi[j] = buf[j] * scale;
+            }
+        }
+    }
+}
+
+void HadamardRotation::check_identical(const VectorTransform& other_in) const {
+    VectorTransform::check_identical(other_in);
+    auto other = dynamic_cast<const HadamardRotation*>(&other_in);
+    FAISS_THROW_IF_NOT(other);
+    FAISS_THROW_IF_NOT(other->signs == signs);
+}
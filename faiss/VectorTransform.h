@@ -126,6 +126,53 @@ struct RandomRotationMatrix : LinearTransform {
     RandomRotationMatrix() {}
 };
 
+/** Accumulates the first and second order moments of a stream of vectors,
+ * to train a PCAMatrix on more vectors than fit in RAM at once.
+ *
+ * The moments are accumulated in double precision relative to a shift (the
+ * mean of the first batch), which avoids the cancellation of the
+ * sum(x x^T) - n * mean * mean^T formula when the data is far from the
+ * origin. Accumulators filled on different threads or machines can be
+ * combined with merge().
+ */
+struct CovarianceAccumulator {
+    int d;
+
+    /// nb of vectors accumulated so far
+    size_t n = 0;
+
+    /// size d, origin of the moments (set by the first add)
+    std::vector<double> shift;
+
+    /// size d, sum of (x - shift)
+    std::vector<double> sum;
+
+    /// size d * d, sum of (x - shift) (x - shift)^T
+    std::vector<double> sum2;
+
+    explicit CovarianceAccumulator(int d = 0);
+
+    /// accumulate n vectors of size d
+    void add(idx_t n, const float* x);
+
+    /// add the vectors accumulated by another accumulator
+    void merge(const CovarianceAccumulator& other);
+
+    void reset();
+
+    /// mean of the accumulated vectors, size d
+    void get_mean(double* mean) const;
+
+    /** scatter matrix of the vectors, ie. n times their covariance matrix
+     * (same scaling as the one used by PCAMatrix::train)
+     *
+     * @param cov      output matrix, size d * d
+     * @param centered if false, the moments are computed around 0 instead
+     *                 of around the mean
+     */
+    void get_scatter(double* cov, bool centered = true) const;
+};
+
 /** Applies a principal component analysis on a set of vectors,
  *  with optionally whitening and random rotation. */
 struct PCAMatrix : LinearTransform {
@@ -149,6 +196,15 @@ struct PCAMatrix : LinearTransform {
     /// try to distribute output eigenvectors in this many bins
     int balanced_bins;
 
+    /** if > 0, compute only the top d_out + randomized_oversample
+     * eigenvectors with this many iterations of randomized subspace
+     * iteration instead of a full eigendecomposition. This is much faster
+     * when d_out << d_in. */
+    int randomized_niter = 0;
+
+    /// nb of additional eigenvectors computed by the randomized method
+    int randomized_oversample = 10;
+
     /// Mean, size d_in
     std::vector<float> mean;
 
@@ -169,6 +225,10 @@ struct PCAMatrix : LinearTransform {
     /// will be completed with 0s
     void train(idx_t n, const float* x) override;
 
+    /// train from the moments of a stream of vectors (max_points_per_d
+    /// does not apply)
+    void train_from_accumulator(const CovarianceAccumulator& acc);
+
     /// copy pre-trained PCA matrix
     void copy_from(const PCAMatrix& other);
 
@@ -308,6 +368,36 @@ struct CenteringTransform : VectorTransform {
     void check_identical(const VectorTransform& other) const override;
 };
 
+/** Structured random rotation: nrounds of random sign flips followed by a
+ * fast Walsh-Hadamard transform, y = (H D_nrounds) ... (H D_1) x, with H
+ * normalized to be orthonormal.
+ *
+ * The cost is O(d log d) per vector instead of O(d^2) for
+ * RandomRotationMatrix. The input is padded with 0s to d_out, the next
+ * power of 2 >= d_in.
+ */
+struct HadamardRotation : VectorTransform {
+    int nrounds = 2; ///< nb of sign flip + Hadamard transform rounds
+    int seed = 1234; ///< seed for the random signs
+
+    /// random signs (+1 / -1), size nrounds * d_out
+    std::vector<float> signs;
+
+    explicit HadamardRotation(int d, int nrounds = 2, int seed = 1234);
+
+    HadamardRotation() {}
+
+    /// draw the random signs, called by the constructor
+    void init(int seed);
+
+    void apply_noalloc(idx_t n, const float* x, float* xt) const override;
+
+    /// exact inverse (the padding dimensions are dropped)
+    void reverse_transform(idx_t n, const float* xt, float* x) const override;
+
+    void check_identical(const VectorTransform& other) const override;
+};
+
 } // namespace faiss
 
 #endif
@@ -71,6 +71,7 @@ Index* clone_index(const Index* index) {
 
 VectorTransform* Cloner::clone_VectorTransform(const VectorTransform* vt) {
     TRYCLONE(RemapDimensionsTransform, vt)
+    TRYCLONE(HadamardRotation, vt)
     TRYCLONE(OPQMatrix, vt)
     TRYCLONE(PCAMatrix, vt)
     TRYCLONE(ITQMatrix, vt)
@@ -273,6 +274,7 @@ Index* Cloner::clone_Index(const Index* index) {
     TRYCLONE(IndexPQFastScan, index)
 
     TRYCLONE(IndexScalarQuantizer, index)
+    TRYCLONE(IndexScalarQuantizerBlocked, index)
     TRYCLONE(MultiIndexQuantizer, index)
 
     if (const IndexIVF* ivf = dynamic_cast<const IndexIVF*>(index)) {
@@ -8,11 +8,13 @@
 // -*- c++ -*-
 
 #include <algorithm>
+#include <atomic>
 #include <cstring>
 
 #include <faiss/impl/AuxIndexStructures.h>
 
 #include <faiss/impl/FaissAssert.h>
+#include <faiss/utils/utils.h>
 
 namespace faiss {
 
@@ -199,6 +201,60 @@ void RangeSearchPartialResult::merge(
     result->lims[0] = 0;
 }
 
+/***********************************************************
+ * Per-call search statistics
+ ***********************************************************/
+
+void QueryStats::add(const QueryStats& other) {
+    ndis += other.ndis;
+    nvisited += other.nvisited;
+    nbytes += other.nbytes;
+    nheap_updates += other.nheap_updates;
+    coarse_time += other.coarse_time;
+    lut_time += other.lut_time;
+    scan_time += other.scan_time;
+    heap_time += other.heap_time;
+}
+
+double QueryStatsTimer::now() {
+    return getmillisecs();
+}
+
+void SearchStats::begin(idx_t n) {
+    queries.assign(n, QueryStats());
+}
+
+QueryStats SearchStats::total() const {
+    QueryStats tot;
+    for (const QueryStats& qs : queries) {
+        tot.add(qs);
+    }
+    return tot;
+}
+
+/***********************************************************
+ * SearchCacheKey
+ ***********************************************************/
+
+namespace {
+
+std::atomic<uint64_t> search_cache_key_counter(1);
+
+} // namespace
+
+SearchCacheKey::SearchCacheKey() : value(search_cache_key_counter++) {}
+
+SearchCacheKey::SearchCacheKey(const SearchCacheKey&) : SearchCacheKey() {}
+
+SearchCacheKey& SearchCacheKey::operator=(const SearchCacheKey&) {
+    invalidate();
+    return *this;
+}
+
+void SearchCacheKey::invalidate() {
+    value = search_cache_key_counter++;
+}
+
 /***********************************************************
  * Interrupt callback
  ***********************************************************/
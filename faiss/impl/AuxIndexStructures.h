@@ -161,6 +161,91 @@ struct FAISS_API InterruptCallback {
     static size_t get_period_hint(size_t flops);
 };
 
+/***********************************************************
+ * Per-call search statistics
+ ***********************************************************/
+
+/// cost of the search of one query. The times are in ms, the coarse
+/// quantization time is the time of the batch of queries divided by its size.
+struct QueryStats {
+    size_t ndis = 0;          ///< nb of distances computed
+    size_t nvisited = 0;      ///< nb of inverted lists or graph nodes visited
+    size_t nbytes = 0;        ///< nb of bytes of codes and ids read
+    size_t nheap_updates = 0; ///< nb of times the result heap was updated
+    double coarse_time = 0;   ///< coarse quantization
+    double lut_time = 0;      ///< setting the query and lists (look-up tables)
+    double scan_time = 0;     ///< scanning codes or graph nodes
+    double heap_time = 0;     ///< initializing and sorting the result heap
+
+    void add(const QueryStats& other);
+};
+
+/// adds the time spent in its scope to a field of a QueryStats, does
+/// nothing if the QueryStats is null
+struct QueryStatsTimer {
+    double* field;
+    double t0 = 0;
+
+    QueryStatsTimer(QueryStats* qs, double QueryStats::*member)
+            : field(qs ? &(qs->*member) : nullptr) {
+        if (field) {
+            t0 = now();
+        }
+    }
+
+    ~QueryStatsTimer() {
+        if (field) {
+            *field += now() - t0;
+        }
+    }
+
+    static double now(); ///< same as getmillisecs()
+};
+
+/// receives the stats of each query as soon as it is searched, eg. to
+/// forward them as trace events. It is called from the search threads.
+struct SearchTracer {
+    virtual void on_query(idx_t q, const QueryStats& stats) = 0;
+    virtual ~SearchTracer() {}
+};
+
+/** Stats of one search call, collected when it is passed in
+ * SearchParameters::stats (supported by IndexIVF, IndexHNSW and IndexFlat).
+ * The index sizes queries to the nb of queries of the call. */
+struct SearchStats {
+    std::vector<QueryStats> queries;
+    SearchTracer* tracer = nullptr;
+
+    /// clear the stats for a search of n queries
+    void begin(idx_t n);
+
+    /// forward the stats of a query of this->queries to the tracer
+    void end_query(const QueryStats& qs) const {
+        if (tracer) {
+            tracer->on_query(&qs - queries.data(), qs);
+        }
+    }
+
+    /// sum of the per-query stats
+    QueryStats total() const;
+};
+
+/** Identifies the state of an index for the search objects (scanners,
+ * distance computers) that are kept between single-query searches. The
+ * value is never reused in the process: a copy or an assignment gets a new
+ * one, so a cache keyed on it never matches a destroyed or modified index.
+ */
+struct SearchCacheKey {
+    uint64_t value;
+
+    SearchCacheKey();
+    SearchCacheKey(const SearchCacheKey&);
+    SearchCacheKey& operator=(const SearchCacheKey&);
+
+    /// get a new value, the cached search objects are rebuilt
+    void invalidate();
+};
+
 /// set implementation optimized for fast access.
 struct VisitedTable {
     std::vector<uint8_t> visited;
@@ -64,4 +64,53 @@ void CodePackerFlat::unpack_1(
     unpack_all(block, flat_code);
 }
 
+/*********************************************
+ * CodePackerInterleaved
+ */
+
+CodePackerInterleaved::CodePackerInterleaved(size_t code_size, size_t nvec) {
+    this->code_size = code_size;
+    this->nvec = nvec;
+    block_size = code_size * nvec;
+}
+
+void CodePackerInterleaved::pack_1(
+        const uint8_t* flat_code,
+        size_t offset,
+        uint8_t* block) const {
+    assert(offset < nvec);
+    for (size_t j = 0; j < code_size; j++) {
+        block[j * nvec + offset] = flat_code[j];
+    }
+}
+
+void CodePackerInterleaved::unpack_1(
+        const uint8_t* block,
+        size_t offset,
+        uint8_t* flat_code) const {
+    assert(offset < nvec);
+    for (size_t j = 0; j < code_size; j++) {
+        flat_code[j] = block[j * nvec + offset];
+    }
+}
+
+void CodePackerInterleaved::pack_all(const uint8_t* flat_codes, uint8_t* block)
+        const {
+    for (size_t i = 0; i < nvec; i++) {
+        for (size_t j = 0; j < code_size; j++) {
+            block[j * nvec + i] = flat_codes[i * code_size + j];
+        }
+    }
+}
+
+void CodePackerInterleaved::unpack_all(
+        const uint8_t* block,
+        uint8_t* flat_codes) const {
+    for (size_t i = 0; i < nvec; i++) {
+        for (size_t j = 0; j < code_size; j++) {
+            flat_codes[i * code_size + j] = block[j * nvec + i];
+        }
+    }
+}
+
 } // namespace faiss
@@ -68,4 +68,20 @@ struct CodePackerFlat : CodePacker {
     void unpack_all(const uint8_t* block, uint8_t* flat_codes) const final;
 };
 
+/** Codes are interleaved by blocks of nvec vectors: byte j of the code at
+ * offset i in the block is stored at block[j * nvec + i]. This makes it
+ * possible to compute distances to nvec vectors at a time with SIMD
+ * instructions, at least for codes with one byte per component. */
+struct CodePackerInterleaved : CodePacker {
+    CodePackerInterleaved(size_t code_size, size_t nvec);
+
+    void pack_1(const uint8_t* flat_code, size_t offset, uint8_t* block)
+            const final;
+    void unpack_1(const uint8_t* block, size_t offset, uint8_t* flat_code)
+            const final;
+
+    void pack_all(const uint8_t* flat_codes, uint8_t* block) const final;
+    void unpack_all(const uint8_t* block, uint8_t* flat_codes) const final;
+};
+
 } // namespace faiss
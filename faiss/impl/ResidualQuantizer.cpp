@@ -7,12 +7,14 @@
 
 #include <faiss/impl/ResidualQuantizer.h>
 
+#include <omp.h>
 #include <algorithm>
 #include <cmath>
 #include <cstddef>
 #include <cstdio>
 #include <cstring>
 #include <memory>
+#include <mutex>
 
 #include <faiss/IndexFlat.h>
 #include <faiss/VectorTransform.h>
@@ -427,44 +429,75 @@ void ResidualQuantizer::compute_codes_add_centroids(
         size_t n,
         const float* centroids) const {
     FAISS_THROW_IF_NOT_MSG(is_trained, "RQ is not trained yet.");
+    FAISS_THROW_IF_NOT_MSG(
+            use_beam_LUT == 0 || M == 1 || codebook_cross_products.size() > 0,
+            "call compute_codebook_tables first");
+
+    // The vectors are encoded by chunks. Each thread encodes whole chunks
+    // with its own memory pools, so the beam search steps do not
+    // synchronize and the buffers are allocated only once per thread.
+    int nt = omp_in_parallel() ? 1 : std::max(int(num_omp_threads), 1);
 
-    //
     size_t mem = memory_per_point();
 
-    size_t bs = max_mem_distances / mem;
+    // the max_mem_distances budget is shared by the threads
+    size_t bs = max_mem_distances / (mem * nt);
+    // chunks that fit in the L2 cache keep the working set of the steps
+    // cache-resident. Below 32 vectors the BLAS calls get inefficient.
+    bs = std::min(bs, std::max(get_l2_cache_size() / mem, size_t(32)));
+    // enough chunks to keep all threads busy
+    bs = std::min(bs, (n + nt - 1) / nt);
     if (bs == 0) {
         bs = 1; // otherwise we can't do much
     }
 
-    // prepare memory pools
-    ComputeCodesAddCentroidsLUT0MemoryPool pool0;
-    ComputeCodesAddCentroidsLUT1MemoryPool pool1;
+    int64_t nchunk = (n + bs - 1) / bs;
+    std::mutex exception_mutex;
+    std::string exception_string;
 
-    for (size_t i0 = 0; i0 < n; i0 += bs) {
-        size_t i1 = std::min(n, i0 + bs);
-        const float* cent = nullptr;
-        if (centroids != nullptr) {
-            cent = centroids + i0 * d;
-        }
+#pragma omp parallel if (nt > 1 && nchunk > 1) num_threads(nt)
+    {
+        // prepare memory pools
+        ComputeCodesAddCentroidsLUT0MemoryPool pool0;
+        ComputeCodesAddCentroidsLUT1MemoryPool pool1;
+
+#pragma omp for schedule(dynamic)
+        for (int64_t chunk = 0; chunk < nchunk; chunk++) {
+            size_t i0 = chunk * bs;
+            size_t i1 = std::min(n, i0 + bs);
+            const float* cent = nullptr;
+            if (centroids != nullptr) {
+                cent = centroids + i0 * d;
+            }
 
-        if (use_beam_LUT == 0) {
-            compute_codes_add_centroids_mp_lut0(
-                    *this,
-                    x + i0 * d,
-                    codes_out + i0 * code_size,
-                    i1 - i0,
-                    cent,
-                    pool0);
-        } else if (use_beam_LUT == 1) {
-            compute_codes_add_centroids_mp_lut1(
-                    *this,
-                    x + i0 * d,
-                    codes_out + i0 * code_size,
-                    i1 - i0,
-                    cent,
-                    pool1);
+            try {
+                if (use_beam_LUT == 0) {
+                    compute_codes_add_centroids_mp_lut0(
+                            *this,
+                            x + i0 * d,
+                            codes_out + i0 * code_size,
+                            i1 - i0,
+                            cent,
+                            pool0);
+                } else if (use_beam_LUT == 1) {
+                    compute_codes_add_centroids_mp_lut1(
+                            *this,
+                            x + i0 * d,
+                            codes_out + i0 * code_size,
+                            i1 - i0,
+                            cent,
+                            pool1);
+                }
+            } catch (const std::exception& e) {
+                std::lock_guard<std::mutex> lock(exception_mutex);
+                exception_string = e.what();
+            }
         }
     }
+
+    if (!exception_string.empty()) {
+        FAISS_THROW_MSG(exception_string.c_str());
+    }
 }
 
 void ResidualQuantizer::refine_beam(
@@ -545,4 +578,43 @@ void ResidualQuantizer::refine_beam_LUT(
             pool);
 }
 
+/*******************************************************************
+ * ResidualQuantizerStats
+ *******************************************************************/
+
+void ResidualQuantizerStats::reset() {
+    nvec = 0;
+    step_times.clear();
+    step_ndis.clear();
+}
+
+void ResidualQuantizerStats::add(
+        size_t n,
+        const std::vector<double>& times,
+        const std::vector<size_t>& ndis) {
+#pragma omp critical(residual_quantizer_stats)
+    {
+        nvec += n;
+        if (step_times.size() < times.size()) {
+            step_times.resize(times.size());
+        }
+        for (size_t m = 0; m < times.size(); m++) {
+            step_times[m] += times[m];
+        }
+        if (step_ndis.size() < ndis.size()) {
+            step_ndis.resize(ndis.size());
+        }
+        for (size_t m = 0; m < ndis.size(); m++) {
+            step_ndis[m] += ndis[m];
+        }
+    }
+}
+
+double ResidualQuantizerStats::step_throughput(int m) const {
+    FAISS_THROW_IF_NOT(m >= 0 && m < step_times.size());
+    return step_times[m] > 0 ? nvec * 1000.0 / step_times[m] : 0;
+}
+
+ResidualQuantizerStats residual_quantizer_stats;
+
 } // namespace faiss
@@ -155,4 +155,31 @@ struct ResidualQuantizer : AdditiveQuantizer {
     std::vector<float> cent_norms;
 };
 
+/// Statistics of the beam search encoding. The timings are summed over the
+/// threads that encode concurrently, so the throughputs are per thread.
+struct ResidualQuantizerStats {
+    size_t nvec; ///< nb of vectors that went through the encoding steps
+
+    /// per encoding step: cumulative time in ms
+    std::vector<double> step_times;
+    /// per encoding step: nb of beam entry to centroid distances evaluated
+    std::vector<size_t> step_ndis;
+
+    ResidualQuantizerStats() {
+        reset();
+    }
+    void reset();
+
+    /// accumulate the stats of one multi-step encoding of n vectors
+    void add(
+            size_t n,
+            const std::vector<double>& times,
+            const std::vector<size_t>& ndis);
+
+    /// throughput of encoding step m, in vectors/s
+    double step_throughput(int m) const;
+};
+
+FAISS_API extern ResidualQuantizerStats residual_quantizer_stats;
+
 } // namespace faiss
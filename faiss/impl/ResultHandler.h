@@ -11,8 +11,13 @@
 
 #pragma once
 
+#include <algorithm>
+#include <utility>
+#include <vector>
+
 #include <faiss/impl/AuxIndexStructures.h>
 #include <faiss/utils/Heap.h>
+#include <faiss/utils/approx_topk/bucketed.h>
 #include <faiss/utils/partitioning.h>
 
 namespace faiss {
@@ -112,6 +117,13 @@ struct Top1BlockResultHandler : BlockResultHandler<C> {
             return false;
         }
 
+        /// add results j0..j1 for query i, dis[0] is the result for j0
+        void add_results(size_t j0, size_t j1, const T* dis) {
+            for (size_t j = j0; j < j1; j++) {
+                add_result(dis[j - j0], j);
+            }
+        }
+
         /// series of results for query i is done
         void end() {
             hr.dis_tab[current_idx] = threshold;
@@ -219,6 +231,13 @@ struct HeapBlockResultHandler : BlockResultHandler<C> {
             return false;
         }
 
+        /// add results j0..j1 for query i, dis[0] is the result for j0
+        void add_results(size_t j0, size_t j1, const T* dis) {
+            for (size_t j = j0; j < j1; j++) {
+                add_result(dis[j - j0], j);
+            }
+        }
+
         /// series of results for query i is done
         void end() {
             heap_reorder<C>(k, heap_dis, heap_ids);
@@ -314,6 +333,13 @@ struct ReservoirTopN : ResultHandler<C> {
         add_result(val, id);
     }
 
+    /// add results j0..j1, dis[0] is the result for j0
+    void add_results(size_t j0, size_t j1, const T* dis) {
+        for (size_t j = j0; j < j1; j++) {
+            add_result(dis[j - j0], j);
+        }
+    }
+
     // reduce storage from capacity to anything
     // between n and (capacity + n) / 2
     void shrink_fuzzy() {
@@ -455,6 +481,294 @@ struct ReservoirBlockResultHandler : BlockResultHandler<C> {
     }
 };
 
+/*****************************************************************
+ * Buffered result handler
+ *
+ * Same storage as the reservoir, but results are submitted by batches. The
+ * elements of a batch that pass the threshold are appended to the buffer
+ * with a vectorized filter, so there is no branch per element. When the
+ * buffer is full, it is shrunk with partition_fuzzy. At the end, the buffer
+ * is partitioned to exactly n elements that are then sorted.
+ *
+ * This is intended for large k (several hundreds), where the heap updates
+ * dominate the search time.
+ *****************************************************************/
+
+/// Buffer for a single query
+template <class C>
+struct BufferedTopN : ReservoirTopN<C> {
+    using T = typename C::T;
+    using TI = typename C::TI;
+    using ReservoirTopN<C>::threshold;
+    using ReservoirTopN<C>::vals;
+    using ReservoirTopN<C>::ids;
+    using ReservoirTopN<C>::i;
+    using ReservoirTopN<C>::n;
+    using ReservoirTopN<C>::capacity;
+
+    BufferedTopN() {}
+
+    BufferedTopN(size_t n, size_t capacity, T* vals, TI* ids)
+            : ReservoirTopN<C>(n, capacity, vals, ids) {}
+
+    /// add results j0..j1, dis[0] is the result for j0
+    void add_results(size_t j0, size_t j1, const T* dis) {
+        while (j0 < j1) {
+            if (i == capacity) {
+                this->shrink_fuzzy();
+            }
+            // the filter may keep all elements
+            size_t j1b = std::min(j1, j0 + (capacity - i));
+            i += filter_by_threshold<C>(
+                    dis, j1b - j0, threshold, j0, vals + i, ids + i);
+            dis += j1b - j0;
+            j0 = j1b;
+        }
+    }
+
+    /// writes the n results sorted, destroys the buffer
+    void to_result(T* res_dis, TI* res_ids) {
+        if (i > n) {
+            this->shrink();
+        }
+        std::vector<std::pair<T, TI>> sorted(i);
+        for (size_t j = 0; j < i; j++) {
+            sorted[j] = {vals[j], ids[j]};
+        }
+        // same order as heap_reorder
+        std::sort(
+                sorted.begin(),
+                sorted.end(),
+                [](const std::pair<T, TI>& a, const std::pair<T, TI>& b) {
+                    return C::cmp2(b.first, a.first, b.second, a.second);
+                });
+        for (size_t j = 0; j < i; j++) {
+            res_dis[j] = sorted[j].first;
+            res_ids[j] = sorted[j].second;
+        }
+        for (size_t j = i; j < n; j++) {
+            res_dis[j] = C::neutral();
+            res_ids[j] = -1;
+        }
+    }
+};
+
+template <class C>
+struct BufferedBlockResultHandler : BlockResultHandler<C> {
+    using T = typename C::T;
+    using TI = typename C::TI;
+    using BlockResultHandler<C>::i0;
+    using BlockResultHandler<C>::i1;
+
+    T* heap_dis_tab;
+    TI* heap_ids_tab;
+
+    int64_t k;       // number of results to keep
+    size_t capacity; // capacity of the buffers
+
+    BufferedBlockResultHandler(
+            size_t nq,
+            T* heap_dis_tab,
+            TI* heap_ids_tab,
+            size_t k)
+            : BlockResultHandler<C>(nq),
+              heap_dis_tab(heap_dis_tab),
+              heap_ids_tab(heap_ids_tab),
+              k(k) {
+        // double then round up to multiple of 16 (for SIMD alignment)
+        capacity = (2 * k + 15) & ~15;
+    }
+
+    /******************************************************
+     * API for 1 result at a time (each SingleResultHandler is
+     * called from 1 thread)
+     */
+
+    struct SingleResultHandler : BufferedTopN<C> {
+        BufferedBlockResultHandler& hr;
+
+        std::vector<T> buffer_dis;
+        std::vector<TI> buffer_ids;
+
+        explicit SingleResultHandler(BufferedBlockResultHandler& hr)
+                : BufferedTopN<C>(hr.k, hr.capacity, nullptr, nullptr),
+                  hr(hr) {}
+
+        size_t qno;
+
+        /// begin results for query # i
+        void begin(size_t qno_2) {
+            buffer_dis.resize(hr.capacity);
+            buffer_ids.resize(hr.capacity);
+            this->vals = buffer_dis.data();
+            this->ids = buffer_ids.data();
+            this->i = 0;
+            this->threshold = C::neutral();
+            this->qno = qno_2;
+        }
+
+        /// series of results for query qno is done
+        void end() {
+            T* heap_dis = hr.heap_dis_tab + qno * hr.k;
+            TI* heap_ids = hr.heap_ids_tab + qno * hr.k;
+            this->to_result(heap_dis, heap_ids);
+        }
+    };
+
+    /******************************************************
+     * API for multiple results (called from 1 thread)
+     */
+
+    std::vector<T> buffer_dis;
+    std::vector<TI> buffer_ids;
+    std::vector<BufferedTopN<C>> buffers;
+
+    /// begin
+    void begin_multiple(size_t i0_2, size_t i1_2) final {
+        this->i0 = i0_2;
+        this->i1 = i1_2;
+        buffer_dis.resize((i1 - i0) * capacity);
+        buffer_ids.resize((i1 - i0) * capacity);
+        buffers.clear();
+        for (size_t i = i0_2; i < i1_2; i++) {
+            buffers.emplace_back(
+                    k,
+                    capacity,
+                    buffer_dis.data() + (i - i0_2) * capacity,
+                    buffer_ids.data() + (i - i0_2) * capacity);
+        }
+    }
+
+    /// add results for query i0..i1 and j0..j1
+    void add_results(size_t j0, size_t j1, const T* dis_tab) final {
+#pragma omp parallel for num_threads(num_omp_threads)
+        for (int64_t i = i0; i < i1; i++) {
+            buffers[i - i0].add_results(
+                    j0, j1, dis_tab + (j1 - j0) * (i - i0));
+        }
+    }
+
+    /// series of results for queries i0..i1 is done
+    void end_multiple() final {
+        for (size_t i = i0; i < i1; i++) {
+            buffers[i - i0].to_result(
+                    heap_dis_tab + i * k, heap_ids_tab + i * k);
+        }
+    }
+};
+
+/*****************************************************************
+ * Approximate top-k result handler
+ *
+ * Collects results in buckets (see utils/approx_topk/bucketed.h), which is
+ * cheaper than a heap for large k but may miss some of the nearest
+ * neighbors.
+ *****************************************************************/
+
+template <class C>
+struct ApproxTopKBlockResultHandler : BlockResultHandler<C> {
+    using T = typename C::T;
+    using TI = typename C::TI;
+    using BlockResultHandler<C>::i0;
+    using BlockResultHandler<C>::i1;
+
+    T* heap_dis_tab;
+    TI* heap_ids_tab;
+
+    int64_t k; // number of results to keep
+    ApproxTopKConfig config;
+
+    ApproxTopKBlockResultHandler(
+            size_t nq,
+            T* heap_dis_tab,
+            TI* heap_ids_tab,
+            size_t k,
+            const ApproxTopKConfig& config)
+            : BlockResultHandler<C>(nq),
+              heap_dis_tab(heap_dis_tab),
+              heap_ids_tab(heap_ids_tab),
+              k(k),
+              config(config) {}
+
+    /******************************************************
+     * API for 1 result at a time (each SingleResultHandler is
+     * called from 1 thread)
+     */
+
+    struct SingleResultHandler : ResultHandler<C> {
+        ApproxTopKBlockResultHandler& hr;
+        ApproxTopKBuckets<C> buckets;
+        size_t qno;
+
+        explicit SingleResultHandler(ApproxTopKBlockResultHandler& hr)
+                : hr(hr), buckets(hr.config) {
+            this->threshold = C::neutral();
+        }
+
+        /// begin results for query # i
+        void begin(size_t qno_2) {
+            buckets.reset();
+            qno = qno_2;
+        }
+
+        /// add one result for query i
+        bool add_result(T dis, TI idx) final {
+            buckets.add(1, &dis, &idx);
+            return false;
+        }
+
+        /// add results j0..j1 for query i, dis[0] is the result for j0
+        void add_results(size_t j0, size_t j1, const T* dis) {
+            buckets.add(j1 - j0, dis, nullptr, j0);
+        }
+
+        /// series of results for query i is done
+        void end() {
+            T* heap_dis = hr.heap_dis_tab + qno * hr.k;
+            TI* heap_ids = hr.heap_ids_tab + qno * hr.k;
+            heap_heapify<C>(hr.k, heap_dis, heap_ids);
+            buckets.to_heap(hr.k, heap_dis, heap_ids);
+            heap_reorder<C>(hr.k, heap_dis, heap_ids);
+        }
+    };
+
+    /******************************************************
+     * API for multiple results (called from 1 thread)
+     */
+
+    std::vector<ApproxTopKBuckets<C>> buckets;
+
+    /// begin
+    void begin_multiple(size_t i0_2, size_t i1_2) final {
+        this->i0 = i0_2;
+        this->i1 = i1_2;
+        buckets.resize(i1 - i0);
+        for (auto& b : buckets) {
+            b.init(config);
+        }
+    }
+
+    /// add results for query i0..i1 and j0..j1
+    void add_results(size_t j0, size_t j1, const T* dis_tab) final {
+#pragma omp parallel for num_threads(num_omp_threads)
+        for (int64_t i = i0; i < i1; i++) {
+            buckets[i - i0].add(
+                    j1 - j0, dis_tab + (j1 - j0) * (i - i0), nullptr, j0);
+        }
+    }
+
+    /// series of results for queries i0..i1 is done
+    void end_multiple() final {
+        for (size_t i = i0; i < i1; i++) {
+            T* heap_dis = heap_dis_tab + i * k;
+            TI* heap_ids = heap_ids_tab + i * k;
+            heap_heapify<C>(k, heap_dis, heap_ids);
+            buckets[i - i0].to_heap(k, heap_dis, heap_ids);
+            heap_reorder<C>(k, heap_dis, heap_ids);
+        }
+    }
+};
+
 /*****************************************************************
  * Result handler for range searches
  *****************************************************************/
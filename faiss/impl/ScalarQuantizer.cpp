@@ -10,7 +10,10 @@
 #include <faiss/impl/ScalarQuantizer.h>
 
 #include <algorithm>
+#include <cmath>
 #include <cstdio>
+#include <cstring>
+#include <memory>
 
 #include <faiss/impl/platform_macros.h>
 #include <omp.h>
@@ -22,8 +25,11 @@
 
 #include <faiss/IndexIVF.h>
 #include <faiss/impl/AuxIndexStructures.h>
+#include <faiss/impl/CodePacker.h>
 #include <faiss/impl/FaissAssert.h>
 #include <faiss/impl/IDSelector.h>
+#include <faiss/utils/bf16.h>
+#include <faiss/utils/distances.h>
 #include <faiss/utils/fp16.h>
 #include <faiss/utils/utils.h>
 
@@ -53,6 +59,10 @@ namespace faiss {
 #endif
 #endif
 
+#if defined(__AVX512F__) && defined(__AVX512BW__)
+#define USE_AVX512_SQ
+#endif
+
 namespace {
 
 typedef ScalarQuantizer::QuantizerType QuantizerType;
@@ -505,6 +515,72 @@ struct QuantizerFP16<8> : QuantizerFP16<1> {
 };
 #endif
 
+/*******************************************************************
+ * BF16 quantizer
+ *******************************************************************/
+
+template <int SIMDWIDTH>
+struct QuantizerBF16 {};
+
+template <>
+struct QuantizerBF16<1> : ScalarQuantizer::SQuantizer {
+    const size_t d;
+
+    QuantizerBF16(size_t d, const std::vector<float>& /* unused */) : d(d) {}
+
+    void encode_vector(const float* x, uint8_t* code) const final {
+        for (size_t i = 0; i < d; i++) {
+            ((uint16_t*)code)[i] = encode_bf16(x[i]);
+        }
+    }
+
+    void decode_vector(const uint8_t* code, float* x) const final {
+        for (size_t i = 0; i < d; i++) {
+            x[i] = decode_bf16(((uint16_t*)code)[i]);
+        }
+    }
+
+    FAISS_ALWAYS_INLINE float reconstruct_component(const uint8_t* code, int i)
+            const {
+        return decode_bf16(((uint16_t*)code)[i]);
+    }
+};
+
+#ifdef __AVX2__
+
+template <>
+struct QuantizerBF16<8> : QuantizerBF16<1> {
+    QuantizerBF16(size_t d, const std::vector<float>& trained)
+            : QuantizerBF16<1>(d, trained) {}
+
+    FAISS_ALWAYS_INLINE __m256
+    reconstruct_8_components(const uint8_t* code, int i) const {
+        __m128i code_128i = _mm_loadu_si128((const __m128i*)(code + 2 * i));
+        __m256i code_256i = _mm256_cvtepu16_epi32(code_128i);
+        code_256i = _mm256_slli_epi32(code_256i, 16);
+        return _mm256_castsi256_ps(code_256i);
+    }
+};
+
+#endif
+
+#ifdef __aarch64__
+
+template <>
+struct QuantizerBF16<8> : QuantizerBF16<1> {
+    QuantizerBF16(size_t d, const std::vector<float>& trained)
+            : QuantizerBF16<1>(d, trained) {}
+
+    FAISS_ALWAYS_INLINE float32x4x2_t
+    reconstruct_8_components(const uint8_t* code, int i) const {
+        uint16x8_t codei = vld1q_u16((const uint16_t*)(code + 2 * i));
+        return {vreinterpretq_f32_u32(vshll_n_u16(vget_low_u16(codei), 16)),
+                vreinterpretq_f32_u32(vshll_n_u16(vget_high_u16(codei), 16))};
+    }
+};
+
+#endif
+
 /*******************************************************************
  * 8bit_direct quantizer
  *******************************************************************/
@@ -576,6 +652,89 @@ struct Quantizer8bitDirect<8> : Quantizer8bitDirect<1> {
 
 #endif
 
+/*******************************************************************
+ * 8bit_sym quantizer: the components are signed bytes, scaled by the
+ * same factor for all dimensions so that integer dot products between
+ * codes are proportional to the float ones.
+ *******************************************************************/
+
+template <int SIMDWIDTH>
+struct Quantizer8bitSym {};
+
+template <>
+struct Quantizer8bitSym<1> : ScalarQuantizer::SQuantizer {
+    const size_t d;
+    const float vmax;  ///< the representable range is [-vmax, vmax]
+    const float scale; ///< vmax / 127
+
+    Quantizer8bitSym(size_t d, const std::vector<float>& trained)
+            : d(d), vmax(trained[0]), scale(trained[0] / 127) {}
+
+    void encode_vector(const float* x, uint8_t* code) const final {
+        for (size_t i = 0; i < d; i++) {
+            float xi = 0;
+            if (vmax != 0) {
+                xi = std::nearbyint(x[i] / scale);
+                if (xi < -127) {
+                    xi = -127;
+                }
+                if (xi > 127) {
+                    xi = 127;
+                }
+            }
+            code[i] = (uint8_t)(int8_t)xi;
+        }
+    }
+
+    void decode_vector(const uint8_t* code, float* x) const final {
+        for (size_t i = 0; i < d; i++) {
+            x[i] = (int8_t)code[i] * scale;
+        }
+    }
+
+    FAISS_ALWAYS_INLINE float reconstruct_component(const uint8_t* code, int i)
+            const {
+        return (int8_t)code[i] * scale;
+    }
+};
+
+#ifdef __AVX2__
+
+template <>
+struct Quantizer8bitSym<8> : Quantizer8bitSym<1> {
+    Quantizer8bitSym(size_t d, const std::vector<float>& trained)
+            : Quantizer8bitSym<1>(d, trained) {}
+
+    FAISS_ALWAYS_INLINE __m256
+    reconstruct_8_components(const uint8_t* code, int i) const {
+        __m128i x8 = _mm_loadl_epi64((__m128i*)(code + i)); // 8 * int8
+        __m256i y8 = _mm256_cvtepi8_epi32(x8);              // 8 * int32
+        return _mm256_mul_ps(
+                _mm256_cvtepi32_ps(y8), _mm256_set1_ps(this->scale));
+    }
+};
+
+#endif
+
+#ifdef __aarch64__
+
+template <>
+struct Quantizer8bitSym<8> : Quantizer8bitSym<1> {
+    Quantizer8bitSym(size_t d, const std::vector<float>& trained)
+            : Quantizer8bitSym<1>(d, trained) {}
+
+    FAISS_ALWAYS_INLINE float32x4x2_t
+    reconstruct_8_components(const uint8_t* code, int i) const {
+        int16x8_t x16 = vmovl_s8(vld1_s8((const int8_t*)(code + i)));
+        float32x4_t lo = vcvtq_f32_s32(vmovl_s16(vget_low_s16(x16)));
+        float32x4_t hi = vcvtq_f32_s32(vmovl_s16(vget_high_s16(x16)));
+        float32x4_t scale_4 = vdupq_n_f32(this->scale);
+        return {vmulq_f32(lo, scale_4), vmulq_f32(hi, scale_4)};
+    }
+};
+
+#endif
+
 template <int SIMDWIDTH>
 ScalarQuantizer::SQuantizer* select_quantizer_1(
         QuantizerType qtype,
@@ -601,6 +760,10 @@ ScalarQuantizer::SQuantizer* select_quantizer_1(
             return new QuantizerFP16<SIMDWIDTH>(d, trained);
         case ScalarQuantizer::QT_8bit_direct:
             return new Quantizer8bitDirect<SIMDWIDTH>(d, trained);
+        case ScalarQuantizer::QT_bf16:
+            return new QuantizerBF16<SIMDWIDTH>(d, trained);
+        case ScalarQuantizer::QT_8bit_sym:
+            return new Quantizer8bitSym<SIMDWIDTH>(d, trained);
     }
     FAISS_THROW_MSG("unknown qtype");
 }
@@ -779,6 +942,21 @@ void train_NonUniform(
     }
 }
 
+void train_Symmetric(
+        RangeStat rs,
+        float rs_arg,
+        idx_t n,
+        const float* x,
+        std::vector<float>& trained) {
+    // estimate the range as for the uniform quantizer, then make it
+    // symmetric around 0
+    train_Uniform(rs, rs_arg, n, 255, x, trained);
+    float vmin = trained[0];
+    float vmax = trained[0] + trained[1];
+    trained.resize(1);
+    trained[0] = std::max(std::abs(vmin), std::abs(vmax));
+}
+
 /*******************************************************************
  * Similarity: gets vector components and computes a similarity wrt. a
  * query vector stored in the object. The data fields just encapsulate
@@ -1351,6 +1529,572 @@ struct DistanceComputerByte<Similarity, 8> : SQDistanceComputer {
 
 #endif
 
+#ifdef __AVX2__
+FAISS_ALWAYS_INLINE int32_t hsum_epi32(__m256i accu) {
+    __m128i sum = _mm256_extractf128_si256(accu, 0);
+    sum = _mm_add_epi32(sum, _mm256_extractf128_si256(accu, 1));
+    sum = _mm_hadd_epi32(sum, sum);
+    sum = _mm_hadd_epi32(sum, sum);
+    return _mm_cvtsi128_si32(sum);
+}
+#endif
+
+/*******************************************************************
+ * Native distance computers for QT_bf16 and QT_8bit_sym: they process
+ * 16 components per AVX-512 instruction. When the corresponding CPU
+ * extensions are enabled at compile time (FAISS_OPT_LEVEL=avx512_spr), the
+ * dot products are computed directly on the code types, with vdpbf16ps
+ * (AVX512_BF16) for bf16 and vpdpwssd (AVX512_VNNI) for int8. This applies
+ * to query-to-code distances as well: the query is converted once in
+ * set_query (bf16 hi + lo halves, or 16-bit fixed point for int8) and L2
+ * distances are expanded as |q|^2 - 2 <q, c> + |c|^2.
+ *******************************************************************/
+
+#ifdef USE_AVX512_SQ
+
+FAISS_ALWAYS_INLINE __m512 bf16_16_to_fp32(const uint16_t* p) {
+    __m512i i32 = _mm512_cvtepu16_epi32(_mm256_loadu_si256((const __m256i*)p));
+    return _mm512_castsi512_ps(_mm512_slli_epi32(i32, 16));
+}
+
+FAISS_ALWAYS_INLINE __m512 int8_16_to_fp32(const uint8_t* p) {
+    __m512i i32 = _mm512_cvtepi8_epi32(_mm_loadu_si128((const __m128i*)p));
+    return _mm512_cvtepi32_ps(i32);
+}
+
+template <class Similarity>
+struct DistanceComputerBF16 : SQDistanceComputer {
+    using Sim = Similarity;
+
+    int d;
+    /// query split as qhi + qlo, both in bf16, so that the native dot
+    /// products keep ~16 bits of query precision
+    std::vector<uint16_t> qhi, qlo;
+    /// squared norm of the query, for the expanded L2 distance
+    float qnorm2 = 0;
+
+    DistanceComputerBF16(int d, const std::vector<float>&)
+            : d(d), qhi(d), qlo(d) {}
+
+    float bf16_inner_product(const uint16_t* a, const uint16_t* b) const {
+        __m512 accu = _mm512_setzero_ps();
+        int i = 0;
+#ifdef __AVX512BF16__
+        for (; i + 32 <= d; i += 32) {
+            __m512bh a32 = (__m512bh)_mm512_loadu_si512(a + i);
+            __m512bh b32 = (__m512bh)_mm512_loadu_si512(b + i);
+            accu = _mm512_dpbf16_ps(accu, a32, b32);
+        }
+#endif
+        for (; i < d; i += 16) {
+            accu = _mm512_fmadd_ps(
+                    bf16_16_to_fp32(a + i), bf16_16_to_fp32(b + i), accu);
+        }
+        return _mm512_reduce_add_ps(accu);
+    }
+
+    float compute_code_distance(const uint8_t* code1, const uint8_t* code2)
+            const {
+        const uint16_t* c1 = (const uint16_t*)code1;
+        const uint16_t* c2 = (const uint16_t*)code2;
+        if (Sim::metric_type == METRIC_INNER_PRODUCT) {
+            return bf16_inner_product(c1, c2);
+        }
+        __m512 accu = _mm512_setzero_ps();
+        for (int i = 0; i < d; i += 16) {
+            __m512 diff = _mm512_sub_ps(
+                    bf16_16_to_fp32(c1 + i), bf16_16_to_fp32(c2 + i));
+            accu = _mm512_fmadd_ps(diff, diff, accu);
+        }
+        return _mm512_reduce_add_ps(accu);
+    }
+
+    void set_query(const float* x) final {
+        q = x;
+        for (int i = 0; i < d; i++) {
+            qhi[i] = encode_bf16(x[i]);
+            qlo[i] = encode_bf16(x[i] - decode_bf16(qhi[i]));
+        }
+        if (Sim::metric_type == METRIC_L2) {
+            qnorm2 = fvec_norm_L2sqr(x, d);
+        }
+    }
+
+    float query_to_code(const uint8_t* code) const final {
+        const uint16_t* c = (const uint16_t*)code;
+#ifdef __AVX512BF16__
+        // <q, c> from both query halves, and |c|^2 for L2
+        __m512 accu_qc = _mm512_setzero_ps();
+        __m512 accu_cc = _mm512_setzero_ps();
+        int i = 0;
+        for (; i + 32 <= d; i += 32) {
+            __m512bh c32 = (__m512bh)_mm512_loadu_si512(c + i);
+            accu_qc = _mm512_dpbf16_ps(
+                    accu_qc, (__m512bh)_mm512_loadu_si512(qhi.data() + i), c32);
+            accu_qc = _mm512_dpbf16_ps(
+                    accu_qc, (__m512bh)_mm512_loadu_si512(qlo.data() + i), c32);
+            if (Sim::metric_type == METRIC_L2) {
+                accu_cc = _mm512_dpbf16_ps(accu_cc, c32, c32);
+            }
+        }
+        if (i < d) {
+            // 16 leftover components
+            __m512 ci = bf16_16_to_fp32(c + i);
+            accu_qc = _mm512_fmadd_ps(_mm512_loadu_ps(q + i), ci, accu_qc);
+            accu_cc = _mm512_fmadd_ps(ci, ci, accu_cc);
+        }
+        float qc = _mm512_reduce_add_ps(accu_qc);
+        if (Sim::metric_type == METRIC_INNER_PRODUCT) {
+            return qc;
+        }
+        return qnorm2 - 2 * qc + _mm512_reduce_add_ps(accu_cc);
+#else
+        __m512 accu = _mm512_setzero_ps();
+        for (int i = 0; i < d; i += 16) {
+            __m512 ci = bf16_16_to_fp32(c + i);
+            __m512 qi = _mm512_loadu_ps(q + i);
+            if (Sim::metric_type == METRIC_INNER_PRODUCT) {
+                accu = _mm512_fmadd_ps(qi, ci, accu);
+            } else {
+                __m512 diff = _mm512_sub_ps(qi, ci);
+                accu = _mm512_fmadd_ps(diff, diff, accu);
+            }
+        }
+        return _mm512_reduce_add_ps(accu);
+#endif
+    }
+
+    float symmetric_dis(idx_t i, idx_t j) override {
+        return compute_code_distance(
+                codes + i * code_size, codes + j * code_size);
+    }
+};
+
+template <class Similarity>
+struct DistanceComputerInt8Sym : SQDistanceComputer {
+    using Sim = Similarity;
+
+    int d;
+    float scale; ///< all distances are multiplied by scale^2
+    /// query divided by the scale, so that the codes are used as they are
+    std::vector<float> qs;
+    /// all codes are 0 when the range is empty
+    float dis0 = 0;
+#ifdef __AVX512VNNI__
+    /// qs in 16-bit fixed point: qs[i] ~= q16[i] / qfactor
+    std::vector<int16_t> q16;
+    float qfactor = 1;
+    /// squared norm of qs, for the expanded L2 distance
+    float qs_norm2 = 0;
+#endif
+
+    DistanceComputerInt8Sym(int d, const std::vector<float>& trained)
+            : d(d), scale(trained[0] / 127), qs(d) {
+#ifdef __AVX512VNNI__
+        q16.resize(d);
+#endif
+    }
+
+    /// distance between two codes in the integer domain
+    int32_t int8_distance(const uint8_t* a, const uint8_t* b) const {
+        __m512i accu = _mm512_setzero_si512();
+        int i = 0;
+        for (; i + 32 <= d; i += 32) {
+            __m512i a32 = _mm512_cvtepi8_epi16(
+                    _mm256_loadu_si256((const __m256i*)(a + i)));
+            __m512i b32 = _mm512_cvtepi8_epi16(
+                    _mm256_loadu_si256((const __m256i*)(b + i)));
+            if (Sim::metric_type == METRIC_L2) {
+                a32 = _mm512_sub_epi16(a32, b32);
+                b32 = a32;
+            }
+#ifdef __AVX512VNNI__
+            accu = _mm512_dpwssd_epi32(accu, a32, b32);
+#else
+            accu = _mm512_add_epi32(accu, _mm512_madd_epi16(a32, b32));
+#endif
+        }
+        int32_t res = _mm512_reduce_add_epi32(accu);
+        if (i < d) {
+            // 16 leftover components
+            __m256i a16 = _mm256_cvtepi8_epi16(
+                    _mm_loadu_si128((const __m128i*)(a + i)));
+            __m256i b16 = _mm256_cvtepi8_epi16(
+                    _mm_loadu_si128((const __m128i*)(b + i)));
+            if (Sim::metric_type == METRIC_L2) {
+                a16 = _mm256_sub_epi16(a16, b16);
+                b16 = a16;
+            }
+            __m256i prod = _mm256_madd_epi16(a16, b16);
+            __m128i sum = _mm_add_epi32(
+                    _mm256_castsi256_si128(prod),
+                    _mm256_extracti128_si256(prod, 1));
+            sum = _mm_hadd_epi32(sum, sum);
+            sum = _mm_hadd_epi32(sum, sum);
+            res += _mm_cvtsi128_si32(sum);
+        }
+        return res;
+    }
+
+    float compute_code_distance(const uint8_t* code1, const uint8_t* code2)
+            const {
+        return int8_distance(code1, code2) * scale * scale;
+    }
+
+    void set_query(const float* x) final {
+        q = x;
+        if (scale == 0) {
+            dis0 = Sim::metric_type == METRIC_L2 ? fvec_norm_L2sqr(x, d) : 0;
+            return;
+        }
+        for (int i = 0; i < d; i++) {
+            qs[i] = x[i] / scale;
+        }
+#ifdef __AVX512VNNI__
+        float qmax = 0;
+        for (int i = 0; i < d; i++) {
+            qmax = std::max(qmax, std::fabs(qs[i]));
+        }
+        qfactor = qmax > 0 ? 32767 / qmax : 1;
+        for (int i = 0; i < d; i++) {
+            q16[i] = int16_t(std::lrint(qs[i] * qfactor));
+        }
+        qs_norm2 = fvec_norm_L2sqr(qs.data(), d);
+#endif
+    }
+
+#ifdef __AVX512VNNI__
+    /// <q16, c> and |c|^2 in the integer domain. A lane accumulates at most
+    /// 8192 / 16 products of 32767 * 128 between two reductions of the
+    /// query accumulator, which stays below 2^31.
+    void int16_query_dots(const uint8_t* code, int64_t& qc, int32_t& cc)
+            const {
+        __m512i accu_qc = _mm512_setzero_si512();
+        __m512i accu_cc = _mm512_setzero_si512();
+        qc = 0;
+        int i = 0;
+        for (; i + 32 <= d; i += 32) {
+            __m512i c32 = _mm512_cvtepi8_epi16(
+                    _mm256_loadu_si256((const __m256i*)(code + i)));
+            accu_qc = _mm512_dpwssd_epi32(
+                    accu_qc, _mm512_loadu_si512(q16.data() + i), c32);
+            if (Sim::metric_type == METRIC_L2) {
+                accu_cc = _mm512_dpwssd_epi32(accu_cc, c32, c32);
+            }
+            if ((i + 32) % 8192 == 0) {
+                qc += _mm512_reduce_add_epi32(accu_qc);
+                accu_qc = _mm512_setzero_si512();
+            }
+        }
+        qc += _mm512_reduce_add_epi32(accu_qc);
+        cc = _mm512_reduce_add_epi32(accu_cc);
+        if (i < d) {
+            // 16 leftover components
+            __m256i c16 = _mm256_cvtepi8_epi16(
+                    _mm_loadu_si128((const __m128i*)(code + i)));
+            __m256i q = _mm256_loadu_si256((const __m256i*)(q16.data() + i));
+            qc += hsum_epi32(_mm256_madd_epi16(q, c16));
+            cc += hsum_epi32(_mm256_madd_epi16(c16, c16));
+        }
+    }
+#endif
+
+    float query_to_code(const uint8_t* code) const final {
+        if (scale == 0) {
+            return dis0;
+        }
+#ifdef __AVX512VNNI__
+        int64_t qc;
+        int32_t cc;
+        int16_query_dots(code, qc, cc);
+        float dis = qc / qfactor;
+        if (Sim::metric_type == METRIC_L2) {
+            dis = qs_norm2 - 2 * dis + cc;
+        }
+        return dis * scale * scale;
+#else
+        __m512 accu = _mm512_setzero_ps();
+        for (int i = 0; i < d; i += 16) {
+            __m512 ci = int8_16_to_fp32(code + i);
+            __m512 qi = _mm512_loadu_ps(qs.data() + i);
+            if (Sim::metric_type == METRIC_INNER_PRODUCT) {
+                accu = _mm512_fmadd_ps(qi, ci, accu);
+            } else {
+                __m512 diff = _mm512_sub_ps(qi, ci);
+                accu = _mm512_fmadd_ps(diff, diff, accu);
+            }
+        }
+        return _mm512_reduce_add_ps(accu) * scale * scale;
+#endif
+    }
+
+    float symmetric_dis(idx_t i, idx_t j) override {
+        return compute_code_distance(
+                codes + i * code_size, codes + j * code_size);
+    }
+};
+
+#endif
+
+/*******************************************************************
+ * DistanceComputerSQ8Query: query-side quantization for QT_8bit and
+ * QT_8bit_uniform. set_query maps the query to the code grid once,
+ * then the distance to a code c is computed as
+ *
+ *    dis = K + lscale * sum_i l_i c_i + sum_i g_i (t_i - c_i)^2
+ *
+ * The linear term uses integer accumulators. l are int8 weights for the
+ * linear part: the full inner product for METRIC_INNER_PRODUCT, the
+ * rounding residual of the query for METRIC_L2. t is the query rounded
+ * to the grid and g are the per-dimension weights a_i^2, only used for
+ * METRIC_L2. For the uniform quantizer g is the constant gscale and the
+ * squared differences are accumulated with integers, otherwise the
+ * weighted sum is computed in float so that small ranges are not
+ * rounded away.
+ *******************************************************************/
+
+#if defined(USE_AVX512_SQ) && defined(__AVX512VNNI__)
+#define USE_VNNI_SQ
+#endif
+
+#if defined(__AVX2__) && !defined(USE_VNNI_SQ)
+// pmaddubsw adds pairs of uint8 * int8 products with int16 saturation,
+// which limits the weight magnitudes
+constexpr int sq8q_wmax = 63;
+#else
+constexpr int sq8q_wmax = 127;
+#endif
+
+/// sum_i c[i] * w[i], with |w[i]| <= sq8q_wmax
+int32_t dot_u8_s8(const uint8_t* c, const int8_t* w, size_t n) {
+    size_t i = 0;
+    int32_t accu = 0;
+#ifdef USE_VNNI_SQ
+    __m512i accu512 = _mm512_setzero_si512();
+    for (; i + 64 <= n; i += 64) {
+        accu512 = _mm512_dpbusd_epi32(
+                accu512,
+                _mm512_loadu_si512(c + i),
+                _mm512_loadu_si512(w + i));
+    }
+    accu += _mm512_reduce_add_epi32(accu512);
+#endif
+#ifdef __AVX2__
+    __m256i accu256 = _mm256_setzero_si256();
+#ifndef USE_VNNI_SQ
+    const __m256i ones = _mm256_set1_epi16(1);
+    for (; i + 32 <= n; i += 32) {
+        __m256i p16 = _mm256_maddubs_epi16(
+                _mm256_loadu_si256((const __m256i*)(c + i)),
+                _mm256_loadu_si256((const __m256i*)(w + i)));
+        accu256 = _mm256_add_epi32(accu256, _mm256_madd_epi16(p16, ones));
+    }
+#endif
+    for (; i + 16 <= n; i += 16) {
+        __m256i c16 = _mm256_cvtepu8_epi16(
+                _mm_loadu_si128((const __m128i*)(c + i)));
+        __m256i w16 = _mm256_cvtepi8_epi16(
+                _mm_loadu_si128((const __m128i*)(w + i)));
+        accu256 = _mm256_add_epi32(accu256, _mm256_madd_epi16(c16, w16));
+    }
+    accu += hsum_epi32(accu256);
+#endif
+    for (; i < n; i++) {
+        accu += int32_t(c[i]) * w[i];
+    }
+    return accu;
+}
+
+/// sum_i (t[i] - c[i])^2, does not overflow for n <= 32768
+int32_t sqdiff_u8(const uint8_t* t, const uint8_t* c, size_t n) {
+    size_t i = 0;
+    int32_t accu = 0;
+#ifdef USE_AVX512_SQ
+    __m512i accu512 = _mm512_setzero_si512();
+    for (; i + 32 <= n; i += 32) {
+        __m512i t16 = _mm512_cvtepu8_epi16(
+                _mm256_loadu_si256((const __m256i*)(t + i)));
+        __m512i c16 = _mm512_cvtepu8_epi16(
+                _mm256_loadu_si256((const __m256i*)(c + i)));
+        __m512i diff = _mm512_sub_epi16(t16, c16);
+#ifdef USE_VNNI_SQ
+        accu512 = _mm512_dpwssd_epi32(accu512, diff, diff);
+#else
+        accu512 = _mm512_add_epi32(accu512, _mm512_madd_epi16(diff, diff));
+#endif
+    }
+    accu += _mm512_reduce_add_epi32(accu512);
+#endif
+#ifdef __AVX2__
+    __m256i accu256 = _mm256_setzero_si256();
+    for (; i + 16 <= n; i += 16) {
+        __m256i t16 = _mm256_cvtepu8_epi16(
+                _mm_loadu_si128((const __m128i*)(t + i)));
+        __m256i c16 = _mm256_cvtepu8_epi16(
+                _mm_loadu_si128((const __m128i*)(c + i)));
+        __m256i diff = _mm256_sub_epi16(t16, c16);
+        accu256 = _mm256_add_epi32(accu256, _mm256_madd_epi16(diff, diff));
+    }
+    accu += hsum_epi32(accu256);
+#endif
+    for (; i < n; i++) {
+        int32_t diff = int32_t(t[i]) - c[i];
+        accu += diff * diff;
+    }
+    return accu;
+}
+
+/// sum_i g[i] * (t[i] - c[i])^2
+float sqdiff_u8_weighted(
+        const uint8_t* t,
+        const uint8_t* c,
+        const float* g,
+        size_t n) {
+    size_t i = 0;
+    float accu = 0;
+#ifdef USE_AVX512_SQ
+    __m512 accu512 = _mm512_setzero_ps();
+    for (; i + 16 <= n; i += 16) {
+        __m512i t32 = _mm512_cvtepu8_epi32(
+                _mm_loadu_si128((const __m128i*)(t + i)));
+        __m512i c32 = _mm512_cvtepu8_epi32(
+                _mm_loadu_si128((const __m128i*)(c + i)));
+        __m512i diff = _mm512_sub_epi32(t32, c32);
+        __m512 sq = _mm512_cvtepi32_ps(_mm512_mullo_epi32(diff, diff));
+        accu512 = _mm512_fmadd_ps(sq, _mm512_loadu_ps(g + i), accu512);
+    }
+    accu += _mm512_reduce_add_ps(accu512);
+#endif
+#ifdef __AVX2__
+    __m256 accu256 = _mm256_setzero_ps();
+    for (; i + 8 <= n; i += 8) {
+        __m256i t32 = _mm256_cvtepu8_epi32(
+                _mm_loadl_epi64((const __m128i*)(t + i)));
+        __m256i c32 = _mm256_cvtepu8_epi32(
+                _mm_loadl_epi64((const __m128i*)(c + i)));
+        __m256i diff = _mm256_sub_epi32(t32, c32);
+        __m256 sq = _mm256_cvtepi32_ps(_mm256_mullo_epi32(diff, diff));
+        accu256 = _mm256_fmadd_ps(sq, _mm256_loadu_ps(g + i), accu256);
+    }
+    __m128 sum = _mm_add_ps(
+            _mm256_castps256_ps128(accu256),
+            _mm256_extractf128_ps(accu256, 1));
+    sum = _mm_hadd_ps(sum, sum);
+    sum = _mm_hadd_ps(sum, sum);
+    accu += _mm_cvtss_f32(sum);
+#endif
+    for (; i < n; i++) {
+        int32_t diff = int32_t(t[i]) - c[i];
+        accu += g[i] * float(diff * diff);
+    }
+    return accu;
+}
+
+template <class Similarity, bool uniform>
+struct DistanceComputerSQ8Query : SQDistanceComputer {
+    using Sim = Similarity;
+
+    size_t d;
+    /// ranges expanded to all dimensions
+    std::vector<float> vmin, vdiff;
+
+    float K = 0;      ///< constant term
+    float lscale = 0; ///< scale of the linear term
+    float gscale = 0; ///< scale of the squared differences (L2, uniform)
+    std::vector<int8_t> l;  ///< linear weights
+    std::vector<uint8_t> t; ///< query on the code grid (L2 only)
+    std::vector<float> g;   ///< per-dimension weights (L2, non-uniform)
+    std::vector<float> lin; ///< linear weights before quantization
+
+    DistanceComputerSQ8Query(size_t d, const std::vector<float>& trained)
+            : d(d), vmin(d), vdiff(d), l(d), t(d), g(d), lin(d) {
+        for (size_t i = 0; i < d; i++) {
+            vmin[i] = uniform ? trained[0] : trained[i];
+            vdiff[i] = uniform ? trained[1] : trained[d + i];
+        }
+        if (Sim::metric_type == METRIC_L2 && !uniform) {
+            // the g weights depend only on the ranges
+            for (size_t i = 0; i < d; i++) {
+                float a = vdiff[i] / 255;
+                g[i] = a * a;
+            }
+        }
+    }
+
+    void set_query(const float* x) final {
+        q = x;
+        K = 0;
+        for (size_t i = 0; i < d; i++) {
+            float a = vdiff[i] / 255;
+            if (Sim::metric_type == METRIC_INNER_PRODUCT) {
+                // x_i = vmin_i + (c_i + 0.5) * a_i
+                K += x[i] * (vmin[i] + 0.5f * a);
+                lin[i] = x[i] * a;
+                continue;
+            }
+            // (x_i - vmin_i - (c_i + 0.5) * a_i)^2 = a_i^2 (ti - c_i)^2
+            // with ti = t_i + r_i, t_i an integer on the grid
+            if (a == 0) {
+                K += sqr(x[i] - vmin[i]);
+                t[i] = 0;
+                lin[i] = 0;
+                continue;
+            }
+            float ti = (x[i] - vmin[i]) / a - 0.5f;
+            float tq = std::min(std::max(std::nearbyint(ti), 0.f), 255.f);
+            float r = ti - tq;
+            t[i] = uint8_t(tq);
+            K += a * a * r * (r + 2 * tq);
+            lin[i] = -2 * a * a * r;
+        }
+        if (Sim::metric_type == METRIC_L2 && uniform) {
+            float a = vdiff[0] / 255;
+            gscale = a * a;
+        }
+        float lmax = 0;
+        for (size_t i = 0; i < d; i++) {
+            lmax = std::max(lmax, std::abs(lin[i]));
+        }
+        lscale = lmax / sq8q_wmax;
+        for (size_t i = 0; i < d; i++) {
+            l[i] = lscale == 0 ? 0 : int8_t(std::nearbyint(lin[i] / lscale));
+        }
+    }
+
+    float query_to_code(const uint8_t* code) const final {
+        float dis = K + lscale * dot_u8_s8(code, l.data(), d);
+        if (Sim::metric_type == METRIC_L2) {
+            if (uniform) {
+                int64_t accu = 0;
+                for (size_t i0 = 0; i0 < d; i0 += 32768) {
+                    size_t i1 = std::min(i0 + 32768, d);
+                    accu += sqdiff_u8(t.data() + i0, code + i0, i1 - i0);
+                }
+                dis += gscale * accu;
+            } else {
+                dis += sqdiff_u8_weighted(t.data(), code, g.data(), d);
+            }
+        }
+        return dis;
+    }
+
+    float symmetric_dis(idx_t i, idx_t j) override {
+        const uint8_t* c1 = codes + i * code_size;
+        const uint8_t* c2 = codes + j * code_size;
+        float accu = 0;
+        for (size_t k = 0; k < d; k++) {
+            float x1 = vmin[k] + Codec8bit::decode_component(c1, k) * vdiff[k];
+            float x2 = vmin[k] + Codec8bit::decode_component(c2, k) * vdiff[k];
+            if (Sim::metric_type == METRIC_INNER_PRODUCT) {
+                accu += x1 * x2;
+            } else {
+                accu += sqr(x1 - x2);
+            }
+        }
+        return accu;
+    }
+};
+
 /*******************************************************************
  * select_distance_computer: runtime selection of template
  * specialization
@@ -1360,10 +2104,14 @@ template <class Sim>
 SQDistanceComputer* select_distance_computer(
         QuantizerType qtype,
         size_t d,
-        const std::vector<float>& trained) {
+        const std::vector<float>& trained,
+        bool query_quantization) {
     constexpr int SIMDWIDTH = Sim::simdwidth;
     switch (qtype) {
         case ScalarQuantizer::QT_8bit_uniform:
+            if (query_quantization) {
+                return new DistanceComputerSQ8Query<Sim, true>(d, trained);
+            }
             return new DCTemplate<
                     QuantizerTemplate<Codec8bit, true, SIMDWIDTH>,
                     Sim,
@@ -1376,6 +2124,9 @@ SQDistanceComputer* select_distance_computer(
                     SIMDWIDTH>(d, trained);
 
         case ScalarQuantizer::QT_8bit:
+            if (query_quantization) {
+                return new DistanceComputerSQ8Query<Sim, false>(d, trained);
+            }
             return new DCTemplate<
                     QuantizerTemplate<Codec8bit, false, SIMDWIDTH>,
                     Sim,
@@ -1406,6 +2157,24 @@ SQDistanceComputer* select_distance_computer(
                         Sim,
                         SIMDWIDTH>(d, trained);
             }
+
+        case ScalarQuantizer::QT_bf16:
+#ifdef USE_AVX512_SQ
+            if (d % 16 == 0) {
+                return new DistanceComputerBF16<Sim>(d, trained);
+            }
+#endif
+            return new DCTemplate<QuantizerBF16<SIMDWIDTH>, Sim, SIMDWIDTH>(
+                    d, trained);
+
+        case ScalarQuantizer::QT_8bit_sym:
+#ifdef USE_AVX512_SQ
+            if (d % 16 == 0) {
+                return new DistanceComputerInt8Sym<Sim>(d, trained);
+            }
+#endif
+            return new DCTemplate<Quantizer8bitSym<SIMDWIDTH>, Sim, SIMDWIDTH>(
+                    d, trained);
     }
     FAISS_THROW_MSG("unknown qtype");
     return nullptr;
@@ -1442,9 +2211,14 @@ void ScalarQuantizer::set_derived_sizes() {
             bits = 6;
             break;
         case QT_fp16:
+        case QT_bf16:
             code_size = d * 2;
             bits = 16;
             break;
+        case QT_8bit_sym:
+            code_size = d;
+            bits = 8;
+            break;
     }
 }
 
@@ -1479,8 +2253,12 @@ void ScalarQuantizer::train(size_t n, const float* x) {
                     x,
                     trained);
             break;
+        case QT_8bit_sym:
+            train_Symmetric(rangestat, rangestat_arg, n * d, x, trained);
+            break;
         case QT_fp16:
         case QT_8bit_direct:
+        case QT_bf16:
             // no training necessary
             break;
     }
@@ -1528,17 +2306,21 @@ SQDistanceComputer* ScalarQuantizer::get_distance_computer(
 #if defined(USE_F16C) || defined(__aarch64__)
     if (d % 8 == 0) {
         if (metric == METRIC_L2) {
-            return select_distance_computer<SimilarityL2<8>>(qtype, d, trained);
+            return select_distance_computer<SimilarityL2<8>>(
+                    qtype, d, trained, query_quantization);
         } else {
-            return select_distance_computer<SimilarityIP<8>>(qtype, d, trained);
+            return select_distance_computer<SimilarityIP<8>>(
+                    qtype, d, trained, query_quantization);
         }
     } else
 #endif
     {
         if (metric == METRIC_L2) {
-            return select_distance_computer<SimilarityL2<1>>(qtype, d, trained);
+            return select_distance_computer<SimilarityL2<1>>(
+                    qtype, d, trained, query_quantization);
         } else {
-            return select_distance_computer<SimilarityIP<1>>(qtype, d, trained);
+            return select_distance_computer<SimilarityIP<1>>(
+                    qtype, d, trained, query_quantization);
         }
     }
 }
@@ -1551,6 +2333,176 @@ void SQDistanceComputer::distance_to_codes(idx_t n, const uint8_t* codes, float*
     return;
 }
 
+/*******************************************************************
+ * Block distance computers, for codes interleaved by blocks of bbs
+ * vectors (see CodePackerInterleaved)
+ ********************************************************************/
+
+namespace {
+
+using SQBlockDistanceComputer = ScalarQuantizer::SQBlockDistanceComputer;
+
+/* For the 8-bit quantizers, component j of a vector is reconstructed as
+ * x_j = b_j + a_j * c_j. The distances are computed for all the codes
+ * of a block at once:
+ *   METRIC_INNER_PRODUCT: K + sum_j w_j c_j     with w_j = q_j a_j
+ *   METRIC_L2:            K + sum_j w_j (t_j - c_j)^2
+ *                         with w_j = a_j^2, t_j = (q_j - b_j) / a_j
+ * The loops over the bbs codes of a block are contiguous, so that they
+ * are vectorized by the compiler. */
+template <class T, MetricType metric>
+struct BlockDistanceComputer8bit : SQBlockDistanceComputer {
+    size_t d;
+    std::vector<float> a, b;
+    std::vector<float> w, t;
+    float K = 0;
+
+    BlockDistanceComputer8bit(
+            size_t d,
+            size_t bbs,
+            std::vector<float> a,
+            std::vector<float> b)
+            : d(d), a(std::move(a)), b(std::move(b)), w(d), t(d) {
+        this->bbs = bbs;
+    }
+
+    void set_query(const float* x) final {
+        K = 0;
+        for (size_t j = 0; j < d; j++) {
+            if (metric == METRIC_INNER_PRODUCT) {
+                K += x[j] * b[j];
+                w[j] = x[j] * a[j];
+            } else if (a[j] == 0) {
+                K += sqr(x[j] - b[j]);
+                w[j] = t[j] = 0;
+            } else {
+                t[j] = (x[j] - b[j]) / a[j];
+                w[j] = a[j] * a[j];
+            }
+        }
+    }
+
+    /// accumulates in acc, of size nv
+    void accumulate_block(const T* block, size_t nv, float* acc) const {
+        for (size_t i = 0; i < nv; i++) {
+            acc[i] = K;
+        }
+        for (size_t j = 0; j < d; j++) {
+            const T* c = block + j * nv;
+            float wj = w[j];
+            if (metric == METRIC_INNER_PRODUCT) {
+                for (size_t i = 0; i < nv; i++) {
+                    acc[i] += wj * c[i];
+                }
+            } else {
+                float tj = t[j];
+                for (size_t i = 0; i < nv; i++) {
+                    float diff = tj - c[i];
+                    acc[i] += wj * diff * diff;
+                }
+            }
+        }
+    }
+
+    template <size_t NV>
+    void distances_block_NV(const T* block, float* dis) const {
+        // block size known at compile time + local accumulators: the
+        // inner loops are fully vectorized
+        float acc[NV];
+        accumulate_block(block, NV, acc);
+        memcpy(dis, acc, sizeof(acc));
+    }
+
+    void distances_block(const uint8_t* block, float* dis) final {
+        const T* blockT = (const T*)block;
+        if (bbs == 32) {
+            distances_block_NV<32>(blockT, dis);
+        } else if (bbs == 64) {
+            distances_block_NV<64>(blockT, dis);
+        } else {
+            accumulate_block(blockT, bbs, dis);
+        }
+    }
+};
+
+/// fallback for the other quantizers: unpack and compute one by one
+struct BlockDistanceComputerUnpack : SQBlockDistanceComputer {
+    std::unique_ptr<SQDistanceComputer> dc;
+    CodePackerInterleaved packer;
+    std::vector<uint8_t> flat_codes;
+
+    BlockDistanceComputerUnpack(
+            SQDistanceComputer* dc,
+            size_t code_size,
+            size_t bbs)
+            : dc(dc), packer(code_size, bbs), flat_codes(code_size * bbs) {
+        this->bbs = bbs;
+    }
+
+    void set_query(const float* x) final {
+        dc->set_query(x);
+    }
+
+    void distances_block(const uint8_t* block, float* dis) final {
+        packer.unpack_all(block, flat_codes.data());
+        for (size_t i = 0; i < bbs; i++) {
+            dis[i] = dc->query_to_code(
+                    flat_codes.data() + i * packer.code_size);
+        }
+    }
+};
+
+template <MetricType metric>
+SQBlockDistanceComputer* select_block_distance_computer(
+        const ScalarQuantizer& sq,
+        size_t bbs) {
+    size_t d = sq.d;
+    const std::vector<float>& trained = sq.trained;
+    std::vector<float> a(d), b(d);
+    switch (sq.qtype) {
+        case ScalarQuantizer::QT_8bit:
+        case ScalarQuantizer::QT_8bit_uniform: {
+            // x_j = vmin_j + (c_j + 0.5) / 255 * vdiff_j
+            bool uniform = sq.qtype == ScalarQuantizer::QT_8bit_uniform;
+            for (size_t j = 0; j < d; j++) {
+                float vmin = uniform ? trained[0] : trained[j];
+                float vdiff = uniform ? trained[1] : trained[d + j];
+                a[j] = vdiff / 255;
+                b[j] = vmin + 0.5f * a[j];
+            }
+            return new BlockDistanceComputer8bit<uint8_t, metric>(
+                    d, bbs, a, b);
+        }
+        case ScalarQuantizer::QT_8bit_direct:
+            std::fill(a.begin(), a.end(), 1.0f);
+            return new BlockDistanceComputer8bit<uint8_t, metric>(
+                    d, bbs, a, b);
+        case ScalarQuantizer::QT_8bit_sym:
+            std::fill(a.begin(), a.end(), trained[0] / 127);
+            return new BlockDistanceComputer8bit<int8_t, metric>(
+                    d, bbs, a, b);
+        default:
+            return new BlockDistanceComputerUnpack(
+                    sq.get_distance_computer(metric), sq.code_size, bbs);
+    }
+}
+
+} // anonymous namespace
+
+SQBlockDistanceComputer* ScalarQuantizer::get_block_distance_computer(
+        MetricType metric,
+        size_t bbs) const {
+    FAISS_THROW_IF_NOT(bbs > 0);
+    if (metric == METRIC_L2) {
+        return select_block_distance_computer<METRIC_L2>(*this, bbs);
+    } else if (metric == METRIC_INNER_PRODUCT) {
+        return select_block_distance_computer<METRIC_INNER_PRODUCT>(
+                *this, bbs);
+    } else {
+        FAISS_THROW_MSG("unsupported metric type");
+    }
+}
+
 /*******************************************************************
  * IndexScalarQuantizer/IndexIVFScalarQuantizer scanner object
  *
@@ -1560,6 +2512,23 @@ void SQDistanceComputer::distance_to_codes(idx_t n, const uint8_t* codes, float*
 
 namespace {
 
+/// fields of the index that the IVFSQ scanners depend on, to check if a
+/// scanner can be reused
+struct IVFSQScannerSource {
+    const ScalarQuantizer* sq = nullptr;
+    ScalarQuantizer::QuantizerType qtype = ScalarQuantizer::QT_8bit;
+    bool query_quantization = false;
+    bool by_residual = false;
+    const Index* quantizer = nullptr;
+
+    bool matches(const IndexIVF& index) const {
+        return sq && sq->qtype == qtype &&
+                sq->query_quantization == query_quantization &&
+                index.by_residual == by_residual &&
+                index.quantizer == quantizer;
+    }
+};
+
 template <class DCClass, int use_sel>
 struct IVFSQScannerIP : InvertedListScanner {
     DCClass dc;
@@ -1581,6 +2550,12 @@ struct IVFSQScannerIP : InvertedListScanner {
         this->keep_max = true;
     }
 
+    IVFSQScannerSource source;
+
+    bool is_reusable(const IndexIVF& index) const override {
+        return source.matches(index);
+    }
+
     void set_query(const float* query) override {
         dc.set_query(query);
     }
@@ -1594,6 +2569,13 @@ struct IVFSQScannerIP : InvertedListScanner {
         return accu0 + dc.query_to_code(code);
     }
 
+    void distances_to_codes(size_t n, const uint8_t* codes, float* dis)
+            const override {
+        for (size_t j = 0; j < n; j++, codes += code_size) {
+            dis[j] = accu0 + dc.query_to_code(codes);
+        }
+    }
+
     size_t scan_codes(
             size_t list_size,
             const uint8_t* codes,
@@ -1671,6 +2653,12 @@ struct IVFSQScannerL2 : InvertedListScanner {
         this->code_size = code_size;
     }
 
+    IVFSQScannerSource source;
+
+    bool is_reusable(const IndexIVF& index) const override {
+        return source.matches(index);
+    }
+
     void set_query(const float* query) override {
         x = query;
         if (!quantizer) {
@@ -1693,6 +2681,13 @@ struct IVFSQScannerL2 : InvertedListScanner {
         return dc.query_to_code(code);
     }
 
+    void distances_to_codes(size_t n, const uint8_t* codes, float* dis)
+            const override {
+        for (size_t j = 0; j < n; j++, codes += code_size) {
+            dis[j] = dc.query_to_code(codes);
+        }
+    }
+
     size_t scan_codes(
             size_t list_size,
             const uint8_t* codes,
@@ -1744,8 +2739,14 @@ InvertedListScanner* sel3_InvertedListScanner(
         bool store_pairs,
         const IDSelector* sel,
         bool r) {
+    IVFSQScannerSource source;
+    source.sq = sq;
+    source.qtype = sq->qtype;
+    source.query_quantization = sq->query_quantization;
+    source.by_residual = r;
+    source.quantizer = quantizer;
     if (DCClass::Sim::metric_type == METRIC_L2) {
-        return new IVFSQScannerL2<DCClass, use_sel>(
+        auto scanner = new IVFSQScannerL2<DCClass, use_sel>(
                 sq->d,
                 sq->trained,
                 sq->code_size,
@@ -1753,9 +2754,13 @@ InvertedListScanner* sel3_InvertedListScanner(
                 store_pairs,
                 sel,
                 r);
+        scanner->source = source;
+        return scanner;
     } else if (DCClass::Sim::metric_type == METRIC_INNER_PRODUCT) {
-        return new IVFSQScannerIP<DCClass, use_sel>(
+        auto scanner = new IVFSQScannerIP<DCClass, use_sel>(
                 sq->d, sq->trained, sq->code_size, store_pairs, sel, r);
+        scanner->source = source;
+        return scanner;
     } else {
         FAISS_THROW_MSG("unsupported metric type");
     }
@@ -1806,12 +2811,22 @@ InvertedListScanner* sel1_InvertedListScanner(
     constexpr int SIMDWIDTH = Similarity::simdwidth;
     switch (sq->qtype) {
         case ScalarQuantizer::QT_8bit_uniform:
+            if (sq->query_quantization) {
+                return sel2_InvertedListScanner<
+                        DistanceComputerSQ8Query<Similarity, true>>(
+                        sq, quantizer, store_pairs, sel, r);
+            }
             return sel12_InvertedListScanner<Similarity, Codec8bit, true>(
                     sq, quantizer, store_pairs, sel, r);
         case ScalarQuantizer::QT_4bit_uniform:
             return sel12_InvertedListScanner<Similarity, Codec4bit, true>(
                     sq, quantizer, store_pairs, sel, r);
         case ScalarQuantizer::QT_8bit:
+            if (sq->query_quantization) {
+                return sel2_InvertedListScanner<
+                        DistanceComputerSQ8Query<Similarity, false>>(
+                        sq, quantizer, store_pairs, sel, r);
+            }
             return sel12_InvertedListScanner<Similarity, Codec8bit, false>(
                     sq, quantizer, store_pairs, sel, r);
         case ScalarQuantizer::QT_4bit:
@@ -1836,6 +2851,30 @@ InvertedListScanner* sel1_InvertedListScanner(
                         Similarity,
                         SIMDWIDTH>>(sq, quantizer, store_pairs, sel, r);
             }
+        case ScalarQuantizer::QT_bf16:
+#ifdef USE_AVX512_SQ
+            if (sq->d % 16 == 0) {
+                return sel2_InvertedListScanner<
+                        DistanceComputerBF16<Similarity>>(
+                        sq, quantizer, store_pairs, sel, r);
+            }
+#endif
+            return sel2_InvertedListScanner<DCTemplate<
+                    QuantizerBF16<SIMDWIDTH>,
+                    Similarity,
+                    SIMDWIDTH>>(sq, quantizer, store_pairs, sel, r);
+        case ScalarQuantizer::QT_8bit_sym:
+#ifdef USE_AVX512_SQ
+            if (sq->d % 16 == 0) {
+                return sel2_InvertedListScanner<
+                        DistanceComputerInt8Sym<Similarity>>(
+                        sq, quantizer, store_pairs, sel, r);
+            }
+#endif
+            return sel2_InvertedListScanner<DCTemplate<
+                    Quantizer8bitSym<SIMDWIDTH>,
+                    Similarity,
+                    SIMDWIDTH>>(sq, quantizer, store_pairs, sel, r);
     }
 
     FAISS_THROW_MSG("unknown qtype");
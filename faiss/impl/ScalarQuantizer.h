@@ -32,6 +32,8 @@ struct ScalarQuantizer : Quantizer {
         QT_fp16,
         QT_8bit_direct, ///< fast indexing of uint8s
         QT_6bit,        ///< 6 bits per component
+        QT_bf16,        ///< bfloat16 components, no training
+        QT_8bit_sym,    ///< int8 in [-vmax, vmax], shared range for all dims
     };
 
     QuantizerType qtype = QT_8bit;
@@ -54,6 +56,12 @@ struct ScalarQuantizer : Quantizer {
     /// bits per scalar code
     size_t bits = 0;
 
+    /** For QT_8bit and QT_8bit_uniform: quantize the query to the code
+     * grid and compute the distances with integer dot products. Faster,
+     * but the distances are approximate. This is a search-time setting
+     * that is not stored with the index. */
+    bool query_quantization = false;
+
     /// trained values (including the range)
     std::vector<float> trained;
 
@@ -111,6 +119,25 @@ struct ScalarQuantizer : Quantizer {
     SQDistanceComputer* get_distance_computer(
             MetricType metric = METRIC_L2) const;
 
+    /** Computes distances to blocks of bbs codes, stored in the
+     * CodePackerInterleaved layout. The 8-bit quantizers have dedicated
+     * kernels that process all the codes of a block at once, the other
+     * ones unpack the block and use a SQDistanceComputer. */
+    struct SQBlockDistanceComputer {
+        size_t bbs = 0;
+
+        virtual void set_query(const float* x) = 0;
+
+        /// distances of the current query to the bbs codes of a block
+        virtual void distances_block(const uint8_t* block, float* dis) = 0;
+
+        virtual ~SQBlockDistanceComputer() {}
+    };
+
+    SQBlockDistanceComputer* get_block_distance_computer(
+            MetricType metric,
+            size_t bbs) const;
+
     InvertedListScanner* select_InvertedListScanner(
             MetricType mt,
             const Index* quantizer,
@@ -6,6 +6,7 @@
  */
 
 #include <faiss/impl/FaissAssert.h>
+#include <faiss/utils/numa.h>
 #include <exception>
 #include <iostream>
 
@@ -160,6 +161,31 @@ void ThreadedIndex<IndexT>::reset() {
     this->is_trained = false;
 }
 
+template <typename IndexT>
+void ThreadedIndex<IndexT>::setNumaNode(int i, int node) {
+    FAISS_THROW_IF_NOT_MSG(
+            isThreaded_, "NUMA binding is supported only in threaded mode");
+    FAISS_THROW_IF_NOT_FMT(
+            i >= 0 && i < indices_.size(), "invalid sub-index %d", i);
+    FAISS_THROW_IF_NOT_FMT(
+            node >= 0 && node < numa_num_nodes(), "invalid NUMA node %d", node);
+
+    IndexT* index = indices_[i].first;
+    auto fut = indices_[i].second->add([index, node]() {
+        numa_bind_thread(node);
+        numa_first_touch(index);
+    });
+    fut.get();
+}
+
+template <typename IndexT>
+void ThreadedIndex<IndexT>::spreadOverNumaNodes() {
+    int nnodes = numa_num_nodes();
+    for (int i = 0; i < indices_.size(); i++) {
+        setNumaNode(i, i % nnodes);
+    }
+}
+
 template <typename IndexT>
 void ThreadedIndex<IndexT>::onAfterAddIndex(IndexT* index) {}
 
@@ -46,6 +46,16 @@ class ThreadedIndex : public IndexT {
     /// All indices receive the same call
     void reset() override;
 
+    /// Bind sub-index i to a NUMA node: its worker thread and the OpenMP
+    /// threads it uses run on the cpus of the node, and its storage is
+    /// copied from there so that it is allocated on the node. Requires
+    /// threaded mode. num_omp_threads is global, so it should be set to
+    /// the nb of cpus of a node divided by the nb of sub-indices per node.
+    void setNumaNode(int i, int node);
+
+    /// Bind the sub-indices to the NUMA nodes, round-robin
+    void spreadOverNumaNodes();
+
     /// Returns the number of sub-indices
     int count() const {
         return indices_.size();
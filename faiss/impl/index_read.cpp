@@ -11,8 +11,10 @@
 
 #include <faiss/impl/io_macros.h>
 
+#include <cstdint>
 #include <cstdio>
 #include <cstdlib>
+#include <memory>
 
 #include <sys/stat.h>
 #include <sys/types.h>
@@ -130,6 +132,12 @@ VectorTransform* read_VectorTransform(IOReader* f) {
         CenteringTransform* ct = new CenteringTransform();
         READVECTOR(ct->mean);
         vt = ct;
+    } else if (h == fourcc("VHad")) {
+        HadamardRotation* hr = new HadamardRotation();
+        READ1(hr->nrounds);
+        READ1(hr->seed);
+        READVECTOR(hr->signs);
+        vt = hr;
     } else if (h == fourcc("Viqt")) {
         ITQTransform* itqt = new ITQTransform();
 
@@ -205,18 +213,25 @@ InvertedLists* read_InvertedLists(IOReader* f, int io_flags) {
         std::vector<size_t> sizes(ails->nlist);
         read_ArrayInvertedLists_sizes(f, sizes);
 
+        SectionDestPieces pieces;
         for (size_t i = 0; i < ails->nlist; i++) {
             size_t n = sizes[i];
             if (n > 0) {
                 ails->ids[i].resize(n);
                 ails->codes[i].resize(n * ails->code_size);
-                READANDCHECK(ails->codes[i].data(), n * ails->code_size);
-                READANDCHECK(ails->ids[i].data(), n);
+                pieces.push_back(
+                        {ails->codes[i].data(), n * ails->code_size});
+                pieces.push_back({ails->ids[i].data(), n * sizeof(idx_t)});
             }
         }
+        read_section(f, pieces);
         return ails;
 
     } else if (h == fourcc("ilar") && !load_mem) {
+        FAISS_THROW_IF_NOT_MSG(
+                !dynamic_cast<SectionedIOReader*>(f),
+                "inverted lists of a sectioned index cannot be mapped, "
+                "write the index without IO_FLAG_SECTIONED");
         // code is always ilxx where xx is specific to the type of invlists we
         // want so we get the 16 high bits from the io_flag and the 16 low bits
         // as "il"
@@ -368,9 +383,9 @@ static void read_ScalarQuantizer(ScalarQuantizer* ivsc, IOReader* f) {
 static void read_HNSW(HNSW* hnsw, IOReader* f) {
     READVECTOR(hnsw->assign_probas);
     READVECTOR(hnsw->cum_nneighbor_per_level);
-    READVECTOR(hnsw->levels);
-    READVECTOR(hnsw->offsets);
-    READVECTOR(hnsw->neighbors);
+    READVECTOR_SECTION(hnsw->levels);
+    READVECTOR_SECTION(hnsw->offsets);
+    READVECTOR_SECTION(hnsw->neighbors);
 
     READ1(hnsw->entry_point);
     READ1(hnsw->max_level);
@@ -449,11 +464,13 @@ static void read_direct_map(DirectMap* dm, IOReader* f) {
     if (dm->type == DirectMap::Hashtable) {
         std::vector<std::pair<idx_t, idx_t>> v;
         READVECTOR(v);
-        std::unordered_map<idx_t, idx_t>& map = dm->hashtable;
-        map.reserve(v.size());
-        for (auto it : v) {
-            map[it.first] = it.second;
+        std::vector<idx_t> ids(v.size()), los(v.size());
+        for (size_t i = 0; i < v.size(); i++) {
+            ids[i] = v[i].first;
+            los[i] = v[i].second;
         }
+        dm->hashtable.clear();
+        dm->hashtable.add(ids.size(), ids.data(), los.data());
     }
 }
 
@@ -514,7 +531,8 @@ static IndexIVFPQ* read_ivfpq(IOReader* f, uint32_t h, int io_flags) {
         ivpq->use_precomputed_table = 0;
         if (ivpq->by_residual) {
             if ((io_flags & IO_FLAG_SKIP_PRECOMPUTE_TABLE) == 0) {
-                ivpq->precompute_table();
+                // the quantizer centroids may be in a section
+                run_after_sections(f, [ivpq]() { ivpq->precompute_table(); });
             }
         }
         if (ivfpqr) {
@@ -532,6 +550,12 @@ Index* read_index(IOReader* f, int io_flags) {
     Index* idx = nullptr;
     uint32_t h;
     READ1(h);
+    if (h == sectioned_io_magic()) {
+        SectionedIOReader reader(f);
+        std::unique_ptr<Index> index(read_index(&reader, io_flags));
+        reader.finish();
+        return index.release();
+    }
     if (h == fourcc("IxFI") || h == fourcc("IxF2") || h == fourcc("IxFl")) {
         IndexFlat* idxf;
         if (h == fourcc("IxFI")) {
@@ -544,7 +568,7 @@ Index* read_index(IOReader* f, int io_flags) {
         read_index_header(idxf, f);
         idxf->code_size = idxf->d * sizeof(float);
 
-        READXBVECTOR(idxf->codes);
+        READXBVECTOR_SECTION(idxf->codes);
         FAISS_THROW_IF_NOT(
             idxf->codes.size() == idxf->ntotal * idxf->code_size);
         // leak!
@@ -588,7 +612,7 @@ Index* read_index(IOReader* f, int io_flags) {
         read_index_header(idxp, f);
         read_ProductQuantizer(&idxp->pq, f);
         idxp->code_size = idxp->pq.code_size;
-        READVECTOR(idxp->codes);
+        READVECTOR_SECTION(idxp->codes);
         if (h == fourcc("IxPo") || h == fourcc("IxPq")) {
             READ1(idxp->search_type);
             READ1(idxp->encode_signs);
@@ -788,9 +812,32 @@ Index* read_index(IOReader* f, int io_flags) {
         IndexScalarQuantizer* idxs = new IndexScalarQuantizer();
         read_index_header(idxs, f);
         read_ScalarQuantizer(&idxs->sq, f);
-        READVECTOR(idxs->codes);
+        READVECTOR_SECTION(idxs->codes);
         idxs->code_size = idxs->sq.code_size;
         idx = idxs;
+    } else if (h == fourcc("IxSB")) {
+        IndexScalarQuantizerBlocked* idxsb = new IndexScalarQuantizerBlocked();
+        read_index_header(idxsb, f);
+        read_ScalarQuantizer(&idxsb->sq, f);
+        READ1(idxsb->bbs);
+        READVECTOR(idxsb->codes);
+        idxsb->code_size = idxsb->sq.code_size;
+        size_t bbs = idxsb->bbs, code_size = idxsb->code_size;
+        FAISS_THROW_IF_NOT_FMT(
+                bbs > 0 && code_size > 0 && bbs <= SIZE_MAX / code_size,
+                "invalid block size bbs=%zd code_size=%zd",
+                bbs,
+                code_size);
+        size_t block_size = bbs * code_size;
+        size_t nblock = (idxsb->ntotal + bbs - 1) / bbs;
+        FAISS_THROW_IF_NOT_FMT(
+                idxsb->codes.size() % block_size == 0 &&
+                        idxsb->codes.size() / block_size == nblock,
+                "codes size %zd inconsistent with ntotal=%zd bbs=%zd",
+                idxsb->codes.size(),
+                size_t(idxsb->ntotal),
+                bbs);
+        idx = idxsb;
     } else if (h == fourcc("IxLa")) {
         int d, nsq, scale_nbit, r2;
         READ1(d);
@@ -1004,7 +1051,7 @@ Index* read_index(IOReader* f, int io_flags) {
         READ1(idxpqfs->qbs);
         READ1(idxpqfs->ntotal2);
         READ1(idxpqfs->M2);
-        READVECTOR(idxpqfs->codes);
+        READVECTOR_SECTION(idxpqfs->codes);
 
         const auto& pq = idxpqfs->pq;
         idxpqfs->M = pq.M;
@@ -1025,7 +1072,7 @@ Index* read_index(IOReader* f, int io_flags) {
         READ1(ivpq->qbs2);
         read_ProductQuantizer(&ivpq->pq, f);
         read_InvertedLists(ivpq, f, io_flags);
-        ivpq->precompute_table();
+        run_after_sections(f, [ivpq]() { ivpq->precompute_table(); });
 
         const auto& pq = ivpq->pq;
         ivpq->M = pq.M;
@@ -1169,10 +1216,17 @@ IndexBinary* read_index_binary(IOReader* f, int io_flags) {
     IndexBinary* idx = nullptr;
     uint32_t h;
     READ1(h);
+    if (h == sectioned_io_magic()) {
+        SectionedIOReader reader(f);
+        std::unique_ptr<IndexBinary> index(
+                read_index_binary(&reader, io_flags));
+        reader.finish();
+        return index.release();
+    }
     if (h == fourcc("IBxF")) {
         IndexBinaryFlat* idxf = new IndexBinaryFlat();
         read_index_binary_header(idxf, f);
-        READVECTOR(idxf->xb);
+        READVECTOR_SECTION(idxf->xb);
         FAISS_THROW_IF_NOT(idxf->xb.size() == idxf->ntotal * idxf->code_size);
         // leak!
         idx = idxf;
@@ -1229,6 +1283,26 @@ IndexBinary* read_index_binary(IOReader* f, int io_flags) {
                     idxmh->maps[i], idxmh->b, idxmh->ntotal, f);
         }
         idx = idxmh;
+    } else if (h == fourcc("IBMi")) {
+        IndexBinaryMIH* idxmi = new IndexBinaryMIH();
+        read_index_binary_header(idxmi, f);
+        int m;
+        READ1(m);
+        // rebuild the substring layout from (d, m)
+        IndexBinaryMIH layout(idxmi->d, m);
+        idxmi->m = m;
+        idxmi->sub_offsets = layout.sub_offsets;
+        READVECTOR(idxmi->xb);
+        FAISS_THROW_IF_NOT(
+                idxmi->xb.size() == idxmi->ntotal * idxmi->code_size);
+        idxmi->tables.resize(m);
+        for (auto& t : idxmi->tables) {
+            READVECTOR(t.keys);
+            READVECTOR(t.offsets);
+            READVECTOR(t.ids);
+            FAISS_THROW_IF_NOT(t.offsets.size() == t.keys.size() + 1);
+        }
+        idx = idxmi;
     } else {
         FAISS_THROW_FMT(
                 "Index type %08x (\"%s\") not recognized",
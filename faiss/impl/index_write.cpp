@@ -141,6 +141,14 @@ void write_VectorTransform(const VectorTransform* vt, IOWriter* f) {
         uint32_t h = fourcc("VCnt");
         WRITE1(h);
         WRITEVECTOR(ct->mean);
+    } else if (
+            const HadamardRotation* hr =
+                    dynamic_cast<const HadamardRotation*>(vt)) {
+        uint32_t h = fourcc("VHad");
+        WRITE1(h);
+        WRITE1(hr->nrounds);
+        WRITE1(hr->seed);
+        WRITEVECTOR(hr->signs);
     } else if (
             const ITQTransform* itqt = dynamic_cast<const ITQTransform*>(vt)) {
         uint32_t h = fourcc("Viqt");
@@ -284,13 +292,16 @@ void write_InvertedLists(const InvertedLists* ils, IOWriter* f) {
             WRITEVECTOR(sizes);
         }
         // make a single contiguous data buffer (useful for mmapping)
+        SectionPieces pieces;
         for (size_t i = 0; i < ails->nlist; i++) {
             size_t n = ails->ids[i].size();
             if (n > 0) {
-                WRITEANDCHECK(ails->codes[i].data(), n * ails->code_size);
-                WRITEANDCHECK(ails->ids[i].data(), n);
+                pieces.push_back(
+                        {ails->codes[i].data(), n * ails->code_size});
+                pieces.push_back({ails->ids[i].data(), n * sizeof(idx_t)});
             }
         }
+        write_section(f, pieces);
 
     } else {
         InvertedListsIOHook::lookup_classname(typeid(*ils).name())
@@ -306,9 +317,9 @@ void write_ProductQuantizer(const ProductQuantizer* pq, const char* fname) {
 static void write_HNSW(const HNSW* hnsw, IOWriter* f) {
     WRITEVECTOR(hnsw->assign_probas);
     WRITEVECTOR(hnsw->cum_nneighbor_per_level);
-    WRITEVECTOR(hnsw->levels);
-    WRITEVECTOR(hnsw->offsets);
-    WRITEVECTOR(hnsw->neighbors);
+    WRITEVECTOR_SECTION(hnsw->levels);
+    WRITEVECTOR_SECTION(hnsw->offsets);
+    WRITEVECTOR_SECTION(hnsw->neighbors);
 
     WRITE1(hnsw->entry_point);
     WRITE1(hnsw->max_level);
@@ -372,10 +383,7 @@ static void write_direct_map(const DirectMap* dm, IOWriter* f) {
     WRITE1(maintain_direct_map);
     WRITEVECTOR(dm->array);
     if (dm->type == DirectMap::Hashtable) {
-        std::vector<std::pair<idx_t, idx_t>> v;
-        const std::unordered_map<idx_t, idx_t>& map = dm->hashtable;
-        v.resize(map.size());
-        std::copy(map.begin(), map.end(), v.begin());
+        std::vector<std::pair<idx_t, idx_t>> v = dm->hashtable.get_entries();
         WRITEVECTOR(v);
     }
 }
@@ -390,7 +398,13 @@ static void write_ivf_header(const IndexIVF* ivf, IOWriter* f) {
     write_direct_map(&ivf->direct_map, f);
 }
 
-void write_index(const Index* idx, IOWriter* f) {
+void write_index(const Index* idx, IOWriter* f, int io_flags) {
+    if (io_flags & IO_FLAG_SECTIONED) {
+        SectionedIOWriter writer(f);
+        write_index(idx, &writer, io_flags & ~IO_FLAG_SECTIONED);
+        writer.finish();
+        return;
+    }
     if (const IndexFlat* idxf = dynamic_cast<const IndexFlat*>(idx)) {
         uint32_t h =
                 fourcc(idxf->metric_type == METRIC_INNER_PRODUCT ? "IxFI"
@@ -398,7 +412,7 @@ void write_index(const Index* idx, IOWriter* f) {
                                                                  : "IxFl");
         WRITE1(h);
         write_index_header(idx, f);
-        WRITEXBVECTOR(idxf->codes);
+        WRITEXBVECTOR_SECTION(idxf->codes);
     } else if (const IndexLSH* idxl = dynamic_cast<const IndexLSH*>(idx)) {
         uint32_t h = fourcc("IxHe");
         WRITE1(h);
@@ -416,7 +430,7 @@ void write_index(const Index* idx, IOWriter* f) {
         WRITE1(h);
         write_index_header(idx, f);
         write_ProductQuantizer(&idxp->pq, f);
-        WRITEVECTOR(idxp->codes);
+        WRITEVECTOR_SECTION(idxp->codes);
         // search params -- maybe not useful to store?
         WRITE1(idxp->search_type);
         WRITE1(idxp->encode_signs);
@@ -598,7 +612,16 @@ void write_index(const Index* idx, IOWriter* f) {
         WRITE1(h);
         write_index_header(idx, f);
         write_ScalarQuantizer(&idxs->sq, f);
-        WRITEVECTOR(idxs->codes);
+        WRITEVECTOR_SECTION(idxs->codes);
+    } else if (
+            const IndexScalarQuantizerBlocked* idxsb =
+                    dynamic_cast<const IndexScalarQuantizerBlocked*>(idx)) {
+        uint32_t h = fourcc("IxSB");
+        WRITE1(h);
+        write_index_header(idx, f);
+        write_ScalarQuantizer(&idxsb->sq, f);
+        WRITE1(idxsb->bbs);
+        WRITEVECTOR(idxsb->codes);
     } else if (
             const IndexLattice* idxl_2 =
                     dynamic_cast<const IndexLattice*>(idx)) {
@@ -805,7 +828,7 @@ void write_index(const Index* idx, IOWriter* f) {
         WRITE1(idxpqfs->qbs);
         WRITE1(idxpqfs->ntotal2);
         WRITE1(idxpqfs->M2);
-        WRITEVECTOR(idxpqfs->codes);
+        WRITEVECTOR_SECTION(idxpqfs->codes);
     } else if (
             const IndexIVFPQFastScan* ivpq_2 =
                     dynamic_cast<const IndexIVFPQFastScan*>(idx)) {
@@ -841,14 +864,14 @@ void write_index(const Index* idx, IOWriter* f) {
     }
 }
 
-void write_index(const Index* idx, FILE* f) {
+void write_index(const Index* idx, FILE* f, int io_flags) {
     FileIOWriter writer(f);
-    write_index(idx, &writer);
+    write_index(idx, &writer, io_flags);
 }
 
-void write_index(const Index* idx, const char* fname) {
+void write_index(const Index* idx, const char* fname, int io_flags) {
     FileIOWriter writer(fname);
-    write_index(idx, &writer);
+    write_index(idx, &writer, io_flags);
 }
 
 void write_VectorTransform(const VectorTransform* vt, const char* fname) {
@@ -937,13 +960,19 @@ static void write_binary_multi_hash_map(
     WRITEVECTOR(buf);
 }
 
-void write_index_binary(const IndexBinary* idx, IOWriter* f) {
+void write_index_binary(const IndexBinary* idx, IOWriter* f, int io_flags) {
+    if (io_flags & IO_FLAG_SECTIONED) {
+        SectionedIOWriter writer(f);
+        write_index_binary(idx, &writer, io_flags & ~IO_FLAG_SECTIONED);
+        writer.finish();
+        return;
+    }
     if (const IndexBinaryFlat* idxf =
                 dynamic_cast<const IndexBinaryFlat*>(idx)) {
         uint32_t h = fourcc("IBxF");
         WRITE1(h);
         write_index_binary_header(idx, f);
-        WRITEVECTOR(idxf->xb);
+        WRITEVECTOR_SECTION(idxf->xb);
     } else if (
             const IndexBinaryIVF* ivf =
                     dynamic_cast<const IndexBinaryIVF*>(idx)) {
@@ -1000,19 +1029,35 @@ void write_index_binary(const IndexBinary* idx, IOWriter* f) {
             write_binary_multi_hash_map(
                     idxmh->maps[i], idxmh->b, idxmh->ntotal, f);
         }
+    } else if (
+            const IndexBinaryMIH* idxmi =
+                    dynamic_cast<const IndexBinaryMIH*>(idx)) {
+        uint32_t h = fourcc("IBMi");
+        WRITE1(h);
+        write_index_binary_header(idxmi, f);
+        WRITE1(idxmi->m);
+        WRITEVECTOR(idxmi->xb);
+        for (const auto& t : idxmi->tables) {
+            WRITEVECTOR(t.keys);
+            WRITEVECTOR(t.offsets);
+            WRITEVECTOR(t.ids);
+        }
     } else {
         FAISS_THROW_MSG("don't know how to serialize this type of index");
     }
 }
 
-void write_index_binary(const IndexBinary* idx, FILE* f) {
+void write_index_binary(const IndexBinary* idx, FILE* f, int io_flags) {
     FileIOWriter writer(f);
-    write_index_binary(idx, &writer);
+    write_index_binary(idx, &writer, io_flags);
 }
 
-void write_index_binary(const IndexBinary* idx, const char* fname) {
+void write_index_binary(
+        const IndexBinary* idx,
+        const char* fname,
+        int io_flags) {
     FileIOWriter writer(fname);
-    write_index_binary(idx, &writer);
+    write_index_binary(idx, &writer, io_flags);
 }
 
 } // namespace faiss
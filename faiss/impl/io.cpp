@@ -9,10 +9,20 @@
 
 #include <algorithm>
 #include <cassert>
+#include <cerrno>
+#include <cinttypes>
+#include <cstdint>
 #include <cstring>
+#include <mutex>
 
+#ifndef _MSC_VER
+#include <unistd.h>
+#endif
+
+#include <faiss/OMPConfig.h>
 #include <faiss/impl/FaissAssert.h>
 #include <faiss/impl/io.h>
+#include <faiss/impl/io_macros.h>
 
 namespace faiss {
 
@@ -255,6 +265,432 @@ BufferedIOWriter::~BufferedIOWriter() {
     }
 }
 
+/***********************************************************************
+ * Sectioned container
+ ***********************************************************************/
+
+namespace {
+
+const uint32_t sectioned_io_version = 1;
+
+inline uint64_t rotl64(uint64_t x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+const uint64_t P1 = 0x9E3779B185EBCA87ULL;
+const uint64_t P2 = 0xC2B2AE3D27D4EB4FULL;
+const uint64_t P3 = 0x165667B19E3779F9ULL;
+
+/// xxhash64-style hash of a buffer, chained with the previous value h
+uint64_t checksum_update(uint64_t h, const uint8_t* p, size_t n) {
+    uint64_t v[4] = {h + P1 + P2, h + P2, h, h - P1};
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        for (int l = 0; l < 4; l++) {
+            uint64_t w;
+            memcpy(&w, p + i + 8 * l, 8);
+            v[l] = rotl64(v[l] + w * P2, 31) * P1;
+        }
+    }
+    uint64_t r = rotl64(v[0], 1) + rotl64(v[1], 7) + rotl64(v[2], 12) +
+            rotl64(v[3], 18) + n;
+    for (; i < n; i++) {
+        r = rotl64(r ^ (p[i] * P3), 11) * P1;
+    }
+    r ^= r >> 33;
+    r *= P2;
+    r ^= r >> 29;
+    r *= P3;
+    r ^= r >> 32;
+    return r;
+}
+
+/// checksum of a section from the checksums of its chunks
+uint64_t combine_checksums(const uint64_t* chunk_sums, size_t n) {
+    uint64_t h = 0;
+    for (size_t i = 0; i < n; i++) {
+        h = rotl64(h + chunk_sums[i] * P2, 31) * P1;
+    }
+    return h;
+}
+
+size_t align_up(size_t x, size_t alignment) {
+    return (x + alignment - 1) / alignment * alignment;
+}
+
+/// call fn(piece_ptr, nbytes) on the intersection of each piece of a
+/// section with the byte range [begin, end)
+template <class Pieces, class Fn>
+void for_each_fragment(
+        const Pieces& pieces,
+        const std::vector<size_t>& piece_offsets,
+        size_t begin,
+        size_t end,
+        Fn fn) {
+    size_t i = std::upper_bound(
+                       piece_offsets.begin(), piece_offsets.end(), begin) -
+            piece_offsets.begin() - 1;
+    for (; i < pieces.size() && piece_offsets[i] < end; i++) {
+        size_t b = std::max(begin, piece_offsets[i]);
+        size_t e = std::min(end, piece_offsets[i] + pieces[i].second);
+        if (e > b) {
+            fn((uint8_t*)pieces[i].first + (b - piece_offsets[i]), e - b);
+        }
+    }
+}
+
+/// prefix sums of the piece sizes, returns the total size
+template <class Pieces>
+size_t compute_piece_offsets(
+        const Pieces& pieces,
+        std::vector<size_t>& piece_offsets) {
+    piece_offsets.resize(pieces.size() + 1);
+    piece_offsets[0] = 0;
+    for (size_t i = 0; i < pieces.size(); i++) {
+        piece_offsets[i + 1] = piece_offsets[i] + pieces[i].second;
+    }
+    return piece_offsets.back();
+}
+
+struct SectionChunk {
+    size_t section;
+    size_t begin, end; // byte range within the section
+};
+
+} // namespace
+
+uint32_t sectioned_io_magic() {
+    return fourcc("FSv2");
+}
+
+SectionedIOWriter::SectionedIOWriter(IOWriter* writer) : writer(writer) {
+    name = writer->name;
+    IOWriter* f = this;
+    uint32_t h = sectioned_io_magic();
+    WRITEANDCHECK(&h, 1);
+    WRITEANDCHECK(&sectioned_io_version, 1);
+    WRITEANDCHECK(&alignment, 1);
+    WRITEANDCHECK(&chunk_size, 1);
+}
+
+size_t SectionedIOWriter::operator()(
+        const void* ptr,
+        size_t size,
+        size_t nitems) {
+    size_t ret = (*writer)(ptr, size, nitems);
+    nbytes += ret * size;
+    return ret;
+}
+
+void SectionedIOWriter::write_section(const SectionPieces& pieces) {
+    IOWriter* f = this;
+    size_t size = 0;
+    for (const auto& p : pieces) {
+        size += p.second;
+    }
+    int64_t section_no = -1;
+    if (size >= min_section_size) {
+        section_no = sections.size();
+        sections.push_back(pieces);
+    }
+    WRITEANDCHECK(&section_no, 1);
+    if (section_no < 0) {
+        for (const auto& p : pieces) {
+            WRITEANDCHECK((const uint8_t*)p.first, p.second);
+        }
+    }
+}
+
+void SectionedIOWriter::finish() {
+    IOWriter* f = this;
+    size_t ns = sections.size();
+    std::vector<size_t> sizes(ns);
+    std::vector<std::vector<size_t>> piece_offsets(ns);
+    std::vector<SectionChunk> chunks;
+    std::vector<size_t> chunk0(ns + 1);
+    for (size_t s = 0; s < ns; s++) {
+        sizes[s] = compute_piece_offsets(sections[s], piece_offsets[s]);
+        chunk0[s] = chunks.size();
+        for (size_t b = 0; b < sizes[s]; b += chunk_size) {
+            chunks.push_back({s, b, std::min(b + chunk_size, sizes[s])});
+        }
+    }
+    chunk0[ns] = chunks.size();
+
+    std::vector<uint64_t> chunk_sums(chunks.size());
+#pragma omp parallel for schedule(dynamic) num_threads(num_omp_threads)
+    for (int64_t i = 0; i < chunks.size(); i++) {
+        const SectionChunk& c = chunks[i];
+        uint64_t h = 0;
+        for_each_fragment(
+                sections[c.section],
+                piece_offsets[c.section],
+                c.begin,
+                c.end,
+                [&](const uint8_t* p, size_t n) {
+                    h = checksum_update(h, p, n);
+                });
+        chunk_sums[i] = h;
+    }
+
+    // table of contents
+    uint32_t h = fourcc("FStc");
+    WRITEANDCHECK(&h, 1);
+    WRITEANDCHECK(&ns, 1);
+    size_t ofs = nbytes + ns * 3 * sizeof(uint64_t);
+    for (size_t s = 0; s < ns; s++) {
+        ofs = align_up(ofs, alignment);
+        uint64_t entry[3] = {
+                ofs,
+                sizes[s],
+                combine_checksums(
+                        chunk_sums.data() + chunk0[s],
+                        chunk0[s + 1] - chunk0[s])};
+        WRITEANDCHECK(entry, 3);
+        ofs += sizes[s];
+    }
+
+    std::vector<uint8_t> zeros(alignment);
+    for (size_t s = 0; s < ns; s++) {
+        size_t npad = align_up(nbytes, alignment) - nbytes;
+        WRITEANDCHECK(zeros.data(), npad);
+        for (const auto& p : sections[s]) {
+            WRITEANDCHECK((const uint8_t*)p.first, p.second);
+        }
+    }
+    sections.clear();
+}
+
+SectionedIOReader::SectionedIOReader(IOReader* reader) : reader(reader) {
+    name = reader->name;
+    nbytes = sizeof(uint32_t);
+    if (auto fr = dynamic_cast<FileIOReader*>(reader)) {
+        base_offset = ftell(fr->f) - nbytes;
+    } else if (auto br = dynamic_cast<BufIOReader*>(reader)) {
+        base_offset = br->rp - nbytes;
+    } else if (auto vr = dynamic_cast<VectorIOReader*>(reader)) {
+        base_offset = vr->rp - nbytes;
+    }
+    IOReader* f = this;
+    uint32_t version;
+    READANDCHECK(&version, 1);
+    FAISS_THROW_IF_NOT_FMT(
+            version == sectioned_io_version,
+            "unsupported sectioned format version %d",
+            int(version));
+    READANDCHECK(&alignment, 1);
+    READANDCHECK(&chunk_size, 1);
+    FAISS_THROW_IF_NOT(alignment > 0 && chunk_size > 0);
+}
+
+size_t SectionedIOReader::operator()(void* ptr, size_t size, size_t nitems) {
+    size_t ret = (*reader)(ptr, size, nitems);
+    nbytes += ret * size;
+    return ret;
+}
+
+void SectionedIOReader::read_section(const SectionDestPieces& pieces) {
+    IOReader* f = this;
+    int64_t section_no;
+    READANDCHECK(&section_no, 1);
+    if (section_no < 0) {
+        for (const auto& p : pieces) {
+            READANDCHECK((uint8_t*)p.first, p.second);
+        }
+    } else {
+        FAISS_THROW_IF_NOT_FMT(
+                section_no == pending.size(),
+                "unexpected section number %" PRId64,
+                section_no);
+        pending.push_back(pieces);
+    }
+}
+
+void SectionedIOReader::finish() {
+    IOReader* f = this;
+    uint32_t h;
+    READANDCHECK(&h, 1);
+    FAISS_THROW_IF_NOT_MSG(
+            h == fourcc("FStc"), "table of contents of sections not found");
+    size_t ns;
+    READANDCHECK(&ns, 1);
+    FAISS_THROW_IF_NOT_FMT(
+            ns == pending.size(),
+            "%zd sections in the table of contents, %zd expected",
+            ns,
+            pending.size());
+    std::vector<uint64_t> toc(ns * 3);
+    READANDCHECK(toc.data(), ns * 3);
+
+    std::vector<std::vector<size_t>> piece_offsets(ns);
+    std::vector<SectionChunk> chunks;
+    std::vector<size_t> chunk0(ns + 1);
+    size_t end = nbytes;
+    for (size_t s = 0; s < ns; s++) {
+        size_t size = compute_piece_offsets(pending[s], piece_offsets[s]);
+        FAISS_THROW_IF_NOT_FMT(
+                size == toc[3 * s + 1] && toc[3 * s] >= end &&
+                        toc[3 * s] <= SIZE_MAX - size,
+                "inconsistent table of contents for section %zd",
+                s);
+        end = toc[3 * s] + size;
+        chunk0[s] = chunks.size();
+        for (size_t b = 0; b < size; b += chunk_size) {
+            chunks.push_back({s, b, std::min(b + chunk_size, size)});
+        }
+    }
+    chunk0[ns] = chunks.size();
+    std::vector<uint64_t> chunk_sums(chunks.size());
+
+    // source for the positional reads
+    FileIOReader* file_reader = dynamic_cast<FileIOReader*>(reader);
+    const uint8_t* buf = nullptr;
+    size_t buf_size = 0;
+    if (auto br = dynamic_cast<BufIOReader*>(reader)) {
+        buf = br->buf;
+        buf_size = br->buf_size;
+    } else if (auto vr = dynamic_cast<VectorIOReader*>(reader)) {
+        buf = vr->data.data();
+        buf_size = vr->data.size();
+    }
+    if (buf) {
+        FAISS_THROW_IF_NOT_MSG(
+                base_offset <= buf_size && end <= buf_size - base_offset,
+                "sections extend beyond the end of the buffer");
+    }
+#ifdef _MSC_VER
+    file_reader = nullptr;
+#endif
+
+    if (file_reader || buf) {
+        int fd = file_reader ? file_reader->fileno() : -1;
+        std::mutex exception_mutex;
+        std::string exception_string;
+
+#pragma omp parallel for schedule(dynamic) num_threads(num_omp_threads)
+        for (int64_t i = 0; i < chunks.size(); i++) {
+            const SectionChunk& c = chunks[i];
+            size_t ofs = base_offset + toc[3 * c.section] + c.begin;
+            uint64_t hc = 0;
+            for_each_fragment(
+                    pending[c.section],
+                    piece_offsets[c.section],
+                    c.begin,
+                    c.end,
+                    [&](uint8_t* p, size_t n) {
+                        if (buf) {
+                            memcpy(p, buf + ofs, n);
+                        } else {
+#ifndef _MSC_VER
+                            size_t nr = 0;
+                            while (nr < n) {
+                                ssize_t ret =
+                                        pread(fd, p + nr, n - nr, ofs + nr);
+                                if (ret <= 0) {
+                                    std::lock_guard<std::mutex> lock(
+                                            exception_mutex);
+                                    exception_string = std::string(
+                                            "read error in section of ") +
+                                            name + ": " + strerror(errno);
+                                    break;
+                                }
+                                nr += ret;
+                            }
+#endif
+                        }
+                        ofs += n;
+                        hc = checksum_update(hc, p, n);
+                    });
+            chunk_sums[i] = hc;
+        }
+        if (!exception_string.empty()) {
+            FAISS_THROW_MSG(exception_string.c_str());
+        }
+
+        // position the reader after the container
+        if (file_reader) {
+            fseek(file_reader->f, base_offset + end, SEEK_SET);
+        } else if (auto br = dynamic_cast<BufIOReader*>(reader)) {
+            br->rp = base_offset + end;
+        } else if (auto vr = dynamic_cast<VectorIOReader*>(reader)) {
+            vr->rp = base_offset + end;
+        }
+    } else {
+        // sequential reads
+        std::vector<uint8_t> skip;
+        for (size_t i = 0; i < chunks.size(); i++) {
+            const SectionChunk& c = chunks[i];
+            if (c.begin == 0) {
+                skip.resize(toc[3 * c.section] - nbytes);
+                READANDCHECK(skip.data(), skip.size());
+            }
+            uint64_t hc = 0;
+            for_each_fragment(
+                    pending[c.section],
+                    piece_offsets[c.section],
+                    c.begin,
+                    c.end,
+                    [&](uint8_t* p, size_t n) {
+                        READANDCHECK(p, n);
+                        hc = checksum_update(hc, p, n);
+                    });
+            chunk_sums[i] = hc;
+        }
+    }
+
+    for (size_t s = 0; s < ns; s++) {
+        uint64_t checksum = combine_checksums(
+                chunk_sums.data() + chunk0[s], chunk0[s + 1] - chunk0[s]);
+        FAISS_THROW_IF_NOT_FMT(
+                checksum == toc[3 * s + 2],
+                "checksum mismatch in section %zd of %s",
+                s,
+                name.c_str());
+    }
+    pending.clear();
+
+    for (auto& fn : after_sections) {
+        fn();
+    }
+    after_sections.clear();
+}
+
+void write_section(IOWriter* f, const SectionPieces& pieces) {
+    if (auto sw = dynamic_cast<SectionedIOWriter*>(f)) {
+        sw->write_section(pieces);
+    } else {
+        for (const auto& p : pieces) {
+            WRITEANDCHECK((const uint8_t*)p.first, p.second);
+        }
+    }
+}
+
+void write_section(IOWriter* f, const void* data, size_t nbytes) {
+    write_section(f, SectionPieces{{data, nbytes}});
+}
+
+void read_section(IOReader* f, const SectionDestPieces& pieces) {
+    if (auto sr = dynamic_cast<SectionedIOReader*>(f)) {
+        sr->read_section(pieces);
+    } else {
+        for (const auto& p : pieces) {
+            READANDCHECK((uint8_t*)p.first, p.second);
+        }
+    }
+}
+
+void run_after_sections(IOReader* f, std::function<void()> fn) {
+    if (auto sf = dynamic_cast<SectionedIOReader*>(f)) {
+        sf->after_sections.push_back(std::move(fn));
+    } else {
+        fn();
+    }
+}
+
+void read_section(IOReader* f, void* data, size_t nbytes) {
+    read_section(f, SectionDestPieces{{data, nbytes}});
+}
+
 uint32_t fourcc(const char sx[4]) {
     FAISS_THROW_IF_NOT(4 == strlen(sx));
     const unsigned char* x = (unsigned char*)sx;
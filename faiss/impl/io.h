@@ -17,7 +17,9 @@
 #pragma once
 
 #include <cstdio>
+#include <functional>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include <faiss/Index.h>
@@ -141,6 +143,104 @@ struct BufferedIOWriter : IOWriter {
     ~BufferedIOWriter() override;
 };
 
+/*******************************************************
+ * Sectioned container (v2 format)
+ *
+ * The object is serialized as usual, except that large arrays are not
+ * written inline: they are moved to sections that are appended after the
+ * stream, aligned and with a checksum. The layout is:
+ *
+ *   "FSv2" header | stream | table of contents | sections
+ *
+ * When reading, the sections are filled in after the stream is parsed. If
+ * the underlying reader supports random access (file or memory buffer),
+ * they are read with parallel positional reads directly into the
+ * destination buffers.
+ *
+ * The serialization code transfers large arrays with write_section and
+ * read_section, that fall back to inline data on plain readers and writers.
+ *******************************************************/
+
+/// list of buffers that are stored contiguously in a section
+typedef std::vector<std::pair<const void*, size_t>> SectionPieces;
+typedef std::vector<std::pair<void*, size_t>> SectionDestPieces;
+
+struct SectionedIOWriter : IOWriter {
+    IOWriter* writer;
+
+    /// arrays smaller than this are stored inline
+    size_t min_section_size = 1 << 16;
+    /// sections start at a multiple of this (relative to the header)
+    size_t alignment = 4096;
+    /// checksums are computed on chunks of this size, that are also the
+    /// unit of parallel reads
+    size_t chunk_size = 16 << 20;
+
+    /// nb of bytes written so far, including the header
+    size_t nbytes = 0;
+
+    /// sections to write after the stream. The data is referenced, so it
+    /// must not be modified before finish() is called.
+    std::vector<SectionPieces> sections;
+
+    /// writes the header
+    explicit SectionedIOWriter(IOWriter* writer);
+
+    size_t operator()(const void* ptr, size_t size, size_t nitems) override;
+
+    /// stores the pieces either inline or as a new section
+    void write_section(const SectionPieces& pieces);
+
+    /// writes the table of contents and the sections
+    void finish();
+};
+
+struct SectionedIOReader : IOReader {
+    IOReader* reader;
+
+    size_t alignment = 0;
+    size_t chunk_size = 0;
+
+    /// nb of bytes read so far, including the header
+    size_t nbytes = 0;
+
+    /// offset of the header in the underlying reader (for positional reads)
+    size_t base_offset = 0;
+
+    /// destinations of the sections that are not read yet
+    std::vector<SectionDestPieces> pending;
+
+    /// computations on the read data, run once the sections are filled
+    std::vector<std::function<void()>> after_sections;
+
+    /// reads the header. The magic number has already been consumed.
+    explicit SectionedIOReader(IOReader* reader);
+
+    size_t operator()(void* ptr, size_t size, size_t nitems) override;
+
+    /// reads the pieces if they are inline, otherwise defers the read
+    void read_section(const SectionDestPieces& pieces);
+
+    /// reads the table of contents, then the sections and checks them,
+    /// then runs after_sections
+    void finish();
+};
+
+/// magic number of the sectioned container
+uint32_t sectioned_io_magic();
+
+/// write a block of data, possibly as a section if f is a SectionedIOWriter
+void write_section(IOWriter* f, const SectionPieces& pieces);
+void write_section(IOWriter* f, const void* data, size_t nbytes);
+
+/// read a block of data written with write_section
+void read_section(IOReader* f, const SectionDestPieces& pieces);
+void read_section(IOReader* f, void* data, size_t nbytes);
+
+/// run fn once the data read so far from f is available: immediately,
+/// or at the end of SectionedIOReader::finish if f is sectioned
+void run_after_sections(IOReader* f, std::function<void()> fn);
+
 /// cast a 4-character string to a uint32_t that can be written and read easily
 uint32_t fourcc(const char sx[4]);
 uint32_t fourcc(const std::string& sx);
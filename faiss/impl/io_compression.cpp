@@ -0,0 +1,535 @@
+/**
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+// -*- c++ -*-
+
+#include <faiss/impl/io_compression.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+
+#include <faiss/OMPConfig.h>
+#include <faiss/impl/FaissAssert.h>
+#include <faiss/impl/io_macros.h>
+
+namespace faiss {
+
+/***********************************************************************
+ * LZIOCodec
+ ***********************************************************************/
+
+namespace {
+
+const size_t lz_min_match = 4;
+// no match can start in the last bytes of the block, so that the
+// decoder always ends with literals
+const size_t lz_last_literals = 5;
+const size_t lz_mf_limit = 12;
+const size_t lz_max_offset = 65535;
+
+inline uint32_t read32(const uint8_t* p) {
+    uint32_t x;
+    memcpy(&x, p, 4);
+    return x;
+}
+
+inline uint64_t read64(const uint8_t* p) {
+    uint64_t x;
+    memcpy(&x, p, 8);
+    return x;
+}
+
+/// write a length that does not fit in the token
+inline uint8_t* write_length(uint8_t* op, size_t len) {
+    while (len >= 255) {
+        *op++ = 255;
+        len -= 255;
+    }
+    *op++ = len;
+    return op;
+}
+
+inline uint8_t* write_sequence(
+        uint8_t* op,
+        const uint8_t* literals,
+        size_t nlit,
+        size_t offset,
+        size_t match_len) {
+    uint8_t* token = op++;
+    *token = (nlit >= 15 ? 15 : nlit) << 4;
+    if (nlit >= 15) {
+        op = write_length(op, nlit - 15);
+    }
+    memcpy(op, literals, nlit);
+    op += nlit;
+    if (match_len == 0) { // last sequence
+        return op;
+    }
+    *op++ = offset & 0xff;
+    *op++ = offset >> 8;
+    size_t ml = match_len - lz_min_match;
+    *token |= ml >= 15 ? 15 : ml;
+    if (ml >= 15) {
+        op = write_length(op, ml - 15);
+    }
+    return op;
+}
+
+size_t lz_compress(const uint8_t* src, size_t n, uint8_t* dst, int hash_bits) {
+    uint8_t* op = dst;
+    size_t anchor = 0;
+    if (n >= lz_mf_limit) {
+        std::vector<uint32_t> table(size_t(1) << hash_bits);
+        const int shift = 32 - hash_bits;
+        size_t match_limit = n - lz_last_literals;
+        size_t ip = 0;
+        while (ip + lz_mf_limit <= n) {
+            uint32_t seq = read32(src + ip);
+            uint32_t h = (seq * 2654435761U) >> shift;
+            size_t ref = table[h];
+            table[h] = ip;
+            if (ref >= ip || ip - ref > lz_max_offset ||
+                read32(src + ref) != seq) {
+                // skip faster in incompressible areas
+                ip += 1 + ((ip - anchor) >> 6);
+                continue;
+            }
+            size_t ml = lz_min_match;
+            while (ip + ml + 8 <= match_limit &&
+                   read64(src + ref + ml) == read64(src + ip + ml)) {
+                ml += 8;
+            }
+            while (ip + ml < match_limit && src[ref + ml] == src[ip + ml]) {
+                ml++;
+            }
+            op = write_sequence(op, src + anchor, ip - anchor, ip - ref, ml);
+            ip += ml;
+            anchor = ip;
+        }
+    }
+    op = write_sequence(op, src + anchor, n - anchor, 0, 0);
+    return op - dst;
+}
+
+void lz_decompress(const uint8_t* src, size_t csize, uint8_t* dst, size_t n) {
+    size_t ip = 0, op = 0;
+    auto read_length = [&](size_t len) {
+        uint8_t b;
+        do {
+            FAISS_THROW_IF_NOT_MSG(ip < csize, "corrupted compressed block");
+            b = src[ip++];
+            len += b;
+        } while (b == 255);
+        return len;
+    };
+    for (;;) {
+        FAISS_THROW_IF_NOT_MSG(ip < csize, "corrupted compressed block");
+        uint8_t token = src[ip++];
+        size_t nlit = token >> 4;
+        if (nlit == 15) {
+            nlit = read_length(nlit);
+        }
+        FAISS_THROW_IF_NOT_MSG(
+                nlit <= csize - ip && nlit <= n - op,
+                "corrupted compressed block");
+        memcpy(dst + op, src + ip, nlit);
+        ip += nlit;
+        op += nlit;
+        if (ip == csize) {
+            break;
+        }
+        FAISS_THROW_IF_NOT_MSG(ip + 2 <= csize, "corrupted compressed block");
+        size_t offset = src[ip] | (size_t(src[ip + 1]) << 8);
+        ip += 2;
+        size_t ml = token & 15;
+        if (ml == 15) {
+            ml = read_length(ml);
+        }
+        ml += lz_min_match;
+        FAISS_THROW_IF_NOT_MSG(
+                offset > 0 && offset <= op && ml <= n - op,
+                "corrupted compressed block");
+        uint8_t* d = dst + op;
+        const uint8_t* s = d - offset;
+        if (offset >= ml) {
+            memcpy(d, s, ml);
+        } else { // overlapping copy
+            for (size_t i = 0; i < ml; i++) {
+                d[i] = s[i];
+            }
+        }
+        op += ml;
+    }
+    FAISS_THROW_IF_NOT_MSG(op == n, "corrupted compressed block");
+}
+
+/// group byte j of each 8-byte word together (the tail is copied as is)
+void shuffle_bytes(const uint8_t* src, size_t n, uint8_t* dst) {
+    size_t nw = n / 8;
+    for (size_t i = 0; i < nw; i++) {
+        for (size_t j = 0; j < 8; j++) {
+            dst[j * nw + i] = src[i * 8 + j];
+        }
+    }
+    memcpy(dst + nw * 8, src + nw * 8, n - nw * 8);
+}
+
+void unshuffle_bytes(const uint8_t* src, size_t n, uint8_t* dst) {
+    size_t nw = n / 8;
+    for (size_t i = 0; i < nw; i++) {
+        for (size_t j = 0; j < 8; j++) {
+            dst[i * 8 + j] = src[j * nw + i];
+        }
+    }
+    memcpy(dst + nw * 8, src + nw * 8, n - nw * 8);
+}
+
+} // namespace
+
+LZIOCodec::LZIOCodec() {
+    codec_id = fourcc("lz77");
+}
+
+size_t LZIOCodec::max_compressed_size(size_t n) const {
+    return 1 + n + n / 255 + 16;
+}
+
+// the first byte of the compressed data indicates whether the bytes were
+// shuffled before compression
+size_t LZIOCodec::compress(const uint8_t* src, size_t n, uint8_t* dst)
+        const {
+    dst[0] = 0;
+    size_t csize = lz_compress(src, n, dst + 1, hash_bits);
+    if (try_shuffle && n >= 64) {
+        std::vector<uint8_t> shuffled(n);
+        shuffle_bytes(src, n, shuffled.data());
+        std::vector<uint8_t> tmp(max_compressed_size(n));
+        size_t csize2 = lz_compress(shuffled.data(), n, tmp.data(), hash_bits);
+        if (csize2 < csize) {
+            dst[0] = 1;
+            memcpy(dst + 1, tmp.data(), csize2);
+            csize = csize2;
+        }
+    }
+    return csize + 1;
+}
+
+void LZIOCodec::decompress(
+        const uint8_t* src,
+        size_t csize,
+        uint8_t* dst,
+        size_t n) const {
+    FAISS_THROW_IF_NOT_MSG(
+            csize >= 1 && src[0] <= 1, "corrupted compressed block");
+    if (src[0] == 0) {
+        lz_decompress(src + 1, csize - 1, dst, n);
+    } else {
+        std::vector<uint8_t> shuffled(n);
+        lz_decompress(src + 1, csize - 1, shuffled.data(), n);
+        unshuffle_bytes(shuffled.data(), n, dst);
+    }
+}
+
+const IOCodec* get_builtin_io_codec(uint32_t codec_id) {
+    static LZIOCodec lz;
+    if (codec_id == lz.codec_id) {
+        return &lz;
+    }
+    return nullptr;
+}
+
+uint32_t compressed_io_magic() {
+    return fourcc("FSzc");
+}
+
+/***********************************************************************
+ * Positional access to the readers that support it
+ ***********************************************************************/
+
+namespace {
+
+size_t reader_tell(IOReader* r) {
+    if (auto fr = dynamic_cast<FileIOReader*>(r)) {
+        return ftell(fr->f);
+    } else if (auto br = dynamic_cast<BufIOReader*>(r)) {
+        return br->rp;
+    } else if (auto vr = dynamic_cast<VectorIOReader*>(r)) {
+        return vr->rp;
+    }
+    return 0;
+}
+
+size_t reader_size(IOReader* r) {
+    if (auto fr = dynamic_cast<FileIOReader*>(r)) {
+        long pos = ftell(fr->f);
+        fseek(fr->f, 0, SEEK_END);
+        size_t size = ftell(fr->f);
+        fseek(fr->f, pos, SEEK_SET);
+        return size;
+    } else if (auto br = dynamic_cast<BufIOReader*>(r)) {
+        return br->buf_size;
+    } else if (auto vr = dynamic_cast<VectorIOReader*>(r)) {
+        return vr->data.size();
+    }
+    FAISS_THROW_MSG("seek not supported on this type of reader");
+}
+
+void reader_seek(IOReader* r, size_t ofs) {
+    if (auto fr = dynamic_cast<FileIOReader*>(r)) {
+        FAISS_THROW_IF_NOT_FMT(
+                fseek(fr->f, ofs, SEEK_SET) == 0,
+                "seek error in %s: %s",
+                r->name.c_str(),
+                strerror(errno));
+    } else if (auto br = dynamic_cast<BufIOReader*>(r)) {
+        br->rp = ofs;
+    } else if (auto vr = dynamic_cast<VectorIOReader*>(r)) {
+        vr->rp = ofs;
+    } else {
+        FAISS_THROW_MSG("seek not supported on this type of reader");
+    }
+}
+
+} // namespace
+
+/***********************************************************************
+ * CompressedIOWriter
+ ***********************************************************************/
+
+CompressedIOWriter::CompressedIOWriter(
+        IOWriter* writer,
+        const IOCodec* codec,
+        size_t block_size)
+        : writer(writer), codec(codec), block_size(block_size) {
+    FAISS_THROW_IF_NOT(block_size > 0 && block_size < (size_t(1) << 31));
+    name = writer->name;
+    if (!this->codec) {
+        this->codec = get_builtin_io_codec(fourcc("lz77"));
+    }
+    IOWriter* f = writer;
+    uint32_t h = compressed_io_magic();
+    WRITE1(h);
+    WRITE1(this->codec->codec_id);
+    uint64_t bs = block_size;
+    WRITE1(bs);
+    nbytes = sizeof(h) + sizeof(uint32_t) + sizeof(bs);
+}
+
+size_t CompressedIOWriter::operator()(
+        const void* ptr,
+        size_t size,
+        size_t nitems) {
+    FAISS_THROW_IF_NOT(!finished);
+    const uint8_t* src = (const uint8_t*)ptr;
+    size_t n = size * nitems;
+    size_t batch_size = block_size * nblocks_per_batch;
+    while (n > 0) {
+        size_t nc = std::min(n, batch_size - buffer.size());
+        buffer.insert(buffer.end(), src, src + nc);
+        src += nc;
+        n -= nc;
+        if (buffer.size() == batch_size) {
+            write_blocks();
+        }
+    }
+    return nitems;
+}
+
+void CompressedIOWriter::write_blocks() {
+    size_t nb = (buffer.size() + block_size - 1) / block_size;
+    std::vector<std::vector<uint8_t>> cblocks(nb);
+
+#pragma omp parallel for schedule(dynamic) num_threads(num_omp_threads)
+    for (int64_t i = 0; i < nb; i++) {
+        size_t i0 = i * block_size;
+        size_t n = std::min(block_size, buffer.size() - i0);
+        std::vector<uint8_t>& cb = cblocks[i];
+        cb.resize(codec->max_compressed_size(n));
+        size_t csize = codec->compress(buffer.data() + i0, n, cb.data());
+        if (csize >= n) { // store as is
+            cb.assign(buffer.data() + i0, buffer.data() + i0 + n);
+        } else {
+            cb.resize(csize);
+        }
+    }
+
+    IOWriter* f = writer;
+    for (size_t i = 0; i < nb; i++) {
+        uint32_t sizes[2] = {
+                uint32_t(cblocks[i].size()),
+                uint32_t(std::min(block_size, buffer.size() - i * block_size))};
+        block_offsets.push_back(nbytes);
+        WRITEANDCHECK(sizes, 2);
+        WRITEANDCHECK(cblocks[i].data(), cblocks[i].size());
+        nbytes += sizeof(sizes) + cblocks[i].size();
+    }
+    buffer.clear();
+}
+
+void CompressedIOWriter::finish() {
+    if (finished) {
+        return;
+    }
+    finished = true;
+    write_blocks();
+    IOWriter* f = writer;
+    uint32_t end_marker[2] = {0, 0};
+    WRITEANDCHECK(end_marker, 2);
+    uint64_t index_offset = nbytes + sizeof(end_marker);
+    WRITEVECTOR(block_offsets);
+    WRITE1(index_offset);
+    uint32_t h = fourcc("FSzi");
+    WRITE1(h);
+}
+
+CompressedIOWriter::~CompressedIOWriter() {
+    try {
+        finish();
+    } catch (const std::exception& e) {
+        // we cannot raise an exception in the destructor
+        fprintf(stderr,
+                "CompressedIOWriter %s: finish error: %s\n",
+                name.c_str(),
+                e.what());
+    }
+}
+
+/***********************************************************************
+ * CompressedIOReader
+ ***********************************************************************/
+
+CompressedIOReader::CompressedIOReader(IOReader* reader, const IOCodec* codec)
+        : reader(reader), codec(codec) {
+    name = reader->name;
+    base_offset = reader_tell(reader);
+    IOReader* f = reader;
+    uint32_t h, codec_id;
+    READ1(h);
+    FAISS_THROW_IF_NOT_MSG(
+            h == compressed_io_magic(), "not a compressed stream");
+    READ1(codec_id);
+    if (!this->codec) {
+        this->codec = get_builtin_io_codec(codec_id);
+        FAISS_THROW_IF_NOT_FMT(
+                this->codec,
+                "no built-in codec for id %s",
+                fourcc_inv_printable(codec_id).c_str());
+    }
+    FAISS_THROW_IF_NOT_FMT(
+            this->codec->codec_id == codec_id,
+            "stream compressed with codec %s",
+            fourcc_inv_printable(codec_id).c_str());
+    uint64_t bs;
+    READ1(bs);
+    FAISS_THROW_IF_NOT(bs > 0 && bs < (uint64_t(1) << 31));
+    block_size = bs;
+}
+
+void CompressedIOReader::read_blocks() {
+    IOReader* f = reader;
+    std::vector<std::vector<uint8_t>> cblocks;
+    std::vector<size_t> raw_offsets(1, 0);
+    size_t max_csize = codec->max_compressed_size(block_size);
+    while (cblocks.size() < nblocks_per_batch) {
+        uint32_t sizes[2];
+        READANDCHECK(sizes, 2);
+        if (sizes[0] == 0 && sizes[1] == 0) {
+            eof = true;
+            break;
+        }
+        FAISS_THROW_IF_NOT_MSG(
+                sizes[1] <= block_size && sizes[0] <= max_csize,
+                "corrupted compressed stream");
+        cblocks.emplace_back(sizes[0]);
+        READANDCHECK(cblocks.back().data(), sizes[0]);
+        raw_offsets.push_back(raw_offsets.back() + sizes[1]);
+    }
+    buffer.resize(raw_offsets.back());
+    b0 = 0;
+
+    std::mutex exception_mutex;
+    std::string exception_string;
+
+#pragma omp parallel for schedule(dynamic) num_threads(num_omp_threads)
+    for (int64_t i = 0; i < cblocks.size(); i++) {
+        const std::vector<uint8_t>& cb = cblocks[i];
+        uint8_t* dst = buffer.data() + raw_offsets[i];
+        size_t n = raw_offsets[i + 1] - raw_offsets[i];
+        if (cb.size() == n) {
+            memcpy(dst, cb.data(), n);
+            continue;
+        }
+        try {
+            codec->decompress(cb.data(), cb.size(), dst, n);
+        } catch (const std::exception& e) {
+            std::lock_guard<std::mutex> lock(exception_mutex);
+            exception_string = e.what();
+        }
+    }
+    if (!exception_string.empty()) {
+        FAISS_THROW_MSG(exception_string.c_str());
+    }
+}
+
+size_t CompressedIOReader::operator()(void* ptr, size_t size, size_t nitems) {
+    uint8_t* dst = (uint8_t*)ptr;
+    size_t n = size * nitems;
+    size_t nr = 0;
+    while (nr < n) {
+        if (b0 == buffer.size()) {
+            if (eof) {
+                break;
+            }
+            read_blocks();
+            continue;
+        }
+        size_t nc = std::min(n - nr, buffer.size() - b0);
+        memcpy(dst + nr, buffer.data() + b0, nc);
+        b0 += nc;
+        nr += nc;
+    }
+    return size == 0 ? 0 : nr / size;
+}
+
+void CompressedIOReader::seek(size_t ofs) {
+    IOReader* f = reader;
+    if (block_offsets.empty()) {
+        size_t end = reader_size(reader);
+        uint64_t index_offset;
+        uint32_t h;
+        FAISS_THROW_IF_NOT(end >= base_offset + sizeof(index_offset) + 4);
+        reader_seek(reader, end - sizeof(index_offset) - sizeof(h));
+        READ1(index_offset);
+        READ1(h);
+        FAISS_THROW_IF_NOT_MSG(
+                h == fourcc("FSzi"),
+                "block index of compressed stream not found");
+        reader_seek(reader, base_offset + index_offset);
+        READVECTOR(block_offsets);
+    }
+    size_t block_no = ofs / block_size;
+    FAISS_THROW_IF_NOT_FMT(
+            block_no < block_offsets.size(),
+            "offset %zd out of compressed stream",
+            ofs);
+    reader_seek(reader, base_offset + block_offsets[block_no]);
+    buffer.clear();
+    b0 = 0;
+    eof = false;
+    // decompress a single block
+    size_t nbpb = nblocks_per_batch;
+    nblocks_per_batch = 1;
+    read_blocks();
+    nblocks_per_batch = nbpb;
+    FAISS_THROW_IF_NOT(ofs % block_size <= buffer.size());
+    b0 = ofs % block_size;
+}
+
+} // namespace faiss
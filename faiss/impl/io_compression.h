@@ -0,0 +1,164 @@
+/**
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+// -*- c++ -*-
+
+/***********************************************************
+ * Compressing IOWriter / IOReader
+ *
+ * The data is cut into blocks that are compressed independently, so that
+ * they can be (de)compressed in parallel and the stream can be entered at
+ * any block. The stream format is:
+ *
+ *   header:      "FSzc", codec_id, block_size
+ *   blocks:      compressed size (u32), raw size (u32), compressed data
+ *   end marker:  0, 0
+ *   block index: nb of blocks, offset of each block from the header
+ *   trailer:     offset of the block index, "FSzi"
+ *
+ * A block whose compressed size equals its raw size is stored as is.
+ ***********************************************************/
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <faiss/impl/io.h>
+
+namespace faiss {
+
+/** Block compression algorithm. Other algorithms (zstd, lz4...) can be
+ * plugged in by implementing this interface. */
+struct IOCodec {
+    /// stored in the stream header to check that the right codec is used
+    uint32_t codec_id = 0;
+
+    /// upper bound of the compressed size of n bytes
+    virtual size_t max_compressed_size(size_t n) const = 0;
+
+    /// compress n bytes of src to dst, returns the compressed size
+    virtual size_t compress(const uint8_t* src, size_t n, uint8_t* dst)
+            const = 0;
+
+    /// decompress csize bytes of src to exactly n bytes in dst
+    virtual void decompress(
+            const uint8_t* src,
+            size_t csize,
+            uint8_t* dst,
+            size_t n) const = 0;
+
+    virtual ~IOCodec() {}
+};
+
+/** LZ77 codec in the style of LZ4: greedy matching of 4-byte sequences
+ * found with a hash table, byte-aligned tokens. It is fast enough not to
+ * slow down the I/O and works well on low-entropy codes. */
+struct LZIOCodec : IOCodec {
+    /// log2 of the hash table size
+    int hash_bits = 16;
+
+    /** also try to compress the block after grouping the bytes of
+     * 8-byte words by position, and keep the smallest result. This is
+     * effective on ids, whose high-order bytes are mostly 0. */
+    bool try_shuffle = true;
+
+    LZIOCodec();
+
+    size_t max_compressed_size(size_t n) const override;
+    size_t compress(const uint8_t* src, size_t n, uint8_t* dst)
+            const override;
+    void decompress(const uint8_t* src, size_t csize, uint8_t* dst, size_t n)
+            const override;
+};
+
+/// built-in codec corresponding to an id, nullptr if there is none
+const IOCodec* get_builtin_io_codec(uint32_t codec_id);
+
+uint32_t compressed_io_magic();
+
+struct CompressedIOWriter : IOWriter {
+    IOWriter* writer;
+    const IOCodec* codec;
+    size_t block_size;
+
+    /// nb of blocks that are compressed in parallel
+    size_t nblocks_per_batch = 32;
+
+    /// data that is not compressed yet
+    std::vector<uint8_t> buffer;
+
+    /// nb of compressed bytes written, including the header
+    size_t nbytes = 0;
+
+    /// offset of each block, relative to the header
+    std::vector<uint64_t> block_offsets;
+
+    bool finished = false;
+
+    /**
+     * @param codec     if null, an LZIOCodec is used
+     */
+    explicit CompressedIOWriter(
+            IOWriter* writer,
+            const IOCodec* codec = nullptr,
+            size_t block_size = 1 << 20);
+
+    size_t operator()(const void* ptr, size_t size, size_t nitems) override;
+
+    /// compress the remaining data and write the block index. Call it
+    /// explicitly to get the write errors as exceptions.
+    void finish();
+
+    // finishes if needed, errors are only reported on stderr
+    ~CompressedIOWriter() override;
+
+   private:
+    void write_blocks();
+};
+
+struct CompressedIOReader : IOReader {
+    IOReader* reader;
+    const IOCodec* codec;
+    size_t block_size = 0;
+
+    /// nb of blocks that are decompressed in parallel
+    size_t nblocks_per_batch = 32;
+
+    /// decompressed data and read position in it
+    std::vector<uint8_t> buffer;
+    size_t b0 = 0;
+
+    /// the end marker was reached
+    bool eof = false;
+
+    /// offset of the header in the underlying reader
+    size_t base_offset = 0;
+
+    /// loaded by seek()
+    std::vector<uint64_t> block_offsets;
+
+    /**
+     * @param codec     if null, the built-in codec that matches the
+     *                  header is used
+     */
+    explicit CompressedIOReader(
+            IOReader* reader,
+            const IOCodec* codec = nullptr);
+
+    size_t operator()(void* ptr, size_t size, size_t nitems) override;
+
+    /** move to offset ofs of the uncompressed stream, decompressing only
+     * the block that contains it. The underlying reader must be a file or
+     * memory reader that ends with the compressed stream. */
+    void seek(size_t ofs);
+
+   private:
+    void read_blocks();
+};
+
+} // namespace faiss
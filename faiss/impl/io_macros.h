@@ -81,8 +81,45 @@
     {                                                                \
         size_t size;                                                 \
         READANDCHECK(&size, 1);                                      \
-        FAISS_THROW_IF_NOT(size >= 0 && size < (uint64_t{1} << 40)); \
+        FAISS_THROW_IF_NOT(size < (uint64_t{1} << 40));              \
         size *= 4;                                                   \
         (vec).resize(size);                                          \
         READANDCHECK((vec).data(), size);                            \
     }
+
+// vectors that may be stored in a separate section (see SectionedIOWriter).
+// The format is the same as READVECTOR / WRITEVECTOR for other writers.
+
+#define WRITEVECTOR_SECTION(vec)                                        \
+    {                                                                   \
+        size_t size = (vec).size();                                     \
+        WRITEANDCHECK(&size, 1);                                        \
+        write_section(f, (vec).data(), size * sizeof((vec).data()[0])); \
+    }
+
+#define READVECTOR_SECTION(vec)                                        \
+    {                                                                  \
+        size_t size;                                                   \
+        READANDCHECK(&size, 1);                                        \
+        FAISS_THROW_IF_NOT(size < (uint64_t{1} << 40));                \
+        (vec).resize(size);                                            \
+        read_section(f, (vec).data(), size * sizeof((vec).data()[0])); \
+    }
+
+#define WRITEXBVECTOR_SECTION(vec)                 \
+    {                                              \
+        FAISS_THROW_IF_NOT((vec).size() % 4 == 0); \
+        size_t size = (vec).size() / 4;            \
+        WRITEANDCHECK(&size, 1);                   \
+        write_section(f, (vec).data(), size * 4);  \
+    }
+
+#define READXBVECTOR_SECTION(vec)                                    \
+    {                                                                \
+        size_t size;                                                 \
+        READANDCHECK(&size, 1);                                      \
+        FAISS_THROW_IF_NOT(size < (uint64_t{1} << 40));              \
+        size *= 4;                                                   \
+        (vec).resize(size);                                          \
+        read_section(f, (vec).data(), size);                         \
+    }
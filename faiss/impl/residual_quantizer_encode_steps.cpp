@@ -95,7 +95,7 @@ void accum_and_store_tab(
         for (size_t ij = 1; ij < M; ij++) {
             reg += cbs[ij][kk];
         }
-        output[b * K + kk] = reg;
+        output[kk] = reg;
     }
 }
 
@@ -152,7 +152,7 @@ void accum_and_add_tab(
         for (size_t ij = 1; ij < M; ij++) {
             reg += cbs[ij][kk];
         }
-        output[b * K + kk] += reg;
+        output[kk] += reg;
     }
 }
 
@@ -202,7 +202,7 @@ void accum_and_finalize_tab(
             common_v = fmadd(two, regs[ik], common_v);
 
             common_v += simd8float32(distances_i[b]);
-            common_v.storeu(output + b * K + kk + ik * 8);
+            common_v.storeu(output + kk + ik * 8);
         }
     }
 #else
@@ -216,10 +216,152 @@ void accum_and_finalize_tab(
             reg += cbs[ij][kk];
         }
 
-        output[b * K + kk] = distances_i[b] + cd_common[kk] + 2 * reg;
+        output[kk] = distances_i[b] + cd_common[kk] + 2 * reg;
     }
 }
 
+/// Distances of the beam entry b to the K centroids of the current codebook,
+/// computed from the codebook cross-products. The result is stored in
+/// row (size K), dp is a temporary buffer of size K.
+void compute_beam_row_tab(
+        size_t K,
+        size_t m,
+        size_t b,
+        const float* const __restrict codebook_cross_norms,
+        const uint64_t* const __restrict codebook_offsets,
+        const size_t ldc,
+        const int32_t* const __restrict codes_i,
+        const float* const __restrict distances_i,
+        const float* const __restrict cd_common,
+        float* const __restrict dp,
+        float* const __restrict row) {
+    bool use_baseline_implementation = false;
+
+    // This is the baseline implementation. Its primary flaw
+    //   that it writes way too many info to the temporary buffer
+    //   called dp.
+    //
+    // This baseline code is kept intentionally because it is easy to
+    // understand what an optimized version optimizes exactly.
+    //
+    if (use_baseline_implementation) {
+        memset(dp, 0, sizeof(*dp) * K);
+
+        for (size_t m1 = 0; m1 < m; m1++) {
+            size_t c = codes_i[b * m + m1];
+            const float* cb =
+                    &codebook_cross_norms[(codebook_offsets[m1] + c) * ldc];
+            fvec_add(K, cb, dp, dp);
+        }
+
+        for (size_t k = 0; k < K; k++) {
+            row[k] = distances_i[b] + cd_common[k] + 2 * dp[k];
+        }
+        return;
+    }
+
+    // An optimized implementation that avoids using a temporary buffer
+    // and does the accumulation in registers.
+
+    // Compute a sum of NK AQ codes.
+#define ACCUM_AND_FINALIZE_TAB(NK)         \
+    case NK:                               \
+        accum_and_finalize_tab<NK, 4>(     \
+                codebook_cross_norms,      \
+                codebook_offsets,          \
+                codes_i,                   \
+                b,                         \
+                ldc,                       \
+                K,                         \
+                distances_i,               \
+                cd_common,                 \
+                row);                      \
+        break;
+
+    // this version contains many switch-case scenarios, but
+    // they won't affect branch predictor.
+    switch (m) {
+        case 0:
+            // trivial case
+            for (size_t k = 0; k < K; k++) {
+                row[k] = distances_i[b] + cd_common[k];
+            }
+            break;
+
+            ACCUM_AND_FINALIZE_TAB(1)
+            ACCUM_AND_FINALIZE_TAB(2)
+            ACCUM_AND_FINALIZE_TAB(3)
+            ACCUM_AND_FINALIZE_TAB(4)
+            ACCUM_AND_FINALIZE_TAB(5)
+            ACCUM_AND_FINALIZE_TAB(6)
+            ACCUM_AND_FINALIZE_TAB(7)
+
+        default: {
+            // m >= 8 case.
+
+            // A temporary buffer has to be used due to the lack of
+            // registers. But we'll try to accumulate up to 8 AQ codes
+            // in registers and issue a single write operation to the
+            // buffer, while the baseline does no accumulation. So, the
+            // number of write operations to the temporary buffer is
+            // reduced 8x.
+
+            // Initialize it. Compute a sum of first 8 AQ codes
+            // because m >= 8 .
+            accum_and_store_tab<8, 4>(
+                    m,
+                    codebook_cross_norms,
+                    codebook_offsets,
+                    codes_i,
+                    b,
+                    ldc,
+                    K,
+                    dp);
+
+#define ACCUM_AND_ADD_TAB(NK)          \
+    case NK:                           \
+        accum_and_add_tab<NK, 4>(      \
+                m,                     \
+                codebook_cross_norms,  \
+                codebook_offsets + im, \
+                codes_i + im,          \
+                b,                     \
+                ldc,                   \
+                K,                     \
+                dp);                   \
+        break;
+
+            // accumulate up to 8 additional AQ codes into
+            // a temporary buffer
+            for (size_t im = 8; im < ((m + 7) / 8) * 8; im += 8) {
+                size_t m_left = m - im;
+                if (m_left > 8) {
+                    m_left = 8;
+                }
+
+                switch (m_left) {
+                    ACCUM_AND_ADD_TAB(1)
+                    ACCUM_AND_ADD_TAB(2)
+                    ACCUM_AND_ADD_TAB(3)
+                    ACCUM_AND_ADD_TAB(4)
+                    ACCUM_AND_ADD_TAB(5)
+                    ACCUM_AND_ADD_TAB(6)
+                    ACCUM_AND_ADD_TAB(7)
+                    ACCUM_AND_ADD_TAB(8)
+                }
+            }
+
+            // done. finalize the result
+            for (size_t k = 0; k < K; k++) {
+                row[k] = distances_i[b] + cd_common[k] + 2 * dp[k];
+            }
+        }
+    }
+
+#undef ACCUM_AND_ADD_TAB
+#undef ACCUM_AND_FINALIZE_TAB
+}
+
 } // anonymous namespace
 
 /********************************************************************
@@ -275,60 +417,69 @@ void beam_search_encode_step(
     }
     InterruptCallback::check();
 
-#pragma omp parallel for if (n > 100)
-    for (int64_t i = 0; i < n; i++) {
-        const int32_t* codes_i = codes + i * m * beam_size;
-        int32_t* new_codes_i = new_codes + i * (m + 1) * new_beam_size;
-        const float* residuals_i = residuals + i * d * beam_size;
-        float* new_residuals_i = new_residuals + i * d * new_beam_size;
-
-        float* new_distances_i = new_distances + i * new_beam_size;
-        using C = CMax<float, int>;
-
-        if (assign_index) {
-            const float* cent_distances_i =
-                    cent_distances.data() + i * beam_size * new_beam_size;
-            const idx_t* cent_ids_i =
-                    cent_ids.data() + i * beam_size * new_beam_size;
-
-            // here we could be a tad more efficient by merging sorted arrays
-            for (int i_2 = 0; i_2 < new_beam_size; i_2++) {
-                new_distances_i[i_2] = C::neutral();
-            }
-            std::vector<int> perm(new_beam_size, -1);
-            heap_addn<C>(
-                    new_beam_size,
-                    new_distances_i,
-                    perm.data(),
-                    cent_distances_i,
-                    nullptr,
-                    beam_size * new_beam_size);
-            heap_reorder<C>(new_beam_size, new_distances_i, perm.data());
-
-            for (int j = 0; j < new_beam_size; j++) {
-                int js = perm[j] / new_beam_size;
-                int ls = cent_ids_i[perm[j]];
-                if (m > 0) {
-                    memcpy(new_codes_i, codes_i + js * m, sizeof(*codes) * m);
+#pragma omp parallel if (n > 100) num_threads(num_omp_threads)
+    {
+        // per-thread buffer, re-used for all the vectors of the thread
+        std::vector<int> perm(new_beam_size);
+
+#pragma omp for
+        for (int64_t i = 0; i < n; i++) {
+            const int32_t* codes_i = codes + i * m * beam_size;
+            int32_t* new_codes_i = new_codes + i * (m + 1) * new_beam_size;
+            const float* residuals_i = residuals + i * d * beam_size;
+            float* new_residuals_i = new_residuals + i * d * new_beam_size;
+
+            float* new_distances_i = new_distances + i * new_beam_size;
+            using C = CMax<float, int>;
+
+            if (assign_index) {
+                const float* cent_distances_i =
+                        cent_distances.data() + i * beam_size * new_beam_size;
+                const idx_t* cent_ids_i =
+                        cent_ids.data() + i * beam_size * new_beam_size;
+
+                // here we could be a tad more efficient by merging sorted
+                // arrays
+                for (int i_2 = 0; i_2 < new_beam_size; i_2++) {
+                    new_distances_i[i_2] = C::neutral();
+                }
+                std::fill(perm.begin(), perm.end(), -1);
+                heap_addn<C>(
+                        new_beam_size,
+                        new_distances_i,
+                        perm.data(),
+                        cent_distances_i,
+                        nullptr,
+                        beam_size * new_beam_size);
+                heap_reorder<C>(
+                        new_beam_size, new_distances_i, perm.data());
+
+                for (int j = 0; j < new_beam_size; j++) {
+                    int js = perm[j] / new_beam_size;
+                    int ls = cent_ids_i[perm[j]];
+                    if (m > 0) {
+                        memcpy(new_codes_i,
+                               codes_i + js * m,
+                               sizeof(*codes) * m);
+                    }
+                    new_codes_i[m] = ls;
+                    new_codes_i += m + 1;
+                    fvec_sub(
+                            d,
+                            residuals_i + js * d,
+                            cent + ls * d,
+                            new_residuals_i);
+                    new_residuals_i += d;
                 }
-                new_codes_i[m] = ls;
-                new_codes_i += m + 1;
-                fvec_sub(
-                        d,
-                        residuals_i + js * d,
-                        cent + ls * d,
-                        new_residuals_i);
-                new_residuals_i += d;
-            }
 
-        } else {
-            const float* cent_distances_i =
-                    cent_distances.data() + i * beam_size * K;
-            // then we have to select the best results
-            for (int i_2 = 0; i_2 < new_beam_size; i_2++) {
-                new_distances_i[i_2] = C::neutral();
-            }
-            std::vector<int> perm(new_beam_size, -1);
+            } else {
+                const float* cent_distances_i =
+                        cent_distances.data() + i * beam_size * K;
+                // then we have to select the best results
+                for (int i_2 = 0; i_2 < new_beam_size; i_2++) {
+                    new_distances_i[i_2] = C::neutral();
+                }
+                std::fill(perm.begin(), perm.end(), -1);
 
 #define HANDLE_APPROX(NB, BD)                                  \
     case ApproxTopK_mode_t::APPROX_TOPK_BUCKETS_B##NB##_D##BD: \
@@ -341,38 +492,42 @@ void beam_search_encode_step(
                 perm.data());                                  \
         break;
 
-            switch (approx_topk_mode) {
-                HANDLE_APPROX(8, 3)
-                HANDLE_APPROX(8, 2)
-                HANDLE_APPROX(16, 2)
-                HANDLE_APPROX(32, 2)
-                default:
-                    heap_addn<C>(
-                            new_beam_size,
-                            new_distances_i,
-                            perm.data(),
-                            cent_distances_i,
-                            nullptr,
-                            beam_size * K);
-            }
-            heap_reorder<C>(new_beam_size, new_distances_i, perm.data());
+                switch (approx_topk_mode) {
+                    HANDLE_APPROX(8, 3)
+                    HANDLE_APPROX(8, 2)
+                    HANDLE_APPROX(16, 2)
+                    HANDLE_APPROX(32, 2)
+                    default:
+                        heap_addn<C>(
+                                new_beam_size,
+                                new_distances_i,
+                                perm.data(),
+                                cent_distances_i,
+                                nullptr,
+                                beam_size * K);
+                }
+                heap_reorder<C>(
+                        new_beam_size, new_distances_i, perm.data());
 
 #undef HANDLE_APPROX
 
-            for (int j = 0; j < new_beam_size; j++) {
-                int js = perm[j] / K;
-                int ls = perm[j] % K;
-                if (m > 0) {
-                    memcpy(new_codes_i, codes_i + js * m, sizeof(*codes) * m);
+                for (int j = 0; j < new_beam_size; j++) {
+                    int js = perm[j] / K;
+                    int ls = perm[j] % K;
+                    if (m > 0) {
+                        memcpy(new_codes_i,
+                               codes_i + js * m,
+                               sizeof(*codes) * m);
+                    }
+                    new_codes_i[m] = ls;
+                    new_codes_i += m + 1;
+                    fvec_sub(
+                            d,
+                            residuals_i + js * d,
+                            cent + ls * d,
+                            new_residuals_i);
+                    new_residuals_i += d;
                 }
-                new_codes_i[m] = ls;
-                new_codes_i += m + 1;
-                fvec_sub(
-                        d,
-                        residuals_i + js * d,
-                        cent + ls * d,
-                        new_residuals_i);
-                new_residuals_i += d;
             }
         }
     }
@@ -399,169 +554,72 @@ void beam_search_encode_step_tab(
 {
     FAISS_THROW_IF_NOT(ldc >= K);
 
-#pragma omp parallel for if (n > 100) schedule(dynamic)
-    for (int64_t i = 0; i < n; i++) {
-        std::vector<float> cent_distances(beam_size * K);
-        std::vector<float> cd_common(K);
+    using C = CMax<float, int>;
 
-        const int32_t* codes_i = codes + i * m * beam_size;
-        const float* query_cp_i = query_cp + i * ldqc;
-        const float* distances_i = distances + i * beam_size;
+    // In exact mode, the top-k selection is fused with the distance
+    // computation: each row of the (beam_size, K) distance matrix is pushed
+    // to the result heap while it is still in L1. The approximate top-k
+    // modes need the full matrix.
+    const bool fused_topk = approx_topk_mode == ApproxTopK_mode_t::EXACT_TOPK;
 
-        for (size_t k = 0; k < K; k++) {
-            cd_common[k] = cent_norms_i[k] - 2 * query_cp_i[k];
-        }
+#pragma omp parallel if (n > 100) num_threads(num_omp_threads)
+    {
+        // per-thread buffers, re-used for all the vectors of the thread
+        std::vector<float> cent_distances(fused_topk ? K : beam_size * K);
+        std::vector<float> cd_common(K);
+        std::vector<float> dp(K);
+        std::vector<int> perm(new_beam_size);
 
-        bool use_baseline_implementation = false;
+#pragma omp for schedule(dynamic)
+        for (int64_t i = 0; i < n; i++) {
+            const int32_t* codes_i = codes + i * m * beam_size;
+            const float* query_cp_i = query_cp + i * ldqc;
+            const float* distances_i = distances + i * beam_size;
 
-        // This is the baseline implementation. Its primary flaw
-        //   that it writes way too many info to the temporary buffer
-        //   called dp.
-        //
-        // This baseline code is kept intentionally because it is easy to
-        // understand what an optimized version optimizes exactly.
-        //
-        if (use_baseline_implementation) {
-            for (size_t b = 0; b < beam_size; b++) {
-                std::vector<float> dp(K);
-
-                for (size_t m1 = 0; m1 < m; m1++) {
-                    size_t c = codes_i[b * m + m1];
-                    const float* cb =
-                            &codebook_cross_norms
-                                    [(codebook_offsets[m1] + c) * ldc];
-                    fvec_add(K, cb, dp.data(), dp.data());
-                }
+            int32_t* new_codes_i = new_codes + i * (m + 1) * new_beam_size;
+            float* new_distances_i = new_distances + i * new_beam_size;
 
-                for (size_t k = 0; k < K; k++) {
-                    cent_distances[b * K + k] =
-                            distances_i[b] + cd_common[k] + 2 * dp[k];
-                }
+            for (size_t k = 0; k < K; k++) {
+                cd_common[k] = cent_norms_i[k] - 2 * query_cp_i[k];
             }
 
-        } else {
-            // An optimized implementation that avoids using a temporary buffer
-            // and does the accumulation in registers.
-
-            // Compute a sum of NK AQ codes.
-#define ACCUM_AND_FINALIZE_TAB(NK)               \
-    case NK:                                     \
-        for (size_t b = 0; b < beam_size; b++) { \
-            accum_and_finalize_tab<NK, 4>(       \
-                    codebook_cross_norms,        \
-                    codebook_offsets,            \
-                    codes_i,                     \
-                    b,                           \
-                    ldc,                         \
-                    K,                           \
-                    distances_i,                 \
-                    cd_common.data(),            \
-                    cent_distances.data());      \
-        }                                        \
-        break;
-
-            // this version contains many switch-case scenarios, but
-            // they won't affect branch predictor.
-            switch (m) {
-                case 0:
-                    // trivial case
-                    for (size_t b = 0; b < beam_size; b++) {
-                        for (size_t k = 0; k < K; k++) {
-                            cent_distances[b * K + k] =
-                                    distances_i[b] + cd_common[k];
-                        }
-                    }
-                    break;
-
-                    ACCUM_AND_FINALIZE_TAB(1)
-                    ACCUM_AND_FINALIZE_TAB(2)
-                    ACCUM_AND_FINALIZE_TAB(3)
-                    ACCUM_AND_FINALIZE_TAB(4)
-                    ACCUM_AND_FINALIZE_TAB(5)
-                    ACCUM_AND_FINALIZE_TAB(6)
-                    ACCUM_AND_FINALIZE_TAB(7)
-
-                default: {
-                    // m >= 8 case.
-
-                    // A temporary buffer has to be used due to the lack of
-                    // registers. But we'll try to accumulate up to 8 AQ codes
-                    // in registers and issue a single write operation to the
-                    // buffer, while the baseline does no accumulation. So, the
-                    // number of write operations to the temporary buffer is
-                    // reduced 8x.
-
-                    // allocate a temporary buffer
-                    std::vector<float> dp(K);
-
-                    for (size_t b = 0; b < beam_size; b++) {
-                        // Initialize it. Compute a sum of first 8 AQ codes
-                        // because m >= 8 .
-                        accum_and_store_tab<8, 4>(
-                                m,
-                                codebook_cross_norms,
-                                codebook_offsets,
-                                codes_i,
-                                b,
-                                ldc,
-                                K,
-                                dp.data());
-
-#define ACCUM_AND_ADD_TAB(NK)          \
-    case NK:                           \
-        accum_and_add_tab<NK, 4>(      \
-                m,                     \
-                codebook_cross_norms,  \
-                codebook_offsets + im, \
-                codes_i + im,          \
-                b,                     \
-                ldc,                   \
-                K,                     \
-                dp.data());            \
-        break;
-
-                        // accumulate up to 8 additional AQ codes into
-                        // a temporary buffer
-                        for (size_t im = 8; im < ((m + 7) / 8) * 8; im += 8) {
-                            size_t m_left = m - im;
-                            if (m_left > 8) {
-                                m_left = 8;
-                            }
-
-                            switch (m_left) {
-                                ACCUM_AND_ADD_TAB(1)
-                                ACCUM_AND_ADD_TAB(2)
-                                ACCUM_AND_ADD_TAB(3)
-                                ACCUM_AND_ADD_TAB(4)
-                                ACCUM_AND_ADD_TAB(5)
-                                ACCUM_AND_ADD_TAB(6)
-                                ACCUM_AND_ADD_TAB(7)
-                                ACCUM_AND_ADD_TAB(8)
-                            }
-                        }
+            for (int i_2 = 0; i_2 < new_beam_size; i_2++) {
+                new_distances_i[i_2] = C::neutral();
+                perm[i_2] = -1;
+            }
 
-                        // done. finalize the result
-                        for (size_t k = 0; k < K; k++) {
-                            cent_distances[b * K + k] =
-                                    distances_i[b] + cd_common[k] + 2 * dp[k];
+            for (size_t b = 0; b < beam_size; b++) {
+                float* row = fused_topk ? cent_distances.data()
+                                        : cent_distances.data() + b * K;
+                compute_beam_row_tab(
+                        K,
+                        m,
+                        b,
+                        codebook_cross_norms,
+                        codebook_offsets,
+                        ldc,
+                        codes_i,
+                        distances_i,
+                        cd_common.data(),
+                        dp.data(),
+                        row);
+
+                if (fused_topk) {
+                    // same as heap_addn over the full matrix
+                    for (size_t k = 0; k < K; k++) {
+                        if (C::cmp(new_distances_i[0], row[k])) {
+                            heap_replace_top<C>(
+                                    new_beam_size,
+                                    new_distances_i,
+                                    perm.data(),
+                                    row[k],
+                                    b * K + k);
                         }
                     }
                 }
             }
 
-            // the optimized implementation ends here
-        }
-        using C = CMax<float, int>;
-        int32_t* new_codes_i = new_codes + i * (m + 1) * new_beam_size;
-        float* new_distances_i = new_distances + i * new_beam_size;
-
-        const float* cent_distances_i = cent_distances.data();
-
-        // then we have to select the best results
-        for (int i_2 = 0; i_2 < new_beam_size; i_2++) {
-            new_distances_i[i_2] = C::neutral();
-        }
-        std::vector<int> perm(new_beam_size, -1);
+            const float* cent_distances_i = cent_distances.data();
 
 #define HANDLE_APPROX(NB, BD)                                  \
     case ApproxTopK_mode_t::APPROX_TOPK_BUCKETS_B##NB##_D##BD: \
@@ -574,34 +632,37 @@ void beam_search_encode_step_tab(
                 perm.data());                                  \
         break;
 
-        switch (approx_topk_mode) {
-            HANDLE_APPROX(8, 3)
-            HANDLE_APPROX(8, 2)
-            HANDLE_APPROX(16, 2)
-            HANDLE_APPROX(32, 2)
-            default:
-                heap_addn<C>(
-                        new_beam_size,
-                        new_distances_i,
-                        perm.data(),
-                        cent_distances_i,
-                        nullptr,
-                        beam_size * K);
-                break;
-        }
-
-        heap_reorder<C>(new_beam_size, new_distances_i, perm.data());
+            switch (approx_topk_mode) {
+                HANDLE_APPROX(8, 3)
+                HANDLE_APPROX(8, 2)
+                HANDLE_APPROX(16, 2)
+                HANDLE_APPROX(32, 2)
+                default:
+                    if (!fused_topk) {
+                        heap_addn<C>(
+                                new_beam_size,
+                                new_distances_i,
+                                perm.data(),
+                                cent_distances_i,
+                                nullptr,
+                                beam_size * K);
+                    }
+                    break;
+            }
 
 #undef HANDLE_APPROX
 
-        for (int j = 0; j < new_beam_size; j++) {
-            int js = perm[j] / K;
-            int ls = perm[j] % K;
-            if (m > 0) {
-                memcpy(new_codes_i, codes_i + js * m, sizeof(*codes) * m);
+            heap_reorder<C>(new_beam_size, new_distances_i, perm.data());
+
+            for (int j = 0; j < new_beam_size; j++) {
+                int js = perm[j] / K;
+                int ls = perm[j] % K;
+                if (m > 0) {
+                    memcpy(new_codes_i, codes_i + js * m, sizeof(*codes) * m);
+                }
+                new_codes_i[m] = ls;
+                new_codes_i += m + 1;
             }
-            new_codes_i[m] = ls;
-            new_codes_i += m + 1;
         }
     }
 }
@@ -673,8 +734,12 @@ void refine_beam_mp(
     size_t distances_size = 0;
     size_t residuals_size = 0;
 
+    std::vector<double> step_times(rq.M);
+    std::vector<size_t> step_ndis(rq.M);
+
     for (int m = 0; m < rq.M; m++) {
         int K = 1 << rq.nbits[m];
+        double t_step = getmillisecs();
 
         const float* __restrict codebooks_m =
                 rq.codebooks.data() + rq.codebook_offsets[m] * rq.d;
@@ -706,6 +771,8 @@ void refine_beam_mp(
         std::swap(codes_ptr, new_codes_ptr);
         std::swap(residuals_ptr, new_residuals_ptr);
 
+        step_times[m] = getmillisecs() - t_step;
+        step_ndis[m] = n * cur_beam_size * K;
         cur_beam_size = new_beam_size;
 
         if (rq.verbose) {
@@ -724,6 +791,8 @@ void refine_beam_mp(
         }
     }
 
+    residual_quantizer_stats.add(n, step_times, step_ndis);
+
     if (out_codes) {
         memcpy(out_codes, codes_ptr, codes_size * sizeof(*codes_ptr));
     }
@@ -789,8 +858,12 @@ void refine_beam_LUT_mp(
     size_t codes_size = 0;
     size_t distances_size = 0;
     size_t cross_ofs = 0;
+    std::vector<double> step_times(rq.M);
+    std::vector<size_t> step_ndis(rq.M);
+
     for (int m = 0; m < rq.M; m++) {
         int K = 1 << rq.nbits[m];
+        double t_step = getmillisecs();
 
         // it is guaranteed that (new_beam_size <= max_beam_size)
         int new_beam_size = std::min(beam_size * K, out_beam_size);
@@ -821,6 +894,8 @@ void refine_beam_LUT_mp(
         std::swap(codes_ptr, new_codes_ptr);
         std::swap(distances_ptr, new_distances_ptr);
 
+        step_times[m] = getmillisecs() - t_step;
+        step_ndis[m] = n * beam_size * K;
         beam_size = new_beam_size;
 
         if (rq.verbose) {
@@ -837,6 +912,8 @@ void refine_beam_LUT_mp(
                    beam_size);
         }
     }
+    residual_quantizer_stats.add(n, step_times, step_ndis);
+
     if (out_codes) {
         memcpy(out_codes, codes_ptr, codes_size * sizeof(*codes_ptr));
     }
@@ -140,8 +140,10 @@ std::map<std::string, ScalarQuantizer::QuantizerType> sq_types = {
         {"SQ4", ScalarQuantizer::QT_4bit},
         {"SQ6", ScalarQuantizer::QT_6bit},
         {"SQfp16", ScalarQuantizer::QT_fp16},
+        {"SQbf16", ScalarQuantizer::QT_bf16},
+        {"SQ8sym", ScalarQuantizer::QT_8bit_sym},
 };
-const std::string sq_pattern = "(SQ4|SQ8|SQ6|SQfp16)";
+const std::string sq_pattern = "(SQ4|SQ8|SQ6|SQfp16|SQbf16|SQ8sym)";
 
 std::map<std::string, AdditiveQuantizer::Search_type_t> aq_search_type = {
         {"_Nfloat", AdditiveQuantizer::ST_norm_float},
@@ -200,6 +202,9 @@ VectorTransform* parse_VectorTransform(const std::string& description, int d) {
     if (match("L2[nN]orm")) {
         return new NormalizationTransform(d, 2.0);
     }
+    if (match("HR")) {
+        return new HadamardRotation(d);
+    }
     if (match("RR([0-9]+)?")) {
         return new RandomRotationMatrix(d, mres_to_int(sm[1], d));
     }
@@ -909,6 +914,9 @@ IndexBinary* index_binary_factory(int d, const char* description) {
         IndexBinaryHNSW* index_hnsw = new IndexBinaryHNSW(d, M);
         index = index_hnsw;
 
+    } else if (sscanf(description, "BMIH%d", &nhash) == 1) {
+        index = new IndexBinaryMIH(d, nhash);
+
     } else if (sscanf(description, "BHash%dx%d", &nhash, &b) == 2) {
         index = new IndexBinaryMultiHash(d, nhash, b);
 
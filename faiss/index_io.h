@@ -35,13 +35,25 @@ struct IOReader;
 struct IOWriter;
 struct InvertedLists;
 
-void write_index(const Index* idx, const char* fname);
-void write_index(const Index* idx, FILE* f);
-void write_index(const Index* idx, IOWriter* writer);
-
-void write_index_binary(const IndexBinary* idx, const char* fname);
-void write_index_binary(const IndexBinary* idx, FILE* f);
-void write_index_binary(const IndexBinary* idx, IOWriter* writer);
+// The write_index flags
+// write the sectioned (v2) container: the large arrays are stored in
+// aligned, checksummed sections that are read in parallel. read_index
+// recognizes both formats.
+const int IO_FLAG_SECTIONED = 128;
+
+void write_index(const Index* idx, const char* fname, int io_flags = 0);
+void write_index(const Index* idx, FILE* f, int io_flags = 0);
+void write_index(const Index* idx, IOWriter* writer, int io_flags = 0);
+
+void write_index_binary(
+        const IndexBinary* idx,
+        const char* fname,
+        int io_flags = 0);
+void write_index_binary(const IndexBinary* idx, FILE* f, int io_flags = 0);
+void write_index_binary(
+        const IndexBinary* idx,
+        IOWriter* writer,
+        int io_flags = 0);
 
 // The read_index flags are implemented only for a subset of index types.
 const int IO_FLAG_READ_ONLY = 2;
@@ -40,26 +40,35 @@ void DirectMap::set_type(
         return;
     } else if (new_type == Array) {
         array.resize(ntotal, -1);
-    } else if (new_type == Hashtable) {
-        hashtable.reserve(ntotal);
-    }
-
-    for (size_t key = 0; key < invlists->nlist; key++) {
-        size_t list_size = invlists->list_size(key);
-        InvertedLists::ScopedIds idlist(invlists, key);
-
-        if (new_type == Array) {
+        for (size_t key = 0; key < invlists->nlist; key++) {
+            size_t list_size = invlists->list_size(key);
+            InvertedLists::ScopedIds idlist(invlists, key);
             for (long ofs = 0; ofs < list_size; ofs++) {
                 FAISS_THROW_IF_NOT_MSG(
                         0 <= idlist[ofs] && idlist[ofs] < ntotal,
                         "direct map supported only for seuquential ids");
                 array[idlist[ofs]] = lo_build(key, ofs);
             }
-        } else if (new_type == Hashtable) {
-            for (long ofs = 0; ofs < list_size; ofs++) {
-                hashtable[idlist[ofs]] = lo_build(key, ofs);
+        }
+    } else if (new_type == Hashtable) {
+        // collect all entries, then add them in one batch
+        size_t nlist = invlists->nlist;
+        std::vector<size_t> list_ofs(nlist + 1);
+        for (size_t key = 0; key < nlist; key++) {
+            list_ofs[key + 1] = list_ofs[key] + invlists->list_size(key);
+        }
+        std::vector<idx_t> ids(list_ofs[nlist]), los(list_ofs[nlist]);
+
+#pragma omp parallel for num_threads(num_omp_threads)
+        for (int64_t key = 0; key < nlist; key++) {
+            size_t list_size = list_ofs[key + 1] - list_ofs[key];
+            InvertedLists::ScopedIds idlist(invlists, key);
+            for (size_t ofs = 0; ofs < list_size; ofs++) {
+                ids[list_ofs[key] + ofs] = idlist[ofs];
+                los[list_ofs[key] + ofs] = lo_build(key, ofs);
             }
         }
+        hashtable.add(ids.size(), ids.data(), los.data());
     }
 }
 
@@ -75,9 +84,24 @@ idx_t DirectMap::get(idx_t key) const {
         FAISS_THROW_IF_NOT_MSG(lo >= 0, "-1 entry in direct_map");
         return lo;
     } else if (type == Hashtable) {
-        auto res = hashtable.find(key);
-        FAISS_THROW_IF_NOT_MSG(res != hashtable.end(), "key not found");
-        return res->second;
+        idx_t lo = hashtable.lookup(key);
+        FAISS_THROW_IF_NOT_MSG(lo >= 0, "key not found");
+        return lo;
+    } else {
+        FAISS_THROW_MSG("direct map not initialized");
+    }
+}
+
+void DirectMap::get_batch(idx_t n, const idx_t* keys, idx_t* los) const {
+    if (type == Array) {
+        for (idx_t i = 0; i < n; i++) {
+            los[i] = get(keys[i]);
+        }
+    } else if (type == Hashtable) {
+        hashtable.lookup(n, keys, los);
+        for (idx_t i = 0; i < n; i++) {
+            FAISS_THROW_IF_NOT_MSG(los[i] >= 0, "key not found");
+        }
     } else {
         FAISS_THROW_MSG("direct map not initialized");
     }
@@ -96,7 +120,7 @@ void DirectMap::add_single_id(idx_t id, idx_t list_no, size_t offset) {
         }
     } else if (type == Hashtable) {
         if (list_no >= 0) {
-            hashtable[id] = lo_build(list_no, offset);
+            hashtable.set(id, lo_build(list_no, offset));
         }
     }
 }
@@ -131,10 +155,17 @@ void DirectMapAdd::add(size_t i, idx_t list_no, size_t ofs) {
 
 DirectMapAdd::~DirectMapAdd() {
     if (type == DirectMap::Hashtable) {
-        for (int i = 0; i < n; i++) {
-            idx_t id = xids ? xids[i] : ntotal + i;
-            direct_map.hashtable[id] = all_ofs[i];
+        // the vectors that were not added to a list are not in the map
+        std::vector<idx_t> ids, los;
+        ids.reserve(n);
+        los.reserve(n);
+        for (size_t i = 0; i < n; i++) {
+            if (all_ofs[i] >= 0) {
+                ids.push_back(xids ? xids[i] : ntotal + i);
+                los.push_back(all_ofs[i]);
+            }
         }
+        direct_map.hashtable.add(ids.size(), ids.data(), los.data());
     }
 }
 
@@ -185,12 +216,12 @@ size_t DirectMap::remove_ids(const IDSelector& sel, InvertedLists* invlists) {
 
         for (idx_t i = 0; i < sela->n; i++) {
             idx_t id = sela->ids[i];
-            auto res = hashtable.find(id);
-            if (res != hashtable.end()) {
-                size_t list_no = lo_listno(res->second);
-                size_t offset = lo_offset(res->second);
+            idx_t lo = hashtable.lookup(id);
+            if (lo >= 0) {
+                size_t list_no = lo_listno(lo);
+                size_t offset = lo_offset(lo);
                 idx_t last = invlists->list_size(list_no) - 1;
-                hashtable.erase(res);
+                hashtable.remove(id);
                 if (offset < last) {
                     idx_t last_id = invlists->get_single_id(list_no, last);
                     invlists->update_entry(
@@ -199,7 +230,7 @@ size_t DirectMap::remove_ids(const IDSelector& sel, InvertedLists* invlists) {
                             last_id,
                             ScopedCodes(invlists, list_no, last).get());
                     // update hash entry for last element
-                    hashtable[last_id] = lo_build(list_no, offset);
+                    hashtable.set(last_id, lo_build(list_no, offset));
                 }
                 invlists->resize(list_no, last);
                 nremove++;
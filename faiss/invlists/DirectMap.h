@@ -11,7 +11,7 @@
 #define FAISS_DIRECT_MAP_H
 
 #include <faiss/invlists/InvertedLists.h>
-#include <unordered_map>
+#include <faiss/utils/sorting.h>
 
 namespace faiss {
 
@@ -45,7 +45,7 @@ struct DirectMap {
 
     /// map for direct access to the elements. Map ids to LO-encoded entries.
     std::vector<idx_t> array;
-    std::unordered_map<idx_t, idx_t> hashtable;
+    HashtableInt64ToInt64 hashtable;
 
     DirectMap();
 
@@ -55,6 +55,9 @@ struct DirectMap {
     /// get an entry
     idx_t get(idx_t id) const;
 
+    /// get the entries of n ids (in parallel for the hashtable)
+    void get_batch(idx_t n, const idx_t* ids, idx_t* los) const;
+
     /// for quick checks
     bool no() const {
         return type == NoMap;
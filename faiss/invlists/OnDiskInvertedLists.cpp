@@ -11,6 +11,8 @@
 
 #include <pthread.h>
 
+#include <algorithm>
+#include <mutex>
 #include <unordered_set>
 
 #include <sys/mman.h>
@@ -18,6 +20,7 @@
 #include <sys/types.h>
 #include <unistd.h>
 
+#include <faiss/OMPConfig.h>
 #include <faiss/impl/FaissAssert.h>
 #include <faiss/utils/utils.h>
 
@@ -359,9 +362,10 @@ OnDiskInvertedLists::OnDiskInvertedLists(
           filename(filename),
           totsize(0),
           ptr(nullptr),
+          read_only(false),
           pre_mapped(false),
           skip_prefetch(false),
-          read_only(false),
+          merge_stripe_bytes(size_t(64) << 20),
           locks(new LockLevels()),
           pf(new OngoingPrefetch(this)),
           prefetch_nthread(32) {
@@ -579,57 +583,120 @@ void OnDiskInvertedLists::free_slot(size_t offset, size_t capacity) {
  * Compact form
  *****************************************/
 
+namespace {
+
+/// ask the kernel to read ahead the data of lists j0:j1 of an input that
+/// is mmapped, if it is stored contiguously
+void prefetch_list_range(const InvertedLists* il, size_t j0, size_t j1) {
+    auto od = dynamic_cast<const OnDiskInvertedLists*>(il);
+    if (!od || !od->ptr) {
+        return;
+    }
+    size_t begin = (size_t)-1, end = 0, nbytes = 0;
+    size_t entry_size = od->code_size + sizeof(idx_t);
+    for (size_t j = j0; j < j1; j++) {
+        const OnDiskOneList& l = od->lists[j];
+        if (l.size == 0) {
+            continue;
+        }
+        begin = std::min(begin, l.offset);
+        end = std::max(end, l.offset + l.capacity * entry_size);
+        nbytes += l.capacity * entry_size;
+    }
+    if (nbytes == 0 || end - begin > 2 * nbytes) {
+        return;
+    }
+    size_t page_size = sysconf(_SC_PAGESIZE);
+    begin = begin / page_size * page_size;
+    // failure is harmless, it's just advice
+    madvise(od->ptr + begin, end - begin, MADV_WILLNEED);
+}
+
+} // namespace
+
 size_t OnDiskInvertedLists::merge_from(
         const InvertedLists** ils,
         int n_il,
         bool verbose) {
+    FAISS_THROW_IF_NOT(!read_only);
     FAISS_THROW_IF_NOT_MSG(
             totsize == 0, "works only on an empty InvertedLists");
 
-    std::vector<size_t> sizes(nlist);
     for (int i = 0; i < n_il; i++) {
         const InvertedLists* il = ils[i];
         FAISS_THROW_IF_NOT(il->nlist == nlist && il->code_size == code_size);
+    }
 
-        for (size_t j = 0; j < nlist; j++) {
-            sizes[j] += il->list_size(j);
+    std::vector<size_t> sizes(nlist);
+#pragma omp parallel for num_threads(num_omp_threads)
+    for (int64_t j = 0; j < nlist; j++) {
+        for (int i = 0; i < n_il; i++) {
+            sizes[j] += ils[i]->list_size(j);
         }
     }
 
+    // compute the layout of the output and cut it into stripes
+    size_t entry_size = code_size + sizeof(idx_t);
     size_t cums = 0;
     size_t ntotal = 0;
+    std::vector<size_t> stripe_begin(1, 0);
+    size_t stripe_bytes = 0;
     for (size_t j = 0; j < nlist; j++) {
         ntotal += sizes[j];
         lists[j].size = 0;
         lists[j].capacity = sizes[j];
         lists[j].offset = cums;
-        cums += lists[j].capacity * (sizeof(idx_t) + code_size);
+        cums += lists[j].capacity * entry_size;
+        stripe_bytes += lists[j].capacity * entry_size;
+        if (stripe_bytes >= merge_stripe_bytes) {
+            stripe_begin.push_back(j + 1);
+            stripe_bytes = 0;
+        }
+    }
+    if (stripe_begin.back() != nlist) {
+        stripe_begin.push_back(nlist);
     }
+    size_t nstripe = stripe_begin.size() - 1;
 
     update_totsize(cums);
 
     size_t nmerged = 0;
     double t0 = getmillisecs(), last_t = t0;
-
-#pragma omp parallel for num_threads(num_omp_threads)
-    for (size_t j = 0; j < nlist; j++) {
-        List& l = lists[j];
-        for (int i = 0; i < n_il; i++) {
-            const InvertedLists* il = ils[i];
-            size_t n_entry = il->list_size(j);
-            l.size += n_entry;
-            update_entries(
-                    j,
-                    l.size - n_entry,
-                    n_entry,
-                    ScopedIds(il, j).get(),
-                    ScopedCodes(il, j).get());
+    std::mutex exception_mutex;
+    std::string exception_string;
+
+#pragma omp parallel for schedule(dynamic) num_threads(num_omp_threads)
+    for (int64_t s = 0; s < nstripe; s++) {
+        size_t j0 = stripe_begin[s], j1 = stripe_begin[s + 1];
+        try {
+            for (int i = 0; i < n_il; i++) {
+                const InvertedLists* il = ils[i];
+                prefetch_list_range(il, j0, j1);
+                for (size_t j = j0; j < j1; j++) {
+                    List& l = lists[j];
+                    size_t n_entry = il->list_size(j);
+                    if (n_entry == 0) {
+                        continue;
+                    }
+                    uint8_t* codes = ptr + l.offset;
+                    idx_t* ids = (idx_t*)(codes + l.capacity * code_size);
+                    memcpy(codes + l.size * code_size,
+                           ScopedCodes(il, j).get(),
+                           n_entry * code_size);
+                    memcpy(ids + l.size,
+                           ScopedIds(il, j).get(),
+                           n_entry * sizeof(idx_t));
+                    l.size += n_entry;
+                }
+            }
+        } catch (const std::exception& e) {
+            std::lock_guard<std::mutex> lock(exception_mutex);
+            exception_string = e.what();
         }
-        assert(l.size == l.capacity);
         if (verbose) {
 #pragma omp critical
             {
-                nmerged++;
+                nmerged += j1 - j0;
                 double t1 = getmillisecs();
                 if (t1 - last_t > 500) {
                     printf("merged %zd lists in %.3f s\r",
@@ -641,6 +708,9 @@ size_t OnDiskInvertedLists::merge_from(
             }
         }
     }
+    if (!exception_string.empty()) {
+        FAISS_THROW_MSG(exception_string.c_str());
+    }
     if (verbose) {
         printf("\n");
     }
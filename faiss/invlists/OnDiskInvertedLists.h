@@ -80,6 +80,10 @@ struct OnDiskInvertedLists : InvertedLists {
     bool pre_mapped;// whether the content is already mmap'd before class creation
     bool skip_prefetch; // whether to skip prefetching the lists while performing search
 
+    /// merge_from fills the output by stripes of consecutive lists of about
+    /// this many bytes, in parallel
+    size_t merge_stripe_bytes;
+
     OnDiskInvertedLists(size_t nlist, size_t code_size, const char* filename);
 
     size_t list_size(size_t list_no) const override;
@@ -101,8 +105,12 @@ struct OnDiskInvertedLists : InvertedLists {
 
     void resize(size_t list_no, size_t new_size) override;
 
-    // copy all inverted lists into *this, in compact form (without
-    // allocating slots)
+    /** copy all inverted lists into *this, in compact form (without
+     * allocating slots). The final list sizes are computed first, then
+     * each stripe of the output is filled by copying from the input
+     * invlists one after another, so that both the output and the inputs
+     * are accessed sequentially. The OnDiskInvertedLists inputs are read
+     * ahead from their mmapped files. */
     size_t merge_from(
             const InvertedLists** ils,
             int n_il,
@@ -568,7 +568,8 @@ class Kmeans:
         stats = [stats.at(i) for i in range(stats.size())]
         self.obj = np.array([st.obj for st in stats])
         # copy all the iteration_stats objects to a python array
-        stat_fields = 'obj time time_search imbalance_factor nsplit'.split()
+        stat_fields = ('obj time time_search imbalance_factor nsplit '
+                       'ndis_skipped').split()
         self.iteration_stats = [
             {field: getattr(st, field) for field in stat_fields}
             for st in stats
@@ -204,7 +204,7 @@ void merge_knn_results(
             idx_t* I = labels + i * k;
 
             int j;
-            for (j = 0; j < k && heap_size > 0; j++) {
+            for (j = 0; j < k && heap_size > 1; j++) {
                 // pop element from best shard
                 int s = shard_ids[0]; // top of heap
                 int& p = pointer[s];
@@ -223,6 +223,16 @@ void merge_knn_results(
                             s);
                 }
             }
+            if (heap_size == 1) {
+                // the remaining results come from a single shard
+                int s = shard_ids[0];
+                for (int p = pointer[s];
+                     j < k && p < k && I_in[stride * s + p] >= 0;
+                     j++, p++) {
+                    D[j] = D_in[stride * s + p];
+                    I[j] = I_in[stride * s + p];
+                }
+            }
             for (; j < k; j++) {
                 I[j] = -1;
                 D[j] = C::Crev::neutral();
@@ -231,6 +241,27 @@ void merge_knn_results(
     }
 }
 
+int64_t SharedKnnBounds::query_no(const void* xi) const {
+    const char* x0 = (const char*)x;
+    const char* xc = (const char*)xi;
+    if (xc < x0 || xc >= x0 + n * query_size) {
+        return -1;
+    }
+    size_t ofs = xc - x0;
+    return ofs % query_size == 0 ? ofs / query_size : -1;
+}
+
+float SharedKnnBounds::update(int64_t q, float kth) {
+    std::atomic<float>& b = bounds[q];
+    float cur = b.load(std::memory_order_relaxed);
+    while (is_max ? kth < cur : kth > cur) {
+        if (b.compare_exchange_weak(cur, kth, std::memory_order_relaxed)) {
+            return kth;
+        }
+    }
+    return cur;
+}
+
 // explicit instanciations
 #define INSTANTIATE(C, distance_t)                                \
     template void merge_knn_results<int64_t, C<distance_t, int>>( \
@@ -29,6 +29,7 @@
 #include <cassert>
 #include <cstdio>
 
+#include <atomic>
 #include <limits>
 
 #include <faiss/utils/ordered_key_value.h>
@@ -306,6 +307,28 @@ inline void maxheap_addn(
     heap_addn<CMax<T, int64_t>>(k, bh_val, bh_ids, x, ids, n);
 }
 
+/* Replace the elements that are strictly worse than bound with
+ * (bound, -1). Elements equal to the bound are kept: they include the
+ * k-th result of the heap that produced the bound. The map is monotonic so
+ * the heap structure is preserved, and the placeholder elements are
+ * dropped by heap_reorder. */
+template <class C>
+inline void heap_clamp(
+        size_t k,
+        typename C::T* bh_val,
+        typename C::TI* bh_ids,
+        typename C::T bound) {
+    if (k == 0 || !C::cmp(bh_val[0], bound)) {
+        return; // nothing to clamp
+    }
+    for (size_t i = 0; i < k; i++) {
+        if (C::cmp(bh_val[i], bound)) {
+            bh_val[i] = bound;
+            bh_ids[i] = -1;
+        }
+    }
+}
+
 /*******************************************************************
  * Heap finalization (reorder elements)
  *******************************************************************/
@@ -526,6 +549,31 @@ void merge_knn_results(
         typename C::T* distances,
         idx_t* labels);
 
+/** Bound on the k-th result distance of each query, shared between
+ * searches that run concurrently on disjoint parts of a dataset (eg. the
+ * shards of an IndexShards). The k-th distance of a part is a bound for the
+ * merged results, so the other parts can skip the results that are not
+ * strictly better.
+ *
+ * The queries are identified by their address in the query array, so that
+ * the bounds remain valid when a sub-index splits the queries in batches.
+ * Queries outside of the array (eg. after a transformation) have no bound.
+ */
+struct SharedKnnBounds {
+    /// whether smaller distances are better (as for CMax heaps)
+    bool is_max = true;
+    const void* x = nullptr;   ///< query array
+    size_t query_size = 0;     ///< size of a query in bytes
+    size_t n = 0;              ///< nb of queries
+    std::atomic<float>* bounds = nullptr; ///< size n, not owned
+
+    /// index of query xi in the array, -1 if it is not in it
+    int64_t query_no(const void* xi) const;
+
+    /// tighten the bound of query q with a k-th distance, returns the bound
+    float update(int64_t q, float kth);
+};
+
 } // namespace faiss
 
 #endif /* FAISS_Heap_h */
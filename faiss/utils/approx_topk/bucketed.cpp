@@ -0,0 +1,76 @@
+/**
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <faiss/utils/approx_topk/bucketed.h>
+
+#include <cmath>
+
+namespace faiss {
+
+double approx_topk_expected_recall(size_t k, size_t nbuckets, size_t depth) {
+    if (k == 0 || depth >= k) {
+        return 1.0;
+    }
+    if (nbuckets == 1) {
+        return double(std::min(depth, k)) / k;
+    }
+    // E[min(X, depth)] = depth - sum_{x < depth} (depth - x) P(X = x)
+    double p = 1.0 / nbuckets;
+    double log_p = std::log(p), log_q = std::log1p(-p);
+    double e = depth;
+    for (size_t x = 0; x < depth; x++) {
+        double log_px = std::lgamma(k + 1.0) - std::lgamma(x + 1.0) -
+                std::lgamma(k - x + 1.0) + x * log_p + (k - x) * log_q;
+        e -= (depth - x) * std::exp(log_px);
+    }
+    return std::min(1.0, nbuckets * e / k);
+}
+
+ApproxTopKConfig approx_topk_choose(size_t k, size_t n, float recall_target) {
+    FAISS_THROW_IF_NOT(recall_target > 0 && recall_target <= 1);
+    FAISS_THROW_IF_NOT(k > 0);
+    n = std::max(n, k);
+    ApproxTopKConfig best;
+    double best_cost = HUGE_VAL;
+    for (size_t depth = 1; depth <= approx_topk_max_depth; depth++) {
+        // with nbuckets * depth >= n, each bucket sees at most depth
+        // elements and the result is exact
+        size_t bmax = ((n + depth - 1) / depth + 15) & ~size_t(15);
+        size_t bmin = ((k + depth - 1) / depth + 15) & ~size_t(15);
+        bmin = std::min(bmin, bmax);
+        auto ok = [&](size_t b) {
+            return b >= bmax ||
+                    approx_topk_expected_recall(k, b, depth) >= recall_target;
+        };
+        // the recall is increasing with the number of buckets
+        size_t lo = bmin / 16, hi = bmax / 16;
+        while (lo < hi) {
+            size_t mid = (lo + hi) / 2;
+            if (ok(mid * 16)) {
+                hi = mid;
+            } else {
+                lo = mid + 1;
+            }
+        }
+        size_t nb = lo * 16;
+        // per-element cost is one vectorized compare-exchange per level,
+        // the final merge is a heap insertion per candidate
+        double cost = n * depth / 8.0 +
+                nb * depth * (1 + std::log2(double(k) + 1));
+        if (cost < best_cost) {
+            best_cost = cost;
+            best.nbuckets = nb;
+            best.depth = depth;
+            best.recall = nb >= bmax
+                    ? 1.0
+                    : approx_topk_expected_recall(k, nb, depth);
+        }
+    }
+    return best;
+}
+
+} // namespace faiss
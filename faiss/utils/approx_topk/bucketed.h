@@ -0,0 +1,174 @@
+/**
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+// Generalization of the bucketed approximate top-k of approx_topk.h to
+// arbitrary k, with the number of buckets and the depth chosen at runtime.
+//
+// The i-th element of the stream goes to bucket i % nbuckets, and each
+// bucket keeps its `depth` best elements. At the end, the nbuckets * depth
+// candidates are merged into a regular heap of size k. An element of the
+// exact top-k is lost only if more than `depth` elements of the top-k fall
+// into its bucket. Assuming that the top-k elements are spread uniformly
+// over the buckets, the number of top-k elements in a bucket follows a
+// binomial distribution B(k, 1 / nbuckets), which gives the expected
+// recall:
+//
+//   recall = nbuckets / k * E[min(X, depth)],  X ~ B(k, 1 / nbuckets)
+//
+// approx_topk_choose uses this to select the cheapest (nbuckets, depth)
+// that reaches a recall target.
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <faiss/impl/FaissAssert.h>
+#include <faiss/impl/platform_macros.h>
+#include <faiss/utils/Heap.h>
+
+namespace faiss {
+
+struct ApproxTopKConfig {
+    size_t nbuckets = 0; ///< number of buckets (multiple of 16)
+    size_t depth = 0;    ///< nb of elements kept per bucket (1..4)
+    double recall = 1;   ///< expected recall of the configuration
+};
+
+/// maximum depth supported by ApproxTopKBuckets
+constexpr size_t approx_topk_max_depth = 4;
+
+/// expected recall of the bucketed top-k (see above)
+double approx_topk_expected_recall(size_t k, size_t nbuckets, size_t depth);
+
+/** choose the configuration with the smallest estimated cost that reaches
+ * the recall target
+ *
+ * @param k              number of results
+ * @param n              (estimated) number of elements per query
+ * @param recall_target  in (0, 1]
+ */
+ApproxTopKConfig approx_topk_choose(size_t k, size_t n, float recall_target);
+
+/** Bucketed top-k collector for a single query. C = CMax keeps the smallest
+ * values. The elements are supplied in batches with add(). */
+template <class C>
+struct ApproxTopKBuckets {
+    using T = typename C::T;
+    using TI = typename C::TI;
+
+    size_t nbuckets = 0;
+    size_t depth = 0;
+
+    /// bucket of the next element
+    size_t cur_bucket = 0;
+
+    /// size depth * nbuckets, level p of bucket b is at p * nbuckets + b
+    std::vector<T> dis;
+    std::vector<TI> ids;
+
+    ApproxTopKBuckets() {}
+
+    explicit ApproxTopKBuckets(const ApproxTopKConfig& config) {
+        init(config);
+    }
+
+    void init(const ApproxTopKConfig& config) {
+        FAISS_THROW_IF_NOT(
+                config.depth >= 1 && config.depth <= approx_topk_max_depth);
+        FAISS_THROW_IF_NOT(config.nbuckets > 0);
+        nbuckets = config.nbuckets;
+        depth = config.depth;
+        dis.resize(nbuckets * depth);
+        ids.resize(nbuckets * depth);
+        reset();
+    }
+
+    /// start a new query
+    void reset() {
+        std::fill(dis.begin(), dis.end(), C::neutral());
+        std::fill(ids.begin(), ids.end(), TI(-1));
+        cur_bucket = 0;
+    }
+
+    /** add n elements. If ids_in is null, the ids are id0 .. id0 + n - 1.
+     * Elements that are not strictly better than C::neutral() are ignored
+     * (this can be used to filter out elements). */
+    void add(size_t n, const T* dis_in, const TI* ids_in, TI id0 = 0) {
+        switch (depth) {
+            case 1:
+                add_d<1>(n, dis_in, ids_in, id0);
+                break;
+            case 2:
+                add_d<2>(n, dis_in, ids_in, id0);
+                break;
+            case 3:
+                add_d<3>(n, dis_in, ids_in, id0);
+                break;
+            case 4:
+                add_d<4>(n, dis_in, ids_in, id0);
+                break;
+            default:
+                FAISS_THROW_MSG("unsupported depth");
+        }
+    }
+
+    /// merge the candidates into a heap of size k (which must be
+    /// initialized). Returns the number of heap updates.
+    size_t to_heap(size_t k, T* heap_dis, TI* heap_ids) const {
+        size_t nup = 0;
+        for (size_t i = 0; i < dis.size(); i++) {
+            if (ids[i] != TI(-1) && C::cmp(heap_dis[0], dis[i])) {
+                heap_replace_top<C>(k, heap_dis, heap_ids, dis[i], ids[i]);
+                nup++;
+            }
+        }
+        return nup;
+    }
+
+   private:
+    /// insert elements into buckets b0 .. b0 + n - 1 (no wrap-around)
+    template <size_t D>
+    void add_range(size_t b0, size_t n, const T* di, const TI* ii, TI id0) {
+        T* bd = dis.data() + b0;
+        TI* bi = ids.data() + b0;
+        // branchless insertion in the sorted levels so that the loop over
+        // buckets is vectorized
+        for (size_t j = 0; j < n; j++) {
+            T cand = di[j];
+            TI cid = ii ? ii[j] : id0 + TI(j);
+            for (size_t p = 0; p < D; p++) {
+                T cur = bd[p * nbuckets + j];
+                TI curi = bi[p * nbuckets + j];
+                bool better = C::cmp(cur, cand);
+                bd[p * nbuckets + j] = better ? cand : cur;
+                bi[p * nbuckets + j] = better ? cid : curi;
+                cand = better ? cur : cand;
+                cid = better ? curi : cid;
+            }
+        }
+    }
+
+    template <size_t D>
+    void add_d(size_t n, const T* di, const TI* ii, TI id0) {
+        size_t i = 0;
+        while (i < n) {
+            size_t nr = std::min(n - i, nbuckets - cur_bucket);
+            add_range<D>(
+                    cur_bucket, nr, di + i, ii ? ii + i : nullptr, id0 + i);
+            i += nr;
+            cur_bucket += nr;
+            if (cur_bucket == nbuckets) {
+                cur_bucket = 0;
+            }
+        }
+    }
+};
+
+} // namespace faiss
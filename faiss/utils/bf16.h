@@ -0,0 +1,37 @@
+/**
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+namespace faiss {
+
+// bfloat16 is the upper half of a float32: same exponent range, 8 bits of
+// mantissa. The conversion to float32 is a shift.
+
+inline uint16_t encode_bf16(const float f) {
+    uint32_t x;
+    memcpy(&x, &f, sizeof(x));
+    if ((x & 0x7fffffffu) > 0x7f800000u) {
+        // NaN: keep it quiet
+        return (x >> 16) | 0x40;
+    }
+    // round to nearest even
+    x += 0x7fffu + ((x >> 16) & 1);
+    return x >> 16;
+}
+
+inline float decode_bf16(const uint16_t v) {
+    uint32_t x = uint32_t(v) << 16;
+    float f;
+    memcpy(&f, &x, sizeof(f));
+    return f;
+}
+
+} // namespace faiss
@@ -8,6 +8,7 @@
 #include <faiss/utils/distances.h>
 
 #include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <cmath>
 #include <cstddef>
@@ -142,15 +143,13 @@ void exhaustive_inner_product_seq(
         const IDSelector* sel = nullptr) {
     using SingleResultHandler =
             typename BlockResultHandler::SingleResultHandler;
-    int nt = std::min(int(nx), omp_get_max_threads());
+    int nt = std::min(int(nx), parallel_num_threads());
 
     FAISS_ASSERT(use_sel == (sel != nullptr));
 
-#pragma omp parallel num_threads(nt)
-    {
+    parallel_for(nt, [&](int64_t rank) {
         SingleResultHandler resi(res);
-#pragma omp for
-        for (int64_t i = 0; i < nx; i++) {
+        for (int64_t i = nx * rank / nt; i < nx * (rank + 1) / nt; i++) {
             const float* x_i = x + i * d;
             const float* y_j = y;
 
@@ -165,7 +164,7 @@ void exhaustive_inner_product_seq(
             }
             resi.end();
         }
-    }
+    });
 }
 
 template <class BlockResultHandler, bool use_sel = false>
@@ -179,15 +178,13 @@ void exhaustive_L2sqr_seq(
         const IDSelector* sel = nullptr) {
     using SingleResultHandler =
             typename BlockResultHandler::SingleResultHandler;
-    int nt = std::min(int(nx), omp_get_max_threads());
+    int nt = std::min(int(nx), parallel_num_threads());
 
     FAISS_ASSERT(use_sel == (sel != nullptr));
 
-#pragma omp parallel num_threads(nt)
-    {
+    parallel_for(nt, [&](int64_t rank) {
         SingleResultHandler resi(res);
-#pragma omp for
-        for (int64_t i = 0; i < nx; i++) {
+        for (int64_t i = nx * rank / nt; i < nx * (rank + 1) / nt; i++) {
             const float* x_i = x + i * d;
             const float* y_j = y;
             resi.begin(i);
@@ -200,7 +197,7 @@ void exhaustive_L2sqr_seq(
             }
             resi.end();
         }
-    }
+    });
 }
 
 /** Find the nearest neighbors for nx queries in a set of ny vectors */
@@ -319,23 +316,29 @@ void exhaustive_L2sqr_blas_default_impl(
                        ip_block.get(),
                        &nyi);
             }
-#pragma omp parallel for num_threads(num_omp_threads)
-            for (int64_t i = i0; i < i1; i++) {
-                float* ip_line = ip_block.get() + (i - i0) * (j1 - j0);
-
-                for (size_t j = j0; j < j1; j++) {
-                    float ip = *ip_line;
-                    float dis = x_norms[i] + y_norms[j] - 2 * ip;
-
-                    // negative values can occur for identical vectors
-                    // due to roundoff errors
-                    if (dis < 0)
-                        dis = 0;
-
-                    *ip_line = dis;
-                    ip_line++;
+            // the rows of the block are split over the tasks
+            int nt = std::min(
+                    int64_t(parallel_num_threads()), int64_t(i1 - i0));
+            parallel_for(nt, [&](int64_t rank) {
+                int64_t ib0 = i0 + (i1 - i0) * rank / nt;
+                int64_t ib1 = i0 + (i1 - i0) * (rank + 1) / nt;
+                for (int64_t i = ib0; i < ib1; i++) {
+                    float* ip_line = ip_block.get() + (i - i0) * (j1 - j0);
+
+                    for (size_t j = j0; j < j1; j++) {
+                        float ip = *ip_line;
+                        float dis = x_norms[i] + y_norms[j] - 2 * ip;
+
+                        // negative values can occur for identical vectors
+                        // due to roundoff errors
+                        if (dis < 0)
+                            dis = 0;
+
+                        *ip_line = dis;
+                        ip_line++;
+                    }
                 }
-            }
+            });
             res.add_results(j0, j1, ip_block.get());
         }
         res.end_multiple();
@@ -414,146 +417,154 @@ void exhaustive_L2sqr_blas_cmax_avx2(
                        ip_block.get(),
                        &nyi);
             }
-#pragma omp parallel for num_threads(num_omp_threads)
-            for (int64_t i = i0; i < i1; i++) {
-                float* ip_line = ip_block.get() + (i - i0) * (j1 - j0);
-
-                _mm_prefetch((const char*)ip_line, _MM_HINT_NTA);
-                _mm_prefetch((const char*)(ip_line + 16), _MM_HINT_NTA);
-
-                // constant
-                const __m256 mul_minus2 = _mm256_set1_ps(-2);
-
-                // Track 8 min distances + 8 min indices.
-                // All the distances tracked do not take x_norms[i]
-                //   into account in order to get rid of extra
-                //   _mm256_add_ps(x_norms[i], ...) instructions
-                //   is distance computations.
-                __m256 min_distances =
-                        _mm256_set1_ps(res.dis_tab[i] - x_norms[i]);
-
-                // these indices are local and are relative to j0.
-                // so, value 0 means j0.
-                __m256i min_indices = _mm256_set1_epi32(0);
-
-                __m256i current_indices =
-                        _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
-                const __m256i indices_delta = _mm256_set1_epi32(8);
-
-                // current j index
-                size_t idx_j = 0;
-                size_t count = j1 - j0;
-
-                // process 16 elements per loop
-                for (; idx_j < (count / 16) * 16; idx_j += 16, ip_line += 16) {
-                    _mm_prefetch((const char*)(ip_line + 32), _MM_HINT_NTA);
-                    _mm_prefetch((const char*)(ip_line + 48), _MM_HINT_NTA);
-
-                    // load values for norms
-                    const __m256 y_norm_0 =
-                            _mm256_loadu_ps(y_norms + idx_j + j0 + 0);
-                    const __m256 y_norm_1 =
-                            _mm256_loadu_ps(y_norms + idx_j + j0 + 8);
-
-                    // load values for dot products
-                    const __m256 ip_0 = _mm256_loadu_ps(ip_line + 0);
-                    const __m256 ip_1 = _mm256_loadu_ps(ip_line + 8);
-
-                    // compute dis = y_norm[j] - 2 * dot(x_norm[i], y_norm[j]).
-                    // x_norm[i] was dropped off because it is a constant for a
-                    // given i. We'll deal with it later.
-                    __m256 distances_0 =
-                            _mm256_fmadd_ps(ip_0, mul_minus2, y_norm_0);
-                    __m256 distances_1 =
-                            _mm256_fmadd_ps(ip_1, mul_minus2, y_norm_1);
-
-                    // compare the new distances to the min distances
-                    // for each of the first group of 8 AVX2 components.
-                    const __m256 comparison_0 = _mm256_cmp_ps(
-                            min_distances, distances_0, _CMP_LE_OS);
-
-                    // update min distances and indices with closest vectors if
-                    // needed.
-                    min_distances = _mm256_blendv_ps(
-                            distances_0, min_distances, comparison_0);
-                    min_indices = _mm256_castps_si256(_mm256_blendv_ps(
-                            _mm256_castsi256_ps(current_indices),
-                            _mm256_castsi256_ps(min_indices),
-                            comparison_0));
-                    current_indices =
-                            _mm256_add_epi32(current_indices, indices_delta);
-
-                    // compare the new distances to the min distances
-                    // for each of the second group of 8 AVX2 components.
-                    const __m256 comparison_1 = _mm256_cmp_ps(
-                            min_distances, distances_1, _CMP_LE_OS);
-
-                    // update min distances and indices with closest vectors if
-                    // needed.
-                    min_distances = _mm256_blendv_ps(
-                            distances_1, min_distances, comparison_1);
-                    min_indices = _mm256_castps_si256(_mm256_blendv_ps(
-                            _mm256_castsi256_ps(current_indices),
-                            _mm256_castsi256_ps(min_indices),
-                            comparison_1));
-                    current_indices =
-                            _mm256_add_epi32(current_indices, indices_delta);
-                }
+            // the rows of the block are split over the tasks
+            int nt = std::min(
+                    int64_t(parallel_num_threads()), int64_t(i1 - i0));
+            parallel_for(nt, [&](int64_t rank) {
+                int64_t ib0 = i0 + (i1 - i0) * rank / nt;
+                int64_t ib1 = i0 + (i1 - i0) * (rank + 1) / nt;
+                for (int64_t i = ib0; i < ib1; i++) {
+                    float* ip_line = ip_block.get() + (i - i0) * (j1 - j0);
+
+                    _mm_prefetch((const char*)ip_line, _MM_HINT_NTA);
+                    _mm_prefetch((const char*)(ip_line + 16), _MM_HINT_NTA);
+
+                    // constant
+                    const __m256 mul_minus2 = _mm256_set1_ps(-2);
+
+                    // Track 8 min distances + 8 min indices.
+                    // All the distances tracked do not take x_norms[i]
+                    //   into account in order to get rid of extra
+                    //   _mm256_add_ps(x_norms[i], ...) instructions
+                    //   is distance computations.
+                    __m256 min_distances =
+                            _mm256_set1_ps(res.dis_tab[i] - x_norms[i]);
+
+                    // these indices are local and are relative to j0.
+                    // so, value 0 means j0.
+                    __m256i min_indices = _mm256_set1_epi32(0);
+
+                    __m256i current_indices =
+                            _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+                    const __m256i indices_delta = _mm256_set1_epi32(8);
+
+                    // current j index
+                    size_t idx_j = 0;
+                    size_t count = j1 - j0;
+
+                    // process 16 elements per loop
+                    for (; idx_j < (count / 16) * 16;
+                         idx_j += 16, ip_line += 16) {
+                        _mm_prefetch((const char*)(ip_line + 32), _MM_HINT_NTA);
+                        _mm_prefetch((const char*)(ip_line + 48), _MM_HINT_NTA);
+
+                        // load values for norms
+                        const __m256 y_norm_0 =
+                                _mm256_loadu_ps(y_norms + idx_j + j0 + 0);
+                        const __m256 y_norm_1 =
+                                _mm256_loadu_ps(y_norms + idx_j + j0 + 8);
+
+                        // load values for dot products
+                        const __m256 ip_0 = _mm256_loadu_ps(ip_line + 0);
+                        const __m256 ip_1 = _mm256_loadu_ps(ip_line + 8);
+
+                        // compute
+                        //   dis = y_norm[j] - 2 * dot(x_norm[i], y_norm[j]).
+                        // x_norm[i] was dropped off because it is a constant
+                        // for a given i. We'll deal with it later.
+                        __m256 distances_0 =
+                                _mm256_fmadd_ps(ip_0, mul_minus2, y_norm_0);
+                        __m256 distances_1 =
+                                _mm256_fmadd_ps(ip_1, mul_minus2, y_norm_1);
+
+                        // compare the new distances to the min distances
+                        // for each of the first group of 8 AVX2 components.
+                        const __m256 comparison_0 = _mm256_cmp_ps(
+                                min_distances, distances_0, _CMP_LE_OS);
+
+                        // update min distances and indices with closest
+                        // vectors if needed.
+                        min_distances = _mm256_blendv_ps(
+                                distances_0, min_distances, comparison_0);
+                        min_indices = _mm256_castps_si256(_mm256_blendv_ps(
+                                _mm256_castsi256_ps(current_indices),
+                                _mm256_castsi256_ps(min_indices),
+                                comparison_0));
+                        current_indices = _mm256_add_epi32(
+                                current_indices, indices_delta);
+
+                        // compare the new distances to the min distances
+                        // for each of the second group of 8 AVX2 components.
+                        const __m256 comparison_1 = _mm256_cmp_ps(
+                                min_distances, distances_1, _CMP_LE_OS);
+
+                        // update min distances and indices with closest
+                        // vectors if needed.
+                        min_distances = _mm256_blendv_ps(
+                                distances_1, min_distances, comparison_1);
+                        min_indices = _mm256_castps_si256(_mm256_blendv_ps(
+                                _mm256_castsi256_ps(current_indices),
+                                _mm256_castsi256_ps(min_indices),
+                                comparison_1));
+                        current_indices = _mm256_add_epi32(
+                                current_indices, indices_delta);
+                    }
 
-                // dump values and find the minimum distance / minimum index
-                float min_distances_scalar[8];
-                uint32_t min_indices_scalar[8];
-                _mm256_storeu_ps(min_distances_scalar, min_distances);
-                _mm256_storeu_si256(
-                        (__m256i*)(min_indices_scalar), min_indices);
-
-                float current_min_distance = res.dis_tab[i];
-                uint32_t current_min_index = res.ids_tab[i];
-
-                // This unusual comparison is needed to maintain the behavior
-                // of the original implementation: if two indices are
-                // represented with equal distance values, then
-                // the index with the min value is returned.
-                for (size_t jv = 0; jv < 8; jv++) {
-                    // add missing x_norms[i]
-                    float distance_candidate =
-                            min_distances_scalar[jv] + x_norms[i];
-
-                    // negative values can occur for identical vectors
-                    //    due to roundoff errors.
-                    if (distance_candidate < 0)
-                        distance_candidate = 0;
-
-                    int64_t index_candidate = min_indices_scalar[jv] + j0;
-
-                    if (current_min_distance > distance_candidate) {
-                        current_min_distance = distance_candidate;
-                        current_min_index = index_candidate;
-                    } else if (
-                            current_min_distance == distance_candidate &&
-                            current_min_index > index_candidate) {
-                        current_min_index = index_candidate;
+                    // dump values and find the minimum distance / minimum index
+                    float min_distances_scalar[8];
+                    uint32_t min_indices_scalar[8];
+                    _mm256_storeu_ps(min_distances_scalar, min_distances);
+                    _mm256_storeu_si256(
+                            (__m256i*)(min_indices_scalar), min_indices);
+
+                    float current_min_distance = res.dis_tab[i];
+                    uint32_t current_min_index = res.ids_tab[i];
+
+                    // This unusual comparison is needed to maintain the
+                    // behavior of the original implementation: if two indices
+                    // are represented with equal distance values, then the
+                    // index with the min value is returned.
+                    for (size_t jv = 0; jv < 8; jv++) {
+                        // add missing x_norms[i]
+                        float distance_candidate =
+                                min_distances_scalar[jv] + x_norms[i];
+
+                        // negative values can occur for identical vectors
+                        //    due to roundoff errors.
+                        if (distance_candidate < 0)
+                            distance_candidate = 0;
+
+                        int64_t index_candidate = min_indices_scalar[jv] + j0;
+
+                        if (current_min_distance > distance_candidate) {
+                            current_min_distance = distance_candidate;
+                            current_min_index = index_candidate;
+                        } else if (
+                                current_min_distance == distance_candidate &&
+                                current_min_index > index_candidate) {
+                            current_min_index = index_candidate;
+                        }
                     }
-                }
 
-                // process leftovers
-                for (; idx_j < count; idx_j++, ip_line++) {
-                    float ip = *ip_line;
-                    float dis = x_norms[i] + y_norms[idx_j + j0] - 2 * ip;
-                    // negative values can occur for identical vectors
-                    //    due to roundoff errors.
-                    if (dis < 0)
-                        dis = 0;
-
-                    if (current_min_distance > dis) {
-                        current_min_distance = dis;
-                        current_min_index = idx_j + j0;
+                    // process leftovers
+                    for (; idx_j < count; idx_j++, ip_line++) {
+                        float ip = *ip_line;
+                        float dis = x_norms[i] + y_norms[idx_j + j0] - 2 * ip;
+                        // negative values can occur for identical vectors
+                        //    due to roundoff errors.
+                        if (dis < 0)
+                            dis = 0;
+
+                        if (current_min_distance > dis) {
+                            current_min_distance = dis;
+                            current_min_index = idx_j + j0;
+                        }
                     }
-                }
 
-                //
-                res.add_result(i, current_min_distance, current_min_index);
-            }
+                    //
+                    res.add_result(i, current_min_distance, current_min_index);
+                }
+            });
         }
         // Does nothing for SingleBestResultHandler, but
         // keeping the call for the consistency.
@@ -602,6 +613,154 @@ void exhaustive_L2sqr_blas<Top1BlockResultHandler<CMax<float, int64_t>>>(
 #endif
 }
 
+/** Fused version of exhaustive_L2sqr_blas / exhaustive_inner_product_blas:
+ * each thread handles a block of queries and computes the distances to
+ * the database by small tiles that stay in cache. The tiles are fed to
+ * the result handlers of the queries as soon as they are computed,
+ * instead of materializing large distance matrices in RAM. When there are
+ * fewer query blocks than threads, the unfused version is used instead. */
+template <class BlockResultHandler, bool is_l2>
+void exhaustive_blas_fused(
+        const float* x,
+        const float* y,
+        size_t d,
+        size_t nx,
+        size_t ny,
+        BlockResultHandler& res,
+        const float* y_norms = nullptr) {
+    using SingleResultHandler =
+            typename BlockResultHandler::SingleResultHandler;
+    // BLAS does not like empty matrices
+    if (nx == 0 || ny == 0)
+        return;
+
+    const size_t bs_x = distance_compute_fused_query_bs;
+    const size_t bs_y = distance_compute_fused_database_bs;
+    FAISS_THROW_IF_NOT(bs_x > 0 && bs_y > 0);
+
+    int64_t nbx = (nx + bs_x - 1) / bs_x;
+    if (nbx < parallel_num_threads()) {
+        // too few query blocks to keep the threads busy: use the unfused
+        // version, where the BLAS parallelizes the matrix products
+        if constexpr (is_l2) {
+            exhaustive_L2sqr_blas(x, y, d, nx, ny, res, y_norms);
+        } else {
+            exhaustive_inner_product_blas(x, y, d, nx, ny, res);
+        }
+        return;
+    }
+
+    std::unique_ptr<float[]> x_norms;
+    std::unique_ptr<float[]> del2;
+    if (is_l2) {
+        x_norms.reset(new float[nx]);
+        fvec_norms_L2sqr(x_norms.get(), x, d, nx);
+        if (!y_norms) {
+            float* y_norms2 = new float[ny];
+            del2.reset(y_norms2);
+            fvec_norms_L2sqr(y_norms2, y, d, ny);
+            y_norms = y_norms2;
+        }
+    }
+
+    int nt = std::min(int64_t(parallel_num_threads()), nbx);
+    std::atomic<bool> interrupt(false);
+    // the query blocks are distributed dynamically over the tasks
+    std::atomic<int64_t> next_block(0);
+
+    parallel_for(nt, [&](int64_t) {
+        std::unique_ptr<float[]> ip_block(new float[bs_x * bs_y]);
+        std::vector<SingleResultHandler> resi;
+        resi.reserve(bs_x);
+
+        for (int64_t ib = next_block++; ib < nbx; ib = next_block++) {
+            // cannot break
+            if (interrupt) {
+                continue;
+            }
+            size_t i0 = ib * bs_x;
+            size_t i1 = std::min(i0 + bs_x, nx);
+
+            resi.clear();
+            for (size_t i = i0; i < i1; i++) {
+                resi.emplace_back(res);
+                resi.back().begin(i);
+            }
+
+            for (size_t j0 = 0; j0 < ny; j0 += bs_y) {
+                size_t j1 = std::min(j0 + bs_y, ny);
+                float one = 1, zero = 0;
+                FINTEGER nyi = j1 - j0, nxi = i1 - i0, di = d;
+                sgemm_("Transpose",
+                       "Not transpose",
+                       &nyi,
+                       &nxi,
+                       &di,
+                       &one,
+                       y + j0 * d,
+                       &di,
+                       x + i0 * d,
+                       &di,
+                       &zero,
+                       ip_block.get(),
+                       &nyi);
+
+                for (size_t i = i0; i < i1; i++) {
+                    float* ip_line = ip_block.get() + (i - i0) * nyi;
+                    if (is_l2) {
+                        // convert to L2 distances in place (vectorized)
+                        float x_norm = x_norms[i];
+                        for (size_t j = j0; j < j1; j++) {
+                            float dis =
+                                    x_norm + y_norms[j] - 2 * ip_line[j - j0];
+                            // negative values can occur for identical
+                            // vectors due to roundoff errors
+                            ip_line[j - j0] = dis < 0 ? 0 : dis;
+                        }
+                    }
+                    resi[i - i0].add_results(j0, j1, ip_line);
+                }
+            }
+
+            for (size_t i = i0; i < i1; i++) {
+                resi[i - i0].end();
+            }
+            if (InterruptCallback::is_interrupted()) {
+                interrupt = true;
+            }
+        }
+    });
+    if (interrupt) {
+        FAISS_THROW_MSG("computation interrupted");
+    }
+}
+
+template <class BlockResultHandler>
+void exhaustive_L2sqr_knn(
+        const float* x,
+        const float* y,
+        size_t d,
+        size_t nx,
+        size_t ny,
+        BlockResultHandler& res,
+        const float* y_norms) {
+    exhaustive_blas_fused<BlockResultHandler, true>(
+            x, y, d, nx, ny, res, y_norms);
+}
+
+// the k=1 case has dedicated kernels
+template <>
+void exhaustive_L2sqr_knn<Top1BlockResultHandler<CMax<float, int64_t>>>(
+        const float* x,
+        const float* y,
+        size_t d,
+        size_t nx,
+        size_t ny,
+        Top1BlockResultHandler<CMax<float, int64_t>>& res,
+        const float* y_norms) {
+    exhaustive_L2sqr_blas(x, y, d, nx, ny, res, y_norms);
+}
+
 template <class BlockResultHandler>
 void knn_L2sqr_select(
         const float* x,
@@ -618,7 +777,7 @@ void knn_L2sqr_select(
     } else if (nx < distance_compute_blas_threshold) {
         exhaustive_L2sqr_seq(x, y, d, nx, ny, res);
     } else {
-        exhaustive_L2sqr_blas(x, y, d, nx, ny, res, y_norm2);
+        exhaustive_L2sqr_knn(x, y, d, nx, ny, res, y_norm2);
     }
 }
 
@@ -637,7 +796,8 @@ void knn_inner_product_select(
     } else if (nx < distance_compute_blas_threshold) {
         exhaustive_inner_product_seq(x, y, d, nx, ny, res);
     } else {
-        exhaustive_inner_product_blas(x, y, d, nx, ny, res);
+        exhaustive_blas_fused<BlockResultHandler, false>(
+                x, y, d, nx, ny, res);
     }
 }
 
@@ -650,7 +810,10 @@ void knn_inner_product_select(
 int distance_compute_blas_threshold = 20;
 int distance_compute_blas_query_bs = 4096;
 int distance_compute_blas_database_bs = 1024;
+int distance_compute_fused_query_bs = 128;
+int distance_compute_fused_database_bs = 512;
 int distance_compute_min_k_reservoir = 100;
+int distance_compute_min_k_buffered = 256;
 
 void knn_inner_product(
         const float* x,
@@ -682,9 +845,12 @@ void knn_inner_product(
     } else if (k < distance_compute_min_k_reservoir) {
         HeapBlockResultHandler<CMin<float, int64_t>> res(nx, vals, ids, k);
         knn_inner_product_select(x, y, d, nx, ny, res, sel);
-    } else {
+    } else if (k < distance_compute_min_k_buffered) {
         ReservoirBlockResultHandler<CMin<float, int64_t>> res(nx, vals, ids, k);
         knn_inner_product_select(x, y, d, nx, ny, res, sel);
+    } else {
+        BufferedBlockResultHandler<CMin<float, int64_t>> res(nx, vals, ids, k);
+        knn_inner_product_select(x, y, d, nx, ny, res, sel);
     }
 
     if (imin != 0) {
@@ -737,9 +903,12 @@ void knn_L2sqr(
     } else if (k < distance_compute_min_k_reservoir) {
         HeapBlockResultHandler<CMax<float, int64_t>> res(nx, vals, ids, k);
         knn_L2sqr_select(x, y, d, nx, ny, res, y_norm2, sel);
-    } else {
+    } else if (k < distance_compute_min_k_buffered) {
         ReservoirBlockResultHandler<CMax<float, int64_t>> res(nx, vals, ids, k);
         knn_L2sqr_select(x, y, d, nx, ny, res, y_norm2, sel);
+    } else {
+        BufferedBlockResultHandler<CMax<float, int64_t>> res(nx, vals, ids, k);
+        knn_L2sqr_select(x, y, d, nx, ny, res, y_norm2, sel);
     }
     if (imin != 0) {
         for (size_t i = 0; i < nx * k; i++) {
@@ -750,6 +919,41 @@ void knn_L2sqr(
     }
 }
 
+void knn_inner_product_approx_topk(
+        const float* x,
+        const float* y,
+        size_t d,
+        size_t nx,
+        size_t ny,
+        size_t k,
+        float* vals,
+        int64_t* ids,
+        float recall,
+        const IDSelector* sel) {
+    ApproxTopKConfig config = approx_topk_choose(k, ny, recall);
+    ApproxTopKBlockResultHandler<CMin<float, int64_t>> res(
+            nx, vals, ids, k, config);
+    knn_inner_product_select(x, y, d, nx, ny, res, sel);
+}
+
+void knn_L2sqr_approx_topk(
+        const float* x,
+        const float* y,
+        size_t d,
+        size_t nx,
+        size_t ny,
+        size_t k,
+        float* vals,
+        int64_t* ids,
+        float recall,
+        const float* y_norm2,
+        const IDSelector* sel) {
+    ApproxTopKConfig config = approx_topk_choose(k, ny, recall);
+    ApproxTopKBlockResultHandler<CMax<float, int64_t>> res(
+            nx, vals, ids, k, config);
+    knn_L2sqr_select(x, y, d, nx, ny, res, y_norm2, sel);
+}
+
 void knn_L2sqr(
         const float* x,
         const float* y,
@@ -281,10 +281,19 @@ FAISS_API extern int distance_compute_blas_threshold;
 FAISS_API extern int distance_compute_blas_query_bs;
 FAISS_API extern int distance_compute_blas_database_bs;
 
+// block sizes for the fused BLAS kernels used by the knn functions, where
+// each thread computes tiles of distances that stay in cache
+FAISS_API extern int distance_compute_fused_query_bs;
+FAISS_API extern int distance_compute_fused_database_bs;
+
 // above this number of results we switch to a reservoir to collect results
 // rather than a heap
 FAISS_API extern int distance_compute_min_k_reservoir;
 
+// above this number of results we switch to a buffer with vectorized
+// threshold filtering (BufferedBlockResultHandler) rather than a reservoir
+FAISS_API extern int distance_compute_min_k_buffered;
+
 /** Return the k nearest neighors of each of the nx vectors x among the ny
  *  vector y, w.r.t to max inner product.
  *
@@ -360,6 +369,38 @@ void knn_L2sqr(
         const float* y_norm2 = nullptr,
         const IDSelector* sel = nullptr);
 
+/** Same as knn_inner_product and knn_L2sqr, but the results are collected
+ * with a bucketed approximate top-k (see utils/approx_topk/bucketed.h),
+ * configured to reach the given expected recall. This is faster than the
+ * exact selection for large k.
+ *
+ * @param recall  expected recall of the top-k selection, in (0, 1]
+ */
+void knn_inner_product_approx_topk(
+        const float* x,
+        const float* y,
+        size_t d,
+        size_t nx,
+        size_t ny,
+        size_t k,
+        float* distances,
+        int64_t* indexes,
+        float recall,
+        const IDSelector* sel = nullptr);
+
+void knn_L2sqr_approx_topk(
+        const float* x,
+        const float* y,
+        size_t d,
+        size_t nx,
+        size_t ny,
+        size_t k,
+        float* distances,
+        int64_t* indexes,
+        float recall,
+        const float* y_norm2 = nullptr,
+        const IDSelector* sel = nullptr);
+
 /** Find the max inner product neighbors for nx queries in a set of ny vectors
  * indexed by ids. May be useful for re-ranking a pre-selected vector list
  *
@@ -97,8 +97,11 @@ struct HCounterState {
               k(k) {}
 
     void update_counter(const uint8_t* y, size_t j) {
-        int32_t dis = hc.hamming(y);
+        update_counter_dis(hc.hamming(y), j);
+    }
 
+    /// same as update_counter, with a precomputed distance
+    void update_counter_dis(int32_t dis, size_t j) {
         if (dis <= thres) {
             if (dis < thres) {
                 ids_per_dis[dis * k + counters[dis]++] = j;
@@ -35,9 +35,15 @@
 #include <faiss/utils/approx_topk_hamming/approx_topk_hamming.h>
 #include <faiss/utils/utils.h>
 
+#if defined(__AVX512VPOPCNTDQ__) && defined(__AVX512VL__)
+#include <immintrin.h>
+#define USE_HAMMING_TILE
+#endif
+
 namespace faiss {
 
 size_t hamming_batch_size = 65536;
+size_t hamming_tile_min_queries = 8;
 
 template <size_t nbits>
 void hammings(
@@ -284,6 +290,172 @@ void hammings_knn_mc(
     }
 }
 
+#ifdef USE_HAMMING_TILE
+
+/* Distances between a tile of up to 8 queries and one database code. The
+ * queries are stored transposed, so that word w of the 8 queries fills a
+ * 512-bit register. A single vpopcntq computes the contribution of word w
+ * of the code to the 8 distances, and the 8 distances are compared to the
+ * 8 thresholds at once. */
+struct HammingTile8 {
+    static constexpr size_t QB = 8;
+    size_t nwords;
+    unsigned lane_mask;
+    std::vector<uint64_t> qT; // size nwords * QB
+
+    HammingTile8(const uint8_t* a, size_t nq, size_t code_size)
+            : nwords(code_size / 8),
+              lane_mask((1u << nq) - 1),
+              qT(nwords * QB, 0) {
+        for (size_t q = 0; q < nq; q++) {
+            const uint64_t* aq = (const uint64_t*)(a + q * code_size);
+            for (size_t w = 0; w < nwords; w++) {
+                qT[w * QB + q] = aq[w];
+            }
+        }
+    }
+
+    /// fills dis[0..7] with the distances to code b and returns the mask
+    /// of the valid lanes q where dis[q] < thres[q]
+    inline unsigned distances(
+            const uint8_t* b,
+            const int32_t* thres,
+            int32_t* dis) const {
+        const uint64_t* bw = (const uint64_t*)b;
+        __m512i acc = _mm512_setzero_si512();
+        for (size_t w = 0; w < nwords; w++) {
+            __m512i x = _mm512_xor_si512(
+                    _mm512_loadu_si512(qT.data() + w * QB),
+                    _mm512_set1_epi64(bw[w]));
+            acc = _mm512_add_epi64(acc, _mm512_popcnt_epi64(x));
+        }
+        __m256i d32 = _mm512_cvtepi64_epi32(acc);
+        _mm256_storeu_si256((__m256i*)dis, d32);
+        __mmask8 m = _mm256_cmplt_epi32_mask(
+                d32, _mm256_loadu_si256((const __m256i*)thres));
+        return m & lane_mask;
+    }
+};
+
+/* Same as hammings_knn_hc, for code sizes that are a multiple of 8, with
+ * tiles of 8 queries processed together. */
+void hammings_knn_hc_tiled(
+        int_maxheap_array_t* __restrict ha,
+        const uint8_t* __restrict bs1,
+        const uint8_t* __restrict bs2,
+        size_t n2,
+        size_t code_size,
+        bool order) {
+    constexpr size_t QB = HammingTile8::QB;
+    size_t k = ha->k;
+    ha->heapify();
+
+    size_t ntile = (ha->nh + QB - 1) / QB;
+    const size_t block_size = hamming_batch_size;
+    for (size_t j0 = 0; j0 < n2; j0 += block_size) {
+        const size_t j1 = std::min(j0 + block_size, n2);
+#pragma omp parallel for num_threads(num_omp_threads)
+        for (int64_t t = 0; t < ntile; t++) {
+            size_t q0 = t * QB;
+            size_t nq = std::min(QB, ha->nh - q0);
+            HammingTile8 tile(bs1 + q0 * code_size, nq, code_size);
+            int32_t thres[QB], dis[QB];
+            for (size_t q = 0; q < QB; q++) {
+                thres[q] = q < nq ? ha->val[(q0 + q) * k] : 0;
+            }
+            const uint8_t* bs2_ = bs2 + j0 * code_size;
+            for (size_t j = j0; j < j1; j++, bs2_ += code_size) {
+                unsigned m = tile.distances(bs2_, thres, dis);
+                while (m) {
+                    int q = __builtin_ctz(m);
+                    m &= m - 1;
+                    hamdis_t* bh_val_ = ha->val + (q0 + q) * k;
+                    int64_t* bh_ids_ = ha->ids + (q0 + q) * k;
+                    maxheap_replace_top<hamdis_t>(
+                            k, bh_val_, bh_ids_, dis[q], j);
+                    thres[q] = bh_val_[0];
+                }
+            }
+        }
+    }
+    if (order)
+        ha->reorder();
+}
+
+/* Same as hammings_knn_mc, with tiles of 8 queries. */
+template <class HammingComputer>
+void hammings_knn_mc_tiled(
+        int bytes_per_code,
+        const uint8_t* __restrict a,
+        const uint8_t* __restrict b,
+        size_t na,
+        size_t nb,
+        size_t k,
+        int32_t* __restrict distances,
+        int64_t* __restrict labels) {
+    constexpr size_t QB = HammingTile8::QB;
+    const int nBuckets = bytes_per_code * 8 + 1;
+    std::vector<int> all_counters(na * nBuckets, 0);
+    std::unique_ptr<int64_t[]> all_ids_per_dis(new int64_t[na * nBuckets * k]);
+
+    std::vector<HCounterState<HammingComputer>> cs;
+    for (size_t i = 0; i < na; ++i) {
+        cs.push_back(HCounterState<HammingComputer>(
+                all_counters.data() + i * nBuckets,
+                all_ids_per_dis.get() + i * nBuckets * k,
+                a + i * bytes_per_code,
+                8 * bytes_per_code,
+                k));
+    }
+
+    size_t ntile = (na + QB - 1) / QB;
+    const size_t block_size = hamming_batch_size;
+    for (size_t j0 = 0; j0 < nb; j0 += block_size) {
+        const size_t j1 = std::min(j0 + block_size, nb);
+#pragma omp parallel for num_threads(num_omp_threads)
+        for (int64_t t = 0; t < ntile; t++) {
+            size_t q0 = t * QB;
+            size_t nq = std::min(QB, na - q0);
+            HammingTile8 tile(a + q0 * bytes_per_code, nq, bytes_per_code);
+            // the counters accept distances <= thres
+            int32_t thres[QB], dis[QB];
+            for (size_t q = 0; q < QB; q++) {
+                thres[q] = q < nq ? cs[q0 + q].thres + 1 : 0;
+            }
+            const uint8_t* b_ = b + j0 * bytes_per_code;
+            for (size_t j = j0; j < j1; j++, b_ += bytes_per_code) {
+                unsigned m = tile.distances(b_, thres, dis);
+                while (m) {
+                    int q = __builtin_ctz(m);
+                    m &= m - 1;
+                    cs[q0 + q].update_counter_dis(dis[q], j);
+                    thres[q] = cs[q0 + q].thres + 1;
+                }
+            }
+        }
+    }
+
+    for (size_t i = 0; i < na; ++i) {
+        HCounterState<HammingComputer>& csi = cs[i];
+
+        int nres = 0;
+        for (int b_2 = 0; b_2 < nBuckets && nres < k; b_2++) {
+            for (int l = 0; l < csi.counters[b_2] && nres < k; l++) {
+                labels[i * k + nres] = csi.ids_per_dis[b_2 * k + l];
+                distances[i * k + nres] = b_2;
+                nres++;
+            }
+        }
+        while (nres < k) {
+            labels[i * k + nres] = -1;
+            distances[i * k + nres] = std::numeric_limits<int32_t>::max();
+            ++nres;
+        }
+    }
+}
+
+#endif // USE_HAMMING_TILE
+
 template <class HammingComputer>
 void hamming_range_search(
         const uint8_t* a,
@@ -331,6 +503,16 @@ struct Run_hammings_knn_mc {
     }
 };
 
+#ifdef USE_HAMMING_TILE
+struct Run_hammings_knn_mc_tiled {
+    using T = void;
+    template <class HammingComputer, class... Types>
+    void f(Types... args) {
+        hammings_knn_mc_tiled<HammingComputer>(args...);
+    }
+};
+#endif
+
 struct Run_hamming_range_search {
     using T = void;
     template <class HammingComputer, class... Types>
@@ -491,6 +673,13 @@ void hammings_knn_hc(
         size_t ncodes,
         int order,
         ApproxTopK_mode_t approx_topk_mode) {
+#ifdef USE_HAMMING_TILE
+    if (approx_topk_mode == ApproxTopK_mode_t::EXACT_TOPK &&
+        ncodes % 8 == 0 && ha->nh >= hamming_tile_min_queries) {
+        hammings_knn_hc_tiled(ha, a, b, nb, ncodes, order);
+        return;
+    }
+#endif
     Run_hammings_knn_hc r;
     dispatch_HammingComputer(
             ncodes, r, ncodes, ha, a, b, nb, order, true, approx_topk_mode);
@@ -505,6 +694,14 @@ void hammings_knn_mc(
         size_t ncodes,
         int32_t* __restrict distances,
         int64_t* __restrict labels) {
+#ifdef USE_HAMMING_TILE
+    if (ncodes % 8 == 0 && na >= hamming_tile_min_queries) {
+        Run_hammings_knn_mc_tiled r;
+        dispatch_HammingComputer(
+                ncodes, r, ncodes, a, b, na, nb, k, distances, labels);
+        return;
+    }
+#endif
     Run_hammings_knn_mc r;
     dispatch_HammingComputer(
             ncodes, r, ncodes, a, b, na, nb, k, distances, labels);
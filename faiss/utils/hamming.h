@@ -102,6 +102,11 @@ struct BitstringReader {
 
 FAISS_API extern size_t hamming_batch_size;
 
+/// when compiled with AVX512 VPOPCNTDQ, hammings_knn_hc and hammings_knn_mc
+/// process tiles of 8 queries together if there are at least this many
+/// queries and the code size is a multiple of 8 bytes
+FAISS_API extern size_t hamming_tile_min_queries;
+
 /** Compute a set of Hamming distances between na and nb binary vectors
  *
  * @param  a             size na * nbytespercode
@@ -0,0 +1,202 @@
+/**
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+// -*- c++ -*-
+
+#include <faiss/utils/numa.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+#include <faiss/IndexBinaryFlat.h>
+#include <faiss/IndexBinaryIVF.h>
+#include <faiss/IndexFlatCodes.h>
+#include <faiss/IndexHNSW.h>
+#include <faiss/IndexIDMap.h>
+#include <faiss/IndexIVF.h>
+#include <faiss/IndexPreTransform.h>
+#include <faiss/OMPConfig.h>
+#include <faiss/impl/FaissAssert.h>
+#include <faiss/invlists/InvertedLists.h>
+
+namespace faiss {
+
+namespace {
+
+#ifdef __linux__
+
+/// parse a cpu list of the form "0-3,8,10-11"
+std::vector<int> parse_cpu_list(const char* s) {
+    std::vector<int> cpus;
+    while (*s) {
+        char* end;
+        long a = strtol(s, &end, 10);
+        if (end == s) {
+            break;
+        }
+        long b = a;
+        s = end;
+        if (*s == '-') {
+            b = strtol(s + 1, &end, 10);
+            s = end;
+        }
+        for (long c = a; c <= b; c++) {
+            cpus.push_back(c);
+        }
+        if (*s == ',') {
+            s++;
+        } else {
+            break;
+        }
+    }
+    return cpus;
+}
+
+bool read_node_cpus(int node, std::vector<int>& cpus) {
+    std::string fname = "/sys/devices/system/node/node" +
+            std::to_string(node) + "/cpulist";
+    FILE* f = fopen(fname.c_str(), "r");
+    if (!f) {
+        return false;
+    }
+    char buf[4096];
+    bool ok = fgets(buf, sizeof(buf), f) != nullptr;
+    fclose(f);
+    if (ok) {
+        cpus = parse_cpu_list(buf);
+    }
+    return ok;
+}
+
+#endif
+
+std::vector<int> all_cpus() {
+    std::vector<int> cpus(std::max(1u, std::thread::hardware_concurrency()));
+    for (int i = 0; i < cpus.size(); i++) {
+        cpus[i] = i;
+    }
+    return cpus;
+}
+
+template <class T>
+size_t first_touch_vector(std::vector<T>& v) {
+    std::vector<T> tmp(v.begin(), v.end());
+    v.swap(tmp);
+    return v.size() * sizeof(T);
+}
+
+size_t first_touch_invlists(InvertedLists* invlists) {
+    auto ails = dynamic_cast<ArrayInvertedLists*>(invlists);
+    if (!ails) {
+        return 0;
+    }
+    size_t nbytes = 0;
+    for (size_t i = 0; i < ails->nlist; i++) {
+        nbytes += first_touch_vector(ails->codes[i]);
+        nbytes += first_touch_vector(ails->ids[i]);
+    }
+    return nbytes;
+}
+
+} // namespace
+
+int numa_num_nodes() {
+#ifdef __linux__
+    static int nnodes = []() {
+        int n = 0;
+        std::vector<int> cpus;
+        while (read_node_cpus(n, cpus)) {
+            n++;
+        }
+        return std::max(n, 1);
+    }();
+    return nnodes;
+#else
+    return 1;
+#endif
+}
+
+std::vector<int> numa_node_cpus(int node) {
+    FAISS_THROW_IF_NOT_FMT(
+            node >= 0 && node < numa_num_nodes(),
+            "invalid NUMA node %d",
+            node);
+#ifdef __linux__
+    std::vector<int> cpus;
+    if (read_node_cpus(node, cpus) && !cpus.empty()) {
+        return cpus;
+    }
+#endif
+    return all_cpus();
+}
+
+bool numa_bind_thread(int node) {
+#ifdef __linux__
+    std::vector<int> cpus = numa_node_cpus(node);
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int c : cpus) {
+        if (c < CPU_SETSIZE) {
+            CPU_SET(c, &set);
+        }
+    }
+    if (sched_setaffinity(0, sizeof(set), &set) != 0) {
+        return false;
+    }
+    // the OpenMP threads of this thread may already exist
+    bool ok = true;
+#pragma omp parallel num_threads(num_omp_threads) reduction(&& : ok)
+    { ok = sched_setaffinity(0, sizeof(set), &set) == 0; }
+    return ok;
+#else
+    return false;
+#endif
+}
+
+size_t numa_first_touch(Index* index) {
+    size_t nbytes = 0;
+    if (auto ifc = dynamic_cast<IndexFlatCodes*>(index)) {
+        nbytes += first_touch_vector(ifc->codes);
+    } else if (auto ivf = dynamic_cast<IndexIVF*>(index)) {
+        nbytes += numa_first_touch(ivf->quantizer);
+        nbytes += first_touch_invlists(ivf->invlists);
+    } else if (auto ihnsw = dynamic_cast<IndexHNSW*>(index)) {
+        nbytes += numa_first_touch(ihnsw->storage);
+        nbytes += first_touch_vector(ihnsw->hnsw.levels);
+        nbytes += first_touch_vector(ihnsw->hnsw.offsets);
+        nbytes += first_touch_vector(ihnsw->hnsw.neighbors);
+    } else if (auto ipt = dynamic_cast<IndexPreTransform*>(index)) {
+        nbytes += numa_first_touch(ipt->index);
+    } else if (auto idmap = dynamic_cast<IndexIDMap*>(index)) {
+        nbytes += numa_first_touch(idmap->index);
+        nbytes += first_touch_vector(idmap->id_map);
+    }
+    return nbytes;
+}
+
+size_t numa_first_touch(IndexBinary* index) {
+    size_t nbytes = 0;
+    if (auto ibf = dynamic_cast<IndexBinaryFlat*>(index)) {
+        nbytes += first_touch_vector(ibf->xb);
+    } else if (auto ivf = dynamic_cast<IndexBinaryIVF*>(index)) {
+        nbytes += numa_first_touch(ivf->quantizer);
+        nbytes += first_touch_invlists(ivf->invlists);
+    } else if (auto idmap = dynamic_cast<IndexBinaryIDMap*>(index)) {
+        nbytes += numa_first_touch(idmap->index);
+        nbytes += first_touch_vector(idmap->id_map);
+    }
+    return nbytes;
+}
+
+} // namespace faiss
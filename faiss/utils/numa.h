@@ -0,0 +1,54 @@
+/**
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+// -*- c++ -*-
+
+/*
+ * NUMA placement of threads and index storage.
+ *
+ * The topology is read from /sys/devices/system/node, threads are bound
+ * with the scheduler affinity and memory is placed by first touch: the
+ * storage of an index is copied from a thread that runs on the target
+ * node, so that the kernel allocates the new pages on that node. No
+ * library or privilege is needed. On other systems than Linux, there is a
+ * single node and the binding functions do nothing.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+namespace faiss {
+
+struct Index;
+struct IndexBinary;
+
+/// nb of NUMA nodes of the machine (1 if unknown)
+int numa_num_nodes();
+
+/// cpus of a NUMA node
+std::vector<int> numa_node_cpus(int node);
+
+/** restrict the calling thread and its OpenMP threads to the cpus of a
+ * node. The threads it creates afterwards inherit the binding.
+ *
+ * @return whether the binding succeeded
+ */
+bool numa_bind_thread(int node);
+
+/** copy the storage of an index (codes, inverted lists, graph, ids) to
+ * new buffers, so that it is placed on the NUMA node of the calling thread.
+ * Supports the flat, IVF with ArrayInvertedLists and HNSW indexes, and
+ * recurses into IndexPreTransform and IndexIDMap.
+ *
+ * @return nb of bytes that were copied
+ */
+size_t numa_first_touch(Index* index);
+size_t numa_first_touch(IndexBinary* index);
+
+} // namespace faiss
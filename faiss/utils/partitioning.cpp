@@ -17,6 +17,10 @@
 
 #include <faiss/impl/platform_macros.h>
 
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
 namespace faiss {
 
 /******************************************************************
@@ -812,6 +816,128 @@ template uint16_t partition_fuzzy<CMax<uint16_t, int>>(
         size_t q_max,
         size_t* q_out);
 
+/******************************************************************
+ * Threshold filtering
+ ******************************************************************/
+
+namespace partitioning {
+
+#if defined(__AVX2__) && !defined(__AVX512F__)
+
+// perm[m] lists the positions of the bits set in the 8-bit mask m, one per
+// byte, so that a lane permutation compacts the kept elements of a block
+struct CompressTable {
+    uint64_t perm[256];
+
+    constexpr CompressTable() : perm() {
+        for (int m = 0; m < 256; m++) {
+            int k = 0;
+            for (int b = 0; b < 8; b++) {
+                if (m & (1 << b)) {
+                    perm[m] |= uint64_t(b) << (8 * k++);
+                }
+            }
+        }
+    }
+};
+
+constexpr CompressTable compress_table;
+
+#endif
+
+// keep_below = true for CMax (keep smallest values)
+template <bool keep_below>
+size_t filter_by_threshold_float(
+        const float* vals,
+        size_t n,
+        float threshold,
+        int64_t id0,
+        float* out_vals,
+        int64_t* out_ids) {
+    size_t nout = 0;
+    size_t i = 0;
+#if defined(__AVX512F__)
+    constexpr int pred = keep_below ? _CMP_LT_OQ : _CMP_GT_OQ;
+    const __m512 thr = _mm512_set1_ps(threshold);
+    const __m512i lanes = _mm512_setr_epi64(0, 1, 2, 3, 4, 5, 6, 7);
+    for (; i + 16 <= n; i += 16) {
+        __m512 v = _mm512_loadu_ps(vals + i);
+        __mmask16 m = _mm512_cmp_ps_mask(v, thr, pred);
+        if (m == 0) {
+            continue;
+        }
+        _mm512_mask_compressstoreu_ps(out_vals + nout, m, v);
+        __m512i ids_lo = _mm512_add_epi64(
+                lanes, _mm512_set1_epi64(id0 + int64_t(i)));
+        __m512i ids_hi = _mm512_add_epi64(ids_lo, _mm512_set1_epi64(8));
+        __mmask8 m_lo = m & 0xff, m_hi = m >> 8;
+        int n_lo = __builtin_popcount(m_lo);
+        _mm512_mask_compressstoreu_epi64(out_ids + nout, m_lo, ids_lo);
+        _mm512_mask_compressstoreu_epi64(
+                out_ids + nout + n_lo, m_hi, ids_hi);
+        nout += n_lo + __builtin_popcount(m_hi);
+    }
+#elif defined(__AVX2__)
+    constexpr int pred = keep_below ? _CMP_LT_OQ : _CMP_GT_OQ;
+    const __m256 thr = _mm256_set1_ps(threshold);
+    for (; i + 8 <= n; i += 8) {
+        __m256 v = _mm256_loadu_ps(vals + i);
+        unsigned m = _mm256_movemask_ps(_mm256_cmp_ps(v, thr, pred));
+        // compact the kept lanes to the front and always store the 8
+        // lanes. nout <= i so the stores stay within the n output slots
+        __m256i perm = _mm256_cvtepu8_epi32(
+                _mm_cvtsi64_si128(compress_table.perm[m]));
+        _mm256_storeu_ps(out_vals + nout, _mm256_permutevar8x32_ps(v, perm));
+        __m256i base = _mm256_set1_epi64x(id0 + int64_t(i));
+        __m256i ids_lo = _mm256_add_epi64(
+                base, _mm256_cvtepi32_epi64(_mm256_castsi256_si128(perm)));
+        __m256i ids_hi = _mm256_add_epi64(
+                base, _mm256_cvtepi32_epi64(_mm256_extracti128_si256(perm, 1)));
+        _mm256_storeu_si256((__m256i*)(out_ids + nout), ids_lo);
+        _mm256_storeu_si256((__m256i*)(out_ids + nout + 4), ids_hi);
+        nout += __builtin_popcount(m);
+    }
+#endif
+    for (; i < n; i++) {
+        float v = vals[i];
+        // branchless: always write, advance only if kept
+        out_vals[nout] = v;
+        out_ids[nout] = id0 + i;
+        nout += keep_below ? v < threshold : v > threshold;
+    }
+    return nout;
+}
+
+} // namespace partitioning
+
+template <class C>
+size_t filter_by_threshold(
+        const typename C::T* vals,
+        size_t n,
+        typename C::T threshold,
+        typename C::TI id0,
+        typename C::T* out_vals,
+        typename C::TI* out_ids) {
+    return partitioning::filter_by_threshold_float<C::is_max>(
+            vals, n, threshold, id0, out_vals, out_ids);
+}
+
+template size_t filter_by_threshold<CMin<float, int64_t>>(
+        const float* vals,
+        size_t n,
+        float threshold,
+        int64_t id0,
+        float* out_vals,
+        int64_t* out_ids);
+
+template size_t filter_by_threshold<CMax<float, int64_t>>(
+        const float* vals,
+        size_t n,
+        float threshold,
+        int64_t id0,
+        float* out_vals,
+        int64_t* out_ids);
+
 /******************************************************************
  * Histogram subroutines
  ******************************************************************/
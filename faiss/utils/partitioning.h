@@ -38,6 +38,25 @@ inline typename C::T partition(
     return partition_fuzzy<C>(vals, ids, n, q, q, nullptr);
 }
 
+/** copies the elements of vals[0:n] that are strictly better than threshold
+ * (below it for C = CMax, above it for CMin) to out_vals, and their index
+ * + id0 to out_ids. The filter is vectorized and has no data-dependent
+ * branch per element: the SIMD paths compact each block with a compress
+ * store (AVX512) or a lane permutation (AVX2) and may write past the
+ * returned count.
+ *
+ * out_vals and out_ids should have room for n elements.
+ * Returns the number of copied elements.
+ */
+template <class C>
+size_t filter_by_threshold(
+        const typename C::T* vals,
+        size_t n,
+        typename C::T threshold,
+        typename C::TI id0,
+        typename C::T* out_vals,
+        typename C::TI* out_ids);
+
 /** low level SIMD histogramming functions */
 
 /** 8-bin histogram of (x - min) >> shift
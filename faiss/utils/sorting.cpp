@@ -13,6 +13,7 @@
 
 #include <algorithm>
 
+#include <faiss/OMPConfig.h>
 #include <faiss/impl/FaissAssert.h>
 #include <faiss/utils/utils.h>
 
@@ -705,34 +706,129 @@ inline int64_t hash_function(int64_t x) {
     return (x * 1000003) % bigprime;
 }
 
+/// the probing for a key wraps around in the range of slots of its bucket
+struct HashtableBucket {
+    size_t k0, k1;
+
+    HashtableBucket(int log2_capacity, size_t slot) {
+        int shift =
+                log2_capacity - log2_capacity_to_log2_nbucket(log2_capacity);
+        size_t bucket = slot >> shift;
+        k0 = bucket << shift;
+        k1 = (bucket + 1) << shift;
+    }
+
+    size_t next(size_t slot) const {
+        slot++;
+        return slot == k1 ? k0 : slot;
+    }
+
+    /// nb of steps from slot a to slot b
+    size_t dist(size_t a, size_t b) const {
+        return b >= a ? b - a : b + (k1 - k0) - a;
+    }
+};
+
+/// below this nb of keys (or of slots for init), the batch operations run
+/// sequentially: opening a parallel region costs more than the work
+constexpr size_t hashtable_parallel_threshold = 16384;
+
+/// insert or overwrite a key. Returns 1 if the key is new, 0 if it was
+/// overwritten and -1 if its bucket is full
+int hashtable_insert_1(
+        int log2_capacity,
+        int64_t* tab,
+        int64_t key,
+        int64_t val) {
+    size_t capacity = (size_t)1 << log2_capacity;
+    size_t hk = hash_function(key) & (capacity - 1);
+    HashtableBucket b(log2_capacity, hk);
+    size_t slot = hk;
+    for (;;) {
+        if (tab[2 * slot] == -1) {
+            tab[2 * slot] = key;
+            tab[2 * slot + 1] = val;
+            return 1;
+        }
+        if (tab[2 * slot] == key) {
+            tab[2 * slot + 1] = val;
+            return 0;
+        }
+        slot = b.next(slot);
+        if (slot == hk) {
+            return -1;
+        }
+    }
+}
+
+/// slot of key, or -1 if it is not in the table
+int64_t hashtable_find_slot(
+        int log2_capacity,
+        const int64_t* tab,
+        int64_t key) {
+    size_t capacity = (size_t)1 << log2_capacity;
+    size_t hk = hash_function(key) & (capacity - 1);
+    HashtableBucket b(log2_capacity, hk);
+    size_t slot = hk;
+    for (;;) {
+        if (tab[2 * slot] == key) {
+            return slot;
+        }
+        if (tab[2 * slot] == -1) {
+            return -1;
+        }
+        slot = b.next(slot);
+        if (slot == hk) {
+            return -1;
+        }
+    }
+}
+
 } // anonymous namespace
 
 void hashtable_int64_to_int64_init(int log2_capacity, int64_t* tab) {
     size_t capacity = (size_t)1 << log2_capacity;
-#pragma omp parallel for
+#pragma omp parallel for if (capacity > hashtable_parallel_threshold) num_threads(num_omp_threads)
     for (int64_t i = 0; i < capacity; i++) {
         tab[2 * i] = -1;
         tab[2 * i + 1] = -1;
     }
 }
 
-void hashtable_int64_to_int64_add(
+size_t hashtable_int64_to_int64_add(
         int log2_capacity,
         int64_t* tab,
         size_t n,
         const int64_t* keys,
         const int64_t* vals) {
+    int num_errors = 0;
+    size_t nnew = 0;
+    int log2_nbucket = log2_capacity_to_log2_nbucket(log2_capacity);
+    if (n <= hashtable_parallel_threshold || log2_nbucket == 0) {
+        for (size_t i = 0; i < n; i++) {
+            int ret = hashtable_insert_1(log2_capacity, tab, keys[i], vals[i]);
+            if (ret < 0) {
+                num_errors++;
+                break;
+            }
+            nnew += ret;
+        }
+        FAISS_THROW_IF_NOT_MSG(
+                num_errors == 0, "hashtable capacity exhausted");
+        return nnew;
+    }
+
+    // the keys are sorted by bucket, then the buckets are filled in
+    // parallel. The hash values are recomputed rather than stored
     size_t capacity = (size_t)1 << log2_capacity;
-    std::vector<int64_t> hk(n);
-    std::vector<uint64_t> bucket_no(n);
     int64_t mask = capacity - 1;
-    int log2_nbucket = log2_capacity_to_log2_nbucket(log2_capacity);
     size_t nbucket = (size_t)1 << log2_nbucket;
+    std::vector<uint64_t> bucket_no(n);
 
-#pragma omp parallel for
+#pragma omp parallel for num_threads(num_omp_threads)
     for (int64_t i = 0; i < n; i++) {
-        hk[i] = hash_function(keys[i]) & mask;
-        bucket_no[i] = hk[i] >> (log2_capacity - log2_nbucket);
+        int64_t hk = hash_function(keys[i]) & mask;
+        bucket_no[i] = hk >> (log2_capacity - log2_nbucket);
     }
 
     std::vector<int64_t> lims(nbucket + 1);
@@ -743,43 +839,24 @@ void hashtable_int64_to_int64_add(
             nbucket,
             lims.data(),
             perm.data(),
-            omp_get_max_threads());
+            std::max(int(num_omp_threads), 1));
+    bucket_no.clear();
+    bucket_no.shrink_to_fit();
 
-    int num_errors = 0;
-#pragma omp parallel for reduction(+ : num_errors)
+#pragma omp parallel for reduction(+ : num_errors, nnew) num_threads(num_omp_threads)
     for (int64_t bucket = 0; bucket < nbucket; bucket++) {
-        size_t k0 = bucket << (log2_capacity - log2_nbucket);
-        size_t k1 = (bucket + 1) << (log2_capacity - log2_nbucket);
-
         for (size_t i = lims[bucket]; i < lims[bucket + 1]; i++) {
             int64_t j = perm[i];
-            assert(bucket_no[j] == bucket);
-            assert(hk[j] >= k0 && hk[j] < k1);
-            size_t slot = hk[j];
-            for (;;) {
-                if (tab[slot * 2] == -1) { // found!
-                    tab[slot * 2] = keys[j];
-                    tab[slot * 2 + 1] = vals[j];
-                    break;
-                } else if (tab[slot * 2] == keys[j]) { // overwrite!
-                    tab[slot * 2 + 1] = vals[j];
-                    break;
-                }
-                slot++;
-                if (slot == k1) {
-                    slot = k0;
-                }
-                if (slot == hk[j]) { // no free slot left in bucket
-                    num_errors++;
-                    break;
-                }
-            }
-            if (num_errors > 0) {
+            int ret = hashtable_insert_1(log2_capacity, tab, keys[j], vals[j]);
+            if (ret < 0) { // no free slot left in bucket
+                num_errors++;
                 break;
             }
+            nnew += ret;
         }
     }
     FAISS_THROW_IF_NOT_MSG(num_errors == 0, "hashtable capacity exhausted");
+    return nnew;
 }
 
 void hashtable_int64_to_int64_lookup(
@@ -789,11 +866,10 @@ void hashtable_int64_to_int64_lookup(
         const int64_t* keys,
         int64_t* vals) {
     size_t capacity = (size_t)1 << log2_capacity;
-    std::vector<int64_t> hk(n), bucket_no(n);
     int64_t mask = capacity - 1;
     int log2_nbucket = log2_capacity_to_log2_nbucket(log2_capacity);
 
-#pragma omp parallel for
+#pragma omp parallel for if (n > hashtable_parallel_threshold) num_threads(num_omp_threads)
     for (int64_t i = 0; i < n; i++) {
         int64_t k = keys[i];
         int64_t hk = hash_function(k) & mask;
@@ -812,6 +888,10 @@ void hashtable_int64_to_int64_lookup(
                     vals[i] = tab[2 * slot + 1];
                     break;
                 }
+                if (tab[slot * 2] == -1) { // end of the probe sequence
+                    vals[i] = -1;
+                    break;
+                }
                 slot++;
                 if (slot == k1) {
                     slot = k0;
@@ -825,4 +905,138 @@ void hashtable_int64_to_int64_lookup(
     }
 }
 
+size_t hashtable_int64_to_int64_remove(
+        int log2_capacity,
+        int64_t* tab,
+        size_t n,
+        const int64_t* keys) {
+    size_t capacity = (size_t)1 << log2_capacity;
+    size_t nremove = 0;
+    for (size_t i = 0; i < n; i++) {
+        int64_t slot = hashtable_find_slot(log2_capacity, tab, keys[i]);
+        if (slot < 0) {
+            continue;
+        }
+        nremove++;
+        // backward-shift deletion: move the following entries of the probe
+        // sequence to the hole if their home slot allows it, so that the
+        // lookups can stop at the first empty slot
+        HashtableBucket b(log2_capacity, slot);
+        size_t hole = slot;
+        size_t j = hole;
+        for (;;) {
+            j = b.next(j);
+            if (tab[2 * j] == -1 || j == hole) {
+                break;
+            }
+            size_t home = hash_function(tab[2 * j]) & (capacity - 1);
+            if (b.dist(home, j) >= b.dist(hole, j)) {
+                tab[2 * hole] = tab[2 * j];
+                tab[2 * hole + 1] = tab[2 * j + 1];
+                hole = j;
+            }
+        }
+        tab[2 * hole] = -1;
+        tab[2 * hole + 1] = -1;
+    }
+    return nremove;
+}
+
+/***************************************************************
+ * HashtableInt64ToInt64
+ ***************************************************************/
+
+void HashtableInt64ToInt64::clear() {
+    log2_capacity = 0;
+    count = 0;
+    tab.clear();
+}
+
+void HashtableInt64ToInt64::reserve(size_t n) {
+    int new_log2_capacity = std::max(log2_capacity, 4);
+    while (n * 4 > ((size_t)3 << new_log2_capacity)) {
+        new_log2_capacity++;
+    }
+    if (new_log2_capacity == log2_capacity) {
+        return;
+    }
+    // the entries are re-inserted directly from the old table, so that
+    // the peak memory is the old + the new table
+    std::vector<int64_t> old_tab((size_t)2 << new_log2_capacity);
+    std::swap(tab, old_tab);
+    log2_capacity = new_log2_capacity;
+    hashtable_int64_to_int64_init(log2_capacity, tab.data());
+    for (size_t i = 0; i < old_tab.size(); i += 2) {
+        if (old_tab[i] != -1) {
+            int ret = hashtable_insert_1(
+                    log2_capacity, tab.data(), old_tab[i], old_tab[i + 1]);
+            FAISS_THROW_IF_NOT_MSG(ret == 1, "hashtable capacity exhausted");
+        }
+    }
+}
+
+void HashtableInt64ToInt64::add(
+        size_t n,
+        const int64_t* keys,
+        const int64_t* vals) {
+    if (n == 0) {
+        return;
+    }
+    for (size_t i = 0; i < n; i++) {
+        FAISS_THROW_IF_NOT_MSG(keys[i] != -1, "key -1 is reserved");
+    }
+    reserve(count + n);
+    count += hashtable_int64_to_int64_add(
+            log2_capacity, tab.data(), n, keys, vals);
+}
+
+void HashtableInt64ToInt64::set(int64_t key, int64_t val) {
+    FAISS_THROW_IF_NOT_MSG(key != -1, "key -1 is reserved");
+    reserve(count + 1);
+    int ret = hashtable_insert_1(log2_capacity, tab.data(), key, val);
+    FAISS_THROW_IF_NOT_MSG(ret >= 0, "hashtable capacity exhausted");
+    count += ret;
+}
+
+void HashtableInt64ToInt64::lookup(
+        size_t n,
+        const int64_t* keys,
+        int64_t* vals) const {
+    if (count == 0) {
+        std::fill(vals, vals + n, -1);
+        return;
+    }
+    hashtable_int64_to_int64_lookup(log2_capacity, tab.data(), n, keys, vals);
+}
+
+int64_t HashtableInt64ToInt64::lookup(int64_t key) const {
+    if (count == 0) {
+        return -1;
+    }
+    int64_t slot = hashtable_find_slot(log2_capacity, tab.data(), key);
+    return slot < 0 ? -1 : tab[2 * slot + 1];
+}
+
+bool HashtableInt64ToInt64::remove(int64_t key) {
+    if (count == 0 ||
+        hashtable_int64_to_int64_remove(log2_capacity, tab.data(), 1, &key) ==
+                0) {
+        return false;
+    }
+    count--;
+    return true;
+}
+
+std::vector<std::pair<int64_t, int64_t>> HashtableInt64ToInt64::get_entries()
+        const {
+    std::vector<std::pair<int64_t, int64_t>> entries;
+    entries.reserve(count);
+    for (size_t i = 0; i < tab.size(); i += 2) {
+        if (tab[i] != -1) {
+            entries.emplace_back(tab[i], tab[i + 1]);
+        }
+    }
+    return entries;
+}
+
 } // namespace faiss
@@ -7,6 +7,10 @@
 
 #pragma once
 
+#include <cstdint>
+#include <utility>
+#include <vector>
+
 #include <faiss/impl/platform_macros.h>
 
 namespace faiss {
@@ -77,11 +81,13 @@ void matrix_bucket_sort_inplace(
  * adding several values in a same batch: an arbitrary one gets added
  * in different batches: the newer batch overwrites.
  * raises an exception if capacity is exhausted.
+ * The key -1 is reserved to mark empty slots.
  */
 
 void hashtable_int64_to_int64_init(int log2_capacity, int64_t* tab);
 
-void hashtable_int64_to_int64_add(
+/// returns the nb of keys that were not in the table yet
+size_t hashtable_int64_to_int64_add(
         int log2_capacity,
         int64_t* tab,
         size_t n,
@@ -95,4 +101,44 @@ void hashtable_int64_to_int64_lookup(
         const int64_t* keys,
         int64_t* vals);
 
+/// remove keys from the table, returns the nb of keys that were found
+size_t hashtable_int64_to_int64_remove(
+        int log2_capacity,
+        int64_t* tab,
+        size_t n,
+        const int64_t* keys);
+
+/** Growable hashtable int64 -> int64 that owns its table. The batch
+ * operations are the parallel functions above. It uses 16 bytes per slot
+ * and the table is kept at most 3/4 full. Lookups return -1 for keys that
+ * are not in the table. */
+struct HashtableInt64ToInt64 {
+    int log2_capacity = 0;
+    size_t count = 0; ///< nb of entries
+    std::vector<int64_t> tab;
+
+    size_t size() const {
+        return count;
+    }
+
+    void clear();
+
+    /// make room for n entries in total
+    void reserve(size_t n);
+
+    void add(size_t n, const int64_t* keys, const int64_t* vals);
+
+    void set(int64_t key, int64_t val);
+
+    void lookup(size_t n, const int64_t* keys, int64_t* vals) const;
+
+    int64_t lookup(int64_t key) const;
+
+    /// returns whether the key was found
+    bool remove(int64_t key);
+
+    /// all (key, value) pairs, in table order
+    std::vector<std::pair<int64_t, int64_t>> get_entries() const;
+};
+
 } // namespace faiss
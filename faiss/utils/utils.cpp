@@ -187,6 +187,16 @@ size_t get_mem_usage_kb() {
 
 #endif
 
+size_t get_l2_cache_size() {
+#ifdef _SC_LEVEL2_CACHE_SIZE
+    long sz = sysconf(_SC_LEVEL2_CACHE_SIZE);
+    if (sz > 0) {
+        return sz;
+    }
+#endif
+    return 1 << 20;
+}
+
 void reflection(
         const float* __restrict u,
         float* __restrict x,
@@ -43,6 +43,9 @@ double getmillisecs();
 /// get current RSS usage in kB
 size_t get_mem_usage_kb();
 
+/// size of the L2 cache of the current CPU in bytes (1 MiB if unknown)
+size_t get_l2_cache_size();
+
 uint64_t get_cycles();
 
 /***************************************************************************
@@ -16,6 +16,7 @@
 #include <vector>
 
 #include <faiss/utils/approx_topk/approx_topk.h>
+#include <faiss/utils/approx_topk/bucketed.h>
 
 #include <faiss/impl/FaissAssert.h>
 #include <faiss/impl/FaissException.h>
@@ -223,3 +224,57 @@ TEST(testApproxTopk, COMMON) {
 }
 
 //
+
+// measured recall of the bucketed top-k should match the recall target
+TEST(testApproxTopk, BUCKETED_RECALL) {
+    std::default_random_engine rng(123);
+    std::uniform_real_distribution<float> u(0, 1);
+
+    const size_t n = 20000;
+    std::vector<float> dis(n);
+
+    for (size_t k : {10, 100, 500}) {
+        for (float target : {0.8f, 0.95f, 0.99f}) {
+            ApproxTopKConfig config = approx_topk_choose(k, n, target);
+            ASSERT_GE(config.recall, target);
+            ASSERT_GE(config.nbuckets * config.depth, k);
+
+            ApproxTopKBuckets<CMax<float, int64_t>> buckets(config);
+            std::vector<float> heap_dis(k), ref_dis(k);
+            std::vector<int64_t> heap_ids(k), ref_ids(k);
+            size_t nfound = 0;
+            const int nrun = 20;
+            for (int run = 0; run < nrun; run++) {
+                for (auto& v : dis) {
+                    v = u(rng);
+                }
+                buckets.reset();
+                // add in uneven batches
+                for (size_t i = 0; i < n; i += 777) {
+                    size_t i1 = std::min(i + 777, n);
+                    buckets.add(i1 - i, dis.data() + i, nullptr, i);
+                }
+                maxheap_heapify(k, heap_dis.data(), heap_ids.data());
+                buckets.to_heap(k, heap_dis.data(), heap_ids.data());
+
+                maxheap_heapify(k, ref_dis.data(), ref_ids.data());
+                maxheap_addn(
+                        k,
+                        ref_dis.data(),
+                        ref_ids.data(),
+                        dis.data(),
+                        nullptr,
+                        n);
+
+                std::unordered_set<int64_t> ref(
+                        ref_ids.begin(), ref_ids.end());
+                for (auto id : heap_ids) {
+                    nfound += ref.count(id);
+                }
+            }
+            double recall = nfound / double(k * nrun);
+            // the recall is an expectation, allow for some variance
+            EXPECT_GE(recall, target - 0.03);
+        }
+    }
+}
@@ -60,3 +60,56 @@ TEST(BinaryFlat, accuracy) {
         }
     }
 }
+
+TEST(BinaryFlat, hamming_tiles) {
+    // with AVX512 VPOPCNTDQ, the queries are processed by tiles of 8. 13
+    // queries leave a partial tile, compare with the non-tiled search
+    size_t nb = 2000, nq = 13, k = 10;
+    for (size_t ncodes : {8, 32, 40}) {
+        std::vector<uint8_t> xb(nb * ncodes), xq(nq * ncodes);
+        for (auto& v : xb) {
+            v = rand() % 0x100;
+        }
+        for (auto& v : xq) {
+            v = rand() % 0x100;
+        }
+
+        std::vector<int32_t> D(nq * k), refD(nq * k);
+        std::vector<int64_t> I(nq * k), refI(nq * k);
+        std::vector<int32_t> Dmc(nq * k), refDmc(nq * k);
+        std::vector<int64_t> Imc(nq * k), refImc(nq * k);
+
+        size_t min_queries = faiss::hamming_tile_min_queries;
+        faiss::hamming_tile_min_queries = nq + 1;
+        faiss::int_maxheap_array_t refres = {nq, k, refI.data(), refD.data()};
+        faiss::hammings_knn_hc(
+                &refres, xq.data(), xb.data(), nb, ncodes, true);
+        faiss::hammings_knn_mc(
+                xq.data(),
+                xb.data(),
+                nq,
+                nb,
+                k,
+                ncodes,
+                refDmc.data(),
+                refImc.data());
+        faiss::hamming_tile_min_queries = 1;
+        faiss::int_maxheap_array_t res = {nq, k, I.data(), D.data()};
+        faiss::hammings_knn_hc(&res, xq.data(), xb.data(), nb, ncodes, true);
+        faiss::hammings_knn_mc(
+                xq.data(),
+                xb.data(),
+                nq,
+                nb,
+                k,
+                ncodes,
+                Dmc.data(),
+                Imc.data());
+        faiss::hamming_tile_min_queries = min_queries;
+
+        EXPECT_EQ(D, refD);
+        EXPECT_EQ(I, refI);
+        EXPECT_EQ(Dmc, refDmc);
+        EXPECT_EQ(Imc, refImc);
+    }
+}
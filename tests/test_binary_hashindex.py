@@ -208,6 +208,55 @@ class TestKnn(unittest.TestCase):
         self.subtest_result_order(3)
 
 
+class TestMIH(unittest.TestCase):
+    """ multi-index hashing should give exact results """
+
+    def do_test(self, d, m, nb=2000):
+        nq = 50
+        (_, xb, xq) = make_binary_dataset(d, 0, nb, nq)
+        # add some near-duplicates so that the first rings are not empty
+        xb[:nq] = xq
+        xb[:nq, 0] ^= 1
+
+        index_ref = faiss.IndexBinaryFlat(d)
+        index_ref.add(xb)
+        index = faiss.index_binary_factory(d, "BMIH%d" % m)
+        index.add(xb[:nb // 2])
+        index.add(xb[nb // 2:])
+
+        k = 10
+        Dref, Iref = index_ref.search(xq, k)
+        Dnew, Inew = index.search(xq, k)
+        np.testing.assert_array_equal(Dref, Dnew)
+        for i in range(nq):
+            # ids of the results strictly below the k-th distance match
+            sel = Dref[i] < Dref[i, -1]
+            self.assertEqual(set(Iref[i][sel]), set(Inew[i][sel]))
+
+        radius = int(np.median(Dref[:, 2]))
+        lims_ref, Drr, Irr = index_ref.range_search(xq, radius)
+        lims, Dr, Ir = index.range_search(xq, radius)
+        np.testing.assert_array_equal(lims_ref, lims)
+        for i in range(nq):
+            l0, l1 = lims[i], lims[i + 1]
+            self.assertEqual(
+                set(zip(Irr[l0:l1], Drr[l0:l1])),
+                set(zip(Ir[l0:l1], Dr[l0:l1])))
+
+        # test serialization
+        index2 = faiss.deserialize_index_binary(
+            faiss.serialize_index_binary(index))
+        D2, I2 = index2.search(xq, k)
+        np.testing.assert_array_equal(Inew, I2)
+        np.testing.assert_array_equal(Dnew, D2)
+
+    def test_64bit(self):
+        self.do_test(64, 4)
+
+    def test_128bit(self):
+        self.do_test(128, 6)
+
+
 
 
 """
@@ -65,6 +65,45 @@ class TestPCA(unittest.TestCase):
         y = pca.apply(x)
         self.assertTrue(np.all(np.isfinite(y)))
 
+    def test_pca_accumulator(self):
+        d = 64
+        n = 3000
+        rs = np.random.RandomState(123)
+        x = rs.randn(n, d).astype('float32')
+        x *= 10 / np.arange(1, d + 1).astype('float32')
+
+        pca_ref = faiss.PCAMatrix(d, 10)
+        pca_ref.train(x)
+        y_ref = pca_ref.apply(x)
+
+        # accumulate by chunks on 2 accumulators and merge
+        acc = faiss.CovarianceAccumulator(d)
+        acc2 = faiss.CovarianceAccumulator(d)
+        for i0 in range(0, 1000, 300):
+            xi = x[i0:min(i0 + 300, 1000)]
+            acc.add(len(xi), faiss.swig_ptr(xi))
+        acc2.add(n - 1000, faiss.swig_ptr(x[1000:]))
+        acc.merge(acc2)
+        self.assertEqual(acc.n, n)
+
+        pca = faiss.PCAMatrix(d, 10)
+        pca.train_from_accumulator(acc)
+        np.testing.assert_allclose(
+            faiss.vector_to_array(pca.eigenvalues),
+            faiss.vector_to_array(pca_ref.eigenvalues), rtol=1e-4)
+        # eigenvectors are defined up to the sign
+        y = pca.apply(x)
+        np.testing.assert_allclose(
+            np.abs(y), np.abs(y_ref), rtol=1e-3, atol=1e-3)
+
+        # the randomized method should capture the same variance
+        pca_rand = faiss.PCAMatrix(d, 10)
+        pca_rand.randomized_niter = 4
+        pca_rand.train_from_accumulator(acc)
+        y_rand = pca_rand.apply(x)
+        var_ref = (y_ref ** 2).sum()
+        self.assertGreater((y_rand ** 2).sum(), var_ref * 0.999)
+
 
 class TestRevSwigPtr(unittest.TestCase):
 
@@ -161,6 +200,51 @@ class TestOrthognalReconstruct(unittest.TestCase):
             self.assertFalse('should do an exception')
 
 
+class TestHadamardRotation(unittest.TestCase):
+
+    def test_hadamard(self):
+        d = 20
+        hr = faiss.HadamardRotation(d, 2)
+        self.assertEqual(hr.d_out, 32)
+        rs = np.random.RandomState(123)
+        x = rs.rand(30, d).astype('float32')
+        xt = hr.apply_py(x)
+
+        # compare with the explicit matrix
+        H = np.ones((1, 1))
+        while H.shape[0] < 32:
+            H = np.block([[H, H], [H, -H]])
+        H /= np.sqrt(32)
+        signs = faiss.vector_to_array(hr.signs).reshape(2, 32)
+        xref = np.hstack((x, np.zeros((30, 12))))
+        for r in range(2):
+            xref = (xref * signs[r]) @ H.T
+        np.testing.assert_allclose(xt, xref, atol=1e-5)
+
+        # the norms are preserved and the transform can be reversed
+        np.testing.assert_allclose(
+            (x ** 2).sum(1), (xt ** 2).sum(1), rtol=1e-5)
+        np.testing.assert_allclose(x, hr.reverse_transform(xt), atol=1e-5)
+
+    def test_factory_and_io(self):
+        d = 24
+        xt, xb, xq = get_dataset_2(d, 1000, 100, 10)
+        index = faiss.index_factory(d, "HR,Flat")
+        index.train(xt)
+        index.add(xb)
+        D, I = index.search(xq, 5)
+        # the rotation preserves distances
+        Dref, Iref = faiss.knn(xq, xb, 5)
+        np.testing.assert_array_equal(I, Iref)
+
+        index2 = faiss.deserialize_index(faiss.serialize_index(index))
+        D2, I2 = index2.search(xq, 5)
+        np.testing.assert_array_equal(I, I2)
+        index3 = faiss.clone_index(index)
+        D3, I3 = index3.search(xq, 5)
+        np.testing.assert_array_equal(I, I3)
+
+
 class TestMAdd(unittest.TestCase):
 
     def test_1(self):
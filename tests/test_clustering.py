@@ -175,6 +175,57 @@ class TestClustering(unittest.TestCase):
         km.train(xt)
         assert list(km.obj) == [st['obj'] for st in km.iteration_stats]
 
+    def test_bounded_assignment(self):
+        d = 16
+        k = 64
+        xt, _, _ = get_dataset_2(d, 5000, 0, 0)
+        km = faiss.Kmeans(d, k, niter=10)
+        km.train(xt)
+        km2 = faiss.Kmeans(d, k, niter=10, bounded_assignment=True)
+        km2.train(xt)
+        # same result up to floating-point rounding
+        np.testing.assert_allclose(km.obj, km2.obj, rtol=1e-4)
+        skipped = [st['ndis_skipped'] for st in km2.iteration_stats]
+        self.assertEqual(skipped[0], 0)
+        self.assertGreater(skipped[-1], 0)
+
+    def test_minibatch(self):
+        d = 32
+        k = 50
+        xt, xb, xq = get_dataset_2(d, 10000, 0, 0)
+
+        def objective(centroids):
+            D, _ = faiss.knn(xt, centroids, 1)
+            return D.sum()
+
+        clus = faiss.Clustering(d, k)
+        clus.max_points_per_centroid = 10000
+        index = faiss.IndexFlatL2(d)
+        clus.train(xt, index)
+        centroids = faiss.vector_to_array(clus.centroids).reshape(k, d)
+        obj_ref = objective(centroids)
+
+        clus = faiss.Clustering(d, k)
+        clus.minibatch_size = 1000
+        clus.minibatch_niter = 50
+        index = faiss.IndexFlatL2(d)
+        src = faiss.ClusteringArraySource(len(xt), d, faiss.swig_ptr(xt))
+        clus.train_minibatch(src, index)
+        self.assertEqual(clus.iteration_stats.size(), 50)
+        centroids = faiss.vector_to_array(clus.centroids).reshape(k, d)
+        self.assertEqual(index.ntotal, k)
+        # the mini-batch objective is within a few % of the full k-means
+        self.assertLess(objective(centroids), obj_ref * 1.05)
+
+        # a single pass over the data stops at the end of the source
+        reader = faiss.VectorIOReader()
+        faiss.copy_array_to_vector(xt.ravel().view('uint8'), reader.data)
+        src = faiss.ClusteringIOReaderSource(reader, d)
+        clus = faiss.Clustering(d, k)
+        clus.minibatch_size = 1000
+        clus.train_minibatch(src, faiss.IndexFlatL2(d))
+        self.assertEqual(clus.iteration_stats.size(), 10)
+
 
 class TestCompositeClustering(unittest.TestCase):
 
@@ -253,6 +304,42 @@ class TestCompositeClustering(unittest.TestCase):
         self.assertLess(kmeans2.obj[-1], kmeans.obj[-1])
 
 
+class TestHierarchicalClustering(unittest.TestCase):
+
+    def test_hierarchical(self):
+        d = 16
+        k = 100
+        xt, _, _ = get_dataset_2(d, 10000, 0, 0)
+
+        def objective(clus):
+            centroids = faiss.vector_to_array(clus.centroids).reshape(k, d)
+            D, I = faiss.knn(xt, centroids, 1)
+            return D.sum(), np.bincount(I.ravel(), minlength=k)
+
+        km = faiss.Kmeans(d, k, niter=20, max_points_per_centroid=1000)
+        km.train(xt)
+        D, _ = km.index.search(xt, 1)
+        obj_ref = D.sum()
+
+        clus = faiss.HierarchicalClustering(d, k)
+        clus.niter = 20
+        clus.train(len(xt), faiss.swig_ptr(xt))
+        obj, sizes = objective(clus)
+        self.assertLess(obj, obj_ref * 1.05)
+        self.assertEqual(sizes.sum(), len(xt))
+
+        clus = faiss.HierarchicalClustering(d, k)
+        clus.niter = 20
+        clus.max_size_factor = 1.5
+        clus.train(len(xt), faiss.swig_ptr(xt))
+        stats = clus.iteration_stats
+        n = stats.size()
+        # the balancing stage is at the end of the stats
+        self.assertLess(
+            stats.at(n - 1).imbalance_factor,
+            stats.at(n - clus.balance_niter).imbalance_factor)
+
+
 class TestClustering1D(unittest.TestCase):
 
     def evaluate_obj(self, centroids, x):
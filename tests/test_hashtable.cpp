@@ -0,0 +1,86 @@
+/**
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <algorithm>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <faiss/utils/sorting.h>
+
+TEST(Hashtable, int64_to_int64) {
+    // random adds, overwrites and removes, checked against std::unordered_map
+    std::mt19937 rng(123);
+    std::uniform_int_distribution<int64_t> key_distrib(0, 5000);
+    faiss::HashtableInt64ToInt64 tab;
+    std::unordered_map<int64_t, int64_t> ref;
+
+    for (int round = 0; round < 20; round++) {
+        std::vector<int64_t> keys, vals;
+        for (int i = 0; i < 500; i++) {
+            int64_t key = key_distrib(rng);
+            if (ref.count(key) || std::find(keys.begin(), keys.end(), key) !=
+                        keys.end()) {
+                continue;
+            }
+            keys.push_back(key);
+            vals.push_back(rng());
+            ref[key] = vals.back();
+        }
+        tab.add(keys.size(), keys.data(), vals.data());
+        for (int i = 0; i < 100; i++) {
+            int64_t key = key_distrib(rng);
+            tab.set(key, round);
+            ref[key] = round;
+        }
+        for (int i = 0; i < 300; i++) {
+            int64_t key = key_distrib(rng);
+            EXPECT_EQ(tab.remove(key), ref.erase(key) == 1);
+        }
+        EXPECT_EQ(tab.size(), ref.size());
+
+        std::vector<int64_t> all_keys(5001), found(5001);
+        for (int64_t key = 0; key <= 5000; key++) {
+            all_keys[key] = key;
+        }
+        tab.lookup(all_keys.size(), all_keys.data(), found.data());
+        for (int64_t key = 0; key <= 5000; key++) {
+            auto it = ref.find(key);
+            int64_t expected = it == ref.end() ? -1 : it->second;
+            EXPECT_EQ(found[key], expected);
+            EXPECT_EQ(tab.lookup(key), expected);
+        }
+    }
+}
+
+TEST(Hashtable, int64_to_int64_large_batch) {
+    // batches above the parallel threshold are inserted by buckets
+    size_t n = 100000;
+    std::vector<int64_t> keys(n), vals(n), found(n);
+    for (size_t i = 0; i < n; i++) {
+        keys[i] = i * 7919 + 1;
+        vals[i] = i;
+    }
+    faiss::HashtableInt64ToInt64 tab;
+    tab.add(n / 2, keys.data(), vals.data());
+    tab.add(n - n / 2, keys.data() + n / 2, vals.data() + n / 2);
+    EXPECT_EQ(tab.size(), n);
+    tab.lookup(n, keys.data(), found.data());
+    EXPECT_EQ(found, vals);
+
+    // overwrite all values in one batch
+    for (size_t i = 0; i < n; i++) {
+        vals[i] = -2 - i;
+    }
+    tab.add(n, keys.data(), vals.data());
+    EXPECT_EQ(tab.size(), n);
+    tab.lookup(n, keys.data(), found.data());
+    EXPECT_EQ(found, vals);
+    EXPECT_EQ(tab.lookup(0), -1);
+}
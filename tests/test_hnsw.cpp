@@ -14,6 +14,7 @@
 #include <unordered_set>
 #include <vector>
 
+#include <faiss/IndexHNSW.h>
 #include <faiss/impl/HNSW.h>
 
 int reference_pop_min(faiss::HNSW::MinimaxHeap& heap, float* vmin_out) {
@@ -190,3 +191,52 @@ TEST(HNSW, Test_popmin_infinite_distances) {
         }
     }
 }
+
+TEST(HNSW, single_query) {
+    // queries searched one at a time reuse the per-thread VisitedTable
+    constexpr int d = 16, nb = 2000, nq = 300, k = 5;
+    std::mt19937 rng;
+    std::uniform_real_distribution<float> distrib;
+    std::vector<float> xb(nb * d), xq(nq * d);
+    for (auto& v : xb) {
+        v = distrib(rng);
+    }
+    for (auto& v : xq) {
+        v = distrib(rng);
+    }
+
+    faiss::IndexHNSWFlat index(d, 16);
+    index.add(nb, xb.data());
+
+    std::vector<float> refD(nq * k), D(nq * k);
+    std::vector<faiss::idx_t> refI(nq * k), I(nq * k);
+    index.search(nq, xq.data(), k, refD.data(), refI.data());
+    // more queries than the 250 values of VisitedTable::visno
+    for (int i = 0; i < nq; i++) {
+        index.search(
+                1, xq.data() + i * d, k, D.data() + i * k, I.data() + i * k);
+    }
+    EXPECT_EQ(I, refI);
+    EXPECT_EQ(D, refD);
+
+    // index too large for the per-thread table
+    size_t cache_size = faiss::hnsw_visited_table_cache_size;
+    faiss::hnsw_visited_table_cache_size = nb - 1;
+    for (int i = 0; i < nq; i++) {
+        index.search(
+                1, xq.data() + i * d, k, D.data() + i * k, I.data() + i * k);
+    }
+    faiss::hnsw_visited_table_cache_size = cache_size;
+    EXPECT_EQ(I, refI);
+    EXPECT_EQ(D, refD);
+
+    // the per-thread distance computer follows the additions to the index
+    index.add(nb, xq.data());
+    index.search(nq, xq.data(), k, refD.data(), refI.data());
+    for (int i = 0; i < nq; i++) {
+        index.search(
+                1, xq.data() + i * d, k, D.data() + i * k, I.data() + i * k);
+    }
+    EXPECT_EQ(I, refI);
+    EXPECT_EQ(D, refD);
+}
@@ -77,9 +77,13 @@ class TestIndexFlat(unittest.TestCase):
         if small:
             faiss.cvar.distance_compute_blas_query_bs = 16
             faiss.cvar.distance_compute_blas_database_bs = 12
+            faiss.cvar.distance_compute_fused_query_bs = 16
+            faiss.cvar.distance_compute_fused_database_bs = 12
         else:
             faiss.cvar.distance_compute_blas_query_bs = 4096
             faiss.cvar.distance_compute_blas_database_bs = 1024
+            faiss.cvar.distance_compute_fused_query_bs = 128
+            faiss.cvar.distance_compute_fused_database_bs = 512
 
     def test_with_blas(self):
         self.set_blas_blocks(small=True)
@@ -109,6 +113,27 @@ class TestIndexFlat(unittest.TestCase):
     def test_with_blas_reservoir_ip(self):
         self.do_test(200, faiss.METRIC_INNER_PRODUCT, k=150)
 
+    def test_with_blas_small_blocks_reservoir(self):
+        self.set_blas_blocks(small=True)
+        self.do_test(200, k=150)
+        self.set_blas_blocks(small=False)
+
+    def test_noblas_buffered(self):
+        self.do_test(10, k=300)
+
+    def test_with_blas_buffered(self):
+        self.do_test(200, k=300)
+
+    def test_with_blas_small_blocks_buffered_ip(self):
+        self.set_blas_blocks(small=True)
+        self.do_test(200, faiss.METRIC_INNER_PRODUCT, k=300)
+        self.set_blas_blocks(small=False)
+
+    def test_with_blas_k1_ip(self):
+        self.set_blas_blocks(small=True)
+        self.do_test(200, faiss.METRIC_INNER_PRODUCT, k=1)
+        self.set_blas_blocks(small=False)
+
 
 class TestIndexFlatL2(unittest.TestCase):
     def test_indexflat_l2_sync_norms_1(self):
@@ -365,7 +390,8 @@ class TestScalarQuantizer(unittest.TestCase):
 
         nok = {}
 
-        for qname in "QT_4bit QT_4bit_uniform QT_8bit QT_8bit_uniform QT_fp16".split():
+        for qname in ("QT_4bit QT_4bit_uniform QT_8bit QT_8bit_uniform "
+                      "QT_fp16 QT_bf16 QT_8bit_sym").split():
             qtype = getattr(faiss.ScalarQuantizer, qname)
             index = faiss.IndexScalarQuantizer(d, qtype, faiss.METRIC_L2)
             index.train(xt)
@@ -380,6 +406,152 @@ class TestScalarQuantizer(unittest.TestCase):
         self.assertGreaterEqual(nok['QT_8bit'], nok['QT_8bit_uniform'])
         self.assertGreaterEqual(nok['QT_4bit'], nok['QT_4bit_uniform'])
         self.assertGreaterEqual(nok['QT_fp16'], nok['QT_8bit'])
+        self.assertGreaterEqual(nok['QT_bf16'], nok['QT_8bit'])
+        self.assertGreaterEqual(nok['QT_8bit_sym'], nok['QT_4bit'])
+
+    def do_test_query_quantization(self, qname, metric):
+        d = 32
+        nt = 2500
+        nq = 200
+        nb = 5000
+
+        (xt, xb, xq) = get_dataset(d, nb, nt, nq)
+        qtype = getattr(faiss.ScalarQuantizer, qname)
+
+        quantizer = faiss.IndexFlat(d, metric)
+        for index in (faiss.IndexScalarQuantizer(d, qtype, metric),
+                      faiss.IndexIVFScalarQuantizer(
+                          quantizer, d, 16, qtype, metric)):
+            index.train(xt)
+            index.add(xb)
+            index.nprobe = 4
+            Dref, Iref = index.search(xq, 10)
+            index.sq.query_quantization = True
+            Dnew, Inew = index.search(xq, 10)
+            # the distances are approximated, so the result lists
+            # differ slightly
+            ninter = faiss.eval_intersection(Iref, Inew)
+            self.assertGreater(ninter, nq * 10 * 0.9)
+            np.testing.assert_allclose(
+                Dref[:, 0], Dnew[:, 0], rtol=0.02, atol=0.02)
+
+    def test_query_quantization_L2(self):
+        self.do_test_query_quantization("QT_8bit", faiss.METRIC_L2)
+
+    def test_query_quantization_uniform_L2(self):
+        self.do_test_query_quantization("QT_8bit_uniform", faiss.METRIC_L2)
+
+    def test_query_quantization_IP(self):
+        self.do_test_query_quantization(
+            "QT_8bit", faiss.METRIC_INNER_PRODUCT)
+
+    def test_query_quantization_nonuniform_ranges(self):
+        # the ranges span 4 orders of magnitude, the per-dimension weights
+        # of the small ranges must not be rounded to 0
+        d = 40
+        (xt, xb, xq) = get_dataset(d, 2000, 2000, 20)
+        scales = 10 ** (-4 * np.arange(d) / d)
+        xt, xb, xq = [(x * scales).astype('float32') for x in (xt, xb, xq)]
+        index = faiss.IndexScalarQuantizer(
+            d, faiss.ScalarQuantizer.QT_8bit, faiss.METRIC_L2)
+        index.train(xt)
+        index.add(xb)
+        Dref, Iref = index.search(xq, 10)
+        index.sq.query_quantization = True
+        Dnew, Inew = index.search(xq, 10)
+        np.testing.assert_allclose(Dref, Dnew, rtol=0.02)
+
+    def do_test_blocked(self, qname, metric, bbs):
+        d = 20
+        nt = 1000
+        nq = 50
+        nb = 1000
+
+        (xt, xb, xq) = get_dataset(d, nb, nt, nq)
+        qtype = getattr(faiss.ScalarQuantizer, qname)
+
+        index = faiss.IndexScalarQuantizer(d, qtype, metric)
+        index.train(xt)
+        index.add(xb)
+        Dref, Iref = index.search(xq, 10)
+
+        index2 = faiss.IndexScalarQuantizerBlocked(index, bbs)
+        D, I = index2.search(xq, 10)
+        np.testing.assert_allclose(Dref, D, rtol=1e-4, atol=1e-4)
+        self.assertLessEqual((Iref != I).sum(), 4)
+
+        # same result when adding by chunks
+        index3 = faiss.IndexScalarQuantizerBlocked(d, qtype, metric, bbs)
+        index3.train(xt)
+        index3.add(xb[:300])
+        index3.add(xb[300:])
+        D3, I3 = index3.search(xq, 10)
+        np.testing.assert_array_equal(D, D3)
+        np.testing.assert_array_equal(I, I3)
+
+        np.testing.assert_array_equal(
+            index.reconstruct_n(0, nb), index2.reconstruct_n(0, nb))
+
+        # serialization
+        index4 = faiss.deserialize_index(faiss.serialize_index(index2))
+        D4, I4 = index4.search(xq, 10)
+        np.testing.assert_array_equal(D, D4)
+        np.testing.assert_array_equal(I, I4)
+
+    def test_blocked_8bit(self):
+        self.do_test_blocked("QT_8bit", faiss.METRIC_L2, 32)
+
+    def test_blocked_8bit_uniform_IP(self):
+        self.do_test_blocked(
+            "QT_8bit_uniform", faiss.METRIC_INNER_PRODUCT, 64)
+
+    def test_blocked_8bit_sym(self):
+        self.do_test_blocked("QT_8bit_sym", faiss.METRIC_L2, 32)
+
+    def test_blocked_4bit(self):
+        # not a multiple of 32, and generic kernel
+        self.do_test_blocked("QT_4bit", faiss.METRIC_L2, 20)
+
+    def test_blocked_remove(self):
+        d = 20
+        (xt, xb, xq) = get_dataset(d, 500, 1000, 0)
+        index = faiss.IndexScalarQuantizerBlocked(
+            d, faiss.ScalarQuantizer.QT_8bit)
+        index.train(xt)
+        index.add(xb)
+        recons = index.reconstruct_n(0, 500)
+        index.remove_ids(np.arange(100, 150))
+        self.assertEqual(index.ntotal, 450)
+        np.testing.assert_array_equal(
+            index.reconstruct_n(0, 450),
+            np.vstack((recons[:100], recons[150:])))
+
+    def test_blocked_permute(self):
+        d = 20
+        (xt, xb, xq) = get_dataset(d, 500, 1000, 0)
+        index = faiss.IndexScalarQuantizerBlocked(
+            d, faiss.ScalarQuantizer.QT_8bit, faiss.METRIC_L2, 32)
+        index.train(xt)
+        index.add(xb)
+        recons = index.reconstruct_n(0, 500)
+        perm = np.random.RandomState(123).permutation(500).astype('int64')
+        index.permute_entries(faiss.swig_ptr(perm))
+        np.testing.assert_array_equal(
+            index.reconstruct_n(0, 500), recons[perm])
+
+    def test_blocked_read_invalid_bbs(self):
+        d = 20
+        (xt, xb, xq) = get_dataset(d, 100, 1000, 0)
+        index = faiss.IndexScalarQuantizerBlocked(
+            d, faiss.ScalarQuantizer.QT_8bit, faiss.METRIC_L2, 32)
+        index.train(xt)
+        index.add(xb)
+        index.bbs = 0
+        buf = faiss.serialize_index(index)
+        self.assertRaises(RuntimeError, faiss.deserialize_index, buf)
+        index.bbs = 16
+        buf = faiss.serialize_index(index)
+        self.assertRaises(RuntimeError, faiss.deserialize_index, buf)
 
 
 class TestRangeSearch(unittest.TestCase):
@@ -370,6 +370,56 @@ class TestTransformChain(unittest.TestCase):
 
         assert np.all(I == I2)
 
+    def test_chain_by_blocks(self):
+        # the transforms are applied by blocks, check that the result
+        # is the same as without blocking
+        d = 32
+        ds = SyntheticDataset(d, 2000, 1000, 100)
+        index = faiss.index_factory(d, "PCA24,RR16,IVF10,PQ4")
+        index.train(ds.get_train())
+
+        bs = faiss.cvar.index_pretransform_bs
+        try:
+            faiss.cvar.index_pretransform_bs = 0
+            index_ref = faiss.clone_index(index)
+            index_ref.add_with_ids(ds.get_database(), np.arange(ds.nb) * 2)
+            Dref, Iref = index_ref.search(ds.get_queries(), 5)
+            codes_ref = index.sa_encode(ds.get_database())
+
+            faiss.cvar.index_pretransform_bs = 64
+            index.add_with_ids(ds.get_database(), np.arange(ds.nb) * 2)
+            D, I = index.search(ds.get_queries(), 5)
+            codes = index.sa_encode(ds.get_database())
+        finally:
+            faiss.cvar.index_pretransform_bs = bs
+
+        np.testing.assert_array_equal(Iref, I)
+        np.testing.assert_array_equal(Dref, D)
+        np.testing.assert_array_equal(codes_ref, codes)
+
+    def test_chain_by_blocks_no_ids(self):
+        # blocked add_with_ids with a null ids pointer
+        d = 32
+        ds = SyntheticDataset(d, 2000, 1000, 100)
+        index = faiss.index_factory(d, "PCA24,IVF10,Flat")
+        index.train(ds.get_train())
+        index_ref = faiss.clone_index(index)
+        index_ref.add(ds.get_database())
+        Dref, Iref = index_ref.search(ds.get_queries(), 5)
+
+        bs = faiss.cvar.index_pretransform_bs
+        try:
+            faiss.cvar.index_pretransform_bs = 64
+            xb = ds.get_database()
+            index.add_with_ids_c(ds.nb, faiss.swig_ptr(xb), None)
+            D, I = index.search(ds.get_queries(), 5)
+        finally:
+            faiss.cvar.index_pretransform_bs = bs
+
+        self.assertEqual(index.ntotal, ds.nb)
+        np.testing.assert_array_equal(Iref, I)
+        np.testing.assert_array_equal(Dref, D)
+
 
 @unittest.skipIf(platform.system() == 'Windows', \
                  'Mmap not supported on Windows.')
@@ -49,6 +49,124 @@ class TestIOVariants(unittest.TestCase):
                 os.unlink(fname)
 
 
+class TestSectionedIO(unittest.TestCase):
+
+    def do_test(self, factory_string):
+        d, n = 32, 5000
+        rs = np.random.RandomState(123)
+        x = rs.rand(n, d).astype('float32')
+        index = faiss.index_factory(d, factory_string)
+        index.train(x)
+        index.add(x)
+        Dref, Iref = index.search(x[:20], 5)
+
+        fd, fname = tempfile.mkstemp()
+        os.close(fd)
+        try:
+            faiss.write_index(index, fname, faiss.IO_FLAG_SECTIONED)
+            index2 = faiss.read_index(fname)
+            D, I = index2.search(x[:20], 5)
+            np.testing.assert_array_equal(I, Iref)
+            np.testing.assert_array_equal(D, Dref)
+
+            # re-serializing to the old format gives the same bytes
+            np.testing.assert_array_equal(
+                faiss.serialize_index(index2), faiss.serialize_index(index))
+
+            # damage the last section
+            with open(fname, 'rb') as f:
+                data = bytearray(f.read())
+            data[-10] ^= 1
+            with open(fname, 'wb') as f:
+                f.write(data)
+            self.assertRaises(RuntimeError, faiss.read_index, fname)
+        finally:
+            if os.path.exists(fname):
+                os.unlink(fname)
+
+    def test_flat(self):
+        self.do_test("Flat")
+
+    def test_ivf(self):
+        self.do_test("IVF20,PQ8")
+
+    def test_hnsw(self):
+        self.do_test("HNSW16,SQ8")
+
+    def test_ivfpq_large_quantizer(self):
+        # the coarse centroids (128 KB) are stored in a section, the
+        # precomputed tables must be built once it is read
+        self.do_test("IVF1024,PQ8")
+
+    def test_ivfpq_fastscan_large_quantizer(self):
+        self.do_test("IVF1024,PQ8x4fs")
+
+    def test_truncated_buffer(self):
+        d, n = 32, 5000
+        x = np.random.RandomState(123).rand(n, d).astype('float32')
+        index = faiss.IndexFlatL2(d)
+        index.add(x)
+        writer = faiss.VectorIOWriter()
+        faiss.write_index(index, writer, faiss.IO_FLAG_SECTIONED)
+        data = faiss.vector_to_array(writer.data)
+        reader = faiss.VectorIOReader()
+        faiss.copy_array_to_vector(data[:-1000], reader.data)
+        self.assertRaises(RuntimeError, faiss.read_index, reader)
+
+
+class TestCompressedIO(unittest.TestCase):
+
+    def test_roundtrip(self):
+        d, n = 32, 5000
+        rs = np.random.RandomState(123)
+        x = rs.rand(n, d).astype('float32')
+        index = faiss.index_factory(d, "IVF20,SQ4")
+        index.train(x)
+        index.add(x)
+        ref = faiss.serialize_index(index)
+
+        writer = faiss.VectorIOWriter()
+        cw = faiss.CompressedIOWriter(writer, None, 1 << 14)
+        faiss.write_index(index, cw)
+        cw.finish()
+        data = faiss.vector_to_array(writer.data)
+        self.assertLess(data.size, ref.size)
+
+        reader = faiss.VectorIOReader()
+        faiss.copy_array_to_vector(data, reader.data)
+        cr = faiss.CompressedIOReader(reader)
+        index2 = faiss.read_index(cr)
+        np.testing.assert_array_equal(faiss.serialize_index(index2), ref)
+
+        # jump into the middle of the stream
+        reader.rp = 0
+        cr = faiss.CompressedIOReader(reader)
+        cr.seek(ref.size // 2)
+        buf = np.zeros(100, dtype='uint8')
+        cr(faiss.swig_ptr(buf), 1, 100)
+        np.testing.assert_array_equal(buf, ref[ref.size // 2:][:100])
+
+    @unittest.skipIf(not os.path.exists("/dev/full"), "needs /dev/full")
+    def test_finish_error(self):
+        d, n = 32, 500
+        x = np.random.RandomState(123).rand(n, d).astype('float32')
+        index = faiss.IndexFlatL2(d)
+        index.add(x)
+
+        # explicit finish reports the write error
+        writer = faiss.FileIOWriter("/dev/full")
+        cw = faiss.CompressedIOWriter(writer, None, 1 << 14)
+        faiss.write_index(index, cw)
+        self.assertRaises(RuntimeError, cw.finish)
+        del cw, writer
+
+        # the destructor must not throw
+        writer = faiss.FileIOWriter("/dev/full")
+        cw = faiss.CompressedIOWriter(writer, None, 1 << 14)
+        faiss.write_index(index, cw)
+        del cw, writer
+
+
 class TestCallbacks(unittest.TestCase):
 
     def do_write_callback(self, bsz):
@@ -12,12 +12,17 @@
 #include <cstring>
 #include <map>
 #include <random>
+#include <unordered_map>
 
 #include <gtest/gtest.h>
 
 #include <faiss/IndexFlat.h>
 #include <faiss/IndexIVFFlat.h>
+#include <faiss/IndexIVFPQ.h>
+#include <faiss/IndexScalarQuantizer.h>
 #include <faiss/impl/FaissAssert.h>
+#include <faiss/impl/IDSelector.h>
+#include <faiss/impl/io.h>
 #include <faiss/index_io.h>
 
 namespace {
@@ -240,3 +245,211 @@ TEST(IVF, list_context) {
                 << "should return the query vector";
     }
 }
+
+TEST(IVF, single_query) {
+    // queries searched one at a time use the per-thread coarse buffers,
+    // also when the quantizer is itself an IVF index
+    constexpr int d = 16, nb = 5000, nq = 20, k = 5;
+    std::mt19937 rng;
+    std::uniform_real_distribution<float> distrib;
+    std::vector<float> xb(nb * d), xq(nq * d);
+    for (auto& v : xb) {
+        v = distrib(rng);
+    }
+    for (auto& v : xq) {
+        v = distrib(rng);
+    }
+
+    faiss::IndexFlatL2 coarse_quantizer(d);
+    faiss::IndexIVFFlat quantizer(&coarse_quantizer, d, 4);
+    quantizer.nprobe = 2;
+    quantizer.train(nb, xb.data());
+    faiss::IndexIVFFlat index(&quantizer, d, 64);
+    index.nprobe = 8;
+    index.train(nb, xb.data());
+    index.add(nb, xb.data());
+
+    std::vector<float> refD(nq * k), D(nq * k);
+    std::vector<faiss::idx_t> refI(nq * k), I(nq * k);
+    index.search(nq, xq.data(), k, refD.data(), refI.data());
+    for (int i = 0; i < nq; i++) {
+        index.search(
+                1, xq.data() + i * d, k, D.data() + i * k, I.data() + i * k);
+    }
+    EXPECT_EQ(I, refI);
+    EXPECT_EQ(D, refD);
+}
+
+namespace {
+
+// compare the queries searched one at a time with a batch search
+void compare_single_queries(
+        const faiss::Index& index,
+        int nq,
+        const float* xq,
+        int k) {
+    std::vector<float> refD(nq * k), D(nq * k);
+    std::vector<faiss::idx_t> refI(nq * k), I(nq * k);
+    index.search(nq, xq, k, refD.data(), refI.data());
+    for (int i = 0; i < nq; i++) {
+        index.search(
+                1, xq + i * index.d, k, D.data() + i * k, I.data() + i * k);
+    }
+    EXPECT_EQ(I, refI);
+    // the batch computes the coarse distances with BLAS
+    for (int i = 0; i < nq * k; i++) {
+        EXPECT_NEAR(D[i], refD[i], 1e-5);
+    }
+}
+
+} // namespace
+
+TEST(IVF, single_query_cached_scanner) {
+    // the scanners kept between single queries are rebuilt when the
+    // index or the search fields that they copy change
+    constexpr int d = 16, nb = 5000, nq = 20, k = 5;
+    std::mt19937 rng;
+    std::uniform_real_distribution<float> distrib;
+    std::vector<float> xb(nb * d), xq(nq * d);
+    for (auto& v : xb) {
+        v = distrib(rng);
+    }
+    for (auto& v : xq) {
+        v = distrib(rng);
+    }
+
+    faiss::IndexFlatL2 quantizer(d);
+    faiss::IndexIVFPQ ivfpq(&quantizer, d, 32, 4, 8);
+    faiss::IndexIVFScalarQuantizer ivfsq(
+            &quantizer, d, 32, faiss::ScalarQuantizer::QT_8bit);
+    for (faiss::IndexIVF* index :
+         std::initializer_list<faiss::IndexIVF*>{&ivfpq, &ivfsq}) {
+        index->nprobe = 4;
+        index->train(nb, xb.data());
+        index->add(nb, xb.data());
+        compare_single_queries(*index, nq, xq.data(), k);
+    }
+
+    ivfpq.polysemous_ht = 20;
+    compare_single_queries(ivfpq, nq, xq.data(), k);
+    ivfpq.polysemous_ht = 0;
+    ivfpq.use_precomputed_table = -1;
+    compare_single_queries(ivfpq, nq, xq.data(), k);
+
+    ivfsq.sq.query_quantization = true;
+    compare_single_queries(ivfsq, nq, xq.data(), k);
+
+    compare_single_queries(ivfpq, nq, xq.data(), k);
+
+    // indexes created at the same address do not reuse the scanner
+    for (auto qtype :
+         {faiss::ScalarQuantizer::QT_8bit, faiss::ScalarQuantizer::QT_4bit}) {
+        faiss::IndexIVFScalarQuantizer index(&quantizer, d, 32, qtype);
+        index.nprobe = 4;
+        index.train(nb, xb.data());
+        index.add(nb, xb.data());
+        compare_single_queries(index, nq, xq.data(), k);
+    }
+}
+
+TEST(IVF, scanner_distances_to_codes) {
+    // the batched distances are those of distance_to_code
+    constexpr int d = 16, nb = 5000, nq = 5;
+    std::mt19937 rng;
+    std::uniform_real_distribution<float> distrib;
+    std::vector<float> xb(nb * d), xq(nq * d);
+    for (auto& v : xb) {
+        v = distrib(rng);
+    }
+    for (auto& v : xq) {
+        v = distrib(rng);
+    }
+
+    for (faiss::MetricType metric :
+         {faiss::METRIC_L2, faiss::METRIC_INNER_PRODUCT}) {
+        faiss::IndexFlat quantizer(d, metric);
+        std::vector<std::unique_ptr<faiss::IndexIVF>> indexes;
+        indexes.emplace_back(
+                new faiss::IndexIVFFlat(&quantizer, d, 16, metric));
+        indexes.emplace_back(
+                new faiss::IndexIVFPQ(&quantizer, d, 16, 4, 8, metric));
+        indexes.emplace_back(new faiss::IndexIVFScalarQuantizer(
+                &quantizer, d, 16, faiss::ScalarQuantizer::QT_8bit, metric));
+        for (auto& index : indexes) {
+            index->train(nb, xb.data());
+            index->add(nb, xb.data());
+            std::unique_ptr<faiss::InvertedListScanner> scanner(
+                    index->get_InvertedListScanner());
+            for (int i = 0; i < nq; i++) {
+                scanner->set_query(xq.data() + i * d);
+                for (faiss::idx_t list_no = 0; list_no < 16; list_no++) {
+                    scanner->set_list(list_no, 0.5);
+                    size_t list_size = index->invlists->list_size(list_no);
+                    faiss::InvertedLists::ScopedCodes codes(
+                            index->invlists, list_no);
+                    std::vector<float> dis(list_size);
+                    scanner->distances_to_codes(
+                            list_size, codes.get(), dis.data());
+                    for (size_t j = 0; j < list_size; j++) {
+                        float ref = scanner->distance_to_code(
+                                codes.get() + j * index->code_size);
+                        EXPECT_NEAR(dis[j], ref, 1e-5);
+                    }
+                }
+            }
+        }
+    }
+}
+
+TEST(IVF, direct_map_hashtable) {
+    constexpr int d = 8, nb = 3000;
+    std::mt19937 rng;
+    std::uniform_real_distribution<float> distrib;
+    std::vector<float> xb(nb * d);
+    for (auto& v : xb) {
+        v = distrib(rng);
+    }
+    std::vector<faiss::idx_t> ids(nb);
+    for (int i = 0; i < nb; i++) {
+        ids[i] = 1000 + 7 * i;
+    }
+
+    faiss::IndexFlatL2 quantizer(d);
+    faiss::IndexIVFFlat index(&quantizer, d, 32);
+    index.train(nb, xb.data());
+    index.set_direct_map_type(faiss::DirectMap::Hashtable);
+    index.add_with_ids(nb / 2, xb.data(), ids.data());
+    index.add_with_ids(
+            nb - nb / 2, xb.data() + nb / 2 * d, ids.data() + nb / 2);
+
+    std::vector<float> recons(nb * d);
+    index.reconstruct_batch(nb, ids.data(), recons.data());
+    EXPECT_EQ(recons, xb);
+
+    // remove every third vector, the others are still found
+    std::vector<faiss::idx_t> removed;
+    for (int i = 0; i < nb; i += 3) {
+        removed.push_back(ids[i]);
+    }
+    faiss::IDSelectorArray sel(removed.size(), removed.data());
+    EXPECT_EQ(index.remove_ids(sel), removed.size());
+    EXPECT_THROW(
+            index.reconstruct(ids[0], recons.data()), faiss::FaissException);
+
+    faiss::VectorIOWriter writer;
+    faiss::write_index(&index, &writer);
+    faiss::VectorIOReader reader;
+    reader.data = writer.data;
+    std::unique_ptr<faiss::Index> index2(faiss::read_index(&reader));
+    auto ivf2 = dynamic_cast<faiss::IndexIVF*>(index2.get());
+    EXPECT_EQ(ivf2->direct_map.hashtable.size(), nb - removed.size());
+
+    for (int i = 0; i < nb; i++) {
+        if (i % 3 == 0) {
+            continue;
+        }
+        std::vector<float> v(d);
+        index2->reconstruct(ids[i], v.data());
+        EXPECT_TRUE(std::equal(v.begin(), v.end(), xb.begin() + i * d));
+    }
+}
@@ -19,6 +19,8 @@
 #include <faiss/IndexIVFPQ.h>
 #include <faiss/IndexPreTransform.h>
 #include <faiss/MetaIndexes.h>
+#include <faiss/clone_index.h>
+#include <faiss/index_factory.h>
 #include <faiss/invlists/OnDiskInvertedLists.h>
 
 namespace {
@@ -90,7 +92,8 @@ CommonData cd;
 int compare_merged(
         faiss::IndexShards* index_shards,
         bool shift_ids,
-        bool standard_merge = true) {
+        bool standard_merge = true,
+        size_t merge_stripe_bytes = 64 << 20) {
     std::vector<idx_t> refI(k * nq);
     std::vector<float> refD(k * nq);
 
@@ -124,6 +127,7 @@ int compare_merged(
 
         auto il = new faiss::OnDiskInvertedLists(
                 index0->nlist, index0->code_size, filename.c_str());
+        il->merge_stripe_bytes = merge_stripe_bytes;
 
         il->merge_from(lists.data(), lists.size());
 
@@ -245,3 +249,117 @@ TEST(MERGE, merge_flat_ondisk_2) {
     int ndiff = compare_merged(&index_shards, false, false);
     EXPECT_GE(0, ndiff);
 }
+
+// merge from ondisk shards, with many stripes
+TEST(MERGE, merge_flat_ondisk_striped) {
+    faiss::IndexShards index_shards(d, false, false);
+    index_shards.own_indices = true;
+    std::vector<Tempfilename> filenames(nindex);
+
+    for (int i = 0; i < nindex; i++) {
+        auto ivf = new faiss::IndexIVFFlat(&cd.quantizer, d, nlist);
+        auto il = new faiss::OnDiskInvertedLists(
+                ivf->nlist, ivf->code_size, filenames[i].c_str());
+        ivf->replace_invlists(il, true);
+        index_shards.add_shard(ivf);
+    }
+    index_shards.add_with_ids(nb, cd.database.data(), cd.ids.data());
+    int ndiff = compare_merged(&index_shards, false, false, 1000);
+    EXPECT_EQ(ndiff, 0);
+}
+
+// sharing the k-th distances between shards does not change the results
+namespace {
+
+void compare_shared_bounds(faiss::IndexShards& index_shards, int k) {
+    std::vector<idx_t> refI(k * nq), newI(k * nq);
+    std::vector<float> refD(k * nq), newD(k * nq);
+    index_shards.share_bounds = false;
+    index_shards.search(nq, cd.queries.data(), k, refD.data(), refI.data());
+    index_shards.share_bounds = true;
+    index_shards.search(nq, cd.queries.data(), k, newD.data(), newI.data());
+
+    EXPECT_EQ(refI, newI);
+    EXPECT_EQ(refD, newD);
+}
+
+} // namespace
+
+TEST(MERGE, shards_shared_bounds) {
+    faiss::IndexShards index_shards(d, false, false);
+    index_shards.own_indices = true;
+
+    for (int i = 0; i < nindex; i++) {
+        auto ivf = new faiss::IndexIVFFlat(&cd.quantizer, d, nlist);
+        ivf->nprobe = 4;
+        index_shards.add_shard(ivf);
+    }
+    index_shards.add_with_ids(nb, cd.database.data(), cd.ids.data());
+
+    for (int k1 : {1, k}) {
+        compare_shared_bounds(index_shards, k1);
+    }
+}
+
+// the shard that holds the whole top-k must keep its results after
+// publishing the bound
+TEST(MERGE, shards_shared_bounds_one_shard) {
+    faiss::IndexShards index_shards(d, false, false);
+    index_shards.own_indices = true;
+
+    std::vector<float> far(cd.database);
+    for (auto& v : far) {
+        v += 10;
+    }
+    for (int i = 0; i < nindex; i++) {
+        auto ivf = new faiss::IndexIVFFlat(&cd.quantizer, d, nlist);
+        ivf->nprobe = 4;
+        std::vector<idx_t> ids(nb);
+        for (size_t j = 0; j < nb; j++) {
+            ids[j] = j * nindex + i;
+        }
+        ivf->add_with_ids(
+                nb, i == 0 ? cd.database.data() : far.data(), ids.data());
+        index_shards.add_shard(ivf);
+    }
+    index_shards.syncWithSubIndexes();
+
+    for (int k1 : {1, k}) {
+        compare_shared_bounds(index_shards, k1);
+        std::vector<idx_t> I(k1 * nq);
+        std::vector<float> D(k1 * nq);
+        index_shards.search(nq, cd.queries.data(), k1, D.data(), I.data());
+        for (idx_t id : I) {
+            EXPECT_EQ(id % nindex, 0);
+        }
+    }
+}
+
+// the fast-scan IVF indexes do not get the shared bounds (some of them
+// reject search parameters)
+TEST(MERGE, shards_fast_scan) {
+    for (const char* index_key : {"IVF16,RQ3x4fs_Nrq2x4", "IVF16,PQ8x4fs"}) {
+        std::unique_ptr<faiss::Index> trained(
+                faiss::index_factory(d, index_key));
+        trained->train(nb, cd.database.data());
+
+        faiss::IndexShards index_shards(d, false, false);
+        index_shards.own_indices = true;
+        for (int i = 0; i < nindex; i++) {
+            index_shards.add_shard(faiss::clone_index(trained.get()));
+        }
+        index_shards.add_with_ids(nb, cd.database.data(), cd.ids.data());
+
+        std::vector<idx_t> refI(k * nq), newI(k * nq);
+        std::vector<float> refD(k * nq), newD(k * nq);
+        index_shards.share_bounds = false;
+        index_shards.search(
+                nq, cd.queries.data(), k, refD.data(), refI.data());
+        index_shards.share_bounds = true;
+        index_shards.search(
+                nq, cd.queries.data(), k, newD.data(), newI.data());
+
+        EXPECT_EQ(refI, newI);
+        EXPECT_EQ(refD, newD);
+    }
+}
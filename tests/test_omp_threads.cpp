@@ -7,8 +7,228 @@
 
 #include <gtest/gtest.h>
 
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <faiss/IndexFlat.h>
+#include <faiss/IndexHNSW.h>
+#include <faiss/IndexIVFFlat.h>
+#include <faiss/OMPConfig.h>
+#include <faiss/impl/AuxIndexStructures.h>
+#include <faiss/utils/distances.h>
+#include <faiss/utils/random.h>
 #include <faiss/utils/utils.h>
 
 TEST(Threading, openmp) {
     EXPECT_TRUE(faiss::check_openmp());
 }
+
+TEST(Threading, thread_pool_executor) {
+    faiss::ThreadPoolExecutor pool(4);
+    EXPECT_EQ(pool.num_threads(), 4);
+
+    std::vector<std::atomic<int>> counts(1000);
+    pool.run(counts.size(), [&](int64_t i) { counts[i]++; });
+    for (auto& c : counts) {
+        EXPECT_EQ(c, 1);
+    }
+
+    EXPECT_THROW(
+            pool.run(10,
+                     [](int64_t i) {
+                         if (i == 3) {
+                             throw std::runtime_error("task 3");
+                         }
+                     }),
+            std::runtime_error);
+}
+
+// the search results are the same with an external executor, also when
+// searches are issued concurrently
+TEST(Threading, search_executor) {
+    int d = 16, nb = 2000, nq = 50, k = 5;
+    std::vector<float> xb(nb * d), xq(nq * d);
+    faiss::float_rand(xb.data(), xb.size(), 123);
+    faiss::float_rand(xq.data(), xq.size(), 456);
+
+    faiss::IndexFlatL2 quantizer(d);
+    std::vector<std::unique_ptr<faiss::Index>> indexes;
+    indexes.emplace_back(new faiss::IndexFlatL2(d));
+    auto ivf = new faiss::IndexIVFFlat(&quantizer, d, 16);
+    ivf->nprobe = 4;
+    indexes.emplace_back(ivf);
+    indexes.emplace_back(new faiss::IndexHNSWFlat(d, 16));
+    for (auto& index : indexes) {
+        index->train(nb, xb.data());
+        index->add(nb, xb.data());
+    }
+
+    faiss::ThreadPoolExecutor pool(3);
+
+    for (auto& index : indexes) {
+        std::vector<float> refD(nq * k);
+        std::vector<faiss::idx_t> refI(nq * k);
+        index->search(nq, xq.data(), k, refD.data(), refI.data());
+
+        faiss::set_search_executor(&pool);
+        int nthread = 4;
+        std::vector<std::vector<faiss::idx_t>> allI(
+                nthread, std::vector<faiss::idx_t>(nq * k));
+        std::vector<std::thread> threads;
+        for (int t = 0; t < nthread; t++) {
+            threads.emplace_back([&, t]() {
+                std::vector<float> D(nq * k);
+                index->search(nq, xq.data(), k, D.data(), allI[t].data());
+            });
+        }
+        for (auto& th : threads) {
+            th.join();
+        }
+        faiss::set_search_executor(nullptr);
+
+        for (int t = 0; t < nthread; t++) {
+            EXPECT_EQ(allI[t], refI);
+        }
+    }
+}
+
+// the IVF parallel modes that split the queries or the probes over threads
+// also run on the executor
+TEST(Threading, search_executor_ivf_parallel_modes) {
+    int d = 16, nb = 2000, nq = 20, k = 5;
+    std::vector<float> xb(nb * d), xq(nq * d);
+    faiss::float_rand(xb.data(), xb.size(), 123);
+    faiss::float_rand(xq.data(), xq.size(), 456);
+
+    faiss::IndexFlatL2 quantizer(d);
+    faiss::IndexIVFFlat index(&quantizer, d, 16);
+    index.nprobe = 4;
+    index.train(nb, xb.data());
+    index.add(nb, xb.data());
+    float radius = 1.0;
+
+    faiss::ThreadPoolExecutor pool(3);
+
+    for (int pmode : {0, 1, 2, 3}) {
+        index.parallel_mode = pmode;
+        std::vector<float> refD(nq * k), D(nq * k);
+        std::vector<faiss::idx_t> refI(nq * k), I(nq * k);
+        faiss::RangeSearchResult refres(nq), res(nq);
+
+        index.search(nq, xq.data(), k, refD.data(), refI.data());
+        if (pmode != 3) {
+            index.range_search(nq, xq.data(), radius, &refres);
+        }
+
+        faiss::set_search_executor(&pool);
+        index.search(nq, xq.data(), k, D.data(), I.data());
+        if (pmode != 3) {
+            index.range_search(nq, xq.data(), radius, &res);
+        }
+        faiss::set_search_executor(nullptr);
+
+        EXPECT_EQ(I, refI);
+        EXPECT_EQ(D, refD);
+        if (pmode == 3) {
+            continue;
+        }
+        EXPECT_GT(refres.lims[nq], 0);
+        for (int i = 0; i < nq; i++) {
+            std::vector<faiss::idx_t> refids(
+                    refres.labels + refres.lims[i],
+                    refres.labels + refres.lims[i + 1]);
+            std::vector<faiss::idx_t> ids(
+                    res.labels + res.lims[i], res.labels + res.lims[i + 1]);
+            std::sort(refids.begin(), refids.end());
+            std::sort(ids.begin(), ids.end());
+            EXPECT_EQ(ids, refids);
+        }
+    }
+}
+
+namespace {
+
+// counts the parallel loops that run on the executor
+struct CountingExecutor : faiss::Executor {
+    faiss::ThreadPoolExecutor pool{3};
+    std::atomic<int> nrun{0};
+
+    void run(int64_t ntask, const std::function<void(int64_t)>& task)
+            override {
+        nrun++;
+        pool.run(ntask, task);
+    }
+
+    int num_threads() const override {
+        return pool.num_threads();
+    }
+};
+
+} // namespace
+
+// the BLAS distance loops, IndexFlat1D and the HNSW level-0 search do not
+// open OpenMP regions when an executor is installed
+TEST(Threading, search_executor_no_openmp) {
+    int d = 16, nb = 2000, nq = 50, n1d = 20000;
+    std::vector<float> xb(nb * d), xq(nq * d), x1d(n1d);
+    faiss::float_rand(xb.data(), xb.size(), 123);
+    faiss::float_rand(xq.data(), xq.size(), 456);
+    faiss::float_rand(x1d.data(), x1d.size(), 789);
+
+    faiss::IndexFlatL2 flat(d);
+    flat.add(nb, xb.data());
+    faiss::IndexFlat1D flat1d;
+    flat1d.add(nb, xb.data());
+    faiss::IndexHNSWFlat hnsw(d, 16);
+    hnsw.add(nb, xb.data());
+    std::vector<faiss::HNSW::storage_idx_t> nearest(
+            nq, hnsw.hnsw.entry_point);
+    std::vector<float> nearest_d(nq);
+    for (int i = 0; i < nq; i++) {
+        nearest_d[i] = faiss::fvec_L2sqr(
+                xq.data() + i * d, xb.data() + nearest[i] * d, d);
+    }
+
+    // k = 1 takes the specialized BLAS loop
+    std::vector<std::function<void(float*, faiss::idx_t*)>> searches = {
+            [&](float* D, faiss::idx_t* I) {
+                flat.search(nq, xq.data(), 5, D, I);
+            },
+            [&](float* D, faiss::idx_t* I) {
+                flat.search(nq, xq.data(), 1, D, I);
+            },
+            [&](float* D, faiss::idx_t* I) {
+                flat1d.search(n1d, x1d.data(), 1, D, I);
+            },
+            [&](float* D, faiss::idx_t* I) {
+                hnsw.search_level_0(
+                        nq,
+                        xq.data(),
+                        5,
+                        nearest.data(),
+                        nearest_d.data(),
+                        D,
+                        I);
+            }};
+
+    CountingExecutor executor;
+    for (auto& search : searches) {
+        std::vector<float> refD(n1d * 5), D(n1d * 5);
+        std::vector<faiss::idx_t> refI(n1d * 5), I(n1d * 5);
+        search(refD.data(), refI.data());
+
+        executor.nrun = 0;
+        faiss::set_search_executor(&executor);
+        search(D.data(), I.data());
+        faiss::set_search_executor(nullptr);
+
+        EXPECT_GT(executor.nrun, 0);
+        EXPECT_EQ(I, refI);
+        EXPECT_EQ(D, refD);
+    }
+}
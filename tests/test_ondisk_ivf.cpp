@@ -19,6 +19,7 @@
 
 #include <faiss/IndexFlat.h>
 #include <faiss/IndexIVFFlat.h>
+#include <faiss/impl/FaissAssert.h>
 #include <faiss/index_io.h>
 #include <faiss/invlists/OnDiskInvertedLists.h>
 #include <faiss/utils/random.h>
@@ -205,3 +206,22 @@ TEST(ONDISK, make_invlists_threaded) {
     }
     EXPECT_EQ(ntot, nadd);
 }
+
+TEST(ONDISK, merge_from_read_only) {
+    int nlist = 10;
+    int code_size = 8;
+
+    faiss::ArrayInvertedLists src(nlist, code_size);
+    std::vector<uint8_t> code(code_size);
+    src.add_entry(3, 0, code.data());
+    const faiss::InvertedLists* ils[] = {&src};
+
+    Tempfilename filename;
+    faiss::OnDiskInvertedLists ivf(nlist, code_size, filename.c_str());
+    ivf.read_only = true;
+    EXPECT_THROW(ivf.merge_from(ils, 1), faiss::FaissException);
+
+    ivf.read_only = false;
+    EXPECT_EQ(ivf.merge_from(ils, 1), 1);
+    EXPECT_EQ(ivf.list_size(3), 1);
+}
@@ -7,8 +7,10 @@
 
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
 
 #include <memory>
+#include <mutex>
 #include <random>
 #include <vector>
 
@@ -17,6 +19,7 @@
 #include <faiss/AutoTune.h>
 #include <faiss/IVFlib.h>
 #include <faiss/IndexBinaryIVF.h>
+#include <faiss/IndexHNSW.h>
 #include <faiss/IndexIVF.h>
 #include <faiss/clone_index.h>
 #include <faiss/impl/AuxIndexStructures.h>
@@ -156,6 +159,49 @@ int test_selector(const char* index_key) {
     return 0;
 }
 
+/*************************************************************
+ * Test per-query stats
+ *************************************************************/
+
+struct CountingTracer : SearchTracer {
+    std::vector<int> counts;
+    std::vector<size_t> ndis;
+    std::mutex mutex;
+
+    explicit CountingTracer(size_t n) : counts(n), ndis(n) {}
+
+    void on_query(idx_t q, const QueryStats& stats) override {
+        std::lock_guard<std::mutex> lock(mutex);
+        counts[q]++;
+        ndis[q] = stats.ndis;
+    }
+};
+
+// returns the per-query stats of a search with params, and checks that the
+// results are the same as without stats
+SearchStats search_with_stats(
+        Index* index,
+        const float* xq,
+        SearchParameters* params) {
+    auto ref_result = search_index(index, xq);
+    int k = 10;
+    std::vector<idx_t> I(k * nq);
+    std::vector<float> D(k * nq);
+    SearchStats stats;
+    CountingTracer tracer(nq);
+    stats.tracer = &tracer;
+    params->stats = &stats;
+    index->search(nq, xq, k, D.data(), I.data(), params);
+    params->stats = nullptr;
+    EXPECT_EQ(ref_result, I);
+    EXPECT_EQ(stats.queries.size(), nq);
+    for (size_t q = 0; q < nq; q++) {
+        EXPECT_EQ(tracer.counts[q], 1);
+        EXPECT_EQ(tracer.ndis[q], stats.queries[q].ndis);
+    }
+    return stats;
+}
+
 } // namespace
 
 /*************************************************************
@@ -285,3 +331,54 @@ TEST(TPOB, IVF) {
     int err1 = test_params_override_binary("BIVF32");
     EXPECT_EQ(err1, 0);
 }
+
+TEST(TSTATS, IVFFlat) {
+    std::vector<float> xb = make_data(nb);
+    std::vector<float> xq = make_data(nq);
+    auto index = make_index("IVF32,Flat", METRIC_L2, xb);
+    auto index_ivf = dynamic_cast<IndexIVF*>(index.get());
+    index_ivf->nprobe = 4;
+
+    IVFSearchParameters params;
+    params.nprobe = 4;
+    indexIVF_stats.reset();
+    SearchStats stats = search_with_stats(index.get(), xq.data(), &params);
+    QueryStats tot = stats.total();
+    // the global stats also count the reference search
+    EXPECT_EQ(tot.ndis * 2, indexIVF_stats.ndis);
+    EXPECT_EQ(tot.nvisited, nq * 4);
+    EXPECT_EQ(tot.nbytes, tot.ndis * (index_ivf->code_size + sizeof(idx_t)));
+
+    // the per-query counters do not depend on the parallel mode
+    for (int pmode : {1, 2}) {
+        index_ivf->parallel_mode = pmode;
+        SearchStats stats_pmode =
+                search_with_stats(index.get(), xq.data(), &params);
+        for (size_t q = 0; q < nq; q++) {
+            EXPECT_EQ(stats_pmode.queries[q].ndis, stats.queries[q].ndis);
+            EXPECT_EQ(
+                    stats_pmode.queries[q].nvisited,
+                    stats.queries[q].nvisited);
+        }
+    }
+}
+
+TEST(TSTATS, HNSWAndFlat) {
+    std::vector<float> xb = make_data(nb);
+    std::vector<float> xq = make_data(nq);
+    for (const char* index_key : {"HNSW16", "Flat"}) {
+        auto index = make_index(index_key, METRIC_L2, xb);
+        SearchParametersHNSW params_hnsw;
+        params_hnsw.efSearch = 16;
+        SearchParameters params_flat;
+        SearchParameters* params = strcmp(index_key, "Flat") == 0
+                ? &params_flat
+                : &params_hnsw;
+        SearchStats stats = search_with_stats(index.get(), xq.data(), params);
+        for (const QueryStats& qs : stats.queries) {
+            EXPECT_GT(qs.ndis, 0);
+            EXPECT_LE(qs.ndis, nb);
+            EXPECT_EQ(qs.nbytes, qs.ndis * d * sizeof(float));
+        }
+    }
+}
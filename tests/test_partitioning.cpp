@@ -7,7 +7,10 @@
 
 #include <gtest/gtest.h>
 
+#include <vector>
+
 #include <faiss/utils/AlignedTable.h>
+#include <faiss/utils/ordered_key_value.h>
 #include <faiss/utils/partitioning.h>
 
 using namespace faiss;
@@ -31,3 +34,46 @@ TEST(TestPartitioning, TestPartitioningBigRange) {
         ASSERT_EQ(hist[i], 64);
     }
 }
+
+TEST(TestPartitioning, TestFilterByThreshold) {
+    std::vector<float> vals(1000);
+    for (int i = 0; i < vals.size(); i++) {
+        vals[i] = (i * 7919) % 1000;
+    }
+    std::vector<float> out_vals(vals.size());
+    std::vector<int64_t> out_ids(vals.size());
+    // odd sizes to exercise the scalar tail
+    size_t n = filter_by_threshold<CMax<float, int64_t>>(
+            vals.data() + 3,
+            990,
+            100,
+            3,
+            out_vals.data(),
+            out_ids.data());
+    size_t nref = 0;
+    for (int i = 3; i < 993; i++) {
+        if (vals[i] < 100) {
+            ASSERT_EQ(out_vals[nref], vals[i]);
+            ASSERT_EQ(out_ids[nref], i);
+            nref++;
+        }
+    }
+    ASSERT_EQ(n, nref);
+
+    n = filter_by_threshold<CMin<float, int64_t>>(
+            vals.data(), 1000, 900, 0, out_vals.data(), out_ids.data());
+    ASSERT_EQ(n, 99);
+    for (int i = 0; i < n; i++) {
+        ASSERT_GT(out_vals[i], 900);
+        ASSERT_EQ(vals[out_ids[i]], out_vals[i]);
+    }
+
+    // every element kept: the compacted blocks are written back to back
+    n = filter_by_threshold<CMax<float, int64_t>>(
+            vals.data(), 1000, 1000, 0, out_vals.data(), out_ids.data());
+    ASSERT_EQ(n, 1000);
+    ASSERT_EQ(out_vals, vals);
+    for (int i = 0; i < n; i++) {
+        ASSERT_EQ(out_ids[i], i);
+    }
+}
@@ -260,6 +260,29 @@ class TestResidualQuantizer(unittest.TestCase):
         for c0, c1 in zip(cb0, cb1):
             self.assertTrue(np.all(c0 == c1))
 
+    def test_encode_by_chunks(self):
+        """ the encoding is done by chunks: make sure the chunk size does not
+        change the codes and that the per-step stats are collected """
+        ds = datasets.SyntheticDataset(32, 3000, 1000, 0)
+        xb = ds.get_database()
+
+        rq = faiss.ResidualQuantizer(ds.d, 4, 6)
+        rq.train_type = faiss.ResidualQuantizer.Train_default
+        rq.max_beam_size = 5
+        rq.train(ds.get_train())
+        codes0 = rq.compute_codes(xb)
+
+        stats = faiss.cvar.residual_quantizer_stats
+        stats.reset()
+        rq.max_mem_distances = 10 * rq.memory_per_point()
+        codes1 = rq.compute_codes(xb)
+        np.testing.assert_array_equal(codes0, codes1)
+
+        self.assertEqual(stats.nvec, ds.nb)
+        self.assertEqual(stats.step_ndis.size(), rq.M)
+        for m in range(rq.M):
+            self.assertGreater(stats.step_ndis.at(m), 0)
+
     def test_clipping(self):
         """ verify that a clipped residual quantizer gives the same
         code prefix + suffix as the full RQ """
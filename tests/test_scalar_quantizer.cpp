@@ -0,0 +1,85 @@
+/**
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <cmath>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <faiss/IndexScalarQuantizer.h>
+#include <faiss/impl/DistanceComputer.h>
+#include <faiss/utils/distances.h>
+
+namespace {
+
+// query_to_code must match the distance to the decoded vector. The leftover
+// 16 components and, for d > 8192, the intermediate reductions of the
+// integer accumulators are covered.
+void test_query_to_code(
+        faiss::ScalarQuantizer::QuantizerType qtype,
+        faiss::MetricType metric,
+        int d) {
+    size_t nt = 200, nb = 50, nq = 5;
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<float> distrib(-1, 1);
+    std::vector<float> xt(nt * d), xq(nq * d);
+    for (auto& v : xt) {
+        v = distrib(rng);
+    }
+    for (auto& v : xq) {
+        v = distrib(rng);
+    }
+
+    faiss::IndexScalarQuantizer index(d, qtype, metric);
+    index.train(nt, xt.data());
+    index.add(nb, xt.data());
+    std::vector<float> decoded(nb * d);
+    index.sa_decode(nb, index.codes.data(), decoded.data());
+
+    std::unique_ptr<faiss::FlatCodesDistanceComputer> dc(
+            index.get_FlatCodesDistanceComputer());
+    for (size_t q = 0; q < nq; q++) {
+        const float* x = xq.data() + q * d;
+        dc->set_query(x);
+        for (size_t i = 0; i < nb; i++) {
+            const float* y = decoded.data() + i * d;
+            float ref = metric == faiss::METRIC_L2
+                    ? faiss::fvec_L2sqr(x, y, d)
+                    : faiss::fvec_inner_product(x, y, d);
+            float tol = 1e-4 *
+                    (faiss::fvec_norm_L2sqr(x, d) +
+                     faiss::fvec_norm_L2sqr(y, d));
+            EXPECT_NEAR((*dc)(i), ref, tol);
+        }
+    }
+}
+
+} // namespace
+
+TEST(ScalarQuantizer, bf16_query_to_code) {
+    for (int d : {48, 64}) {
+        test_query_to_code(
+                faiss::ScalarQuantizer::QT_bf16, faiss::METRIC_L2, d);
+        test_query_to_code(
+                faiss::ScalarQuantizer::QT_bf16,
+                faiss::METRIC_INNER_PRODUCT,
+                d);
+    }
+}
+
+TEST(ScalarQuantizer, int8_sym_query_to_code) {
+    for (int d : {48, 64, 8208}) {
+        test_query_to_code(
+                faiss::ScalarQuantizer::QT_8bit_sym, faiss::METRIC_L2, d);
+        test_query_to_code(
+                faiss::ScalarQuantizer::QT_8bit_sym,
+                faiss::METRIC_INNER_PRODUCT,
+                d);
+    }
+}
@@ -389,6 +389,58 @@ class TestSearchParams(unittest.TestCase):
         self.assertTrue(sel2.this.own())
 
 
+class TestApproxTopK(unittest.TestCase):
+
+    def do_test(self, index_key, params_class, metric=faiss.METRIC_L2,
+                use_sel=False, **kwargs):
+        ds = datasets.SyntheticDataset(
+            32, 2000, 5000, 20,
+            metric="L2" if metric == faiss.METRIC_L2 else "IP")
+        index = faiss.index_factory(ds.d, index_key, metric)
+        index.train(ds.get_train())
+        index.add(ds.get_database())
+        k = 200
+        params = params_class(**kwargs)
+        if use_sel:
+            sel = faiss.IDSelectorBatch(np.arange(0, ds.nb, 2))
+            params.sel = sel
+        Dref, Iref = index.search(ds.get_queries(), k, params=params)
+
+        params.approx_topk_recall = 0.9
+        Dnew, Inew = index.search(ds.get_queries(), k, params=params)
+
+        # the results are sorted and are a subset of the exact distances
+        if metric == faiss.METRIC_L2:
+            self.assertTrue(np.all(Dnew[:, 1:] >= Dnew[:, :-1]))
+        else:
+            self.assertTrue(np.all(Dnew[:, 1:] <= Dnew[:, :-1]))
+        if use_sel:
+            self.assertTrue(np.all(Inew % 2 == 0))
+        recall = np.mean([
+            len(np.intersect1d(Iref[q], Inew[q])) / k
+            for q in range(ds.nq)
+        ])
+        self.assertGreater(recall, 0.85)
+
+    def test_Flat(self):
+        self.do_test("Flat", faiss.SearchParameters)
+
+    def test_Flat_IP(self):
+        self.do_test(
+            "Flat", faiss.SearchParameters, metric=faiss.METRIC_INNER_PRODUCT)
+
+    def test_Flat_sel(self):
+        self.do_test("Flat", faiss.SearchParameters, use_sel=True)
+
+    def test_IVFFlat(self):
+        self.do_test("IVF16,Flat", faiss.SearchParametersIVF, nprobe=4)
+
+    def test_IVFSQ_IP_sel(self):
+        self.do_test(
+            "IVF16,SQ8", faiss.SearchParametersIVF,
+            metric=faiss.METRIC_INNER_PRODUCT, use_sel=True, nprobe=4)
+
+
 class TestSelectorCallback(unittest.TestCase):
 
     def test(self):
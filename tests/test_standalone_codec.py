@@ -56,6 +56,12 @@ class TestEncodeDecode(unittest.TestCase):
     def test_SQ8(self):
         self.do_encode_twice('SQ8')
 
+    def test_SQbf16(self):
+        self.do_encode_twice('SQbf16')
+
+    def test_SQ8sym(self):
+        self.do_encode_twice('SQ8sym')
+
     def test_IVFSQ8(self):
         self.do_encode_twice('IVF256,SQ8')
 
@@ -174,6 +180,12 @@ class TestAccuracy(unittest.TestCase):
     def test_SQ3(self):
         self.compare_accuracy('SQ8', 'SQfp16')
 
+    def test_SQ4(self):
+        self.compare_accuracy('SQ8sym', 'SQbf16')
+
+    def test_SQ5(self):
+        self.compare_accuracy('SQbf16', 'SQfp16')
+
     def test_PQ(self):
         self.compare_accuracy('PQ6x8np', 'PQ8x8np')
 
@@ -5,13 +5,19 @@
  * LICENSE file in the root directory of this source tree.
  */
 
+#include <faiss/IndexFlat.h>
 #include <faiss/IndexReplicas.h>
 #include <faiss/IndexShards.h>
 #include <faiss/impl/ThreadedIndex.h>
+#include <faiss/utils/numa.h>
 
 #include <gtest/gtest.h>
+#include <atomic>
 #include <chrono>
+#include <condition_variable>
+#include <functional>
 #include <memory>
+#include <mutex>
 #include <thread>
 #include <vector>
 
@@ -211,6 +217,272 @@ TEST(ThreadedIndex, TestReplica) {
     }
 }
 
+namespace {
+
+/// returns the first component of each query as label, after a delay
+struct DelayIndex : public faiss::Index {
+    int usPerQuery;
+
+    DelayIndex(idx_t d, int usPerQuery)
+            : faiss::Index(d), usPerQuery(usPerQuery) {}
+
+    void add(idx_t n, const float* x) override {}
+
+    void search(
+            idx_t n,
+            const float* x,
+            idx_t k,
+            float* distances,
+            idx_t* labels,
+            const faiss::SearchParameters* params) const override {
+        std::this_thread::sleep_for(std::chrono::microseconds(usPerQuery * n));
+        for (idx_t i = 0; i < n * k; i++) {
+            labels[i] = idx_t(x[(i / k) * d]);
+            distances[i] = 0;
+        }
+    }
+
+    void reset() override {}
+};
+
+/// blocks the threads that wait on it until it is opened
+struct Gate {
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool is_open = false;
+
+    void open() {
+        std::lock_guard<std::mutex> lock(mutex);
+        is_open = true;
+        cv.notify_all();
+    }
+
+    void wait() {
+        std::unique_lock<std::mutex> lock(mutex);
+        cv.wait(lock, [this]() { return is_open; });
+    }
+};
+
+/// returns the first component of each query as label. The hooks run
+/// before and after each search call, numbered from 0, so that the tests
+/// decide which replica runs which micro-batch without relying on timing
+struct HookIndex : public faiss::Index {
+    mutable std::atomic<int> nCalls{0};
+    std::function<void(int)> before = [](int) {};
+    std::function<void(int)> after = [](int) {};
+
+    explicit HookIndex(idx_t d) : faiss::Index(d) {}
+
+    void add(idx_t n, const float* x) override {}
+
+    void search(
+            idx_t n,
+            const float* x,
+            idx_t k,
+            float* distances,
+            idx_t* labels,
+            const faiss::SearchParameters* params) const override {
+        int call = nCalls++;
+        before(call);
+        for (idx_t i = 0; i < n * k; i++) {
+            labels[i] = idx_t(x[(i / k) * d]);
+            distances[i] = 0;
+        }
+        after(call);
+    }
+
+    void reset() override {}
+};
+
+} // namespace
+
+TEST(ThreadedIndex, TestReplicaMicroBatches) {
+    int d = 2;
+    int n = 200;
+    int k = 3;
+    int bs = 10, nbatch = n / bs;
+
+    std::vector<float> x(n * d);
+    for (int i = 0; i < n; i++) {
+        x[i * d] = i;
+    }
+
+    // replica 2 is held on its first micro-batch until the other
+    // replicas have processed all the others
+    std::vector<std::unique_ptr<HookIndex>> idxs;
+    for (int i = 0; i < 3; i++) {
+        idxs.emplace_back(new HookIndex(d));
+    }
+    Gate slow_started, slow_release;
+    std::atomic<int> nfast{0};
+    idxs[2]->before = [&](int call) {
+        if (call == 0) {
+            slow_started.open();
+            slow_release.wait();
+        }
+    };
+    for (int i = 0; i < 2; i++) {
+        idxs[i]->before = [&](int) { slow_started.wait(); };
+        idxs[i]->after = [&](int) {
+            if (++nfast == nbatch - 1) {
+                slow_release.open();
+            }
+        };
+    }
+
+    faiss::IndexReplicas replica(d);
+    for (auto& idx : idxs) {
+        replica.addIndex(idx.get());
+    }
+    replica.micro_batch_size = bs;
+
+    std::vector<float> distances(n * k);
+    std::vector<faiss::idx_t> labels(n * k);
+    replica.search(n, x.data(), k, distances.data(), labels.data());
+
+    for (int i = 0; i < n * k; i++) {
+        EXPECT_EQ(labels[i], i / k);
+    }
+    // the idle replicas pulled the micro-batches of the busy one
+    EXPECT_EQ(idxs[2]->nCalls, 1);
+    EXPECT_EQ(idxs[0]->nCalls + idxs[1]->nCalls, nbatch - 1);
+    std::vector<double> latency = replica.get_replica_latency();
+    ASSERT_EQ(latency.size(), 3);
+    EXPECT_GT(latency[2], 0);
+}
+
+TEST(ThreadedIndex, TestReplicaMicroBatchesHedging) {
+    int d = 2;
+    int n = 200;
+    int k = 3;
+    int bs = 10, nbatch = n / bs;
+
+    std::vector<float> x(n * d);
+    for (int i = 0; i < n; i++) {
+        x[i * d] = i;
+    }
+
+    std::vector<std::unique_ptr<HookIndex>> idxs;
+    for (int i = 0; i < 3; i++) {
+        idxs.emplace_back(new HookIndex(d));
+    }
+
+    // first search: all the replicas get a micro-batch, and thus a
+    // latency estimate, because none can finish before the 3 started
+    std::mutex mutex;
+    std::condition_variable cv;
+    int nstarted = 0;
+    Gate stall_started, stall_release;
+    std::atomic<bool> stall_done{false};
+    for (auto& idx : idxs) {
+        idx->before = [&](int call) {
+            if (call == 0) {
+                std::unique_lock<std::mutex> lock(mutex);
+                nstarted++;
+                cv.notify_all();
+                cv.wait(lock, [&]() { return nstarted == 3; });
+            }
+        };
+    }
+
+    faiss::IndexReplicas replica(d);
+    for (auto& idx : idxs) {
+        replica.addIndex(idx.get());
+    }
+    replica.micro_batch_size = bs;
+    replica.hedge_factor = 3.0;
+
+    std::vector<float> distances(n * k);
+    std::vector<faiss::idx_t> labels(n * k);
+    replica.search(n, x.data(), k, distances.data(), labels.data());
+    for (double l : replica.get_replica_latency()) {
+        EXPECT_GT(l, 0);
+    }
+
+    // second search: replica 0 stalls on its first micro-batch until the
+    // search returned, the other replicas re-issue it
+    for (auto& idx : idxs) {
+        idx->nCalls = 0;
+    }
+    idxs[0]->before = [&](int call) {
+        if (call == 0) {
+            stall_started.open();
+            stall_release.wait();
+        }
+    };
+    idxs[0]->after = [&](int call) {
+        if (call == 0) {
+            stall_done = true;
+        }
+    };
+    for (int i = 1; i < 3; i++) {
+        idxs[i]->before = [&](int) { stall_started.wait(); };
+    }
+
+    std::fill(labels.begin(), labels.end(), -1);
+    replica.search(n, x.data(), k, distances.data(), labels.data());
+
+    EXPECT_FALSE(stall_done);
+    for (int i = 0; i < n * k; i++) {
+        EXPECT_EQ(labels[i], i / k);
+    }
+    // the other replicas ran all the micro-batches, including a re-issue
+    // of the stalled one
+    EXPECT_EQ(idxs[0]->nCalls, 1);
+    EXPECT_GE(idxs[1]->nCalls + idxs[2]->nCalls, nbatch);
+
+    // the straggler completes on its worker thread
+    stall_release.open();
+    while (!stall_done) {
+        std::this_thread::yield();
+    }
+}
+
+TEST(ThreadedIndex, TestReplicaMicroBatchesConcurrent) {
+    int d = 2;
+    int n = 100;
+    int k = 3;
+
+    std::vector<float> x(n * d);
+    for (int i = 0; i < n; i++) {
+        x[i * d] = i;
+    }
+
+    std::vector<std::unique_ptr<DelayIndex>> idxs;
+    for (int i = 0; i < 3; i++) {
+        idxs.emplace_back(new DelayIndex(d, 10));
+    }
+    faiss::IndexReplicas replica(d);
+    for (auto& idx : idxs) {
+        replica.addIndex(idx.get());
+    }
+    replica.micro_batch_size = 10;
+    replica.hedge_factor = 3.0;
+
+    // the latency estimates are shared by the concurrent searches
+    std::vector<std::thread> threads;
+    std::atomic<int> nerr{0};
+    for (int t = 0; t < 4; t++) {
+        threads.emplace_back([&]() {
+            std::vector<float> distances(n * k);
+            std::vector<faiss::idx_t> labels(n * k);
+            for (int rep = 0; rep < 5; rep++) {
+                replica.search(
+                        n, x.data(), k, distances.data(), labels.data());
+                for (int i = 0; i < n * k; i++) {
+                    if (labels[i] != i / k) {
+                        nerr++;
+                    }
+                }
+            }
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    EXPECT_EQ(nerr, 0);
+}
+
 TEST(ThreadedIndex, TestShards) {
     int numShards = 7;
     int d = 3;
@@ -258,3 +530,43 @@ TEST(ThreadedIndex, TestShards) {
         }
     }
 }
+
+TEST(ThreadedIndex, TestNumaBinding) {
+    int d = 8;
+    int nb = 1000;
+    int nq = 20;
+    int k = 4;
+
+    EXPECT_GE(faiss::numa_num_nodes(), 1);
+    EXPECT_FALSE(faiss::numa_node_cpus(0).empty());
+
+    std::vector<float> xb(nb * d), xq(nq * d);
+    for (int i = 0; i < xb.size(); i++) {
+        xb[i] = (i * 7919) % 1000 / 1000.0;
+    }
+    for (int i = 0; i < xq.size(); i++) {
+        xq[i] = (i * 104729) % 1000 / 1000.0;
+    }
+
+    faiss::IndexReplicas replica(d);
+    replica.own_indices = true;
+    for (int i = 0; i < 3; i++) {
+        auto index = new faiss::IndexFlatL2(d);
+        index->add(nb, xb.data());
+        replica.add_replica(index);
+    }
+
+    std::vector<float> refD(nq * k), newD(nq * k);
+    std::vector<faiss::idx_t> refI(nq * k), newI(nq * k);
+    replica.search(nq, xq.data(), k, refD.data(), refI.data());
+
+    auto flat = dynamic_cast<faiss::IndexFlatL2*>(replica.at(1));
+    const uint8_t* codes = flat->codes.data();
+    replica.spreadOverNumaNodes();
+    // the storage was re-allocated from the worker thread
+    EXPECT_NE(codes, flat->codes.data());
+
+    replica.search(nq, xq.data(), k, newD.data(), newI.data());
+    EXPECT_EQ(refI, newI);
+    EXPECT_EQ(refD, newD);
+}